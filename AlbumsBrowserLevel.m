@@ -93,16 +93,33 @@
 	NSAttributedString *displayString = [RKBrowserLevel formatBrowserTextForDisplay:string isSelected:isSelected dividerString:@"\n"];
 	[cell setAttributedStringValue:displayString];
 	
-	NSImage *artworkImage = nil;
-    if([[self.parentBrowser window] inLiveResize])
+	//Artwork is never read from disk here. Rows whose artwork isn't
+	//in memory yet are redrawn once it has been loaded in the background.
+	NSImage *artworkImage = [[ArtworkCache sharedArtworkCache] cachedArtworkForItem:item size:kArtworkSizeSmall];
+	if(!artworkImage)
+	{
+		if(![[self.parentBrowser window] inLiveResize])
+		{
+			[[ArtworkCache sharedArtworkCache] loadArtworkForItems:@[item] size:kArtworkSizeSmall completionHandler:^(id loadedItem) {
+				[self redisplayRowsForItems:@[loadedItem]];
+			}];
+		}
+		
 		artworkImage = [NSImage imageNamed:@"NoArtwork"];
-    else
-		artworkImage = [[ArtworkCache sharedArtworkCache] artworkForAlbum:item] ?: [NSImage imageNamed:@"NoArtwork"];
-    [artworkImage setSize:NSMakeSize(32.0, 32.0)];
+		[artworkImage setSize:NSMakeSize(32.0, 32.0)];
+	}
     [cell setImage:artworkImage];
 	[cell setStylizesImage:YES];
 }
 
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows
+{
+	NSArray *albums = [self displayedItemsInRows:[self prefetchRowsForVisibleRows:visibleRows]];
+	[[ArtworkCache sharedArtworkCache] prefetchArtworkForItems:albums size:kArtworkSizeSmall completionHandler:^(id loadedItem) {
+		[self redisplayRowsForItems:@[loadedItem]];
+	}];
+}
+
 - (NSImage *)hoverButtonImageForItem:(id)item
 {
 	return [NSImage imageNamed:@"PlayItemButton"];
@@ -22,6 +22,7 @@
 #import "PlayerApplication.h"
 #import "LastFMSession.h"
 #import "LastFMDefines.h"
+#import "ScrobbleQueue.h"
 
 #import "ExfmSession.h"
 #import "Library.h"
@@ -34,9 +35,14 @@
 #import "Song.h"
 
 static NSString *const kShowSongChangeNotificationsDefaultsKey = @"ShowSongChangeNotifications";
+static NSString *const kScrobblePlayedSongsDefaultsKey = @"ScrobblePlayedSongsAndUpdateNowPlaying";
 static NSString *const kHasShownDownloadPlayKeysAlertDefaultsKey = @"HasShownDownloadPlayKeysAlert";
 static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey = @"AlwaysShowSongChangeNotificationsWithoutGrowl";
 
+//These are read on every song change, so they're cached rather than read from the user defaults each time.
+static RK_DEFINE_SETTING(ShowSongChangeNotificationsSetting, kShowSongChangeNotificationsDefaultsKey, kRKSettingTypeBool)
+static RK_DEFINE_SETTING(ScrobblePlayedSongsSetting, kScrobblePlayedSongsDefaultsKey, kRKSettingTypeBool)
+
 #pragma mark -
 
 @implementation AppDelegate
@@ -200,10 +206,16 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
 		if(returnCode != NSAlertAlternateReturn)
 		{
 			ExfmSession *exFMSession = [ExfmSession defaultSession];
+			Library *library = [Library sharedLibrary];
 			NSArray *songPromises = RKCollectionMapToArray(exFMSongIdentifiers, ^id(NSString *identifier) {
 				if([identifier rangeOfString:@"$"].location != NSNotFound)
 					return [[SongQueryPromise alloc] initWithIdentifier:identifier];
 				
+				//Songs already in the library don't need a round trip to Ex.fm.
+				Song *librarySong = [library songWithSourceIdentifier:identifier];
+				if(librarySong && [[library exFMIdentifierForSong:librarySong] isEqualToString:identifier])
+					return [RKPromise acceptedPromiseWithValue:librarySong];
+				
 				return [exFMSession songWithID:identifier];
 			});
 			[[RKPromise when:songPromises] then:^(NSArray *possibilities) {
@@ -304,11 +316,25 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
 
 - (void)applicationWillTerminate:(NSNotification *)notification
 {
+	RKSettingsFlushPendingWrites();
+	
 	if(!RKProcessIsRunningInDebugger())
 	{
 		[[NSDistributedNotificationCenter defaultCenter] postNotificationName:@"com.roundabout.PlayKeys:appTerminated" 
 																	   object:[[NSBundle mainBundle] bundleIdentifier]];
 	}
+	
+	if(RKTraceIsEnabled())
+	{
+		NSURL *libraryLocation = [[[NSFileManager defaultManager] URLsForDirectory:NSLibraryDirectory inDomains:NSUserDomainMask] lastObject];
+		NSURL *traceLocation = [[libraryLocation URLByAppendingPathComponent:@"Logs"] URLByAppendingPathComponent:@"Pinna-Trace.json"];
+		
+		NSError *error = nil;
+		if(RKTraceWriteChromeTrace(traceLocation, &error))
+			NSLog(@"Wrote execution trace to %@", [traceLocation path]);
+		else
+			NSLog(@"Could not write execution trace. %@", error);
+	}
 }
 
 - (BOOL)applicationShouldOpenUntitledFile:(NSApplication *)sender
@@ -352,6 +378,7 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
 - (void)updatePulseFired:(NSTimer *)sender
 {
     [[ExfmSession defaultSession] updateCachedSongs];
+    [[ScrobbleQueue sharedScrobbleQueue] flush];
 }
 
 #pragma mark - • Other
@@ -375,7 +402,7 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
 
 - (BOOL)shouldPostNotifications
 {
-	return (RKGetPersistentBool(kShowSongChangeNotificationsDefaultsKey) && ![NSApp mainWindow]);
+	return (ShowSongChangeNotificationsSetting().boolValue && ![NSApp mainWindow]);
 }
 
 #pragma mark - Account Manager
@@ -391,10 +418,10 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
                 continue;
             
             [reloginPromise then:^(id <Service> service) {
-                
+                [[ScrobbleQueue sharedScrobbleQueue] flush];
             } otherwise:^(NSError *error) {
                 NSLog(@"Could not reauthorize account %@. %@", account, error);
-            }];
+            } onQueue:[NSOperationQueue mainQueue]];
         }
     }
 }
@@ -417,7 +444,7 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
 - (void)sendNowPlayingInfo:(NSTimer *)timer
 {
 	if(mPrivateListeningEnabled ||
-       !RKGetPersistentBool(@"ScrobblePlayedSongsAndUpdateNowPlaying") ||
+       !ScrobblePlayedSongsSetting().boolValue ||
        ![RKConnectivityManager defaultInternetConnectivityManager].isConnected)
     {
 		return;
@@ -453,26 +480,14 @@ static NSString *const kAlwaysShowSongChangeNotificationsWithoutGrowlDefaultsKey
     
 	if([self hasSongBeenPlayedEnoughForScrobble:mLastSong])
 	{
-        if(!RKGetPersistentBool(@"ScrobblePlayedSongsAndUpdateNowPlaying") ||
-           ![RKConnectivityManager defaultInternetConnectivityManager].isConnected)
-        {
+        if(!ScrobblePlayedSongsSetting().boolValue)
             return;
-        }
         
-        Song *lastSong = mLastSong;
-        for (Account *service in [AccountManager sharedAccountManager].accounts)
-        {
-            id <Service> scrobbler = service.descriptor.service;
-            if(!scrobbler)
-                continue;
-            
-            RKPromise *scrobblePromise = [scrobbler scrobbleSong:lastSong duration:mLastSong.duration];
-			[scrobblePromise then:^(id data) {
-                NSLog(@"scrobbled (%@) on %@!", lastSong, service.serviceIdentifier);
-            } otherwise:^(NSError *error) {
-                NSLog(@"Could not scrobble song on %@. Error %@", service.serviceIdentifier, error);
-            }];
-        }
+        //Scrobbles go through the journal so that plays made while offline,
+        //or while a service is unavailable, are submitted later on.
+        ScrobbleQueue *scrobbleQueue = [ScrobbleQueue sharedScrobbleQueue];
+        [scrobbleQueue enqueueSong:mLastSong forAccounts:[AccountManager sharedAccountManager].accounts];
+        [scrobbleQueue flush];
         
         mLastSong = nil;
 	}
@@ -8,14 +8,43 @@
 
 #import <Cocoa/Cocoa.h>
 
-@class Album, Song;
+@class Album, Song, ArtworkStore;
+
+///The sizes, in points, that artwork is cached at.
+///
+///Each size is cached at both @1x and @2x.
+typedef enum ArtworkSize : NSUInteger {
+	///The size used by compact lists.
+	kArtworkSizeSmall = 32,
+	
+	///The size used by the albums and songs browser levels.
+	kArtworkSizeMedium = 64,
+	
+	///The size used by detail views.
+	kArtworkSizeLarge = 128,
+} ArtworkSize;
 
 ///This class is responsible for managing the artwork tiles used by Player.
+///
+///Artwork is kept in a single packed `ArtworkStore` in the application's caches directory.
+///Each unique image is stored and decoded once, and shared by every album whose cover it is.
 @interface ArtworkCache : NSObject
 {
-	NSCache *mImageCache;
+	RKMemoryCache *mImageCache;
 	
 	NSOperationQueue *mCachingQueue;
+	NSOperationQueue *mThumbnailQueue;
+	
+	///The content hashes whose thumbnails are being rendered on the thumbnail queue.
+	NSMutableSet *mRenderingContentHashes;
+	NSCondition *mRenderingCondition;
+	
+	ArtworkStore *mStore;
+	NSMutableDictionary *mContentHashes;
+	
+	NSOperationQueue *mLoadingQueue;
+	NSMutableDictionary *mPendingLoads;
+	NSMutableDictionary *mPendingLoadHandlers;
 }
 
 ///Returns the shared artwork cache, creating it if it doesn't exist.
@@ -30,14 +59,59 @@
 - (BOOL)hasArtworkForAlbum:(Album *)album;
 
 ///Asynchronously cache the artwork for an album.
+///
+///The artwork for each album is decoded once, at the largest size needed, and every size
+///in `ArtworkSize` is rendered from it. Albums are processed in parallel, up to the number
+///of active processors at a time.
 - (void)cacheArtworkForAlbums:(NSArray *)albums completionHandler:(void(^)())completionHandler;
 
-///Returns the cached artwork for a specified album.
+///Returns the cached artwork for a specified album at `kArtworkSizeMedium`.
 - (NSImage *)artworkForAlbum:(Album *)album;
 
-///Returns the cached artwork for a specified album
+///Returns the cached artwork for a specified album at a given size.
+///
+///The returned image contains @1x and @2x representations.
+- (NSImage *)artworkForAlbum:(Album *)album size:(ArtworkSize)size;
+
+///Returns the cached artwork for a specified song at `kArtworkSizeMedium`.
 - (NSImage *)artworkForSong:(Song *)album;
 
+///Returns the cached artwork for a specified song at a given size.
+///
+///The returned image contains @1x and @2x representations.
+- (NSImage *)artworkForSong:(Song *)song size:(ArtworkSize)size;
+
+#pragma mark - Loading Artwork
+
+///Returns the decoded artwork for an album or song if it is in memory, without touching the mass storage device.
+///
+///This method is cheap enough to call while displaying rows. When it returns nil,
+///display a placeholder and use `-loadArtworkForItems:size:completionHandler:`.
+- (NSImage *)cachedArtworkForItem:(id)item size:(ArtworkSize)size;
+
+///Asynchronously load and decode the artwork for albums or songs that need to be displayed now.
+///
+/// \param  items               The albums or songs to load artwork for. Required.
+/// \param  size                The size of the artwork to load.
+/// \param  completionHandler   Invoked on the main thread for each item whose artwork has become
+///                             available through `-cachedArtworkForItem:size:`. Optional.
+///
+///This method must be called from the main thread. Loads requested through this
+///method are never abandoned by `-prefetchArtworkForItems:size:completionHandler:`.
+- (void)loadArtworkForItems:(NSArray *)items size:(ArtworkSize)size completionHandler:(void(^)(id item))completionHandler;
+
+///Asynchronously load and decode the artwork for albums or songs that are about to be displayed.
+///
+/// \param  items               The albums or songs to load artwork for. Required.
+/// \param  size                The size of the artwork to load.
+/// \param  completionHandler   Invoked on the main thread for each item whose artwork has become
+///                             available through `-cachedArtworkForItem:size:`. Optional.
+///
+///Each call supersedes the previous one: prefetches for items not given are abandoned.
+///Prefetches are performed after any loads requested through `-loadArtworkForItems:size:completionHandler:`.
+///This method must be called from the main thread.
+- (void)prefetchArtworkForItems:(NSArray *)items size:(ArtworkSize)size completionHandler:(void(^)(id item))completionHandler;
+
 #pragma mark - Controlling Access
 
 ///Inform the receiver that you will be accessing it extensively.
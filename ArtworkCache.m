@@ -7,7 +7,9 @@
 //
 
 #import "ArtworkCache.h"
+#import "ArtworkStore.h"
 #import <QuickLook/QuickLook.h>
+#import <CommonCrypto/CommonDigest.h>
 
 #import "Library.h"
 #import "Artist.h"
@@ -16,38 +18,162 @@
 
 #import "PlayerApplication.h"
 
-static NSUInteger kHighCacheLimit = 50;
-static NSUInteger kLowCacheLimit = 5;
+///The number of bytes of decoded artwork kept in memory while a level displaying artwork is visible.
+static NSUInteger const kHighCacheCapacity = (1024 * 1024 * 16);
 
-///Returns a data representation for an image of a specified type.
+///The number of bytes of decoded artwork kept in memory otherwise.
+static NSUInteger const kLowCacheCapacity = (1024 * 1024 * 2);
+
+///The revision decoded artwork is stored under in the image cache. Artwork
+///is cached by content hash, so a cached image can never become stale.
+static NSString *const kDecodedArtworkRevision = @"1";
+
+///The pixel sizes artwork is rendered at, smallest first. Every `ArtworkSize`
+///is backed by the pixel size equal to it (@1x) and double it (@2x).
+static size_t const kArtworkPixelSizes[] = { 32, 64, 128, 256 };
+static NSUInteger const kArtworkPixelSizeCount = sizeof(kArtworkPixelSizes) / sizeof(kArtworkPixelSizes[0]);
+
+///The largest pixel size artwork is rendered at. Source artwork is decoded at this size.
+static size_t const kLargestArtworkPixelSize = 256;
+
+///Set to YES to log a comparison of artwork lookups from the artwork store against
+///lookups from individual files after artwork has been cached.
+static NSString *const kArtworkCacheBenchmarkDefaultsKey = @"ArtworkCacheBenchmark";
+
+///Returns a new image containing the artwork at a specified location, decoded no larger than necessary.
 ///
-/// \param  image   The image to return a representation for. Required.
-/// \param  type    The type of data to return.
+/// \param  location    The location of either an audio file with embedded artwork, or a remote image. Required.
+/// \param  pixelSize   The largest width or height the image will be used at.
 ///
-/// \result An NSData object matching the `type`.
+/// \result A CGImage that the caller is responsible for releasing, or NULL if the artwork could not be decoded.
 ///
-///This function is significantly slower for non-bitmap images as a conversion operation is required.
-static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType type)
+///Embedded artwork is decoded by Quick Look, remote images by ImageIO. Either way, the
+///full resolution image is never materialized when a smaller thumbnail will do.
+static CGImageRef ArtworkCreateSourceImage(NSURL *location, size_t pixelSize)
 {
-	NSCParameterAssert(image);
+	NSCParameterAssert(location);
 	
-	//We attempt to get an existing image representation from the image.
-	NSBitmapImageRep *imageRep = nil;
-	for (id representation in [image representations])
+	if([location isFileURL])
 	{
-		if([representation isKindOfClass:[NSBitmapImageRep class]])
-		{
-			imageRep = representation;
-			break;
-		}
+		return QLThumbnailImageCreate(kCFAllocatorDefault,
+									  (__bridge CFURLRef)location,
+									  CGSizeMake(pixelSize, pixelSize),
+									  NULL);
 	}
 	
-	//If there is no existing image representation, we just make a new
-	//representation in the usual, incredibly inefficient manner.
-	if(!imageRep)
-		imageRep = [NSBitmapImageRep imageRepWithData:[image TIFFRepresentation]];
+	NSData *imageData = [NSData dataWithContentsOfURL:location];
+	if(!imageData)
+		return NULL;
+	
+	CGImageSourceRef imageSource = CGImageSourceCreateWithData((__bridge CFDataRef)imageData, NULL);
+	if(!imageSource)
+		return NULL;
 	
-	return [imageRep representationUsingType:type properties:nil];
+	NSDictionary *options = @{
+		(__bridge NSString *)kCGImageSourceCreateThumbnailFromImageAlways: @YES,
+		(__bridge NSString *)kCGImageSourceCreateThumbnailWithTransform: @YES,
+		(__bridge NSString *)kCGImageSourceThumbnailMaxPixelSize: @(pixelSize),
+	};
+	CGImageRef image = CGImageSourceCreateThumbnailAtIndex(imageSource, 0, (__bridge CFDictionaryRef)options);
+	CFRelease(imageSource);
+	
+	return image;
+}
+
+///Returns a new square image containing a specified image scaled to a given pixel size.
+///
+///Unlike drawing into an NSImage with `-lockFocus`, this function is safe to call from any thread.
+static CGImageRef ArtworkCreateThumbnail(CGImageRef image, size_t pixelSize)
+{
+	NSCParameterAssert(image);
+	
+	CGColorSpaceRef colorSpace = CGColorSpaceCreateWithName(kCGColorSpaceSRGB);
+	CGContextRef context = CGBitmapContextCreate(NULL, pixelSize, pixelSize, 8, 0, colorSpace, kCGImageAlphaPremultipliedLast);
+	CGColorSpaceRelease(colorSpace);
+	if(!context)
+		return NULL;
+	
+	CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+	CGContextDrawImage(context, CGRectMake(0.0, 0.0, pixelSize, pixelSize), image);
+	CGImageRef thumbnail = CGBitmapContextCreateImage(context);
+	CGContextRelease(context);
+	
+	return thumbnail;
+}
+
+///Returns the content hash of an image, the hex encoded SHA-1 digest of its dimensions and pixels.
+///
+///Album covers that are the same picture decode to the same pixels at a given size,
+///regardless of which album or file they came from.
+static NSString *ArtworkCopyContentHash(CGImageRef image)
+{
+	NSCParameterAssert(image);
+	
+	CFDataRef pixelData = CGDataProviderCopyData(CGImageGetDataProvider(image));
+	if(!pixelData)
+		return nil;
+	
+	uint32_t dimensions[3] = { (uint32_t)CGImageGetWidth(image), (uint32_t)CGImageGetHeight(image), (uint32_t)CGImageGetBytesPerRow(image) };
+	
+	CC_SHA1_CTX context;
+	CC_SHA1_Init(&context);
+	CC_SHA1_Update(&context, dimensions, sizeof(dimensions));
+	CC_SHA1_Update(&context, CFDataGetBytePtr(pixelData), (CC_LONG)CFDataGetLength(pixelData));
+	CFRelease(pixelData);
+	
+	unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+	CC_SHA1_Final(digest, &context);
+	
+	NSMutableString *hash = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+	for (NSUInteger index = 0; index < CC_SHA1_DIGEST_LENGTH; index++)
+		[hash appendFormat:@"%02x", digest[index]];
+	
+	return hash;
+}
+
+///Returns a bitmap image rep containing the fully decoded pixels of a PNG image.
+///
+///NSBitmapImageRep defers decoding until an image is first drawn, which would put
+///the cost of decoding on the main thread in the middle of a scroll.
+static NSBitmapImageRep *ArtworkCreateDecodedImageRep(NSData *imageData)
+{
+	NSCParameterAssert(imageData);
+	
+	CGImageSourceRef imageSource = CGImageSourceCreateWithData((__bridge CFDataRef)imageData, NULL);
+	if(!imageSource)
+		return nil;
+	
+	CGImageRef image = CGImageSourceCreateImageAtIndex(imageSource, 0, NULL);
+	CFRelease(imageSource);
+	if(!image)
+		return nil;
+	
+	CGImageRef decodedImage = ArtworkCreateThumbnail(image, CGImageGetWidth(image));
+	CGImageRelease(image);
+	if(!decodedImage)
+		return nil;
+	
+	NSBitmapImageRep *imageRep = [[NSBitmapImageRep alloc] initWithCGImage:decodedImage];
+	CGImageRelease(decodedImage);
+	
+	return imageRep;
+}
+
+///Returns the PNG representation of an image, or nil if it could not be encoded.
+static NSData *ArtworkCreatePNGData(CGImageRef image)
+{
+	NSCParameterAssert(image);
+	
+	NSMutableData *imageData = [NSMutableData data];
+	CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)imageData, kUTTypePNG, 1, NULL);
+	if(!destination)
+		return nil;
+	
+	CGImageDestinationAddImage(destination, image, NULL);
+	BOOL succeeded = CGImageDestinationFinalize(destination);
+	CFRelease(destination);
+	
+	return succeeded? imageData : nil;
 }
 
 #pragma mark -
@@ -68,11 +194,17 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 	return [cachesPath stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]];
 }
 
-- (NSString *)artworkCacheDirectoryPath
+///The directory artwork was stored in, one file per album, before the artwork store.
+- (NSString *)legacyArtworkCacheDirectoryPath
 {
 	return [[self applicationCacheDirectoryPath] stringByAppendingPathComponent:@"Artwork"];
 }
 
+- (NSString *)artworkStorePath
+{
+	return [[self applicationCacheDirectoryPath] stringByAppendingPathComponent:@"Artwork.pack"];
+}
+
 #pragma mark - Lifecycle
 
 + (ArtworkCache *)sharedArtworkCache
@@ -91,21 +223,63 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 	if((self = [super init]))
 	{
 		NSError *error = nil;
-		NSString *artworkCachePath = [self artworkCacheDirectoryPath];
+		NSString *applicationCachePath = [self applicationCacheDirectoryPath];
 		
-		if(![[NSFileManager defaultManager] fileExistsAtPath:artworkCachePath])
+		if(![[NSFileManager defaultManager] fileExistsAtPath:applicationCachePath])
 		{
-			NSAssert([[NSFileManager defaultManager] createDirectoryAtPath:artworkCachePath withIntermediateDirectories:YES attributes:nil error:&error],
-					 @"Could not create artwork cache directory (%@). Error %@.", artworkCachePath, [error localizedDescription]);
+			if(![[NSFileManager defaultManager] createDirectoryAtPath:applicationCachePath withIntermediateDirectories:YES attributes:nil error:&error])
+			{
+				[NSException raise:NSInternalInconsistencyException format:@"Could not create application cache directory (%@). Error %@.", applicationCachePath, [error localizedDescription]];
+			}
 		}
 		
-		mCachingQueue = [NSOperationQueue new];
-		[mCachingQueue setName:@"com.roundabout.pinna.ArtworkCache.mCachingQueue"];
-		[mCachingQueue setMaxConcurrentOperationCount:1];
+		mStore = [[ArtworkStore alloc] initWithPath:[self artworkStorePath]];
+		mContentHashes = [NSMutableDictionary dictionary];
+		
+		mCachingQueue = [RKExecutor executorNamed:@"com.roundabout.pinna.ArtworkCache.mCachingQueue"
+								 qualityOfService:kRKExecutorQualityOfServiceUtility
+											width:1];
 		[NSApp addImportantQueue:mCachingQueue];
 		
-		mImageCache = [NSCache new];
-		[mImageCache setCountLimit:kLowCacheLimit];
+		//Loading the store's index reads its entire data file, so it is kept off of the
+		//main thread. Lookups find no artwork until the content hashes are loaded, and
+		//everything that writes to the store is serialized behind this on the caching queue.
+		[mCachingQueue addOperationWithBlock:^{
+			[mStore loadIndex];
+			[self loadContentHashes];
+			
+			[[NSOperationQueue mainQueue] addOperationWithBlock:^{
+				[[Library sharedLibrary] willChangeValueForKey:@"albums"];
+				[[Library sharedLibrary] didChangeValueForKey:@"albums"];
+			}];
+		}];
+		
+		mThumbnailQueue = [RKExecutor executorNamed:@"com.roundabout.pinna.ArtworkCache.mThumbnailQueue"
+								   qualityOfService:kRKExecutorQualityOfServiceUserInitiated
+											  width:[[NSProcessInfo processInfo] activeProcessorCount]];
+		[NSApp addImportantQueue:mThumbnailQueue];
+		
+		mRenderingContentHashes = [NSMutableSet set];
+		mRenderingCondition = [NSCondition new];
+		
+		mLoadingQueue = [RKExecutor executorNamed:@"com.roundabout.pinna.ArtworkCache.mLoadingQueue"
+								 qualityOfService:kRKExecutorQualityOfServiceUserInitiated
+											width:2];
+		
+		mPendingLoads = [NSMutableDictionary dictionary];
+		mPendingLoadHandlers = [NSMutableDictionary dictionary];
+		
+		mImageCache = [[RKMemoryCache alloc] initWithCapacity:kLowCacheCapacity];
+		
+		NSString *legacyArtworkCachePath = [self legacyArtworkCacheDirectoryPath];
+		if([[NSFileManager defaultManager] fileExistsAtPath:legacyArtworkCachePath])
+		{
+			[mCachingQueue addOperationWithBlock:^{
+				NSError *error = nil;
+				if(![[NSFileManager defaultManager] removeItemAtPath:legacyArtworkCachePath error:&error])
+					NSLog(@"*** Could not remove legacy artwork cache %@, error %@ ***", legacyArtworkCachePath, [error localizedDescription]);
+			}];
+		}
 	}
 	
 	return self;
@@ -117,22 +291,10 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 {
 	[mCachingQueue addOperationWithBlock:^{
 		[mImageCache removeAllObjects];
-		
-		NSError *error = nil;
-		NSString *artworkCachePath = [self artworkCacheDirectoryPath];
-		
-		if([[NSFileManager defaultManager] fileExistsAtPath:artworkCachePath])
+		[mStore removeAllData];
+		@synchronized(mContentHashes)
 		{
-			if(![[NSFileManager defaultManager] removeItemAtPath:artworkCachePath error:&error])
-			{
-				NSLog(@"Could not delete artwork cache folder.");
-				return;
-			}
-			
-			if(![[NSFileManager defaultManager] createDirectoryAtPath:artworkCachePath withIntermediateDirectories:YES attributes:nil error:&error])
-			{
-				[NSException raise:NSInternalInconsistencyException format:@"Could not create artwork cache directory (%@). Error %@.", artworkCachePath, [error localizedDescription]];
-			}
+			[mContentHashes removeAllObjects];
 		}
 		
 		[[NSOperationQueue mainQueue] addOperationWithBlock:^{
@@ -144,43 +306,75 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 
 #pragma mark - Accessing Artwork
 
-- (NSString *)imageNameForAlbum:(Album *)album
+- (NSString *)artworkIdentifierForAlbum:(Album *)album
 {
 	if(!album)
 		return nil;
 	
-	return [RKGenerateIdentifierForStrings(@[album.artist.name, album.name]) stringByAppendingPathExtension:@"png"];
+	return RKGenerateIdentifierForStrings(@[album.artist.name, album.name]);
 }
 
-- (NSString *)imageLocationForAlbum:(Album *)album
+- (NSString *)artworkIdentifierForSong:(Song *)song
 {
-	NSString *imageName = [self imageNameForAlbum:album];
-	if(!imageName)
+	if(!song)
 		return nil;
 	
-	return [[self artworkCacheDirectoryPath] stringByAppendingPathComponent:imageName];
+	return RKGenerateIdentifierForStrings(@[song.artist ?: @"", song.album ?: @""]);
 }
 
-- (NSString *)imageNameForSong:(Song *)song
+///Returns the name of the thumbnail of a given size for a content hash in the artwork store.
+///
+///Thumbnails are stored once per unique image, under the hash of their pixels. Each album is
+///stored separately, under its artwork identifier, as a record containing its content hash.
+- (NSString *)imageNameForContentHash:(NSString *)contentHash pixelSize:(size_t)pixelSize
 {
-	if(!song)
+	return [NSString stringWithFormat:@"#%@-%lu", contentHash, (unsigned long)pixelSize];
+}
+
+- (NSString *)contentHashForArtworkIdentifier:(NSString *)identifier
+{
+	if(!identifier)
 		return nil;
 	
-	return [RKGenerateIdentifierForStrings(@[song.artist ?: @"", song.album ?: @""]) stringByAppendingPathExtension:@"png"];
+	@synchronized(mContentHashes)
+	{
+		return [mContentHashes objectForKey:identifier];
+	}
 }
 
-- (NSString *)imageLocationForSong:(Song *)song
+- (NSString *)imageNameForArtworkIdentifier:(NSString *)identifier pixelSize:(size_t)pixelSize
 {
-	NSString *imageName = [self imageNameForSong:song];
-	if(!imageName)
+	NSString *contentHash = [self contentHashForArtworkIdentifier:identifier];
+	if(!contentHash)
 		return nil;
 	
-	return [[self artworkCacheDirectoryPath] stringByAppendingPathComponent:imageName];
+	return [self imageNameForContentHash:contentHash pixelSize:pixelSize];
+}
+
+///Loads the content hash of every album from the artwork store.
+- (void)loadContentHashes
+{
+	NSMutableDictionary *contentHashes = [NSMutableDictionary dictionary];
+	for (NSString *name in [mStore allNames])
+	{
+		if([name hasPrefix:@"#"])
+			continue;
+		
+		NSData *contentHashData = [mStore dataForName:name];
+		NSString *contentHash = contentHashData? [[NSString alloc] initWithData:contentHashData encoding:NSUTF8StringEncoding] : nil;
+		if(contentHash)
+			[contentHashes setObject:contentHash forKey:name];
+	}
+	
+	@synchronized(mContentHashes)
+	{
+		[mContentHashes setDictionary:contentHashes];
+	}
 }
 
 #pragma mark -
 
-- (NSImage *)artworkImageForAlbum:(Album *)album
+- (NSURL *)artworkSourceLocationForAlbum:(Album *)album
 {
 	Song *songChoice = nil;
 	for (Song *albumSong in album.songs)
@@ -194,53 +388,147 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 	if(!songChoice)
 	{
 		songChoice = [album.songs lastObject];
-		NSDictionary *remoteArtworkLocation = songChoice.remoteArtworkLocations;
-		if(![remoteArtworkLocation objectForKey:@"small"])
-			return nil;
-		
-		return [[NSImage alloc] initWithContentsOfURL:[remoteArtworkLocation objectForKey:@"small"]];
+		return [songChoice.remoteArtworkLocations objectForKey:@"small"];
 	}
 	
-	CGImageRef thumbnail = QLThumbnailImageCreate(kCFAllocatorDefault, 
-												  (__bridge CFURLRef)(songChoice.location), 
-												  CGSizeMake(512.0, 512.0), 
-												  NULL);
-	if(thumbnail)
+	return songChoice.location;
+}
+
+- (BOOL)hasThumbnailsForContentHash:(NSString *)contentHash
+{
+	for (NSUInteger index = 0; index < kArtworkPixelSizeCount; index++)
 	{
-		NSBitmapImageRep *artworkImageRep = [[NSBitmapImageRep alloc] initWithCGImage:thumbnail];
-		NSImage *artworkImage = [[NSImage alloc] initWithSize:[artworkImageRep size]];
-		[artworkImage addRepresentation:artworkImageRep];
-		CGImageRelease(thumbnail);
-		return artworkImage;
+		if(![mStore containsDataForName:[self imageNameForContentHash:contentHash pixelSize:kArtworkPixelSizes[index]]])
+			return NO;
 	}
 	
-	return nil;
+	return YES;
 }
 
-- (NSImage *)thumbnailForImage:(NSImage *)sourceImage
+///Claims the rendering of the thumbnails for a content hash.
+///
+/// \param  contentHash The content hash. Required.
+///
+/// esult YES if the caller must render the thumbnails and then call
+///         `-endRenderingThumbnailsForContentHash:`; NO if they are already stored.
+///
+///Albums that share artwork are rendered side by side on the thumbnail queue, so a
+///caller whose thumbnails are being rendered by another thread waits for it to finish.
+- (BOOL)beginRenderingThumbnailsForContentHash:(NSString *)contentHash
 {
-	NSImage *thumbnail = [[NSImage alloc] initWithSize:NSMakeSize(64.0, 64.0)];
-	[thumbnail lockFocus];
+	[mRenderingCondition lock];
+	
+	while ([mRenderingContentHashes member:contentHash])
+		[mRenderingCondition wait];
+	
+	BOOL shouldRender = ![self hasThumbnailsForContentHash:contentHash];
+	if(shouldRender)
+		[mRenderingContentHashes addObject:contentHash];
+	
+	[mRenderingCondition unlock];
+	
+	return shouldRender;
+}
+
+///Releases a claim made with `-beginRenderingThumbnailsForContentHash:`.
+- (void)endRenderingThumbnailsForContentHash:(NSString *)contentHash
+{
+	[mRenderingCondition lock];
+	
+	[mRenderingContentHashes removeObject:contentHash];
+	[mRenderingCondition broadcast];
+	
+	[mRenderingCondition unlock];
+}
+
+///Caches the artwork for an album.
+///
+/// \param  identifier      The artwork identifier of the album. Required.
+/// \param  location        The location of the album's source artwork. Required.
+/// \param  outContentHash  On return, the content hash of the album's artwork.
+/// \param  outRenderTime   On return, the time spent rendering and storing thumbnails.
+///                         Zero when the artwork was already stored for another album.
+///
+/// \result YES if the album's artwork is in the store; NO otherwise.
+- (BOOL)cacheArtworkWithIdentifier:(NSString *)identifier fromLocation:(NSURL *)location contentHash:(NSString **)outContentHash renderTime:(NSTimeInterval *)outRenderTime
+{
+	*outRenderTime = 0.0;
+	
+	CGImageRef sourceImage = ArtworkCreateSourceImage(location, kLargestArtworkPixelSize);
+	if(!sourceImage)
+		return NO;
+	
+	//The largest thumbnail doubles as the input to the content hash.
+	CGImageRef largestThumbnail = ArtworkCreateThumbnail(sourceImage, kLargestArtworkPixelSize);
+	NSString *contentHash = largestThumbnail? ArtworkCopyContentHash(largestThumbnail) : nil;
+	if(!contentHash)
 	{
-		[sourceImage setFlipped:NO];
-		[sourceImage drawInRect:NSMakeRect(0.0, 0.0, 64.0, 64.0) 
-					   fromRect:NSZeroRect 
-					  operation:NSCompositeSourceOver 
-					   fraction:1.0 
-				 respectFlipped:YES 
-						  hints:nil];
+		if(largestThumbnail)
+			CGImageRelease(largestThumbnail);
+		CGImageRelease(sourceImage);
+		return NO;
 	}
-	[thumbnail unlockFocus];
 	
-	return thumbnail;
+	BOOL succeeded = YES;
+	if([self beginRenderingThumbnailsForContentHash:contentHash])
+	{
+		NSDate *startDate = [NSDate date];
+		for (NSUInteger index = 0; index < kArtworkPixelSizeCount && succeeded; index++)
+		{
+			size_t pixelSize = kArtworkPixelSizes[index];
+			CGImageRef thumbnail = (pixelSize == kLargestArtworkPixelSize)? CGImageRetain(largestThumbnail) : ArtworkCreateThumbnail(sourceImage, pixelSize);
+			if(!thumbnail)
+			{
+				succeeded = NO;
+				break;
+			}
+			
+			NSData *imageData = ArtworkCreatePNGData(thumbnail);
+			if(!imageData || ![mStore setData:imageData forName:[self imageNameForContentHash:contentHash pixelSize:pixelSize]])
+			{
+				NSLog(@"*** Could not write out %lu px artwork for %@ ***", (unsigned long)pixelSize, identifier);
+				succeeded = NO;
+			}
+			
+			CGImageRelease(thumbnail);
+		}
+		*outRenderTime = -[startDate timeIntervalSinceNow];
+		
+		[self endRenderingThumbnailsForContentHash:contentHash];
+	}
+	
+	CGImageRelease(largestThumbnail);
+	CGImageRelease(sourceImage);
+	
+	if(succeeded && ![contentHash isEqualToString:[self contentHashForArtworkIdentifier:identifier]])
+	{
+		succeeded = [mStore setData:[contentHash dataUsingEncoding:NSUTF8StringEncoding] forName:identifier];
+		if(succeeded)
+		{
+			@synchronized(mContentHashes)
+			{
+				[mContentHashes setObject:contentHash forKey:identifier];
+			}
+		}
+	}
+	
+	*outContentHash = contentHash;
+	
+	return succeeded;
 }
 
 #pragma mark -
 
+- (BOOL)hasArtworkWithIdentifier:(NSString *)identifier
+{
+	NSString *contentHash = [self contentHashForArtworkIdentifier:identifier];
+	return (contentHash && [self hasThumbnailsForContentHash:contentHash]);
+}
+
 - (BOOL)hasArtworkForAlbum:(Album *)album
 {
-	NSString *imageLocationForAlbum = [self imageLocationForAlbum:album];
-	return (imageLocationForAlbum && [[NSFileManager defaultManager] fileExistsAtPath:imageLocationForAlbum]);
+	NSString *identifier = [self artworkIdentifierForAlbum:album];
+	return (identifier && [self hasArtworkWithIdentifier:identifier]);
 }
 
 - (void)cacheArtworkForAlbums:(NSArray *)albums completionHandler:(void(^)())completionHandler
@@ -249,106 +537,419 @@ static NSData *xNSImageGetRepresentation(NSImage *image, NSBitmapImageFileType t
 	
 	__block ArtworkCache *me = self;
 	[mCachingQueue addOperationWithBlock:^{
-		NSError *error = nil;
 		NSMutableSet *currentArtwork = [NSMutableSet set];
+		NSMutableSet *cachedIdentifiers = [NSMutableSet set];
+		NSMutableSet *pendingIdentifiers = [NSMutableSet set];
+		NSMutableSet *generatedIdentifiers = [NSMutableSet set];
+		__block NSUInteger numberOfRenderedImages = 0;
+		__block NSTimeInterval totalRenderTime = 0.0;
+		NSDate *startDate = [NSDate date];
 		
+		//The albums are only read from this queue. Decoding, scaling,
+		//and encoding is fanned out to the thumbnail queue.
 		for (Album *album in albums)
 		{
 			if([NSApp isWaitingForImportantQueuesToFinish])
 				return;
 			
-			NSString *imageLocationForAlbum = [me imageLocationForAlbum:album];
-			if(imageLocationForAlbum && [[NSFileManager defaultManager] fileExistsAtPath:imageLocationForAlbum])
+			NSString *identifier = [me artworkIdentifierForAlbum:album];
+			if(!identifier || [cachedIdentifiers member:identifier] || [pendingIdentifiers member:identifier])
+				continue;
+			
+			if([me hasArtworkWithIdentifier:identifier])
 			{
-				[currentArtwork addObject:[me imageNameForAlbum:album]];
+				[cachedIdentifiers addObject:identifier];
 				continue;
 			}
 			
-			NSImage *fullArtwork = [me artworkImageForAlbum:album];
-			if(!fullArtwork)
+			NSURL *sourceLocation = [me artworkSourceLocationForAlbum:album];
+			if(!sourceLocation)
 				continue;
 			
-			[currentArtwork addObject:[me imageNameForAlbum:album]];
-			
-			NSImage *thumbnail = [me thumbnailForImage:fullArtwork];
-			NSData *imageData = xNSImageGetRepresentation(thumbnail, NSPNGFileType);
-			if(![imageData writeToFile:[me imageLocationForAlbum:album] options:NSAtomicWrite error:&error])
-			{
-				NSLog(@"*** Could not write out artwork cache for album %@ ***", album);
-				continue;
-			}
-		}
-		
-		if([NSApp isWaitingForImportantQueuesToFinish])
-			return;
-		
-		NSString *artworkCacheDirectoryPath = [me artworkCacheDirectoryPath];
-		NSArray *storedArtwork = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:artworkCacheDirectoryPath error:&error];
-		if(storedArtwork)
-		{
-			for (NSString *storedArtworkName in storedArtwork)
-			{
+			[pendingIdentifiers addObject:identifier];
+			[mThumbnailQueue addOperationWithBlock:^{
 				if([NSApp isWaitingForImportantQueuesToFinish])
 					return;
 				
-				if(![currentArtwork member:storedArtworkName])
+				NSString *contentHash = nil;
+				NSTimeInterval renderTime = 0.0;
+				if([me cacheArtworkWithIdentifier:identifier fromLocation:sourceLocation contentHash:&contentHash renderTime:&renderTime])
 				{
-					NSString *artworkPath = [artworkCacheDirectoryPath stringByAppendingPathComponent:storedArtworkName];
-					if(![[NSFileManager defaultManager] removeItemAtPath:artworkPath error:&error])
+					@synchronized(generatedIdentifiers)
 					{
-						NSLog(@"*** Could not remove stored artwork %@ ***", artworkPath);
+						[generatedIdentifiers addObject:identifier];
+						if(renderTime > 0.0)
+						{
+							numberOfRenderedImages++;
+							totalRenderTime += renderTime;
+						}
 					}
 				}
-			}
+			}];
+		}
+		
+		[mThumbnailQueue waitUntilAllOperationsAreFinished];
+		
+		if([NSApp isWaitingForImportantQueuesToFinish])
+			return;
+		
+		NSTimeInterval duration = -[startDate timeIntervalSinceNow];
+		if([pendingIdentifiers count] > 0)
+		{
+			NSLog(@"Cached artwork for %lu of %lu albums in %.2f seconds (%.1f albums/second)",
+				  (unsigned long)[generatedIdentifiers count], (unsigned long)[pendingIdentifiers count],
+				  duration, [pendingIdentifiers count] / MAX(duration, 0.001));
 		}
-		else
+		
+		[cachedIdentifiers unionSet:generatedIdentifiers];
+		
+		NSMutableSet *currentContentHashes = [NSMutableSet set];
+		for (NSString *identifier in cachedIdentifiers)
 		{
-			NSLog(@"*** Could not look up artwork on mass storage device. ***");
+			[currentArtwork addObject:identifier];
+			
+			NSString *contentHash = [me contentHashForArtworkIdentifier:identifier];
+			if(!contentHash || [currentContentHashes member:contentHash])
+				continue;
+			
+			[currentContentHashes addObject:contentHash];
+			for (NSUInteger index = 0; index < kArtworkPixelSizeCount; index++)
+				[currentArtwork addObject:[me imageNameForContentHash:contentHash pixelSize:kArtworkPixelSizes[index]]];
 		}
 		
+		[me logDeduplicationForArtworkIdentifiers:cachedIdentifiers
+								   generatedCount:[generatedIdentifiers count]
+									  renderCount:numberOfRenderedImages
+									   renderTime:totalRenderTime];
+		
+		NSMutableArray *orphanedArtwork = [NSMutableArray array];
+		for (NSString *storedArtworkName in [mStore allNames])
+		{
+			if(![currentArtwork member:storedArtworkName])
+				[orphanedArtwork addObject:storedArtworkName];
+		}
+		
+		[mStore removeDataForNames:orphanedArtwork];
+		@synchronized(mContentHashes)
+		{
+			[mContentHashes removeObjectsForKeys:orphanedArtwork];
+		}
+		[mStore compactIfNeeded];
+		[mStore synchronize];
+		
+		if(RKGetPersistentBool(kArtworkCacheBenchmarkDefaultsKey))
+			[me logLookupBenchmark];
+		
 		if(completionHandler)
 			[[NSOperationQueue mainQueue] addOperationWithBlock:completionHandler];
 	}];
 }
 
-- (NSImage *)artworkForAlbum:(Album *)album
+///Logs how much disk space, memory, and generation time is saved by storing each unique image once.
+- (void)logDeduplicationForArtworkIdentifiers:(NSSet *)identifiers generatedCount:(NSUInteger)generatedCount renderCount:(NSUInteger)renderCount renderTime:(NSTimeInterval)renderTime
 {
-	NSString *imageLocationForAlbum = [self imageLocationForAlbum:album];
-	NSImage *image = [mImageCache objectForKey:imageLocationForAlbum];
-	if(!image)
+	NSCountedSet *contentHashes = [NSCountedSet set];
+	for (NSString *identifier in identifiers)
 	{
-		image = [[NSImage alloc] initWithContentsOfFile:imageLocationForAlbum];
-		if(image)
-			[mImageCache setObject:image forKey:imageLocationForAlbum];
+		NSString *contentHash = [self contentHashForArtworkIdentifier:identifier];
+		if(contentHash)
+			[contentHashes addObject:contentHash];
 	}
 	
+	NSUInteger numberOfAlbums = 0;
+	unsigned long long savedBytes = 0;
+	for (NSString *contentHash in contentHashes)
+	{
+		NSUInteger numberOfSharingAlbums = [contentHashes countForObject:contentHash];
+		numberOfAlbums += numberOfSharingAlbums;
+		
+		unsigned long long thumbnailBytes = 0;
+		for (NSUInteger index = 0; index < kArtworkPixelSizeCount; index++)
+			thumbnailBytes += [mStore lengthOfDataForName:[self imageNameForContentHash:contentHash pixelSize:kArtworkPixelSizes[index]]];
+		
+		savedBytes += thumbnailBytes * (numberOfSharingAlbums - 1);
+	}
+	
+	NSUInteger numberOfDuplicates = numberOfAlbums - [contentHashes count];
+	if(numberOfDuplicates == 0)
+		return;
+	
+	//Each row of the songs and albums levels holds a decoded 32 pt image with @1x and @2x representations.
+	unsigned long long savedMemory = numberOfDuplicates * ((32 * 32) + (64 * 64)) * 4ULL;
+	
+	NSUInteger numberOfSkippedRenders = (generatedCount > renderCount)? generatedCount - renderCount : 0;
+	NSTimeInterval savedTime = (renderCount > 0)? numberOfSkippedRenders * (renderTime / renderCount) : 0.0;
+	
+	NSLog(@"Artwork for %lu albums is %lu unique images. Sharing saves %llu bytes on disk, up to %llu bytes of decoded artwork, and skipped %lu renders this update (~%.2f seconds)",
+		  (unsigned long)numberOfAlbums, (unsigned long)[contentHashes count], savedBytes, savedMemory, (unsigned long)numberOfSkippedRenders, savedTime);
+}
+
+#pragma mark -
+
+- (id)artworkIdentifierForItem:(id)item
+{
+	if([item isKindOfClass:[Album class]])
+		return [self artworkIdentifierForAlbum:item];
+	else if([item isKindOfClass:[Song class]])
+		return [self artworkIdentifierForSong:item];
+	else
+		return nil;
+}
+
+///Returns the decoded artwork with a given identifier from the image cache, without touching the artwork store.
+///
+///Decoded artwork is cached by content hash, so albums that share a cover share a decoded image.
+- (NSImage *)cachedArtworkWithIdentifier:(NSString *)identifier size:(ArtworkSize)size
+{
+	if(!identifier)
+		return nil;
+	
+	NSString *cacheKey = [self imageNameForArtworkIdentifier:identifier pixelSize:size];
+	if(!cacheKey)
+		return nil;
+	
+	return [mImageCache objectForKey:cacheKey revision:kDecodedArtworkRevision transform:nil];
+}
+
+///Decodes the artwork with a given identifier from the artwork store, and places it in the image cache.
+- (NSImage *)loadArtworkWithIdentifier:(NSString *)identifier size:(ArtworkSize)size
+{
+	NSString *cacheKey = [self imageNameForArtworkIdentifier:identifier pixelSize:size];
+	NSData *imageData = cacheKey? [mStore dataForName:cacheKey] : nil;
+	NSBitmapImageRep *imageRep = imageData? ArtworkCreateDecodedImageRep(imageData) : nil;
+	if(!imageRep)
+		return nil;
+	
+	NSImage *image = [[NSImage alloc] initWithSize:NSMakeSize(size, size)];
+	[imageRep setSize:NSMakeSize(size, size)];
+	[image addRepresentation:imageRep];
+	NSUInteger cost = [imageRep bytesPerPlane] * [imageRep numberOfPlanes];
+	
+	NSData *retinaImageData = [mStore dataForName:[self imageNameForArtworkIdentifier:identifier pixelSize:size * 2]];
+	NSBitmapImageRep *retinaImageRep = retinaImageData? ArtworkCreateDecodedImageRep(retinaImageData) : nil;
+	if(retinaImageRep)
+	{
+		[retinaImageRep setSize:NSMakeSize(size, size)];
+		[image addRepresentation:retinaImageRep];
+		cost += [retinaImageRep bytesPerPlane] * [retinaImageRep numberOfPlanes];
+	}
+	
+	[mImageCache setObject:image forKey:cacheKey revision:kDecodedArtworkRevision transform:nil cost:cost];
+	
 	return image;
 }
 
+- (NSImage *)artworkWithIdentifier:(NSString *)identifier size:(ArtworkSize)size
+{
+	if(!identifier)
+		return nil;
+	
+	return [self cachedArtworkWithIdentifier:identifier size:size] ?: [self loadArtworkWithIdentifier:identifier size:size];
+}
+
+- (NSImage *)artworkForAlbum:(Album *)album
+{
+	return [self artworkForAlbum:album size:kArtworkSizeMedium];
+}
+
+- (NSImage *)artworkForAlbum:(Album *)album size:(ArtworkSize)size
+{
+	return [self artworkWithIdentifier:[self artworkIdentifierForAlbum:album] size:size];
+}
+
 - (NSImage *)artworkForSong:(Song *)album
 {
-	NSString *imageLocationForSong = [self imageLocationForSong:album];
-	NSImage *image = [mImageCache objectForKey:imageLocationForSong];
-	if(!image)
+	return [self artworkForSong:album size:kArtworkSizeMedium];
+}
+
+- (NSImage *)artworkForSong:(Song *)song size:(ArtworkSize)size
+{
+	return [self artworkWithIdentifier:[self artworkIdentifierForSong:song] size:size];
+}
+
+#pragma mark - Loading Artwork
+
+- (NSImage *)cachedArtworkForItem:(id)item size:(ArtworkSize)size
+{
+	return [self cachedArtworkWithIdentifier:[self artworkIdentifierForItem:item] size:size];
+}
+
+- (void)loadArtworkForItems:(NSArray *)items size:(ArtworkSize)size priority:(NSOperationQueuePriority)priority completionHandler:(void(^)(id item))completionHandler
+{
+	completionHandler = [completionHandler copy];
+	
+	for (id item in items)
+	{
+		NSString *identifier = [self artworkIdentifierForItem:item];
+		if(!identifier)
+			continue;
+		
+		//The artwork may have been loaded since the caller last looked.
+		if([self cachedArtworkWithIdentifier:identifier size:size])
+		{
+			if(completionHandler)
+				[[NSOperationQueue mainQueue] addOperationWithBlock:^{ completionHandler(item); }];
+			
+			continue;
+		}
+		
+		NSString *cacheKey = [self imageNameForArtworkIdentifier:identifier pixelSize:size];
+		if(!cacheKey)
+			continue;
+		
+		NSMutableArray *handlers = [mPendingLoadHandlers objectForKey:cacheKey];
+		if(!handlers)
+		{
+			handlers = [NSMutableArray array];
+			[mPendingLoadHandlers setObject:handlers forKey:cacheKey];
+		}
+		
+		if(completionHandler)
+		{
+			[handlers addObject:[^{ completionHandler(item); } copy]];
+		}
+		
+		NSOperation *pendingLoad = [mPendingLoads objectForKey:cacheKey];
+		if(pendingLoad)
+		{
+			if(priority > [pendingLoad queuePriority])
+				[pendingLoad setQueuePriority:priority];
+			
+			continue;
+		}
+		
+		NSBlockOperation *load = [NSBlockOperation new];
+		__weak NSBlockOperation *weakLoad = load;
+		[load addExecutionBlock:^{
+			BOOL succeeded = ([self loadArtworkWithIdentifier:identifier size:size] != nil);
+			[[NSOperationQueue mainQueue] addOperationWithBlock:^{
+				//The load was abandoned, and may have been superseded by a newer one.
+				if([mPendingLoads objectForKey:cacheKey] != weakLoad)
+					return;
+				
+				[mPendingLoads removeObjectForKey:cacheKey];
+				
+				NSArray *handlersToInvoke = [mPendingLoadHandlers objectForKey:cacheKey];
+				[mPendingLoadHandlers removeObjectForKey:cacheKey];
+				if(succeeded)
+				{
+					for (dispatch_block_t handler in handlersToInvoke)
+						handler();
+				}
+			}];
+		}];
+		[load setQueuePriority:priority];
+		[mPendingLoads setObject:load forKey:cacheKey];
+		[mLoadingQueue addOperation:load];
+	}
+}
+
+- (void)loadArtworkForItems:(NSArray *)items size:(ArtworkSize)size completionHandler:(void(^)(id item))completionHandler
+{
+	NSParameterAssert(items);
+	NSAssert([NSThread isMainThread], @"-[ArtworkCache loadArtworkForItems:size:completionHandler:] must be called from the main thread");
+	
+	[self loadArtworkForItems:items size:size priority:NSOperationQueuePriorityHigh completionHandler:completionHandler];
+}
+
+- (void)prefetchArtworkForItems:(NSArray *)items size:(ArtworkSize)size completionHandler:(void(^)(id item))completionHandler
+{
+	NSParameterAssert(items);
+	NSAssert([NSThread isMainThread], @"-[ArtworkCache prefetchArtworkForItems:size:completionHandler:] must be called from the main thread");
+	
+	NSMutableSet *wantedKeys = [NSMutableSet setWithCapacity:[items count]];
+	for (id item in items)
 	{
-		image = [[NSImage alloc] initWithContentsOfFile:imageLocationForSong];
-		if(image)
-			[mImageCache setObject:image forKey:imageLocationForSong];
+		NSString *cacheKey = [self imageNameForArtworkIdentifier:[self artworkIdentifierForItem:item] pixelSize:size];
+		if(cacheKey)
+			[wantedKeys addObject:cacheKey];
 	}
 	
-	return image;
+	//Loads for rows the user has already scrolled past are abandoned. Cancelled
+	//loads that already started still finish, and their handlers are dropped.
+	for (NSString *cacheKey in [mPendingLoads allKeys])
+	{
+		if([wantedKeys member:cacheKey])
+			continue;
+		
+		NSOperation *pendingLoad = [mPendingLoads objectForKey:cacheKey];
+		if([pendingLoad queuePriority] >= NSOperationQueuePriorityHigh)
+			continue;
+		
+		[pendingLoad cancel];
+		[mPendingLoads removeObjectForKey:cacheKey];
+		[mPendingLoadHandlers removeObjectForKey:cacheKey];
+	}
+	
+	[self loadArtworkForItems:items size:size priority:NSOperationQueuePriorityNormal completionHandler:completionHandler];
+}
+
+#pragma mark - Benchmarking
+
+///Logs the time taken to look up and decode medium artwork as the albums browser
+///level does while scrolling, from the artwork store and from one file per album.
+- (void)logLookupBenchmark
+{
+	NSString *suffix = [NSString stringWithFormat:@"-%lu", (unsigned long)kArtworkSizeMedium];
+	NSArray *names = [[mStore allNames] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"SELF ENDSWITH %@", suffix]];
+	if([names count] == 0)
+		return;
+	
+	NSString *directoryPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSProcessInfo processInfo] globallyUniqueString]];
+	[[NSFileManager defaultManager] createDirectoryAtPath:directoryPath withIntermediateDirectories:YES attributes:nil error:NULL];
+	for (NSString *name in names)
+		[[mStore dataForName:name] writeToFile:[directoryPath stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"png"]] atomically:NO];
+	
+	//Each pass scrolls from the top of the list to the bottom, a row at a time.
+	static NSUInteger const kNumberOfPasses = 5;
+	NSUInteger numberOfLookups = [names count] * kNumberOfPasses;
+	
+	NSDate *startDate = [NSDate date];
+	for (NSUInteger pass = 0; pass < kNumberOfPasses; pass++)
+	{
+		for (NSString *name in names)
+		{
+			@autoreleasepool
+			{
+				NSData *imageData = [mStore dataForName:name];
+				(void)[NSBitmapImageRep imageRepWithData:imageData];
+			}
+		}
+	}
+	NSTimeInterval storeDuration = -[startDate timeIntervalSinceNow];
+	
+	startDate = [NSDate date];
+	for (NSUInteger pass = 0; pass < kNumberOfPasses; pass++)
+	{
+		for (NSString *name in names)
+		{
+			@autoreleasepool
+			{
+				NSString *path = [directoryPath stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"png"]];
+				if([[NSFileManager defaultManager] fileExistsAtPath:path])
+					(void)[NSBitmapImageRep imageRepWithContentsOfFile:path];
+			}
+		}
+	}
+	NSTimeInterval filesDuration = -[startDate timeIntervalSinceNow];
+	
+	[[NSFileManager defaultManager] removeItemAtPath:directoryPath error:NULL];
+	
+	NSLog(@"[BENCHMARK] %lu artwork lookups over %lu albums", (unsigned long)numberOfLookups, (unsigned long)[names count]);
+	NSLog(@"[BENCHMARK] Artwork store: %f seconds, %.1f microseconds per lookup", storeDuration, storeDuration / numberOfLookups * 1000000.0);
+	NSLog(@"[BENCHMARK] File per album: %f seconds, %.1f microseconds per lookup", filesDuration, filesDuration / numberOfLookups * 1000000.0);
 }
 
 #pragma mark - Controlling Access
 
 - (void)beginCacheAccess
 {
-	[mImageCache setCountLimit:kHighCacheLimit];
+	[mImageCache setCapacity:kHighCacheCapacity];
 }
 
 - (void)endCacheAccess
 {
-	[mImageCache setCountLimit:kLowCacheLimit];
+	[mImageCache setCapacity:kLowCacheCapacity];
 }
 
 @end
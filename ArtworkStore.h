@@ -0,0 +1,114 @@
+//
+//  ArtworkStore.h
+//  Pinna
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+
+///The ArtworkStore class encapsulates a packed, append-only file of encoded thumbnails.
+///
+///Every thumbnail is appended to a single data file as a self-describing record, and
+///is located through an in-memory hash index keyed by name. Reads are served from a
+///memory mapping of the data file, so looking up a thumbnail neither stats nor opens
+///a file. Removing a thumbnail appends a tombstone, and the space taken by replaced and
+///removed thumbnails is reclaimed by compaction.
+///
+///Each record carries a checksum. The index is rebuilt from the data file the first time
+///a store is used, and a record that was only partially written when the app last exited
+///is discarded along with everything after it. Rebuilding the index reads the entire data
+///file, so `-loadIndex` should be called from a background queue before the store is used.
+///
+///ArtworkStore is safe to use from multiple threads.
+@interface ArtworkStore : NSObject
+{
+	pthread_mutex_t mLock;
+	int mFileDescriptor;
+	unsigned long long mFileLength;
+	BOOL mIsIndexLoaded;
+	
+	///Names to the NSValue-wrapped ranges of their data in the data file.
+	NSMutableDictionary *mIndex;
+	
+	///A memory mapping of the data file. Replaced when a lookup falls outside of it.
+	NSData *mMappedData;
+	
+	unsigned long long mReclaimableSize;
+}
+
+///Initialize the receiver with the location of its data file.
+///
+/// \param  path    The location of the data file. Created if it does not exist. Required.
+///
+/// \result A fully initialized artwork store.
+///
+///The data file is opened, but not read until the receiver's index is loaded.
+///This is the designated initializer.
+- (id)initWithPath:(NSString *)path;
+
+#pragma mark - Properties
+
+///The location of the receiver's data file.
+@property (readonly, copy) NSString *path;
+
+///The number of thumbnails in the receiver.
+@property (readonly) NSUInteger count;
+
+///The number of bytes in the receiver's data file that belong to replaced or removed thumbnails.
+@property (readonly) unsigned long long reclaimableSize;
+
+#pragma mark - Thumbnails
+
+///Returns whether or not the receiver contains a thumbnail with a given name.
+- (BOOL)containsDataForName:(NSString *)name;
+
+///Returns the encoded thumbnail with a given name, or nil if there is none.
+- (NSData *)dataForName:(NSString *)name;
+
+///Returns the length of the encoded thumbnail with a given name, or 0 if there is none.
+- (NSUInteger)lengthOfDataForName:(NSString *)name;
+
+///Appends an encoded thumbnail with a given name, replacing any existing thumbnail with the same name.
+///
+/// \param  data    The encoded thumbnail. Required.
+/// \param  name    The name of the thumbnail. Required.
+///
+/// \result YES if the thumbnail could be written; NO otherwise.
+///
+///Appended thumbnails are not guaranteed to survive a crash until `-synchronize` is called.
+- (BOOL)setData:(NSData *)data forName:(NSString *)name;
+
+///Removes the thumbnails with the given names.
+- (void)removeDataForNames:(NSArray *)names;
+
+///Removes all thumbnails from the receiver, replacing its data file with an empty one.
+///
+///Thumbnails previously returned by the receiver remain readable.
+- (void)removeAllData;
+
+///Returns the names of all of the thumbnails in the receiver.
+- (NSArray *)allNames;
+
+#pragma mark - Maintenance
+
+///Rebuilds the receiver's index from its data file, if it has not already been.
+///
+///Every other method loads the index on demand. Calling this method
+///ahead of time moves the cost of reading the data file off of the
+///thread that first uses the receiver.
+- (void)loadIndex;
+
+///Flushes all appended records to the mass storage device.
+- (void)synchronize;
+
+///Rewrites the receiver's data file so that it only contains live thumbnails,
+///if at least half of the file belongs to replaced or removed thumbnails.
+///
+///The new data file is written to a temporary location and moved into place, so
+///a crash during compaction leaves either the old or the new data file intact.
+- (void)compactIfNeeded;
+
+@end
@@ -0,0 +1,525 @@
+//
+//  ArtworkStore.m
+//  Pinna
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "ArtworkStore.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+///The first four bytes of every data file, 'PnAS'.
+static uint32_t const kFileSignature = 0x506E4153;
+
+///The version of the data file format.
+static uint32_t const kFileVersion = 1;
+
+///The length of the header at the start of every data file, a signature followed by a version.
+static unsigned long long const kFileHeaderLength = sizeof(uint32_t) * 2;
+
+///The data length of a record that removes the thumbnail with its name.
+static uint32_t const kTombstoneDataLength = UINT32_MAX;
+
+///The smallest number of reclaimable bytes that will cause a data file to be compacted.
+static unsigned long long const kMinimumCompactionSize = (1024 * 256);
+
+///The on-disk header of a record. All fields are big endian.
+///
+///A record is its header, followed by its name in UTF-8, followed by its data.
+typedef struct ArtworkStoreRecordHeader
+{
+	///The length of the record's name in bytes.
+	uint32_t nameLength;
+	
+	///The length of the record's data in bytes, or `kTombstoneDataLength`.
+	uint32_t dataLength;
+	
+	///The FNV-1a hash of the record's name followed by its data.
+	uint32_t checksum;
+} ArtworkStoreRecordHeader;
+
+#pragma mark - Records
+
+///The initial value of an FNV-1a hash.
+static uint32_t const kChecksumSeed = 2166136261U;
+
+///Continues an FNV-1a hash over a given buffer.
+static uint32_t ArtworkStoreChecksum(uint32_t hash, const void *bytes, size_t length)
+{
+	const uint8_t *characters = bytes;
+	for (size_t index = 0; index < length; index++)
+	{
+		hash ^= characters[index];
+		hash *= 16777619U;
+	}
+	
+	return hash;
+}
+
+///Appends a record to a given buffer.
+///
+/// \param  buffer      The buffer to append the record to. Required.
+/// \param  nameData    The UTF-8 name of the record. Required.
+/// \param  data        The data of the record, or NULL for a tombstone.
+/// \param  dataLength  The length of `data`.
+static void ArtworkStoreAppendRecord(NSMutableData *buffer, NSData *nameData, const void *data, uint32_t dataLength)
+{
+	uint32_t checksum = ArtworkStoreChecksum(kChecksumSeed, [nameData bytes], [nameData length]);
+	if(data)
+		checksum = ArtworkStoreChecksum(checksum, data, dataLength);
+	
+	ArtworkStoreRecordHeader header = {
+		.nameLength = CFSwapInt32HostToBig((uint32_t)[nameData length]),
+		.dataLength = CFSwapInt32HostToBig(data? dataLength : kTombstoneDataLength),
+		.checksum = CFSwapInt32HostToBig(checksum),
+	};
+	[buffer appendBytes:&header length:sizeof(header)];
+	[buffer appendData:nameData];
+	if(data)
+		[buffer appendBytes:data length:dataLength];
+}
+
+///Returns the length of the record for a given name and data range.
+static unsigned long long ArtworkStoreRecordLength(NSString *name, NSRange dataRange)
+{
+	return sizeof(ArtworkStoreRecordHeader) + [name lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + dataRange.length;
+}
+
+///Writes an entire buffer to a file descriptor at a given offset, retrying short writes.
+static BOOL ArtworkStoreWrite(int fileDescriptor, const void *bytes, size_t length, off_t offset)
+{
+	const uint8_t *cursor = bytes;
+	while (length > 0)
+	{
+		ssize_t bytesWritten = pwrite(fileDescriptor, cursor, length, offset);
+		if(bytesWritten <= 0)
+		{
+			if(bytesWritten == -1 && errno == EINTR)
+				continue;
+			
+			return NO;
+		}
+		
+		cursor += bytesWritten;
+		offset += bytesWritten;
+		length -= (size_t)bytesWritten;
+	}
+	
+	return YES;
+}
+
+#pragma mark -
+
+@implementation ArtworkStore
+
+- (void)dealloc
+{
+	if(mFileDescriptor != -1)
+		close(mFileDescriptor);
+	
+	pthread_mutex_destroy(&mLock);
+}
+
+- (id)initWithPath:(NSString *)path
+{
+	NSParameterAssert(path);
+	
+	if((self = [super init]))
+	{
+		_path = [path copy];
+		mIndex = [NSMutableDictionary dictionary];
+		pthread_mutex_init(&mLock, NULL);
+		
+		mFileDescriptor = open([_path fileSystemRepresentation], O_RDWR | O_CREAT, 0644);
+		if(mFileDescriptor == -1)
+			NSLog(@"*** Could not open artwork store %@. %s", _path, strerror(errno));
+	}
+	
+	return self;
+}
+
+#pragma mark - Recovery
+
+- (void)loadIndex
+{
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	pthread_mutex_unlock(&mLock);
+}
+
+///Rebuilds the receiver's index from its data file the first time it is called.
+///The receiver's lock must be held.
+///
+///The data file is truncated to the last complete record. A data file
+///without a valid header is treated as empty.
+- (void)loadIndexIfNeeded
+{
+	if(mIsIndexLoaded || mFileDescriptor == -1)
+		return;
+	
+	mIsIndexLoaded = YES;
+	
+	NSData *fileData = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedAlways error:NULL];
+	const uint8_t *bytes = [fileData bytes];
+	NSUInteger length = [fileData length];
+	
+	uint32_t fileHeader[2] = { 0, 0 };
+	if(length >= kFileHeaderLength)
+		memcpy(fileHeader, bytes, sizeof(fileHeader));
+	
+	if(CFSwapInt32BigToHost(fileHeader[0]) != kFileSignature || CFSwapInt32BigToHost(fileHeader[1]) != kFileVersion)
+	{
+		[self resetDataFile];
+		return;
+	}
+	
+	NSUInteger offset = kFileHeaderLength;
+	while (offset + sizeof(ArtworkStoreRecordHeader) <= length)
+	{
+		ArtworkStoreRecordHeader header;
+		memcpy(&header, bytes + offset, sizeof(header));
+		
+		uint32_t nameLength = CFSwapInt32BigToHost(header.nameLength);
+		uint32_t dataLength = CFSwapInt32BigToHost(header.dataLength);
+		BOOL isTombstone = (dataLength == kTombstoneDataLength);
+		if(isTombstone)
+			dataLength = 0;
+		
+		NSUInteger nameOffset = offset + sizeof(header);
+		NSUInteger dataOffset = nameOffset + nameLength;
+		if((unsigned long long)dataOffset + dataLength > length)
+			break;
+		
+		uint32_t checksum = ArtworkStoreChecksum(kChecksumSeed, bytes + nameOffset, nameLength);
+		if(!isTombstone)
+			checksum = ArtworkStoreChecksum(checksum, bytes + dataOffset, dataLength);
+		if(checksum != CFSwapInt32BigToHost(header.checksum))
+			break;
+		
+		NSString *name = [[NSString alloc] initWithBytes:bytes + nameOffset length:nameLength encoding:NSUTF8StringEncoding];
+		if(!name)
+			break;
+		
+		NSUInteger recordLength = sizeof(header) + nameLength + dataLength;
+		NSValue *existingRange = mIndex[name];
+		if(existingRange)
+			mReclaimableSize += ArtworkStoreRecordLength(name, [existingRange rangeValue]);
+		
+		if(isTombstone)
+		{
+			[mIndex removeObjectForKey:name];
+			mReclaimableSize += recordLength;
+		}
+		else
+		{
+			mIndex[name] = [NSValue valueWithRange:NSMakeRange(dataOffset, dataLength)];
+		}
+		
+		offset += recordLength;
+	}
+	
+	if(offset < length)
+	{
+		NSLog(@"*** Discarding %ld bytes of incomplete artwork records in %@", (long)(length - offset), _path);
+		
+		//No thumbnails have been returned from the mapping yet, so it
+		//can be dropped before the discarded region is cut off the file.
+		fileData = nil;
+		ftruncate(mFileDescriptor, (off_t)offset);
+	}
+	
+	mFileLength = offset;
+	mMappedData = fileData;
+}
+
+///Replaces the receiver's data file with a new one that only contains a header.
+///The receiver's lock must be held or unnecessary.
+///
+///The old data file is unlinked rather than truncated, so any thumbnails
+///already returned from its memory mapping remain readable.
+- (void)resetDataFile
+{
+	mMappedData = nil;
+	[mIndex removeAllObjects];
+	mReclaimableSize = 0;
+	mFileLength = 0;
+	
+	if(mFileDescriptor != -1)
+	{
+		close(mFileDescriptor);
+		unlink([_path fileSystemRepresentation]);
+	}
+	
+	uint32_t fileHeader[2] = { CFSwapInt32HostToBig(kFileSignature), CFSwapInt32HostToBig(kFileVersion) };
+	mFileDescriptor = open([_path fileSystemRepresentation], O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(mFileDescriptor == -1 || !ArtworkStoreWrite(mFileDescriptor, fileHeader, sizeof(fileHeader), 0))
+	{
+		NSLog(@"*** Could not reset artwork store %@. %s", _path, strerror(errno));
+		return;
+	}
+	
+	mFileLength = kFileHeaderLength;
+}
+
+#pragma mark - Properties
+
+- (NSUInteger)count
+{
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	NSUInteger count = [mIndex count];
+	pthread_mutex_unlock(&mLock);
+	
+	return count;
+}
+
+- (unsigned long long)reclaimableSize
+{
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	unsigned long long reclaimableSize = mReclaimableSize;
+	pthread_mutex_unlock(&mLock);
+	
+	return reclaimableSize;
+}
+
+#pragma mark - Thumbnails
+
+- (BOOL)containsDataForName:(NSString *)name
+{
+	NSParameterAssert(name);
+	
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	BOOL containsData = (mIndex[name] != nil);
+	pthread_mutex_unlock(&mLock);
+	
+	return containsData;
+}
+
+- (NSData *)dataForName:(NSString *)name
+{
+	NSParameterAssert(name);
+	
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	
+	NSData *data = nil;
+	NSValue *rangeValue = mIndex[name];
+	if(rangeValue)
+	{
+		NSRange range = [rangeValue rangeValue];
+		if(NSMaxRange(range) > [mMappedData length])
+			mMappedData = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedAlways error:NULL];
+		
+		if(NSMaxRange(range) <= [mMappedData length])
+			data = [mMappedData subdataWithRange:range];
+	}
+	
+	pthread_mutex_unlock(&mLock);
+	
+	return data;
+}
+
+- (NSUInteger)lengthOfDataForName:(NSString *)name
+{
+	NSParameterAssert(name);
+	
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	NSUInteger length = [mIndex[name] rangeValue].length;
+	pthread_mutex_unlock(&mLock);
+	
+	return length;
+}
+
+- (BOOL)setData:(NSData *)data forName:(NSString *)name
+{
+	NSParameterAssert(data);
+	NSParameterAssert(name);
+	
+	if([data length] >= kTombstoneDataLength)
+		return NO;
+	
+	NSData *nameData = [name dataUsingEncoding:NSUTF8StringEncoding];
+	NSMutableData *record = [NSMutableData dataWithCapacity:sizeof(ArtworkStoreRecordHeader) + [nameData length] + [data length]];
+	ArtworkStoreAppendRecord(record, nameData, [data bytes], (uint32_t)[data length]);
+	
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	
+	BOOL succeeded = (mFileDescriptor != -1 && ArtworkStoreWrite(mFileDescriptor, [record bytes], [record length], (off_t)mFileLength));
+	if(succeeded)
+	{
+		NSValue *existingRange = mIndex[name];
+		if(existingRange)
+			mReclaimableSize += ArtworkStoreRecordLength(name, [existingRange rangeValue]);
+		
+		NSUInteger dataOffset = (NSUInteger)mFileLength + sizeof(ArtworkStoreRecordHeader) + [nameData length];
+		mIndex[name] = [NSValue valueWithRange:NSMakeRange(dataOffset, [data length])];
+		mFileLength += [record length];
+	}
+	else
+	{
+		NSLog(@"*** Could not append to artwork store %@. %s", _path, strerror(errno));
+	}
+	
+	pthread_mutex_unlock(&mLock);
+	
+	return succeeded;
+}
+
+- (void)removeDataForNames:(NSArray *)names
+{
+	NSParameterAssert(names);
+	
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	
+	NSMutableData *records = [NSMutableData data];
+	NSMutableArray *removedNames = [NSMutableArray array];
+	for (NSString *name in names)
+	{
+		if(!mIndex[name])
+			continue;
+		
+		ArtworkStoreAppendRecord(records, [name dataUsingEncoding:NSUTF8StringEncoding], NULL, 0);
+		[removedNames addObject:name];
+	}
+	
+	if([records length] > 0 && mFileDescriptor != -1)
+	{
+		if(ArtworkStoreWrite(mFileDescriptor, [records bytes], [records length], (off_t)mFileLength))
+		{
+			for (NSString *name in removedNames)
+				mReclaimableSize += ArtworkStoreRecordLength(name, [mIndex[name] rangeValue]);
+			
+			[mIndex removeObjectsForKeys:removedNames];
+			mReclaimableSize += [records length];
+			mFileLength += [records length];
+		}
+		else
+		{
+			NSLog(@"*** Could not append to artwork store %@. %s", _path, strerror(errno));
+		}
+	}
+	
+	pthread_mutex_unlock(&mLock);
+}
+
+- (void)removeAllData
+{
+	pthread_mutex_lock(&mLock);
+	
+	//The data file is about to be discarded, so there is no reason to read it first.
+	mIsIndexLoaded = YES;
+	[self resetDataFile];
+	
+	pthread_mutex_unlock(&mLock);
+}
+
+- (NSArray *)allNames
+{
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	NSArray *names = [mIndex allKeys];
+	pthread_mutex_unlock(&mLock);
+	
+	return names;
+}
+
+#pragma mark - Maintenance
+
+- (void)synchronize
+{
+	pthread_mutex_lock(&mLock);
+	
+	if(mFileDescriptor != -1)
+		fsync(mFileDescriptor);
+	
+	pthread_mutex_unlock(&mLock);
+}
+
+- (void)compactIfNeeded
+{
+	pthread_mutex_lock(&mLock);
+	[self loadIndexIfNeeded];
+	
+	if(mFileDescriptor == -1 || mReclaimableSize < kMinimumCompactionSize || mReclaimableSize * 2 < mFileLength)
+	{
+		pthread_mutex_unlock(&mLock);
+		return;
+	}
+	
+	NSDate *startDate = [NSDate date];
+	unsigned long long previousFileLength = mFileLength;
+	
+	NSData *fileData = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedAlways error:NULL];
+	NSString *temporaryPath = [_path stringByAppendingPathExtension:@"compacting"];
+	int temporaryFileDescriptor = open([temporaryPath fileSystemRepresentation], O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(!fileData || temporaryFileDescriptor == -1)
+	{
+		NSLog(@"*** Could not compact artwork store %@. %s", _path, strerror(errno));
+		if(temporaryFileDescriptor != -1)
+			close(temporaryFileDescriptor);
+		
+		pthread_mutex_unlock(&mLock);
+		return;
+	}
+	
+	//Records are copied straight out of the mapping one at a time,
+	//so compaction never holds more than one thumbnail in memory.
+	uint32_t fileHeader[2] = { CFSwapInt32HostToBig(kFileSignature), CFSwapInt32HostToBig(kFileVersion) };
+	BOOL succeeded = ArtworkStoreWrite(temporaryFileDescriptor, fileHeader, sizeof(fileHeader), 0);
+	unsigned long long offset = kFileHeaderLength;
+	NSMutableDictionary *compactedIndex = [NSMutableDictionary dictionaryWithCapacity:[mIndex count]];
+	NSMutableData *record = [NSMutableData data];
+	for (NSString *name in mIndex)
+	{
+		if(!succeeded)
+			break;
+		
+		NSRange range = [mIndex[name] rangeValue];
+		if(NSMaxRange(range) > [fileData length])
+		{
+			succeeded = NO;
+			break;
+		}
+		
+		NSData *nameData = [name dataUsingEncoding:NSUTF8StringEncoding];
+		[record setLength:0];
+		ArtworkStoreAppendRecord(record, nameData, (const uint8_t *)[fileData bytes] + range.location, (uint32_t)range.length);
+		succeeded = ArtworkStoreWrite(temporaryFileDescriptor, [record bytes], [record length], (off_t)offset);
+		
+		NSUInteger dataOffset = (NSUInteger)offset + sizeof(ArtworkStoreRecordHeader) + [nameData length];
+		compactedIndex[name] = [NSValue valueWithRange:NSMakeRange(dataOffset, range.length)];
+		offset += [record length];
+	}
+	
+	if(succeeded)
+		succeeded = (fsync(temporaryFileDescriptor) == 0 && rename([temporaryPath fileSystemRepresentation], [_path fileSystemRepresentation]) == 0);
+	
+	if(succeeded)
+	{
+		close(mFileDescriptor);
+		mFileDescriptor = temporaryFileDescriptor;
+		mFileLength = offset;
+		mIndex = compactedIndex;
+		mReclaimableSize = 0;
+		mMappedData = nil;
+		
+		NSLog(@"Compacted artwork store from %llu to %llu bytes in %.2f seconds", previousFileLength, mFileLength, -[startDate timeIntervalSinceNow]);
+	}
+	else
+	{
+		NSLog(@"*** Could not compact artwork store %@. %s", _path, strerror(errno));
+		close(temporaryFileDescriptor);
+		unlink([temporaryPath fileSystemRepresentation]);
+	}
+	
+	pthread_mutex_unlock(&mLock);
+}
+
+@end
@@ -104,6 +104,9 @@ typedef enum AudioPlayerMode : NSUInteger {
 	///Whether or not the last track had video.
 	BOOL mLastTrackHadVideo;
 	
+	///The token for work being done on behalf of the song currently being played.
+	RKCancellationToken *mPlayingSongCancellationToken;
+	
 	
 	///The queue used to load remote artwork.
 	dispatch_queue_t mArtworkLoadQueue;
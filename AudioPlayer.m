@@ -28,6 +28,14 @@ static NSString *const kShouldPauseWhenHeadphonesAreUnpluggedDefaultsKey = @"Aud
 static NSString *const kShouldSkipRemoteSongsInShuffleDefaultsKey = @"AudioPlayer_shouldSkipRemoteSongsInShuffle";
 NSString *const kAutoSubstituteBadSourcesKey = @"AudioPlayer_autoSubstituteBadSources";
 
+//These are read constantly during playback and shuffle, so they're cached rather than read from the user defaults each time.
+static RK_DEFINE_SETTING(NumberOfRecentlyPlayedSongsSetting, kNumberOfRecentlyPlayedSongsDefaultsKey, kRKSettingTypeInteger)
+static RK_DEFINE_SETTING(VolumeSetting, kVolumeDefaultsKey, kRKSettingTypeFloat)
+static RK_DEFINE_SETTING(ModeSetting, kModeDefaultsKey, kRKSettingTypeInteger)
+static RK_DEFINE_SETTING(ShouldPauseWhenHeadphonesAreUnpluggedSetting, kShouldPauseWhenHeadphonesAreUnpluggedDefaultsKey, kRKSettingTypeBool)
+static RK_DEFINE_SETTING(ShouldSkipRemoteSongsInShuffleSetting, kShouldSkipRemoteSongsInShuffleDefaultsKey, kRKSettingTypeBool)
+static RK_DEFINE_SETTING(AutoSubstituteBadSourcesSetting, kAutoSubstituteBadSourcesKey, kRKSettingTypeBool)
+
 NSString *const AudioPlayerShuffleModeFailedNotification = @"AudioPlayerShuffleModeFailedNotification";
 NSString *const AudioPlayerErrorDidOccurNotification = @"AudioPlayerErrorDidOccurNotification";
 
@@ -69,6 +77,7 @@ AudioPlayer *Player = nil;
 
 - (void)dealloc
 {
+    [mPlayingSongCancellationToken cancel];
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
@@ -79,7 +88,7 @@ AudioPlayer *Player = nil;
 	
 	mPlayer = [AVPlayer new];
 	mPlayer.actionAtItemEnd = AVPlayerActionAtItemEndPause;
-	mPlayer.volume = RKGetPersistentFloat(kVolumeDefaultsKey);
+	mPlayer.volume = VolumeSetting().floatValue;
 	
 	__block AudioPlayer *me = self;
 	mPeriodicTimeObserver = [mPlayer addPeriodicTimeObserverForInterval:CMTimeMake(1, 60) queue:dispatch_get_main_queue() usingBlock:^(CMTime time) {
@@ -211,7 +220,7 @@ static OSStatus DefaultAudioDeviceDidChangeListenerProc(AudioObjectID objectID,
 		if(GetAudioOutputDestination() != kOutputDestinationHeadphones)
 		{
 			if(RK_FLAG_IS_SET([NSEvent modifierFlags], NSAlternateKeyMask) ||
-			   !RKGetPersistentBool(kShouldPauseWhenHeadphonesAreUnpluggedDefaultsKey))
+			   !ShouldPauseWhenHeadphonesAreUnpluggedSetting().boolValue)
 			{
 				return;
 			}
@@ -374,11 +383,12 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 	[mSongsKnownInvalidToShuffle addObject:song];
 	
     //We attempt to substitute bad sources automatically.
-    if(RKGetPersistentBool(kAutoSubstituteBadSourcesKey) &&
+    if(AutoSubstituteBadSourcesSetting().boolValue &&
        !song.hasVideo && [self isMissingFileError:playbackError])
     {
         NSString *searchQuery = [NSString stringWithFormat:@"%@ %@", song.artist, song.name];
         RKPromise *replacementSongSearch = [[ExfmSession defaultSession] searchSongsWithQuery:searchQuery offset:0];
+        replacementSongSearch.cancellationToken = mPlayingSongCancellationToken;
         [replacementSongSearch then:^(NSDictionary *response) {
             //The user has skipped the playing song.
             if(![song isEqualToSong:mPlayingSong])
@@ -674,8 +684,19 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 	}
 }
 
+///Cancels any work still being done on behalf of the song currently being played.
+- (void)cancelWorkForPlayingSong
+{
+	[mPlayingSongCancellationToken cancel];
+	mPlayingSongCancellationToken = [RKCancellationToken new];
+}
+
 - (void)setPlayingSong:(Song *)playingSong
 {
+	//The user has skipped the playing song, so nothing
+	//being done on its behalf matters any longer.
+	[self cancelWorkForPlayingSong];
+	
 	if(playingSong.isProtected && playingSong.hasVideo)
 	{
 		mPlayingSong = playingSong;
@@ -754,7 +775,7 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 	
 	mPlayingSong = playingSong;
 	
-	NSInteger numberOfRecentlyPlayedSongs = RKGetPersistentInteger(kNumberOfRecentlyPlayedSongsDefaultsKey);
+	NSInteger numberOfRecentlyPlayedSongs = NumberOfRecentlyPlayedSongsSetting().integerValue;
 	if(numberOfRecentlyPlayedSongs != -1)
 	{
 		NSUInteger indexOfPlayingSong = [playQueue indexOfObject:mPlayingSong];
@@ -808,24 +829,24 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 {
 	mPlayer.volume = volume;
 	
-	RKSetPersistentFloat(kVolumeDefaultsKey, volume);
+	VolumeSetting().floatValue = volume;
 }
 
 - (float)volume
 {
-	return RKGetPersistentFloat(kVolumeDefaultsKey);
+	return VolumeSetting().floatValue;
 }
 
 #pragma mark -
 
 - (void)setMode:(AudioPlayerMode)mode
 {
-    RKSetPersistentInteger(kModeDefaultsKey, mode);
+    ModeSetting().integerValue = mode;
 }
 
 - (AudioPlayerMode)mode
 {
-    return RKGetPersistentInteger(kModeDefaultsKey);
+    return ModeSetting().integerValue;
 }
 
 #pragma mark -
@@ -926,7 +947,7 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 
 - (BOOL)shouldSkipSongInShuffle:(Song *)song
 {
-	BOOL shouldSkipRemoteSongsInShuffle = RKGetPersistentBool(kShouldSkipRemoteSongsInShuffleDefaultsKey);
+	BOOL shouldSkipRemoteSongsInShuffle = ShouldSkipRemoteSongsInShuffleSetting().boolValue;
 	BOOL basicSkipConditions = (song.hasVideo ||
                                 song.disabled ||
                                 [mSongsKnownInvalidToShuffle containsObject:song]);
@@ -1229,6 +1250,8 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 
 - (void)stop
 {
+	[self cancelWorkForPlayingSong];
+	
 	[self willChangeValueForKey:@"playingSong"];
 	
 	[mPlayer pause];
@@ -1310,7 +1333,7 @@ static void SystemSleepCallback(void *refCon, io_service_t service, natural_t me
 	NSMutableArray *playQueue = [mPlayQueue mutableCopy];
 	NSArray *playQueueHistory = nil;
 	
-	NSInteger numberOfRecentlyPlayedSongs = RKGetPersistentInteger(kNumberOfRecentlyPlayedSongsDefaultsKey);
+	NSInteger numberOfRecentlyPlayedSongs = NumberOfRecentlyPlayedSongsSetting().integerValue;
 	NSUInteger indexOfPlayingSong = [playQueue indexOfObject:mPlayingSong];
 	if(indexOfPlayingSong != NSNotFound)
 	{
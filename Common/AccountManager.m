@@ -90,7 +90,7 @@ NSString *const AccountManagerAffectedAccountKey = @"AccountManagerAffectedAccou
     NSParameterAssert(account);
     
     RKPromise *promise = [RKPromise new];
-    [[RKQueueManager commonQueue] addOperationWithBlock:^{
+    [[RKExecutor commonExecutor] addOperationWithBlock:^{
         NSError *error = nil;
         if([[account.descriptor.service logout] await:&error]) {
             dispatch_sync(dispatch_get_main_queue(), ^{
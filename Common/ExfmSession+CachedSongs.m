@@ -109,6 +109,32 @@ static NSString *const kCachedLoveFriendActivitiesUserDefaultsKey = @"Exfm_cache
     } onQueue:[[self class] sessionRequestQueue]];
 }
 
+///Returns the loved songs fetched so far during an update, followed by
+///the previously cached loved songs which have not been fetched yet.
+- (NSArray *)lovedSongsByMergingFetchedSongs:(NSArray *)fetchedSongs withCachedSongs:(NSArray *)cachedSongs
+{
+	NSSet *fetchedSongIDs = [NSSet setWithArray:[fetchedSongs valueForKey:@"id"]];
+	NSArray *unfetchedSongs = RKCollectionFilterToArray(cachedSongs, ^BOOL(NSDictionary *songResult) {
+		return ![fetchedSongIDs containsObject:songResult[@"id"]];
+	});
+	
+	return [fetchedSongs arrayByAddingObjectsFromArray:unfetchedSongs];
+}
+
+///Replaces the loved songs in memory on the main queue, without persisting them.
+- (void)showLovedSongs:(NSArray *)lovedSongs
+{
+	[[NSOperationQueue mainQueue] addOperationWithBlock:^{
+		@synchronized(self) {
+			[self willChangeValueForKey:@"lovedSongs"];
+			[self setAssociatedValue:lovedSongs forKey:@"cachedLovedSongs"];
+			[self didChangeValueForKey:@"lovedSongs"];
+			
+			[[NSNotificationCenter defaultCenter] postNotificationName:ExfmSessionUpdatedCachedLovedSongsNotification object:self];
+		}
+	}];
+}
+
 - (void)updateCachedSongs
 {
 	if(!self.username) {
@@ -147,41 +173,30 @@ static NSString *const kCachedLoveFriendActivitiesUserDefaultsKey = @"Exfm_cache
 			return;
 		}
 		
-		NSMutableArray *newLovedSongs = [NSMutableArray array];
-		[newLovedSongs addObjectsFromArray:remoteSongs];
+		//The loved songs fill in a page at a time as the remaining pages arrive,
+		//with the previously cached songs that haven't been fetched yet after them.
+		NSMutableArray *newLovedSongs = [remoteSongs mutableCopy];
+		[self showLovedSongs:[self lovedSongsByMergingFetchedSongs:newLovedSongs withCachedSongs:localSongs]];
 		
-        NSUInteger offset = 50;
-        for (;;)
-        {
-            NSError *error = nil;
-            NSDictionary *response = [[self lovedSongsStartingAtOffset:offset] await:&error];
-            if(!response)
-            {
-                NSLog(@"Could not fetch loved songs. Error: %@", error);
-                break;
-            }
-            
-            remoteSongs = response[@"songs"];
-            if([remoteSongs count] > 0) {
-				[newLovedSongs addObjectsFromArray:remoteSongs];
-				
-				offset += 50;
-			} else {
-				RKSetPersistentObject(kCachedLovedSongsUserDefaultsKey, [NSKeyedArchiver archivedDataWithRootObject:newLovedSongs]);
-				
-				[[NSOperationQueue mainQueue] addOperationWithBlock:^{
-					@synchronized(self) {
-						[self willChangeValueForKey:@"lovedSongs"];
-						[self setAssociatedValue:newLovedSongs forKey:@"cachedLovedSongs"];
-						[self didChangeValueForKey:@"lovedSongs"];
-						
-						[[NSNotificationCenter defaultCenter] postNotificationName:ExfmSessionUpdatedCachedLovedSongsNotification object:self];
-					}
-				}];
-                
-                break;
+		RKStream *remainingLovedSongs = [self lovedSongsStreamStartingAtOffset:50];
+		[remainingLovedSongs subscribeWithElement:^(NSDictionary *song) {
+			[newLovedSongs addObject:song];
+			
+			if(([newLovedSongs count] % 50) == 0)
+				[self showLovedSongs:[self lovedSongsByMergingFetchedSongs:newLovedSongs withCachedSongs:localSongs]];
+		} completion:^(NSError *error) {
+			if(error)
+			{
+				NSLog(@"Could not fetch loved songs. Error: %@", error);
+				return;
 			}
-        }
+			
+			NSArray *lovedSongs = [newLovedSongs copy];
+			RKSetPersistentObject(kCachedLovedSongsUserDefaultsKey, [NSKeyedArchiver archivedDataWithRootObject:lovedSongs]);
+			
+			[self showLovedSongs:lovedSongs];
+		} onQueue:[[self class] sessionRequestQueue]];
+		[remainingLovedSongs requestElements:kRKStreamUnboundedDemand];
 	} otherwise:^(NSError *error) {
 		NSLog(@"Could not fetch loved songs. Error: %@", error);
 	} onQueue:[[self class] sessionRequestQueue]];
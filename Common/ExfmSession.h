@@ -9,7 +9,7 @@
 #import <Foundation/Foundation.h>
 #import "Service.h"
 
-@class RKURLRequestPromise;
+@class RKURLRequestPromise, RKStream;
 
 ///The post processor used by the ExfmSession class.
 RK_EXTERN RKPostProcessorBlock const kExfmPostProcessor;
@@ -87,6 +87,66 @@ RK_EXTERN RKPostProcessorBlock const kExfmPostProcessor;
 /// \result A promise that will yield an array of exfm song entities on success.
 - (RKPromise *)allLovedSongsOfFriends RK_REQUIRE_RESULT_USED;
 
+///Returns a promise to yield the items of every page of a paged feed.
+///
+/// \param  offset          The offset of the first page to fetch.
+/// \param  pageForOffset   A block which returns a promise for the page at a given offset. Required.
+/// \param  itemsInPage     A block which returns the items in a page. Required.
+///
+/// \result A promise that will yield an array of the items of every page on success.
+///
+///Pages are fetched one after another until an empty page is found,
+///without blocking a thread while each page is being fetched.
+///Cancelling the returned promise cancels the request for the page being fetched.
+- (RKPromise *)itemsOfPagesStartingAtOffset:(NSUInteger)offset
+                              pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage RK_REQUIRE_RESULT_USED;
+
+#pragma mark - Streams
+
+///Returns a stream of the items of every page of a paged feed.
+///
+/// \param  offset          The offset of the first page to fetch.
+/// \param  pageForOffset   A block which returns a promise for the page at a given offset. Required.
+/// \param  itemsInPage     A block which returns the items in a page. Required.
+///
+/// \result A stream which yields the items of each page as it is fetched, and ends at the first empty page.
+///
+///Pages are only fetched as the stream's buffer empties, so a stream
+///which is no longer being read from stops making requests.
+- (RKStream *)streamOfItemsOfPagesStartingAtOffset:(NSUInteger)offset
+                                     pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                       itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage RK_REQUIRE_RESULT_USED;
+
+///Returns a stream of the items of every page of a paged feed.
+///
+/// \param  offset          The offset of the first page to fetch.
+/// \param  pageForOffset   A block which returns a promise for the page at a given offset. Required.
+/// \param  itemsInPage     A block which returns the items in a page. Required.
+/// \param  endsAtShortPage Whether or not a page with fewer items than were requested is the last page.
+///                         Only pass YES for feeds whose every page but the last is known to be full.
+///
+/// \result A stream which yields the items of each page as it is fetched, and ends at the first
+///         empty page, or at the first short page if `endsAtShortPage` is YES.
+- (RKStream *)streamOfItemsOfPagesStartingAtOffset:(NSUInteger)offset
+                                     pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                       itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage
+                                   endsAtShortPage:(BOOL)endsAtShortPage RK_REQUIRE_RESULT_USED;
+
+///Returns a stream of the user's loved songs, as exfm song entities.
+- (RKStream *)lovedSongsStreamStartingAtOffset:(NSUInteger)offset RK_REQUIRE_RESULT_USED;
+
+///Returns a stream of the user's friend's loved songs, as exfm song entities.
+- (RKStream *)lovedSongsOfFriendsStream RK_REQUIRE_RESULT_USED;
+
+///Returns a stream of the songs matching a specified query, as exfm song entities.
+- (RKStream *)searchSongsStreamWithQuery:(NSString *)query startingAtOffset:(NSUInteger)offset RK_REQUIRE_RESULT_USED;
+
+///Returns a stream of the trending songs of today, as exfm song entities.
+///
+/// \param  tag The tag to get the trending songs of. If nil, the overall trending songs are streamed.
+- (RKStream *)trendingSongsStreamWithTag:(NSString *)tag RK_REQUIRE_RESULT_USED;
+
 #pragma mark -
 
 ///Returns a promise to fetch the logged in user's loved songs feed.
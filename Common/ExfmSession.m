@@ -39,6 +39,12 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
     RKFileSystemCacheManager *_cacheManager;
 }
 
+///The defaults key used to point the session at a different API endpoint, such as a local stand-in server.
+static NSString *const kExfmAPIURLOverrideDefaultsKey = @"ExfmAPIURLOverride";
+
+///The number of items requested for each page of a paged feed.
+static NSUInteger const kFeedPageSize = 50;
+
 #pragma mark - Requests
 
 + (NSOperationQueue *)sessionRequestQueue
@@ -46,8 +52,9 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
     static NSOperationQueue *sessionRequestQueue = nil;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        sessionRequestQueue = [NSOperationQueue new];
-        sessionRequestQueue.name = @"com.roundabout.pinna.ExfmSession.sessionRequestQueue";
+        sessionRequestQueue = [RKExecutor executorNamed:@"com.roundabout.pinna.ExfmSession.sessionRequestQueue"
+                                       qualityOfService:kRKExecutorQualityOfServiceUserInitiated
+                                                  width:kRKExecutorDefaultWidth];
     });
     
     return sessionRequestQueue;
@@ -58,12 +65,17 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
     static RKRequestFactory *sharedRequestFactory = nil;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        sharedRequestFactory = [[RKRequestFactory alloc] initWithBaseURL:[NSURL URLWithString:@"https://ex.fm/api/v3"]
+        NSString *apiURLString = RKGetPersistentObject(kExfmAPIURLOverrideDefaultsKey) ?: @"https://ex.fm/api/v3";
+        sharedRequestFactory = [[RKRequestFactory alloc] initWithBaseURL:[NSURL URLWithString:apiURLString]
                                                         readCacheManager:[RKFileSystemCacheManager sharedCacheManager]
                                                        writeCacheManager:nil
                                                             requestQueue:[self sessionRequestQueue]
                                                            postProcessor:kExfmPostProcessor];
         sharedRequestFactory.authenticationHandler = [self defaultSession];
+        sharedRequestFactory.memoryCache = [RKMemoryCache sharedMemoryCache];
+        
+        //Trending changes slowly, so show what we have immediately and refresh behind it.
+        [sharedRequestFactory setMaximumStaleness:RK_TIME_HOUR forPathPrefix:@"/trending"];
     });
     
     return sharedRequestFactory;
@@ -263,66 +275,107 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
 
 #pragma mark -
 
+- (RKPromise *)itemsOfPagesStartingAtOffset:(NSUInteger)offset
+                              pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage
+{
+    return [[self streamOfItemsOfPagesStartingAtOffset:offset
+                                         pageForOffset:pageForOffset
+                                           itemsInPage:itemsInPage] allElements];
+}
+
 - (RKPromise *)allLovedSongs
 {
-    RKPromise *promise = [RKPromise new];
-    [[self.class sessionRequestQueue] addOperationWithBlock:^{
-        NSMutableArray *allLovedSongs = [NSMutableArray array];
-        NSError *error = nil;
-        NSUInteger offset = 0;
-        for (;;) {
-            NSDictionary *response = [[self lovedSongsStartingAtOffset:offset] await:&error];
-            if(!response)
-                break;
-            
-            NSArray *remoteSongs = response[@"songs"];
-            if([remoteSongs count] > 0) {
-				[allLovedSongs addObjectsFromArray:remoteSongs];
-				
-				offset += 50;
-			} else {
-                break;
-			}
-        }
-        
-        if(error) {
-            [promise reject:error];
-        } else {
-            [promise accept:allLovedSongs];
-        }
-    }];
-    return promise;
+    return [[self lovedSongsStreamStartingAtOffset:0] allElements];
 }
 
 - (RKPromise *)allLovedSongsOfFriends
 {
-    RKPromise *promise = [RKPromise new];
-    [[self.class sessionRequestQueue] addOperationWithBlock:^{
-        NSMutableArray *allLovedSongs = [NSMutableArray array];
-        NSError *error = nil;
-        NSUInteger offset = 0;
-        for (;;) {
-            NSDictionary *response = [[self lovedSongsOfFriendsFeedStartingAtOffset:offset] await:&error];
-            if(!response)
-                break;
-            
-            NSArray *remoteSongs = [response valueForKeyPath:@"activities.object"];
-            if([remoteSongs count] > 0) {
-				[allLovedSongs addObjectsFromArray:remoteSongs];
-				
-				offset += 50;
-			} else {
-                break;
-			}
-        }
+    return [[self lovedSongsOfFriendsStream] allElements];
+}
+
+#pragma mark - Streams
+
+- (RKStream *)streamOfItemsOfPagesStartingAtOffset:(NSUInteger)offset
+                                     pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                       itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage
+{
+    return [self streamOfItemsOfPagesStartingAtOffset:offset
+                                        pageForOffset:pageForOffset
+                                          itemsInPage:itemsInPage
+                                      endsAtShortPage:NO];
+}
+
+- (RKStream *)streamOfItemsOfPagesStartingAtOffset:(NSUInteger)offset
+                                     pageForOffset:(RKPromise *(^)(NSUInteger offset))pageForOffset
+                                       itemsInPage:(NSArray *(^)(NSDictionary *page))itemsInPage
+                                   endsAtShortPage:(BOOL)endsAtShortPage
+{
+    NSParameterAssert(pageForOffset);
+    NSParameterAssert(itemsInPage);
+    
+    //Some feeds return short pages before their end, as items are filtered out after
+    //the page is fetched. Where that cannot happen, the stream ends with the short page
+    //instead of waiting on a request for a page which is known to be empty.
+    __block BOOL reachedLastPage = NO;
+    RKStream *stream = [[RKStream alloc] initWithProducer:^RKPromise *(NSUInteger batchIndex) {
+        if(reachedLastPage)
+            return nil;
         
-        if(error) {
-            [promise reject:error];
-        } else {
-            [promise accept:allLovedSongs];
-        }
+        return [pageForOffset(offset + batchIndex * kFeedPageSize) map:^id(NSDictionary *page) {
+            NSArray *items = itemsInPage(page) ?: @[];
+            if(items.count == 0 || (endsAtShortPage && items.count < kFeedPageSize))
+                reachedLastPage = YES;
+            
+            return items;
+        }];
+    }];
+    
+    //Keep about one page ahead of whoever is reading the stream.
+    stream.bufferCapacity = kFeedPageSize;
+    
+    return stream;
+}
+
+- (RKStream *)lovedSongsStreamStartingAtOffset:(NSUInteger)offset
+{
+    return [self streamOfItemsOfPagesStartingAtOffset:offset pageForOffset:^RKPromise *(NSUInteger pageOffset) {
+        return [self lovedSongsStartingAtOffset:pageOffset];
+    } itemsInPage:^NSArray *(NSDictionary *page) {
+        return page[@"songs"];
+    }];
+}
+
+- (RKStream *)lovedSongsOfFriendsStream
+{
+    return [self streamOfItemsOfPagesStartingAtOffset:0 pageForOffset:^RKPromise *(NSUInteger offset) {
+        return [self lovedSongsOfFriendsFeedStartingAtOffset:offset];
+    } itemsInPage:^NSArray *(NSDictionary *page) {
+        return [page valueForKeyPath:@"activities.object"];
+    }];
+}
+
+- (RKStream *)searchSongsStreamWithQuery:(NSString *)query startingAtOffset:(NSUInteger)offset
+{
+    NSParameterAssert(query);
+    
+    return [self streamOfItemsOfPagesStartingAtOffset:offset pageForOffset:^RKPromise *(NSUInteger pageOffset) {
+        return [self searchSongsWithQuery:query offset:pageOffset];
+    } itemsInPage:^NSArray *(NSDictionary *page) {
+        return page[@"songs"];
+    } endsAtShortPage:YES];
+}
+
+- (RKStream *)trendingSongsStreamWithTag:(NSString *)tag
+{
+    return [self streamOfItemsOfPagesStartingAtOffset:0 pageForOffset:^RKPromise *(NSUInteger offset) {
+        if(tag)
+            return [self trendingSongsWithTag:tag offset:offset];
+        else
+            return [self overallTrendingSongsFromOffset:offset];
+    } itemsInPage:^NSArray *(NSDictionary *page) {
+        return page[@"songs"];
     }];
-    return promise;
 }
 
 #pragma mark -
@@ -334,7 +387,7 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
     NSString *path = [NSString stringWithFormat:@"/user/%@/loved", [_username stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]];
     
     return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path
-                                                             parameters:@{@"results": @50, @"start": @(offset)}];
+                                                             parameters:@{@"results": @(kFeedPageSize), @"start": @(offset)}];
 }
 
 - (RKURLRequestPromise *)lovedSongsOfFriendsFeedStartingAtOffset:(NSUInteger)offset
@@ -344,7 +397,7 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
     NSString *path = [NSString stringWithFormat:@"/user/%@/feed/love", [_username stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]];
     
     return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path
-                                                             parameters:@{@"results": @50, @"start": @(offset)}];
+                                                             parameters:@{@"results": @(kFeedPageSize), @"start": @(offset)}];
 }
 
 #pragma mark -
@@ -413,7 +466,7 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
 	
 	NSString *path = [NSString stringWithFormat:@"/song/search/%@", [query stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]];
 	
-    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path parameters:@{@"results": @50, @"start": @(offset)}];
+    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path parameters:@{@"results": @(kFeedPageSize), @"start": @(offset)}];
 }
 
 - (RKURLRequestPromise *)loveSongWithID:(NSString *)songID
@@ -469,7 +522,7 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
 
 - (RKURLRequestPromise *)overallTrendingSongsFromOffset:(NSUInteger)offset
 {
-    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:@"/trending" parameters:@{@"results": @50, @"start": @(offset)}];
+    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:@"/trending" parameters:@{@"results": @(kFeedPageSize), @"start": @(offset)}];
 }
 
 - (RKURLRequestPromise *)trendingSongsWithTag:(NSString *)tag
@@ -487,7 +540,7 @@ RKPostProcessorBlock const kExfmPostProcessor = ^RKPossibility *(RKPossibility *
 	
 	NSString *path = [NSString stringWithFormat:@"/trending/tag/%@", [tag stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding]];
     
-    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path parameters:@{@"results": @50, @"start": @(offset)}];
+    return [[self.class sharedRequestFactory] GETRequestPromiseWithPath:path parameters:@{@"results": @(kFeedPageSize), @"start": @(offset)}];
 }
 
 #pragma mark - Authentication
@@ -59,4 +59,21 @@
 ///This method will only be called on services with known valid accounts when there is an active internet connection.
 - (RKPromise *)scrobbleSong:(Song *)song duration:(NSTimeInterval)duration;
 
+@optional
+
+///Returns a promise to scrobble a batch of songs in the receiver's user's profile.
+///
+/// \param songs   The songs to scrobble, in the order they were played. The `lastPlayed` date of
+///                 each song is used as the time of its scrobble. Required.
+///
+///Services that implement this method will have scrobbles that could not be submitted immediately
+///delivered in batches by the ScrobbleQueue class. Submitting the same song with the same `lastPlayed`
+///date more than once must not result in duplicate scrobbles.
+///
+///This method will only be called on services with known valid accounts when there is an active internet connection.
+- (RKPromise *)scrobbleSongs:(NSArray *)songs;
+
+///Returns the maximum number of songs that may be passed to `-[Service scrobbleSongs:]`.
+- (NSUInteger)maximumScrobbleBatchSize;
+
 @end
@@ -19,7 +19,7 @@
 - (RKPromise *)loginPromiseForUsername:(NSString *)username password:(NSString *)password
 {
     RKPromise *promise = [RKPromise new];
-    [[RKQueueManager commonQueue] addOperationWithBlock:^{
+    [[RKExecutor commonExecutor] addOperationWithBlock:^{
         ExfmSession *session = [ExfmSession defaultSession];
         
         NSError *error = nil;
@@ -40,7 +40,7 @@
 - (RKPromise *)signUpPromiseForEmail:(NSString *)email username:(NSString *)username password:(NSString *)password
 {
     RKPromise *promise = [RKPromise new];
-    [[RKQueueManager commonQueue] addOperationWithBlock:^{
+    [[RKExecutor commonExecutor] addOperationWithBlock:^{
         ExfmSession *session = [ExfmSession defaultSession];
         
         NSError *error = nil;
@@ -9,7 +9,7 @@
 #import <Cocoa/Cocoa.h>
 #import "RKBrowserLevel.h"
 
-@class Library;
+@class Library, RKStream, RKCancellationToken;
 
 @interface ExploreBrowserLevel : RKBrowserLevel
 {
@@ -17,16 +17,17 @@
 	
 	NSArray *mCachedTrending;
 	NSTimer *mTrendingUpdateTimer;
+	RKCancellationToken *mTrendingCancellationToken;
 	
 	NSArray *mResults;
 	
 	NSUInteger mResultsOffset;
+	BOOL mHasMoreResults;
 	
-	BOOL mIsLoadingMoreResults;
-	
-	NSCache *mArtworkCache;
-	NSMutableSet *mArtworkBeingDownloaded;
-	NSOperationQueue *mArtworkDownloadQueue;
+	NSTimer *mSearchDebounceTimer;
+	RKStream *mResultsStream;
+	BOOL mIsLoadingResults;
+	NSCache *mRecentResultsCache;
 }
 
 ///Whether or not the browser is searching.
@@ -20,10 +20,31 @@
 
 static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 
+///The number of results returned by Exfm for each page of a search.
+static NSUInteger const kSearchResultsPageSize = 50;
+
+///How long to wait after the last change to the search string before searching.
+static NSTimeInterval const kSearchDebounceInterval = 0.25;
+
+///How close to the end of the results the user must scroll before the next page is loaded.
+static NSUInteger const kSearchPrefetchThreshold = 20;
+
+///The number of recent queries whose results are kept in memory.
+static NSUInteger const kRecentResultsCacheLimit = 10;
+
+///Keys for the entries of the recent results cache.
+static NSString *const kRecentResultsSongsKey = @"songs";
+static NSString *const kRecentResultsOffsetKey = @"offset";
+static NSString *const kRecentResultsHasMoreKey = @"hasMore";
+
 @implementation ExploreBrowserLevel
 
 - (void)dealloc
 {
+	[mSearchDebounceTimer invalidate];
+	[mResultsStream cancel:nil];
+	[mTrendingCancellationToken cancel];
+	
 	[[NSUserDefaults standardUserDefaults] removeObserver:self forKeyPath:kTrendingTagUserDefaultsKey];
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
@@ -36,15 +57,9 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 		mResults = [NSArray array];
 		mCachedTrending = [NSArray array];
 		
-		mArtworkCache = [NSCache new];
-		[mArtworkCache setName:@"com.roundabout.pinna.ExploreBrowserLevel.mArtworkCache"];
-		[mArtworkCache setCountLimit:25];
-		
-		mArtworkBeingDownloaded = [NSMutableSet set];
-		
-		mArtworkDownloadQueue = [NSOperationQueue new];
-		[mArtworkDownloadQueue setMaxConcurrentOperationCount:2];
-		[mArtworkDownloadQueue setName:@"com.roundabout.pinna.ExploreBrowserLevel.mArtworkDownloadQueue"];
+		mRecentResultsCache = [NSCache new];
+		[mRecentResultsCache setName:@"com.roundabout.pinna.ExploreBrowserLevel.mRecentResultsCache"];
+		[mRecentResultsCache setCountLimit:kRecentResultsCacheLimit];
 		
 		[[NSNotificationCenter defaultCenter] addObserver:self
 												 selector:@selector(exFMSessionDidUpdateLovedSongs:)
@@ -165,40 +180,159 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 	
 	super.searchString = searchString;
 	
+	//Anything in flight is for a query the user is no longer interested in,
+	//so we release its bandwidth instead of waiting to throw its results away.
+	[self cancelPendingSearch];
+	
 	if(searchString)
 	{
-		RKPromise *songsPromise = [[ExfmSession defaultSession] searchSongsWithQuery:searchString offset:0];
-		[songsPromise then:^(NSDictionary *response) {
-			//It's possible the user has started multiple queries at once
-			//without being aware of it. We only want to display the latest
-			//query results.
-			if(![self.searchString isEqualToString:searchString])
-				return;
-			
-			[self willChangeValueForKey:@"contents"];
-			mResults = [self songsFromExFMData:[response objectForKey:@"songs"]];
-			[self didChangeValueForKey:@"contents"];
-			
-			mResultsOffset = 50;
-		} otherwise:^(NSError *error) {
-			//It's possible the user has started multiple queries at once
-			//without being aware of it. We only want to display the latest
-			//query results.
-			if(![self.searchString isEqualToString:searchString])
-				return;
+		NSDictionary *recentResults = [mRecentResultsCache objectForKey:searchString];
+		if(recentResults)
+		{
+			[self showResults:recentResults[kRecentResultsSongsKey]
+					   offset:[recentResults[kRecentResultsOffsetKey] unsignedIntegerValue]
+					  hasMore:[recentResults[kRecentResultsHasMoreKey] boolValue]
+					 forQuery:searchString];
+			return;
+		}
+		
+		//The previous query's results stay visible until the
+		//user stops typing and the new results arrive.
+		mSearchDebounceTimer = [NSTimer scheduledTimerWithTimeInterval:kSearchDebounceInterval
+																target:self
+															  selector:@selector(searchDebounceTimerFired:)
+															  userInfo:searchString
+															   repeats:NO];
+	}
+	else
+	{
+		[self willChangeValueForKey:@"contents"];
+		mResults = [NSArray array];
+		[self didChangeValueForKey:@"contents"];
+		
+		mResultsOffset = 0;
+		mHasMoreResults = NO;
+	}
+}
+
+- (void)cancelPendingSearch
+{
+	[mSearchDebounceTimer invalidate];
+	mSearchDebounceTimer = nil;
+	
+	[mResultsStream cancel:nil];
+	mResultsStream = nil;
+	mIsLoadingResults = NO;
+}
+
+- (void)showResults:(NSArray *)results offset:(NSUInteger)offset hasMore:(BOOL)hasMore forQuery:(NSString *)query
+{
+	[self willChangeValueForKey:@"contents"];
+	mResults = results;
+	[self didChangeValueForKey:@"contents"];
+	
+	mResultsOffset = offset;
+	mHasMoreResults = hasMore;
+	
+	[mRecentResultsCache setObject:@{ kRecentResultsSongsKey: results,
+									  kRecentResultsOffsetKey: @(offset),
+									  kRecentResultsHasMoreKey: @(hasMore) }
+							forKey:query];
+}
+
+- (void)searchDebounceTimerFired:(NSTimer *)timer
+{
+	NSString *searchString = [timer userInfo];
+	mSearchDebounceTimer = nil;
+	
+	//It's possible the user has started multiple queries at once
+	//without being aware of it. We only want to display the latest
+	//query results.
+	if(![self.searchString isEqualToString:searchString])
+		return;
+	
+	[self streamResultsForQuery:searchString startingAtOffset:0];
+}
+
+///Starts streaming the results of a query from a given offset, a page at a time.
+///
+///The first page of results for an offset of 0 replaces the current results,
+///and every other page is appended to them. The stream ends with the first
+///page Exfm returns short, so the last page is shown as soon as it arrives.
+- (void)streamResultsForQuery:(NSString *)query startingAtOffset:(NSUInteger)offset
+{
+	[mResultsStream cancel:nil];
+	
+	RKStream *resultsStream = [[ExfmSession defaultSession] searchSongsStreamWithQuery:query startingAtOffset:offset];
+	mResultsStream = resultsStream;
+	mResultsOffset = offset;
+	
+	NSMutableArray *pageResults = [NSMutableArray array];
+	void(^showPageResults)(BOOL) = ^(BOOL hasMore) {
+		NSArray *pageSongs = [self songsFromExFMData:pageResults];
+		NSArray *results = (mResultsOffset == 0)? pageSongs : [mResults arrayByAddingObjectsFromArray:pageSongs];
+		[self showResults:results
+				   offset:mResultsOffset + [pageResults count]
+				  hasMore:hasMore
+				 forQuery:query];
+		
+		[pageResults removeAllObjects];
+		mIsLoadingResults = NO;
+	};
+	
+	[resultsStream subscribeWithElement:^(NSDictionary *songResult) {
+		if(mResultsStream != resultsStream)
+			return;
+		
+		[pageResults addObject:songResult];
+		if([pageResults count] == kSearchResultsPageSize)
+			showPageResults(YES);
+	} completion:^(NSError *error) {
+		if(mResultsStream != resultsStream)
+			return;
+		
+		mResultsStream = nil;
+		
+		if(error)
+		{
+			//Results which arrived before the error are still shown, and
+			//the rest can be retried from where they left off by scrolling again.
+			if([pageResults count] > 0)
+				showPageResults(YES);
+			else if(mResultsOffset == 0)
+				mHasMoreResults = NO;
 			
-			mResultsOffset = 0;
+			mIsLoadingResults = NO;
 			
 			[[NSNotificationCenter defaultCenter] postNotificationName:LibraryErrorDidOccurNotification
 																object:self
 															  userInfo:@{@"error": error}];
-		}];
+			return;
+		}
+		
+		showPageResults(NO);
+	} onQueue:[NSOperationQueue mainQueue]];
+	
+	mIsLoadingResults = YES;
+	[resultsStream requestElements:kSearchResultsPageSize];
+}
+
+- (void)loadMoreResults
+{
+	NSString *searchString = self.searchString;
+	if(!searchString || !mHasMoreResults || mIsLoadingResults || mSearchDebounceTimer)
+		return;
+	
+	//The stream keeps the next page buffered, so it is usually shown immediately.
+	//Results recalled from the recent results cache don't have a stream yet.
+	if(mResultsStream)
+	{
+		mIsLoadingResults = YES;
+		[mResultsStream requestElements:kSearchResultsPageSize];
 	}
 	else
 	{
-		[self willChangeValueForKey:@"contents"];
-		mResults = [NSArray array];
-		[self didChangeValueForKey:@"contents"];
+		[self streamResultsForQuery:searchString startingAtOffset:mResultsOffset];
 	}
 }
 
@@ -216,20 +350,33 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 
 - (void)updateTrending
 {
-    RKPromise *trendingPromise;
+    RKURLRequestPromise *trendingPromise;
     NSString *trendingTag = [[NSUserDefaults standardUserDefaults] stringForKey:kTrendingTagUserDefaultsKey];
     if(trendingTag)
         trendingPromise = [[ExfmSession defaultSession] trendingSongsWithTag:trendingTag];
     else
         trendingPromise = [[ExfmSession defaultSession] overallTrendingSongs];
     
-    [trendingPromise then:^(id response) {
+    //A refresh that is still in flight has been superseded by this one.
+    [mTrendingCancellationToken cancel];
+    mTrendingCancellationToken = [RKCancellationToken new];
+    trendingPromise.cancellationToken = mTrendingCancellationToken;
+    
+    void(^showTrending)(id) = ^(id response) {
         NSArray *trending = [self songsFromExFMData:[response objectForKey:@"songs"]];
         
         [self willChangeValueForKey:@"contents"];
         mCachedTrending = trending;
         [self didChangeValueForKey:@"contents"];
-        
+    };
+    
+    [trendingPromise setRevalidationHandler:^(RKPossibility *maybeValue) {
+        if(maybeValue.state == kRKPossibilityStateValue)
+            showTrending(maybeValue.value);
+    } callbackQueue:[NSOperationQueue mainQueue]];
+    
+    [trendingPromise then:^(id response) {
+        showTrending(response);
     } otherwise:^(NSError *error) {
         [[NSNotificationCenter defaultCenter] postNotificationName:LibraryErrorDidOccurNotification
                                                             object:self
@@ -258,6 +405,9 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 {
 	[mTrendingUpdateTimer invalidate];
 	mTrendingUpdateTimer = nil;
+	
+	[mTrendingCancellationToken cancel];
+	mTrendingCancellationToken = nil;
 }
 
 #pragma mark -
@@ -287,36 +437,6 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 	return [[MenuGenerator sharedGenerator] contextualMenuForLibraryItems:items];
 }
 
-- (NSImage *)artworkImageForSong:(Song *)song
-{
-	NSImage *artwork = [mArtworkCache objectForKey:song.universalIdentifier];
-	if(artwork)
-		return artwork;
-	
-	if(![mArtworkBeingDownloaded containsObject:song.universalIdentifier])
-	{
-		[mArtworkDownloadQueue addOperationWithBlock:^{
-			NSURL *remoteArtworkLocation = [song.remoteArtworkLocations objectForKey:@"small"];
-			if(!remoteArtworkLocation)
-				return;
-			
-			NSImage *artworkImage = [[NSImage alloc] initWithContentsOfURL:remoteArtworkLocation];
-			if(artworkImage) //Can be nil.
-			{
-				[mArtworkCache setObject:artworkImage forKey:song.universalIdentifier];
-				[[NSOperationQueue mainQueue] addOperationWithBlock:^{
-					[mArtworkBeingDownloaded removeObject:song.universalIdentifier];
-					
-					[self willChangeValueForKey:@"contents"];
-					[self didChangeValueForKey:@"contents"];
-				}];
-			}
-		}];
-	}
-	
-	return [NSImage imageNamed:@"NoArtwork"];
-}
-
 - (void)levelRowCell:(RKBrowserIconTextFieldCell *)cell willBeDisplayedForItem:(Song *)item atRow:(NSUInteger)index
 {
 	BOOL isSelected = [self.selectedItemIndexes containsIndex:index];
@@ -325,7 +445,7 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 	NSAttributedString *displayString = [RKBrowserLevel formatBrowserTextForDisplay:string isSelected:isSelected dividerString:@"\n"];
 	[cell setAttributedStringValue:displayString];
 	
-	NSImage *artworkImage = [self artworkImageForSong:item];
+	NSImage *artworkImage = [self imageAtURL:[item.remoteArtworkLocations objectForKey:@"small"] forItem:item placeholder:[NSImage imageNamed:@"NoArtwork"]];
     [artworkImage setSize:NSMakeSize(32.0, 32.0)];
     [cell setImage:artworkImage];
 	[cell setStylizesImage:YES];
@@ -377,45 +497,17 @@ static NSString *const kTrendingTagUserDefaultsKey = @"ExFM_trendingTag";
 
 - (void)levelDidScrollToEndOfContents
 {
-	NSString *searchString = self.searchString;
-	
-	if(mIsLoadingMoreResults || !searchString)
-		return;
-	
-	mIsLoadingMoreResults = YES;
+	[self loadMoreResults];
+}
+
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows
+{
+	[self stopLoadingImagesForItemsNotInArray:[self displayedItemsInRows:[self prefetchRowsForVisibleRows:visibleRows]]];
 	
-	RKPromise *moreSongsPromise = [[ExfmSession defaultSession] searchSongsWithQuery:searchString offset:mResultsOffset];
-	[moreSongsPromise then:^(NSDictionary *response) {
-		//It's possible the user has started multiple queries at once
-		//without being aware of it. We only want to display the latest
-		//query results.
-		if(![self.searchString isEqualToString:searchString])
-		{
-			mIsLoadingMoreResults = NO;
-			return;
-		}
-		
-		[self willChangeValueForKey:@"contents"];
-		NSArray *moreResults = [self songsFromExFMData:[response objectForKey:@"songs"]];
-		mResults = [mResults arrayByAddingObjectsFromArray:moreResults];
-		[self didChangeValueForKey:@"contents"];
-		
-		mResultsOffset += 50;
-		
-		mIsLoadingMoreResults = NO;
-	} otherwise:^(NSError *error) {
-		mIsLoadingMoreResults = NO;
-		
-		//It's possible the user has started multiple queries at once
-		//without being aware of it. We only want to display the latest
-		//query results.
-		if(![self.searchString isEqualToString:searchString])
-			return;
-		
-		[[NSNotificationCenter defaultCenter] postNotificationName:LibraryErrorDidOccurNotification
-                                                            object:self
-                                                          userInfo:@{@"error": error}];
-	}];
+	//We start loading the next page while there is still a screenful or
+	//so of results left, so that it is usually in place before it's needed.
+	if(self.searchString && NSMaxRange(visibleRows) + kSearchPrefetchThreshold >= [mResults count])
+		[self loadMoreResults];
 }
 
 - (void)handleHoverButtonClickForItem:(Song *)song
@@ -0,0 +1,90 @@
+//
+//  RKCacheEvictionPolicy.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/26/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKCacheEvictionPolicy_h
+#define RKCacheEvictionPolicy_h 1
+
+#import <Foundation/Foundation.h>
+
+///The RKCacheEvictionPolicy class encapsulates the bookkeeping required to decide
+///which entries of a size-limited cache should be evicted, and in what order.
+///
+///The policy is an implementation of S3-FIFO weighted by entry cost. New keys are
+///admitted into a small probationary queue that holds roughly a tenth of the capacity.
+///Keys that are accessed again before they reach the head of that queue are moved into
+///the main queue; keys that are not are evicted, and remembered in a ghost queue so
+///that they are admitted directly into the main queue if they are inserted again.
+///The main queue is a FIFO which gives each key one more pass for each recent access.
+///This keeps one-off entries from pushing out the entries that are reused.
+///
+///Every operation runs in constant amortized time. RKCacheEvictionPolicy is not
+///thread-safe; clients must serialize their access to an instance.
+@interface RKCacheEvictionPolicy : NSObject
+
+///Initialize the receiver with a given capacity.
+///
+/// \param  capacity    The total cost of the keys the policy may hold before it begins evicting.
+///
+/// \result A fully initialized eviction policy.
+///
+///This is the designated initializer.
+- (instancetype)initWithCapacity:(unsigned long long)capacity;
+
+#pragma mark - Properties
+
+///The total cost of the keys the policy may hold before it begins evicting.
+///
+///Lowering the capacity does not evict any keys until the next call
+///to `-insertKey:cost:` or `-evictKeysExceedingCapacity`.
+@property (nonatomic) unsigned long long capacity;
+
+///The total cost of the keys currently admitted.
+@property (nonatomic, readonly) unsigned long long totalCost;
+
+///The number of keys currently admitted.
+@property (nonatomic, readonly) NSUInteger count;
+
+#pragma mark - Bookkeeping
+
+///Returns a BOOL indicating whether or not a given key is currently admitted.
+- (BOOL)containsKey:(id <NSCopying>)key;
+
+///Records an access of a given key. Has no effect if the key is not admitted.
+- (void)recordAccessForKey:(id <NSCopying>)key;
+
+///Admits a given key, evicting keys as necessary to stay within the receiver's capacity.
+///
+/// \param  key     The key to admit. Required.
+/// \param  cost    The cost of the key, typically its size in bytes.
+///
+/// \result An array of the keys evicted to make room, in the order they were evicted.
+///         The array may contain the key being inserted if its cost exceeds the capacity.
+///
+///Inserting a key that is already admitted updates its cost and records an access.
+- (NSArray *)insertKey:(id <NSCopying>)key cost:(unsigned long long)cost RK_REQUIRE_RESULT_USED;
+
+///Admits a given key directly into the main queue without evicting anything.
+///
+///This method is intended for restoring keys that were admitted in a previous
+///session, and should be called in order of least to most recent access.
+- (void)restoreKey:(id <NSCopying>)key cost:(unsigned long long)cost;
+
+///Removes a given key without placing it in the ghost queue. Has no effect if the key is not admitted.
+- (void)removeKey:(id <NSCopying>)key;
+
+///Removes all keys, including those in the ghost queue.
+- (void)removeAllKeys;
+
+///Evicts keys until the receiver is within its capacity.
+///
+/// \result An array of the keys evicted, in the order they were evicted.
+- (NSArray *)evictKeysExceedingCapacity RK_REQUIRE_RESULT_USED;
+
+@end
+
+#endif /* RKCacheEvictionPolicy_h */
@@ -0,0 +1,348 @@
+//
+//  RKCacheEvictionPolicy.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/26/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKCacheEvictionPolicy.h"
+
+///The largest access count an entry can accumulate.
+#define kMaximumFrequency       3
+
+///The fraction of the capacity allotted to the small queue.
+#define kSmallQueueFraction     0.1
+
+///The minimum number of keys the ghost queue will remember.
+#define kMinimumGhostCount      64
+
+///The queues an entry can belong to.
+typedef NS_ENUM(NSUInteger, RKCacheEvictionQueue) {
+    kRKCacheEvictionQueueNone = 0,
+    kRKCacheEvictionQueueSmall,
+    kRKCacheEvictionQueueMain,
+    kRKCacheEvictionQueueGhost,
+};
+
+#pragma mark -
+
+///The RKCacheEvictionEntry class encapsulates a single key in one of the queues of an eviction policy.
+@interface RKCacheEvictionEntry : NSObject {
+@public
+    id _key;
+    unsigned long long _cost;
+    NSUInteger _frequency;
+    RKCacheEvictionQueue _queue;
+
+    RKCacheEvictionEntry *_next;
+    __unsafe_unretained RKCacheEvictionEntry *_previous;
+}
+
+@end
+
+@implementation RKCacheEvictionEntry
+
+@end
+
+#pragma mark -
+
+///The RKCacheEvictionList class encapsulates an intrusive doubly linked list of entries.
+@interface RKCacheEvictionList : NSObject {
+@public
+    RKCacheEvictionEntry *_head;
+    __unsafe_unretained RKCacheEvictionEntry *_tail;
+    NSUInteger _count;
+    unsigned long long _cost;
+}
+
+@end
+
+@implementation RKCacheEvictionList
+
+- (void)appendEntry:(RKCacheEvictionEntry *)entry
+{
+    entry->_next = nil;
+    entry->_previous = _tail;
+    if(_tail)
+        _tail->_next = entry;
+    else
+        _head = entry;
+    _tail = entry;
+
+    _count++;
+    _cost += entry->_cost;
+}
+
+- (void)removeEntry:(RKCacheEvictionEntry *)entry
+{
+    RKCacheEvictionEntry *retainedEntry = entry;
+    if(retainedEntry->_previous)
+        retainedEntry->_previous->_next = retainedEntry->_next;
+    else
+        _head = retainedEntry->_next;
+
+    if(retainedEntry->_next)
+        retainedEntry->_next->_previous = retainedEntry->_previous;
+    else
+        _tail = retainedEntry->_previous;
+
+    retainedEntry->_next = nil;
+    retainedEntry->_previous = nil;
+
+    _count--;
+    _cost -= retainedEntry->_cost;
+}
+
+- (RKCacheEvictionEntry *)removeHead
+{
+    RKCacheEvictionEntry *head = _head;
+    if(head)
+        [self removeEntry:head];
+
+    return head;
+}
+
+- (void)removeAllEntries
+{
+    //Unlinked iteratively so that releasing a long list does not recurse.
+    while (_head)
+        [self removeHead];
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKCacheEvictionPolicy {
+    NSMutableDictionary *_entries;
+    NSMutableDictionary *_ghosts;
+
+    RKCacheEvictionList *_smallQueue;
+    RKCacheEvictionList *_mainQueue;
+    RKCacheEvictionList *_ghostQueue;
+}
+
+- (void)dealloc
+{
+    [_smallQueue removeAllEntries];
+    [_mainQueue removeAllEntries];
+    [_ghostQueue removeAllEntries];
+}
+
+- (instancetype)initWithCapacity:(unsigned long long)capacity
+{
+    if((self = [super init])) {
+        self.capacity = capacity;
+
+        _entries = [NSMutableDictionary dictionary];
+        _ghosts = [NSMutableDictionary dictionary];
+
+        _smallQueue = [RKCacheEvictionList new];
+        _mainQueue = [RKCacheEvictionList new];
+        _ghostQueue = [RKCacheEvictionList new];
+    }
+
+    return self;
+}
+
+- (id)init
+{
+    return [self initWithCapacity:0];
+}
+
+#pragma mark - Properties
+
+- (unsigned long long)totalCost
+{
+    return _smallQueue->_cost + _mainQueue->_cost;
+}
+
+- (NSUInteger)count
+{
+    return _entries.count;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %lu keys, %llu/%llu (small %llu, main %llu), %lu ghosts>",
+            NSStringFromClass([self class]), self,
+            (unsigned long)self.count, self.totalCost, self.capacity,
+            _smallQueue->_cost, _mainQueue->_cost,
+            (unsigned long)_ghostQueue->_count];
+}
+
+#pragma mark - Bookkeeping
+
+- (BOOL)containsKey:(id <NSCopying>)key
+{
+    NSParameterAssert(key);
+
+    return (_entries[key] != nil);
+}
+
+- (void)recordAccessForKey:(id <NSCopying>)key
+{
+    NSParameterAssert(key);
+
+    RKCacheEvictionEntry *entry = _entries[key];
+    if(entry && entry->_frequency < kMaximumFrequency)
+        entry->_frequency++;
+}
+
+- (NSArray *)insertKey:(id <NSCopying>)key cost:(unsigned long long)cost
+{
+    NSParameterAssert(key);
+
+    RKCacheEvictionEntry *entry = _entries[key];
+    if(entry) {
+        RKCacheEvictionList *queue = (entry->_queue == kRKCacheEvictionQueueSmall)? _smallQueue : _mainQueue;
+        queue->_cost = queue->_cost - entry->_cost + cost;
+        entry->_cost = cost;
+        if(entry->_frequency < kMaximumFrequency)
+            entry->_frequency++;
+
+        return [self evictKeysExceedingCapacity];
+    }
+
+    entry = _ghosts[key];
+    if(entry) {
+        [_ghostQueue removeEntry:entry];
+        [_ghosts removeObjectForKey:key];
+
+        entry->_cost = cost;
+        entry->_frequency = 0;
+        entry->_queue = kRKCacheEvictionQueueMain;
+        [_mainQueue appendEntry:entry];
+    } else {
+        entry = [RKCacheEvictionEntry new];
+        entry->_key = [key copyWithZone:nil];
+        entry->_cost = cost;
+        entry->_queue = kRKCacheEvictionQueueSmall;
+        [_smallQueue appendEntry:entry];
+    }
+    _entries[entry->_key] = entry;
+
+    return [self evictKeysExceedingCapacity];
+}
+
+- (void)restoreKey:(id <NSCopying>)key cost:(unsigned long long)cost
+{
+    NSParameterAssert(key);
+
+    [self removeKey:key];
+
+    RKCacheEvictionEntry *entry = [RKCacheEvictionEntry new];
+    entry->_key = [key copyWithZone:nil];
+    entry->_cost = cost;
+    entry->_queue = kRKCacheEvictionQueueMain;
+    [_mainQueue appendEntry:entry];
+    _entries[entry->_key] = entry;
+}
+
+- (void)removeKey:(id <NSCopying>)key
+{
+    NSParameterAssert(key);
+
+    RKCacheEvictionEntry *entry = _entries[key];
+    if(!entry)
+        return;
+
+    if(entry->_queue == kRKCacheEvictionQueueSmall)
+        [_smallQueue removeEntry:entry];
+    else
+        [_mainQueue removeEntry:entry];
+
+    entry->_queue = kRKCacheEvictionQueueNone;
+    [_entries removeObjectForKey:key];
+}
+
+- (void)removeAllKeys
+{
+    [_smallQueue removeAllEntries];
+    [_mainQueue removeAllEntries];
+    [_ghostQueue removeAllEntries];
+
+    [_entries removeAllObjects];
+    [_ghosts removeAllObjects];
+}
+
+#pragma mark - Eviction
+
+///Remembers a key evicted from the small queue, forgetting the oldest ghosts as necessary.
+- (void)addGhostEntry:(RKCacheEvictionEntry *)entry
+{
+    entry->_cost = 0;
+    entry->_frequency = 0;
+    entry->_queue = kRKCacheEvictionQueueGhost;
+    [_ghostQueue appendEntry:entry];
+    _ghosts[entry->_key] = entry;
+
+    NSUInteger ghostLimit = MAX(_mainQueue->_count, kMinimumGhostCount);
+    while (_ghostQueue->_count > ghostLimit) {
+        RKCacheEvictionEntry *oldestGhost = [_ghostQueue removeHead];
+        [_ghosts removeObjectForKey:oldestGhost->_key];
+    }
+}
+
+///Evicts a single key from the small queue, promoting any keys accessed since they were admitted.
+- (id)evictFromSmallQueue
+{
+    RKCacheEvictionEntry *entry;
+    while ((entry = [_smallQueue removeHead])) {
+        if(entry->_frequency > 0) {
+            entry->_frequency = 0;
+            entry->_queue = kRKCacheEvictionQueueMain;
+            [_mainQueue appendEntry:entry];
+        } else {
+            [_entries removeObjectForKey:entry->_key];
+            [self addGhostEntry:entry];
+            return entry->_key;
+        }
+    }
+
+    return nil;
+}
+
+///Evicts a single key from the main queue, reinserting any keys accessed since their last pass.
+- (id)evictFromMainQueue
+{
+    RKCacheEvictionEntry *entry;
+    while ((entry = [_mainQueue removeHead])) {
+        if(entry->_frequency > 0) {
+            entry->_frequency--;
+            [_mainQueue appendEntry:entry];
+        } else {
+            entry->_queue = kRKCacheEvictionQueueNone;
+            [_entries removeObjectForKey:entry->_key];
+            return entry->_key;
+        }
+    }
+
+    return nil;
+}
+
+- (NSArray *)evictKeysExceedingCapacity
+{
+    NSMutableArray *evictedKeys = [NSMutableArray array];
+
+    unsigned long long smallQueueCapacity = (unsigned long long)(_capacity * kSmallQueueFraction);
+    while (self.totalCost > _capacity) {
+        id evictedKey = nil;
+        if(_smallQueue->_cost > smallQueueCapacity || _mainQueue->_count == 0)
+            evictedKey = [self evictFromSmallQueue];
+
+        //The small queue may have promoted every key it held.
+        if(!evictedKey)
+            evictedKey = [self evictFromMainQueue];
+
+        if(!evictedKey)
+            break;
+
+        [evictedKeys addObject:evictedKey];
+    }
+
+    return evictedKeys;
+}
+
+@end
@@ -0,0 +1,78 @@
+//
+//  RKCancellationToken.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKCancellationToken_h
+#define RKCancellationToken_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPrelude.h"
+
+#pragma mark - Compile Time Options
+
+///Set to 1 to have tokens released with work still registered on them logged.
+#define RKCancellationToken_Option_ReportAbandonedWork  1
+
+#pragma mark -
+
+///The RKCancellationToken class encapsulates a request to stop a group of asynchronous work.
+///
+///A token is typically owned by the object the work is being done for, such as a browser
+///level or the playing song, and is attached to the outermost promise of each piece of work
+///through `-[RKPromise setCancellationToken:]`. Cancelling the token cancels the promises
+///attached to it, which in turn cancel the promises they were chained or combined from.
+///
+///Promises only hold their token weakly. A token that is released while work is still
+///registered on it has abandoned that work without cancelling it, which is reported when
+///`RKCancellationToken_Option_ReportAbandonedWork` is set to 1.
+///
+///RKCancellationToken is safe to use from multiple threads.
+@interface RKCancellationToken : NSObject
+
+///Initialize the receiver with a parent token.
+///
+/// \param  parentToken The token whose cancellation should also cancel the receiver. Optional.
+///
+/// \result A fully initialized cancellation token.
+///
+///The receiver keeps `parentToken` alive. This is the designated initializer.
+- (instancetype)initWithParentToken:(RKCancellationToken *)parentToken;
+
+#pragma mark - Properties
+
+///The token whose cancellation also cancels the receiver.
+@property (readonly) RKCancellationToken *parentToken;
+
+///Whether or not the receiver has been cancelled.
+@property (readonly, getter=isCancelled) BOOL cancelled;
+
+#pragma mark - Cancelling
+
+///Cancels the receiver, invoking all of its cancellation handlers on the calling thread.
+///
+///Cancelling a token more than once has no effect.
+- (void)cancel;
+
+#pragma mark - Handlers
+
+///Registers a block to invoke when the receiver is cancelled.
+///
+/// \param  handler The block to invoke. Required.
+///
+/// \result An opaque object which may be passed to `-[self removeCancellationHandler:]`.
+///
+///If the receiver is already cancelled, `handler` is invoked immediately on the calling thread.
+- (id)addCancellationHandler:(dispatch_block_t)handler;
+
+///Unregisters a block added with `-[self addCancellationHandler:]`.
+///
+/// \param  registration    The object returned when the handler was added. Optional.
+- (void)removeCancellationHandler:(id)registration;
+
+@end
+
+#endif /* RKCancellationToken_h */
@@ -0,0 +1,110 @@
+//
+//  RKCancellationToken.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKCancellationToken.h"
+
+@implementation RKCancellationToken {
+    BOOL _cancelled;
+    NSMutableArray *_handlers;
+    id _parentRegistration;
+}
+
+- (void)dealloc
+{
+#if RKCancellationToken_Option_ReportAbandonedWork
+    if(!_cancelled && _handlers.count > 0)
+        NSLog(@"*** Warning: %@ was released with %lu operations in flight. Cancel tokens before releasing them.", self, (unsigned long)_handlers.count);
+#endif /* RKCancellationToken_Option_ReportAbandonedWork */
+
+    [_parentToken removeCancellationHandler:_parentRegistration];
+}
+
+- (instancetype)init
+{
+    return [self initWithParentToken:nil];
+}
+
+- (instancetype)initWithParentToken:(RKCancellationToken *)parentToken
+{
+    if((self = [super init])) {
+        _handlers = [NSMutableArray new];
+
+        if(parentToken) {
+            _parentToken = parentToken;
+
+            __weak RKCancellationToken *weakSelf = self;
+            _parentRegistration = [parentToken addCancellationHandler:^{
+                [weakSelf cancel];
+            }];
+        }
+    }
+
+    return self;
+}
+
+#pragma mark - Properties
+
+- (BOOL)isCancelled
+{
+    @synchronized(self) {
+        return _cancelled;
+    }
+}
+
+#pragma mark - Cancelling
+
+- (void)cancel
+{
+    NSArray *handlers = nil;
+    @synchronized(self) {
+        if(_cancelled)
+            return;
+
+        _cancelled = YES;
+
+        handlers = _handlers;
+        _handlers = nil;
+    }
+
+    //Handlers are invoked outside of the lock, as cancelling a
+    //promise may cause other handlers on the receiver to be removed.
+    for (dispatch_block_t handler in handlers)
+        handler();
+}
+
+#pragma mark - Handlers
+
+- (id)addCancellationHandler:(dispatch_block_t)handler
+{
+    NSParameterAssert(handler);
+
+    dispatch_block_t registration = [handler copy];
+
+    @synchronized(self) {
+        if(!_cancelled) {
+            [_handlers addObject:registration];
+            return registration;
+        }
+    }
+
+    registration();
+
+    return registration;
+}
+
+- (void)removeCancellationHandler:(id)registration
+{
+    if(!registration)
+        return;
+
+    @synchronized(self) {
+        [_handlers removeObjectIdenticalTo:registration];
+    }
+}
+
+@end
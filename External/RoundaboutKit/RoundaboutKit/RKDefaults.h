@@ -51,9 +51,122 @@ RK_EXTERN BOOL RKGetPersistentBool(NSString *key);
 ///Returns a boolean indicating whether or not a persistent value exists.
 RK_EXTERN BOOL RKPersistentValueExists(NSString *key);
 
+#pragma mark - Settings
+
+///The types of values an RKSetting holds.
+typedef NS_ENUM(NSInteger, RKSettingType) {
+    ///The setting holds a property list object.
+    kRKSettingTypeObject = 0,
+
+    ///The setting holds a BOOL.
+    kRKSettingTypeBool,
+
+    ///The setting holds an NSInteger.
+    kRKSettingTypeInteger,
+
+    ///The setting holds a float.
+    kRKSettingTypeFloat,
+};
+
+///The length of time, in seconds, that changes to settings are held before being written to the user defaults.
+#define kRKSettingWriteDelay    1.0
+
+///Posted when the value of a setting changes. The object is the setting.
+///
+///Posted on the thread the setting was changed on, or for changes made to the
+///user defaults directly (e.g. through bindings), the thread that changed them.
+RK_EXTERN NSString *const RKSettingDidChangeNotification;
+
+///The RKSetting class encapsulates a single typed value persisted into the user defaults.
+///
+///Each setting caches its value in memory, so reading it costs a lock and no boxing,
+///and batches its changes into a single write to the user defaults after `kRKSettingWriteDelay`.
+///Changes made to the user defaults directly are picked up, and reported like any other change.
+///
+///Settings are registered by key, and are never released. Once a setting is registered for
+///a key, the `RK*Persistent*` functions read and write it through the setting.
+///
+///Settings are usually declared with `RK_DEFINE_SETTING`, so misspelled keys are caught by the compiler.
+///
+///Every method on RKSetting is safe to call from multiple threads.
+@interface RKSetting : NSObject
+
+///Returns the setting registered for a given key, creating it if it does not already exist.
+///
+/// \param  key     The user defaults key of the setting. Required.
+/// \param  type    The type of value the setting holds.
+///
+/// \result The setting registered for the key.
+///
+///If a setting is already registered for the key, it is returned unchanged,
+///and a warning is logged if it was registered with a different type.
++ (instancetype)settingForKey:(NSString *)key type:(RKSettingType)type;
+
+///Returns the setting registered for a given key, or nil if there is none.
++ (instancetype)existingSettingForKey:(NSString *)key;
+
+#pragma mark - Properties
+
+///The user defaults key of the receiver.
+@property (readonly) NSString *key;
+
+///The type of value the receiver holds.
+@property (readonly) RKSettingType type;
+
+#pragma mark - Values
+
+///The value of the receiver, boxed if necessary. Valid for every type.
+@property (nonatomic) id objectValue;
+
+///The value of a `kRKSettingTypeBool` setting.
+@property (nonatomic) BOOL boolValue;
+
+///The value of a `kRKSettingTypeInteger` setting.
+@property (nonatomic) NSInteger integerValue;
+
+///The value of a `kRKSettingTypeFloat` setting.
+@property (nonatomic) float floatValue;
+
+@end
+
+#pragma mark -
+
+///Writes every pending change to a setting to the user defaults immediately.
+///
+///Applications should call this function before they terminate.
+RK_EXTERN void RKSettingsFlushPendingWrites();
+
+///Defines a function which returns the setting for a key, registering it the first time it is called.
+///
+/// \param  functionName    The name of the function to define.
+/// \param  key             The user defaults key of the setting.
+/// \param  settingType     The type of value the setting holds.
+///
+///Prefix with `static` to define a setting private to a file. For example:
+///
+///     static RK_DEFINE_SETTING(VolumeSetting, @"AudioPlayer_volume", kRKSettingTypeFloat)
+///
+///     VolumeSetting().floatValue = 0.5f;
+#define RK_DEFINE_SETTING(functionName, key, settingType) \
+    RKSetting *functionName() \
+    { \
+        static RKSetting *setting = nil; \
+        static dispatch_once_t onceToken; \
+        dispatch_once(&onceToken, ^{ \
+            setting = [RKSetting settingForKey:(key) type:(settingType)]; \
+        }); \
+        return setting; \
+    }
+
 #pragma mark - Testing Support
 
 ///Turns off the persistent backing of the RKDefaults functions. Intended for use with unit tests.
+///
+///Registered settings discard their pending changes and are reloaded from the test mode backing.
 RK_EXTERN void RKDefaultsActivateTestMode();
 
+///Restores the persistent backing of the RKDefaults functions, discarding everything
+///written while in test mode. Registered settings are reloaded from the user defaults.
+RK_EXTERN void RKDefaultsDeactivateTestMode();
+
 #endif /* RKDefaults_h */
@@ -7,28 +7,62 @@
 //
 
 #import "RKDefaults.h"
+#import <libkern/OSAtomic.h>
+
+NSString *const RKSettingDidChangeNotification = @"RKSettingDidChangeNotification";
 
 static BOOL _TestMode = NO;
 
 static NSMutableDictionary *TestModeBackingDictionary()
 {
     static NSMutableDictionary *testModeBackingDictionary = nil;
-    if(!testModeBackingDictionary)
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
         testModeBackingDictionary = [NSMutableDictionary dictionary];
+    });
     
     return testModeBackingDictionary;
 }
 
+#pragma mark - Backing Store
+
+///Writes an object directly to the backing of the RKDefaults functions, bypassing settings.
+static void BackingStoreSetObject(NSString *key, id object)
+{
+    if(_TestMode) {
+        NSMutableDictionary *testModeBackingDictionary = TestModeBackingDictionary();
+        @synchronized(testModeBackingDictionary) {
+            [testModeBackingDictionary setValue:object forKey:key];
+        }
+    } else {
+        [[NSUserDefaults standardUserDefaults] setObject:object forKey:key];
+    }
+}
+
+///Reads an object directly from the backing of the RKDefaults functions, bypassing settings.
+static id BackingStoreGetObject(NSString *key)
+{
+    if(_TestMode) {
+        NSMutableDictionary *testModeBackingDictionary = TestModeBackingDictionary();
+        @synchronized(testModeBackingDictionary) {
+            return [testModeBackingDictionary objectForKey:key];
+        }
+    } else {
+        return [[NSUserDefaults standardUserDefaults] objectForKey:key];
+    }
+}
+
 #pragma mark Defaults Short-hand
 
 id RKSetPersistentObject(NSString *key, id object)
 {
 	NSCParameterAssert(key);
     
-    if(_TestMode)
-        [TestModeBackingDictionary() setValue:object forKey:key];
+    RKSetting *setting = [RKSetting existingSettingForKey:key];
+    if(setting)
+        setting.objectValue = object;
     else
-        [[NSUserDefaults standardUserDefaults] setObject:object forKey:key];
+        BackingStoreSetObject(key, object);
 	
     return object;
 }
@@ -36,10 +70,12 @@ id RKSetPersistentObject(NSString *key, id object)
 id RKGetPersistentObject(NSString *key)
 {
 	NSCParameterAssert(key);
-	if(_TestMode)
-        return [TestModeBackingDictionary() objectForKey:key];
+    
+    RKSetting *setting = [RKSetting existingSettingForKey:key];
+    if(setting)
+        return setting.objectValue;
     else
-        return [[NSUserDefaults standardUserDefaults] objectForKey:key];
+        return BackingStoreGetObject(key);
 }
 
 #pragma mark -
@@ -92,10 +128,306 @@ BOOL RKGetPersistentBool(NSString *key)
 BOOL RKPersistentValueExists(NSString *key)
 {
 	NSCParameterAssert(key);
+    return (RKGetPersistentObject(key) != nil);
+}
+
+#pragma mark - Settings
+
+///The registered settings, keyed by user defaults key. Only accessed while synchronized on RKSetting.
+static NSMutableDictionary *gRegisteredSettings = nil;
+
+///The settings with changes waiting to be written. Only accessed while synchronized on RKSetting.
+static NSMutableSet *gSettingsPendingWrite = nil;
+
+///Whether or not a write of the pending settings has been scheduled. Only accessed while synchronized on RKSetting.
+static BOOL gSettingsWriteIsScheduled = NO;
+
+///Incremented by every flush, so a scheduled write that an earlier flush already
+///took care of does nothing. Only accessed while synchronized on RKSetting.
+static NSUInteger gSettingsWriteGeneration = 0;
+
+///Returns the queue pending settings are written to the user defaults on.
+static dispatch_queue_t SettingsWriteQueue()
+{
+    static dispatch_queue_t settingsWriteQueue = NULL;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        settingsWriteQueue = dispatch_queue_create("com.roundabout.rk.settings.write", DISPATCH_QUEUE_SERIAL);
+    });
+    
+    return settingsWriteQueue;
+}
+
+@interface RKSetting ()
+
+///Returns every registered setting.
++ (NSArray *)registeredSettings;
+
+///Reloads the receiver from the backing store, unless it has changes waiting to be written.
+- (void)reloadDiscardingPendingWrite:(BOOL)discardPendingWrite;
+
+@end
+
+@implementation RKSetting {
+    OSSpinLock _lock;
+    
+    //The following are only accessed while holding _lock.
+    id _objectValue;
+    BOOL _boolValue;
+    NSInteger _integerValue;
+    float _floatValue;
+}
+
+#pragma mark - Registry
+
++ (void)initialize
+{
+    if(self != [RKSetting class])
+        return;
+    
+    gRegisteredSettings = [NSMutableDictionary new];
+    gSettingsPendingWrite = [NSMutableSet new];
+    
+    //Picks up changes made through bindings and other direct uses of the user defaults.
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(userDefaultsDidChange:)
+                                                 name:NSUserDefaultsDidChangeNotification
+                                               object:nil];
+}
+
++ (instancetype)settingForKey:(NSString *)key type:(RKSettingType)type
+{
+    NSParameterAssert(key);
+    
+    RKSetting *setting;
+    @synchronized([RKSetting class]) {
+        setting = gRegisteredSettings[key];
+        if(!setting) {
+            setting = [[self alloc] initWithKey:key type:type];
+            gRegisteredSettings[key] = setting;
+            
+            return setting;
+        }
+    }
+    
+    if(setting.type != type) {
+        NSLog(@"*** Warning: setting %@ was requested with type %ld but is registered with type %ld. Using the registered setting.",
+              key, (long)type, (long)setting.type);
+    }
+    
+    return setting;
+}
+
++ (instancetype)existingSettingForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+    
+    @synchronized([RKSetting class]) {
+        return gRegisteredSettings[key];
+    }
+}
+
++ (NSArray *)registeredSettings
+{
+    @synchronized([RKSetting class]) {
+        return [gRegisteredSettings allValues];
+    }
+}
+
+#pragma mark - Lifecycle
+
+- (id)initWithKey:(NSString *)key type:(RKSettingType)type
+{
+    if((self = [super init])) {
+        _key = [key copy];
+        _type = type;
+        _lock = OS_SPINLOCK_INIT;
+        
+        [self cacheObjectValue:BackingStoreGetObject(key)];
+    }
+    
+    return self;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %@ => %@>", NSStringFromClass(self.class), self, self.key, self.objectValue];
+}
+
+#pragma mark - Caching
+
+///Replaces the cached value of the receiver, returning whether or not it changed.
+- (BOOL)cacheObjectValue:(id)objectValue
+{
+    //The primitive values are derived outside of the lock, as they may message arbitrary objects.
+    BOOL boolValue = [objectValue respondsToSelector:@selector(boolValue)]? [objectValue boolValue] : NO;
+    NSInteger integerValue = [objectValue respondsToSelector:@selector(integerValue)]? [objectValue integerValue] : 0;
+    float floatValue = [objectValue respondsToSelector:@selector(floatValue)]? [objectValue floatValue] : 0.f;
+    
+    OSSpinLockLock(&_lock);
+    id oldObjectValue = _objectValue;
+    BOOL didChange = (oldObjectValue != objectValue && ![oldObjectValue isEqual:objectValue]);
+    _objectValue = objectValue;
+    _boolValue = boolValue;
+    _integerValue = integerValue;
+    _floatValue = floatValue;
+    OSSpinLockUnlock(&_lock);
+    
+    return didChange;
+}
+
+- (void)reloadDiscardingPendingWrite:(BOOL)discardPendingWrite
+{
+    BOOL didChange;
+    @synchronized([RKSetting class]) {
+        if([gSettingsPendingWrite containsObject:self]) {
+            if(!discardPendingWrite)
+                return;
+            
+            [gSettingsPendingWrite removeObject:self];
+        }
+        
+        didChange = [self cacheObjectValue:BackingStoreGetObject(self.key)];
+    }
+    
+    if(didChange)
+        [[NSNotificationCenter defaultCenter] postNotificationName:RKSettingDidChangeNotification object:self];
+}
+
++ (void)userDefaultsDidChange:(NSNotification *)notification
+{
     if(_TestMode)
-        return ([TestModeBackingDictionary() objectForKey:key] != nil);
-    else
-        return ([[NSUserDefaults standardUserDefaults] objectForKey:key] != nil);
+        return;
+    
+    for (RKSetting *setting in [self registeredSettings])
+        [setting reloadDiscardingPendingWrite:NO];
+}
+
+#pragma mark - Writing
+
+///Updates the cached value of the receiver, and schedules it to be written to the backing store.
+- (void)changeObjectValue:(id)objectValue
+{
+    //Changes are made while synchronized so they can't interleave with reloads and flushes.
+    @synchronized([RKSetting class]) {
+        if(![self cacheObjectValue:objectValue])
+            return;
+        
+        [gSettingsPendingWrite addObject:self];
+        
+        if(!gSettingsWriteIsScheduled) {
+            gSettingsWriteIsScheduled = YES;
+            
+            NSUInteger generation = gSettingsWriteGeneration;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kRKSettingWriteDelay * NSEC_PER_SEC)), SettingsWriteQueue(), ^{
+                @synchronized([RKSetting class]) {
+                    if(generation != gSettingsWriteGeneration)
+                        return;
+                }
+                
+                RKSettingsFlushPendingWrites();
+            });
+        }
+    }
+    
+    [[NSNotificationCenter defaultCenter] postNotificationName:RKSettingDidChangeNotification object:self];
+}
+
+#pragma mark - Values
+
+- (void)setObjectValue:(id)objectValue
+{
+    [self changeObjectValue:objectValue];
+}
+
+- (id)objectValue
+{
+    OSSpinLockLock(&_lock);
+    id objectValue = _objectValue;
+    OSSpinLockUnlock(&_lock);
+    
+    return objectValue;
+}
+
+- (void)setBoolValue:(BOOL)boolValue
+{
+    NSAssert(_type == kRKSettingTypeBool, @"%@ is not a BOOL setting", _key);
+    
+    [self changeObjectValue:@(boolValue)];
+}
+
+- (BOOL)boolValue
+{
+    NSAssert(_type == kRKSettingTypeBool, @"%@ is not a BOOL setting", _key);
+    
+    OSSpinLockLock(&_lock);
+    BOOL boolValue = _boolValue;
+    OSSpinLockUnlock(&_lock);
+    
+    return boolValue;
+}
+
+- (void)setIntegerValue:(NSInteger)integerValue
+{
+    NSAssert(_type == kRKSettingTypeInteger, @"%@ is not an integer setting", _key);
+    
+    [self changeObjectValue:@(integerValue)];
+}
+
+- (NSInteger)integerValue
+{
+    NSAssert(_type == kRKSettingTypeInteger, @"%@ is not an integer setting", _key);
+    
+    OSSpinLockLock(&_lock);
+    NSInteger integerValue = _integerValue;
+    OSSpinLockUnlock(&_lock);
+    
+    return integerValue;
+}
+
+- (void)setFloatValue:(float)floatValue
+{
+    NSAssert(_type == kRKSettingTypeFloat, @"%@ is not a float setting", _key);
+    
+    [self changeObjectValue:@(floatValue)];
+}
+
+- (float)floatValue
+{
+    NSAssert(_type == kRKSettingTypeFloat, @"%@ is not a float setting", _key);
+    
+    OSSpinLockLock(&_lock);
+    float floatValue = _floatValue;
+    OSSpinLockUnlock(&_lock);
+    
+    return floatValue;
+}
+
+@end
+
+#pragma mark -
+
+void RKSettingsFlushPendingWrites()
+{
+    NSSet *settingsToWrite;
+    @synchronized([RKSetting class]) {
+        settingsToWrite = [gSettingsPendingWrite copy];
+        gSettingsWriteIsScheduled = NO;
+        gSettingsWriteGeneration++;
+    }
+    
+    //Settings stay pending until they're written, so the user defaults change notifications
+    //posted by earlier writes don't reload them with their old values. A setting changed
+    //while it's being written stays pending, and is written by the next flush.
+    for (RKSetting *setting in settingsToWrite) {
+        id objectValue = setting.objectValue;
+        BackingStoreSetObject(setting.key, objectValue);
+        
+        @synchronized([RKSetting class]) {
+            if(setting.objectValue == objectValue)
+                [gSettingsPendingWrite removeObject:setting];
+        }
+    }
 }
 
 #pragma mark - Testing Support
@@ -103,4 +435,20 @@ BOOL RKPersistentValueExists(NSString *key)
 void RKDefaultsActivateTestMode()
 {
     _TestMode = YES;
+    
+    for (RKSetting *setting in [RKSetting registeredSettings])
+        [setting reloadDiscardingPendingWrite:YES];
+}
+
+void RKDefaultsDeactivateTestMode()
+{
+    _TestMode = NO;
+    
+    NSMutableDictionary *testModeBackingDictionary = TestModeBackingDictionary();
+    @synchronized(testModeBackingDictionary) {
+        [testModeBackingDictionary removeAllObjects];
+    }
+    
+    for (RKSetting *setting in [RKSetting registeredSettings])
+        [setting reloadDiscardingPendingWrite:YES];
 }
@@ -0,0 +1,113 @@
+//
+//  RKDurableQueue.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/22/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKDurableQueue_h
+#define RKDurableQueue_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPrelude.h"
+
+@class RKPromise;
+
+///The default value of `RKDurableQueue.initialRetryDelay`.
+RK_EXTERN NSTimeInterval const kRKDurableQueueDefaultInitialRetryDelay;
+
+///The default value of `RKDurableQueue.maximumRetryDelay`.
+RK_EXTERN NSTimeInterval const kRKDurableQueueDefaultMaximumRetryDelay;
+
+///A block which submits a batch of entries from a durable queue.
+///
+/// \param  entries The entries to submit, in the order they were enqueued.
+///
+/// \result A promise which is accepted once every entry in the batch has been accepted,
+///         or nil if the entries cannot be submitted right now. Rejecting the promise
+///         causes the batch to be retried after a backoff period.
+///
+///A batch whose submission failed is retried with the same entries, so a submission
+///that is accepted but whose response is lost must be harmless to repeat.
+typedef RKPromise *(^RKDurableQueueSubmitterBlock)(NSArray *entries);
+
+///The RKDurableQueue class encapsulates an append-only, on-disk journal of entries
+///that are waiting to be submitted somewhere, such as a web service.
+///
+///Entries are written to the journal as soon as they are enqueued, and are only removed
+///once a submission containing them has been accepted, so entries survive the app exiting
+///or crashing before they could be submitted. Entries are submitted in batches of at most
+///`maximumBatchSize` when the queue is flushed. Failed submissions are retried with an
+///exponential backoff.
+///
+///Each entry has an identifier, and enqueuing an entry whose identifier is already
+///pending has no effect, so enqueuing the same entry more than once is harmless.
+///
+///All methods on RKDurableQueue must be called from the main thread.
+@interface RKDurableQueue : NSObject
+
+///Initialize the receiver with a given journal file.
+///
+/// \param  path    The location of the receiver's journal. Pending entries are read from it immediately. Required.
+/// \param  ioQueue The serial queue to write the journal on. May be shared between queues. Required.
+///
+/// \result A fully initialized durable queue.
+///
+///This is the designated initializer.
+- (instancetype)initWithPath:(NSString *)path ioQueue:(NSOperationQueue *)ioQueue;
+
+#pragma mark - Properties
+
+///The location of the receiver's journal.
+@property (readonly, copy) NSString *path;
+
+///The block used to submit the receiver's entries.
+@property (copy) RKDurableQueueSubmitterBlock submitter;
+
+///The maximum number of entries passed to the receiver's submitter at once. Defaults to 1.
+@property NSUInteger maximumBatchSize;
+
+///The delay before the first retry of a failed submission.
+///Defaults to `kRKDurableQueueDefaultInitialRetryDelay`.
+@property NSTimeInterval initialRetryDelay;
+
+///The longest the receiver will wait between submission attempts.
+///Defaults to `kRKDurableQueueDefaultMaximumRetryDelay`.
+@property NSTimeInterval maximumRetryDelay;
+
+#pragma mark - State
+
+///The number of entries waiting to be submitted.
+@property (readonly) NSUInteger numberOfPendingEntries;
+
+///Whether or not a submission is in progress.
+@property (readonly) BOOL isSubmitting;
+
+///The number of submissions which have failed since the last one which succeeded.
+@property (readonly) NSUInteger consecutiveFailures;
+
+///The date before which the receiver will not attempt another submission, or nil.
+@property (readonly) NSDate *nextAttemptDate;
+
+#pragma mark - Entries
+
+///Appends an entry to the receiver's journal.
+///
+/// \param  entry       The entry. Must be a property list object. Required.
+/// \param  identifier  The identifier of the entry. Required.
+///
+/// \result YES if the entry was appended; NO if an entry with the identifier is already pending.
+///
+///This method does not submit the entry, call `-[RKDurableQueue flush]` to do that.
+- (BOOL)enqueueEntry:(id)entry withIdentifier:(NSString *)identifier;
+
+///Submits the receiver's pending entries, a batch at a time.
+///
+///This method does nothing if a submission is in progress, or if the receiver is in
+///a backoff period after a failed submission. It is safe to call frequently.
+- (void)flush;
+
+@end
+
+#endif /* RKDurableQueue_h */
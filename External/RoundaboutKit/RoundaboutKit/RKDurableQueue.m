@@ -0,0 +1,299 @@
+//
+//  RKDurableQueue.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/22/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKDurableQueue.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+#import "RKPromise.h"
+
+NSTimeInterval const kRKDurableQueueDefaultInitialRetryDelay = 30.0;
+NSTimeInterval const kRKDurableQueueDefaultMaximumRetryDelay = (1.0 * RK_TIME_HOUR);
+
+///The number of acknowledgement records a journal will accumulate before it is compacted.
+static NSUInteger const kCompactionThreshold = 64;
+
+///Record keys.
+static NSString *const kRecordOperationKey = @"op";
+static NSString *const kRecordOperationAdd = @"add";
+static NSString *const kRecordOperationAcknowledge = @"ack";
+static NSString *const kRecordIdentifierKey = @"id";
+static NSString *const kRecordIdentifiersKey = @"ids";
+static NSString *const kRecordEntryKey = @"entry";
+
+#pragma mark - Journal Records
+
+///Returns the on-disk representation of a given journal record.
+///
+///Records are stored as a big endian 32-bit length followed by a binary property list.
+static NSData *RKDurableQueueCreateRecordData(NSDictionary *record)
+{
+    NSError *error = nil;
+    NSData *payload = [NSPropertyListSerialization dataWithPropertyList:record
+                                                                 format:NSPropertyListBinaryFormat_v1_0
+                                                                options:0
+                                                                  error:&error];
+    if(!payload) {
+        NSLog(@"*** Warning, could not serialize durable queue record %@. %@", record, error);
+        return nil;
+    }
+
+    uint32_t length = CFSwapInt32HostToBig((uint32_t)[payload length]);
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(length) + [payload length]];
+    [data appendBytes:&length length:sizeof(length)];
+    [data appendData:payload];
+    return data;
+}
+
+#pragma mark -
+
+@interface RKDurableQueue ()
+
+///Readwrite.
+@property (readwrite) BOOL isSubmitting;
+
+///Readwrite.
+@property (readwrite) NSUInteger consecutiveFailures;
+
+///Readwrite.
+@property (readwrite) NSDate *nextAttemptDate;
+
+@end
+
+@implementation RKDurableQueue {
+    NSOperationQueue *_ioQueue;
+
+    NSMutableArray *_pendingIdentifiers;
+    NSMutableDictionary *_pendingRecords;
+    NSUInteger _numberOfAcknowledgementRecords;
+}
+
+- (instancetype)initWithPath:(NSString *)path ioQueue:(NSOperationQueue *)ioQueue
+{
+    NSParameterAssert(path);
+    NSParameterAssert(ioQueue);
+
+    if((self = [super init])) {
+        _path = [path copy];
+        _ioQueue = ioQueue;
+
+        self.maximumBatchSize = 1;
+        self.initialRetryDelay = kRKDurableQueueDefaultInitialRetryDelay;
+        self.maximumRetryDelay = kRKDurableQueueDefaultMaximumRetryDelay;
+
+        _pendingIdentifiers = [NSMutableArray array];
+        _pendingRecords = [NSMutableDictionary dictionary];
+
+        [self replay];
+    }
+
+    return self;
+}
+
+#pragma mark - Recovery
+
+///Rebuilds the in-memory state of the receiver from its journal file.
+///
+///A record that was only partially written when the app last exited is
+///discarded, and the journal is truncated to the last complete record.
+- (void)replay
+{
+    NSData *journalData = [NSData dataWithContentsOfFile:_path options:NSDataReadingMappedIfSafe error:NULL];
+    if(!journalData)
+        return;
+
+    const uint8_t *bytes = [journalData bytes];
+    NSUInteger length = [journalData length];
+    NSUInteger offset = 0;
+    while (offset + sizeof(uint32_t) <= length) {
+        uint32_t recordLength = 0;
+        memcpy(&recordLength, bytes + offset, sizeof(recordLength));
+        recordLength = CFSwapInt32BigToHost(recordLength);
+        if(offset + sizeof(uint32_t) + recordLength > length)
+            break;
+
+        NSData *payload = [journalData subdataWithRange:NSMakeRange(offset + sizeof(uint32_t), recordLength)];
+        NSDictionary *record = [NSPropertyListSerialization propertyListWithData:payload
+                                                                         options:NSPropertyListImmutable
+                                                                          format:NULL
+                                                                           error:NULL];
+        if(![record isKindOfClass:[NSDictionary class]])
+            break;
+
+        [self applyRecord:record];
+        offset += sizeof(uint32_t) + recordLength;
+    }
+
+    if(offset < length) {
+        NSLog(@"*** Warning, discarding %ld bytes of incomplete durable queue records in %@", (long)(length - offset), _path);
+        truncate([_path fileSystemRepresentation], (off_t)offset);
+    }
+}
+
+- (void)applyRecord:(NSDictionary *)record
+{
+    NSString *operation = record[kRecordOperationKey];
+    if([operation isEqualToString:kRecordOperationAdd]) {
+        NSString *identifier = record[kRecordIdentifierKey];
+        if(identifier && record[kRecordEntryKey] && !_pendingRecords[identifier]) {
+            [_pendingIdentifiers addObject:identifier];
+            _pendingRecords[identifier] = record;
+        }
+    } else if([operation isEqualToString:kRecordOperationAcknowledge]) {
+        for (NSString *identifier in record[kRecordIdentifiersKey]) {
+            [_pendingRecords removeObjectForKey:identifier];
+            [_pendingIdentifiers removeObject:identifier];
+        }
+
+        _numberOfAcknowledgementRecords++;
+    }
+}
+
+#pragma mark - Writing
+
+- (void)writeRecord:(NSDictionary *)record
+{
+    NSData *recordData = RKDurableQueueCreateRecordData(record);
+    if(!recordData)
+        return;
+
+    NSString *path = _path;
+    [_ioQueue addOperationWithBlock:^{
+        int fd = open([path fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if(fd == -1) {
+            NSLog(@"*** Warning, could not open durable queue journal %@. %s", path, strerror(errno));
+            return;
+        }
+
+        ssize_t bytesWritten = write(fd, [recordData bytes], [recordData length]);
+        if(bytesWritten != (ssize_t)[recordData length])
+            NSLog(@"*** Warning, could not append to durable queue journal %@. %s", path, strerror(errno));
+
+        fsync(fd);
+        close(fd);
+    }];
+}
+
+///Rewrites the receiver's journal so that it only contains pending entries.
+///
+///The new journal is written to a temporary file and then moved into place,
+///so a crash during compaction leaves either the old or the new journal intact.
+- (void)compact
+{
+    NSMutableData *journalData = [NSMutableData data];
+    for (NSString *identifier in _pendingIdentifiers) {
+        NSData *recordData = RKDurableQueueCreateRecordData(_pendingRecords[identifier]);
+        if(recordData)
+            [journalData appendData:recordData];
+    }
+
+    _numberOfAcknowledgementRecords = 0;
+
+    NSString *path = _path;
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        if([journalData length] == 0) {
+            if(![[NSFileManager defaultManager] removeItemAtPath:path error:&error] &&
+               [[NSFileManager defaultManager] fileExistsAtPath:path]) {
+                NSLog(@"*** Warning, could not remove empty durable queue journal %@. %@", path, error);
+            }
+        } else if(![journalData writeToFile:path options:NSDataWritingAtomic error:&error]) {
+            NSLog(@"*** Warning, could not compact durable queue journal %@. %@", path, error);
+        }
+    }];
+}
+
+#pragma mark - Entries
+
+- (NSUInteger)numberOfPendingEntries
+{
+    return [_pendingIdentifiers count];
+}
+
+- (BOOL)enqueueEntry:(id)entry withIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(entry);
+    NSParameterAssert(identifier);
+    NSAssert([NSThread isMainThread], @"RKDurableQueue must only be used from the main thread.");
+
+    if(_pendingRecords[identifier])
+        return NO;
+
+    NSDictionary *record = @{
+        kRecordOperationKey: kRecordOperationAdd,
+        kRecordIdentifierKey: identifier,
+        kRecordEntryKey: entry,
+    };
+    [_pendingIdentifiers addObject:identifier];
+    _pendingRecords[identifier] = record;
+    [self writeRecord:record];
+
+    return YES;
+}
+
+- (void)acknowledgeEntriesWithIdentifiers:(NSArray *)identifiers
+{
+    NSParameterAssert(identifiers);
+
+    [_pendingRecords removeObjectsForKeys:identifiers];
+    [_pendingIdentifiers removeObjectsInArray:identifiers];
+    _numberOfAcknowledgementRecords++;
+
+    if([_pendingIdentifiers count] == 0 || _numberOfAcknowledgementRecords >= kCompactionThreshold)
+        [self compact];
+    else
+        [self writeRecord:@{ kRecordOperationKey: kRecordOperationAcknowledge, kRecordIdentifiersKey: identifiers }];
+}
+
+#pragma mark - Submission
+
+- (void)flush
+{
+    NSAssert([NSThread isMainThread], @"RKDurableQueue must only be used from the main thread.");
+
+    if(!self.submitter || self.isSubmitting || [_pendingIdentifiers count] == 0)
+        return;
+
+    if(self.nextAttemptDate && [self.nextAttemptDate timeIntervalSinceNow] > 0.0)
+        return;
+
+    NSRange batchRange = NSMakeRange(0, MIN(MAX(self.maximumBatchSize, 1), [_pendingIdentifiers count]));
+    NSArray *identifiers = [_pendingIdentifiers subarrayWithRange:batchRange];
+    NSArray *records = [_pendingRecords objectsForKeys:identifiers notFoundMarker:[NSNull null]];
+    NSArray *entries = [records valueForKey:kRecordEntryKey];
+
+    RKPromise *submission = self.submitter(entries);
+    if(!submission)
+        return;
+
+    self.isSubmitting = YES;
+    [submission then:^(id result) {
+        self.isSubmitting = NO;
+        self.consecutiveFailures = 0;
+        self.nextAttemptDate = nil;
+        [self acknowledgeEntriesWithIdentifiers:identifiers];
+
+        [self flush];
+    } otherwise:^(NSError *error) {
+        self.isSubmitting = NO;
+        self.consecutiveFailures++;
+
+        //Jitter keeps every queue from retrying in lockstep after an outage.
+        NSTimeInterval delay = MIN(self.initialRetryDelay * pow(2.0, self.consecutiveFailures - 1), self.maximumRetryDelay);
+        delay += delay * 0.25 * ((double)arc4random_uniform(1000) / 1000.0);
+        self.nextAttemptDate = [NSDate dateWithTimeIntervalSinceNow:delay];
+
+        NSLog(@"*** Warning, could not submit %ld entries from %@, will retry in %.0f seconds. %@", (unsigned long)[entries count], [_path lastPathComponent], delay, error);
+
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+            [self flush];
+        });
+    } onQueue:[NSOperationQueue mainQueue]];
+}
+
+@end
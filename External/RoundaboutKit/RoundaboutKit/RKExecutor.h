@@ -0,0 +1,118 @@
+//
+//  RKExecutor.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKExecutor_h
+#define RKExecutor_h 1
+
+#import <Foundation/Foundation.h>
+
+///The classes of work an executor can perform, from least to most important.
+typedef NS_ENUM(NSInteger, RKExecutorQualityOfService) {
+    ///Work the user is not aware of, such as pruning caches.
+    kRKExecutorQualityOfServiceBackground = 0,
+
+    ///Long-running work the user is aware of but not waiting on, such as syncing.
+    kRKExecutorQualityOfServiceUtility,
+
+    ///Work the user started and is waiting on, such as loading search results.
+    kRKExecutorQualityOfServiceUserInitiated,
+
+    ///Work that must complete for the interface to respond, such as preparing playback.
+    kRKExecutorQualityOfServiceUserInteractive,
+};
+
+///The width to pass to `+[RKExecutor executorNamed:qualityOfService:width:]`
+///to have the system decide how many operations to run at once.
+#define kRKExecutorDefaultWidth NSOperationQueueDefaultMaxConcurrentOperationCount
+
+///The length of time, in seconds, that the throughput of an executor is measured over.
+#define kRKExecutorThroughputWindow 60
+
+///The RKExecutor class is an operation queue with a stable name, a fixed quality of service
+///and width, and live measurements of the work passing through it.
+///
+///Executors are registered by name the first time they are requested, and are never released,
+///so every client asking for a given name shares the same width limit and serialization.
+///
+///The quality of service of an executor is applied to each operation added to it through its
+///thread priority, and to the executor itself where the system supports it. Operations added
+///to an executor should not have their thread priorities changed afterwards.
+///
+///Every method on RKExecutor is safe to call from multiple threads.
+@interface RKExecutor : NSOperationQueue
+
+#pragma mark - Registry
+
+///Returns the executor registered under a given name, creating it if it does not already exist.
+///
+/// \param  name                    The name of the executor. Required.
+/// \param  qualityOfServiceClass   The class of work the executor performs.
+/// \param  width                   The maximum number of operations the executor may run at once,
+///                                 or `kRKExecutorDefaultWidth`. A width of 1 makes the executor serial.
+///
+/// \result The executor registered under the name.
+///
+///If an executor is already registered under the name, it is returned unchanged,
+///and a warning is logged if it was registered with a different configuration.
++ (instancetype)executorNamed:(NSString *)name qualityOfService:(RKExecutorQualityOfService)qualityOfServiceClass width:(NSInteger)width;
+
+///Returns the executor registered under a given name, or nil if there is none.
++ (instancetype)existingExecutorNamed:(NSString *)name;
+
+///Returns a common catch-all executor suitable for short-lived background tasks.
++ (instancetype)commonExecutor;
+
+///Returns every registered executor, sorted by name.
++ (NSArray *)allExecutors;
+
+#pragma mark - Properties
+
+///The class of work the receiver performs.
+///
+///This is distinct from `NSOperationQueue.qualityOfService`, which does not exist on every system RoundaboutKit supports.
+@property (readonly) RKExecutorQualityOfService qualityOfServiceClass;
+
+///The maximum number of operations the receiver may run at once.
+///
+///Executors may not be reconfigured once they are registered,
+///so `-[self setMaxConcurrentOperationCount:]` raises an exception.
+@property (readonly) NSInteger width;
+
+#pragma mark - Metrics
+
+///The number of operations waiting for the receiver to start them.
+@property (readonly) NSUInteger queueDepth;
+
+///The number of operations the receiver is running.
+@property (readonly) NSUInteger runningCount;
+
+///Returns a property list compatible snapshot of the receiver's measurements.
+///
+///The snapshot has the keys `name`, `qualityOfService`, `width`, `suspended`, `queueDepth`,
+///`running`, `completed`, `waitTime`, `runTime`, and `throughput`. The values of `waitTime` and `runTime`
+///are dictionaries with the keys `mean` and `max`, in seconds. `throughput` is the number of
+///operations completed per second over the last `kRKExecutorThroughputWindow` seconds.
+- (NSDictionary *)snapshot;
+
+///Resets the receiver's completed count, times, and throughput.
+- (void)resetMetrics;
+
+#pragma mark - Debugging
+
+///Returns snapshots of every registered executor, sorted by name.
++ (NSArray *)snapshotsOfAllExecutors;
+
+///Prints the state of every registered executor to stdout.
+///
+///This method is intended to be called from the debugger when investigating
+///stalls, e.g. `po [RKExecutor prettyPrintAllExecutors]`.
++ (void)prettyPrintAllExecutors;
+
+@end
+
+#endif /* RKExecutor_h */
@@ -0,0 +1,456 @@
+//
+//  RKExecutor.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKExecutor.h"
+#import "RKTrace.h"
+#import <objc/runtime.h>
+
+///The name of the executor returned by `+[RKExecutor commonExecutor]`.
+static NSString *const kCommonExecutorName = @"com.roundabout.rk.executor.common";
+
+///The context used when observing the state of operations.
+static void *const kOperationStateObservationContext = (void *)&kOperationStateObservationContext;
+
+///The key of the associated RKExecutorOperationTimes object of an operation.
+static char kOperationTimesKey;
+
+#pragma mark - Quality of Service
+
+///Returns the thread priority corresponding to a given quality of service.
+static double ThreadPriorityForQualityOfService(RKExecutorQualityOfService qualityOfService)
+{
+    switch (qualityOfService) {
+        case kRKExecutorQualityOfServiceBackground:
+            return 0.0;
+
+        case kRKExecutorQualityOfServiceUtility:
+            return 0.25;
+
+        case kRKExecutorQualityOfServiceUserInitiated:
+            return 0.5;
+
+        case kRKExecutorQualityOfServiceUserInteractive:
+            return 0.75;
+    }
+
+    return 0.5;
+}
+
+///Returns the value of `NSQualityOfService` corresponding to a given quality of service.
+///
+///The raw values are used because `NSQualityOfService` is not available on every system.
+static NSInteger SystemQualityOfServiceForQualityOfService(RKExecutorQualityOfService qualityOfService)
+{
+    switch (qualityOfService) {
+        case kRKExecutorQualityOfServiceBackground:
+            return 0x09;
+
+        case kRKExecutorQualityOfServiceUtility:
+            return 0x11;
+
+        case kRKExecutorQualityOfServiceUserInitiated:
+            return 0x19;
+
+        case kRKExecutorQualityOfServiceUserInteractive:
+            return 0x21;
+    }
+
+    return -1;
+}
+
+///Returns a human readable name for a given quality of service.
+static NSString *NameForQualityOfService(RKExecutorQualityOfService qualityOfService)
+{
+    switch (qualityOfService) {
+        case kRKExecutorQualityOfServiceBackground:
+            return @"background";
+
+        case kRKExecutorQualityOfServiceUtility:
+            return @"utility";
+
+        case kRKExecutorQualityOfServiceUserInitiated:
+            return @"userInitiated";
+
+        case kRKExecutorQualityOfServiceUserInteractive:
+            return @"userInteractive";
+    }
+
+    return @"unknown";
+}
+
+#pragma mark -
+
+///The RKExecutorOperationTimes class records when an operation added to an executor was enqueued and started.
+@interface RKExecutorOperationTimes : NSObject
+
+///The time the operation was added to its executor.
+@property CFAbsoluteTime enqueueTime;
+
+///The time the operation started executing, or 0 if it has not.
+@property CFAbsoluteTime startTime;
+
+@end
+
+@implementation RKExecutorOperationTimes
+
+@end
+
+#pragma mark -
+
+@implementation RKExecutor {
+    BOOL _isRegistered;
+
+    //The following are only accessed while synchronized on self.
+    NSUInteger _queueDepth;
+    NSUInteger _runningCount;
+    NSUInteger _completedCount;
+
+    NSTimeInterval _totalWaitTime;
+    NSTimeInterval _maximumWaitTime;
+    NSTimeInterval _totalRunTime;
+    NSTimeInterval _maximumRunTime;
+
+    //Completions are counted in one second buckets, indexed by second modulo the window.
+    NSUInteger _completionCounts[kRKExecutorThroughputWindow];
+    long _completionSeconds[kRKExecutorThroughputWindow];
+}
+
+#pragma mark - Registry
+
+///Returns the registered executors, keyed by name. Only accessed while synchronized on the class.
++ (NSMutableDictionary *)registeredExecutors
+{
+    static NSMutableDictionary *registeredExecutors = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registeredExecutors = [NSMutableDictionary new];
+    });
+
+    return registeredExecutors;
+}
+
++ (instancetype)executorNamed:(NSString *)name qualityOfService:(RKExecutorQualityOfService)qualityOfServiceClass width:(NSInteger)width
+{
+    NSParameterAssert(name);
+    NSParameterAssert(width > 0 || width == kRKExecutorDefaultWidth);
+
+    RKExecutor *executor = nil;
+    @synchronized([RKExecutor class]) {
+        NSMutableDictionary *registeredExecutors = [self registeredExecutors];
+        executor = registeredExecutors[name];
+        if(!executor) {
+            executor = [[RKExecutor alloc] initWithName:name qualityOfService:qualityOfServiceClass width:width];
+            registeredExecutors[name] = executor;
+
+            return executor;
+        }
+    }
+
+    if(executor.qualityOfServiceClass != qualityOfServiceClass || executor.width != width) {
+        NSLog(@"*** Warning: executor %@ was requested as (%@, width %ld) but is registered as (%@, width %ld). Using the registered executor.",
+              name,
+              NameForQualityOfService(qualityOfServiceClass), (long)width,
+              NameForQualityOfService(executor.qualityOfServiceClass), (long)executor.width);
+    }
+
+    return executor;
+}
+
++ (instancetype)existingExecutorNamed:(NSString *)name
+{
+    NSParameterAssert(name);
+
+    @synchronized([RKExecutor class]) {
+        return [self registeredExecutors][name];
+    }
+}
+
++ (instancetype)commonExecutor
+{
+    return [self executorNamed:kCommonExecutorName qualityOfService:kRKExecutorQualityOfServiceUtility width:kRKExecutorDefaultWidth];
+}
+
++ (NSArray *)allExecutors
+{
+    NSArray *executors = nil;
+    @synchronized([RKExecutor class]) {
+        executors = [[self registeredExecutors] allValues];
+    }
+
+    return [executors sortedArrayUsingComparator:^NSComparisonResult(RKExecutor *left, RKExecutor *right) {
+        return [left.name compare:right.name];
+    }];
+}
+
+#pragma mark - Lifecycle
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+- (instancetype)initWithName:(NSString *)name qualityOfService:(RKExecutorQualityOfService)qualityOfServiceClass width:(NSInteger)width
+{
+    if((self = [super init])) {
+        _qualityOfServiceClass = qualityOfServiceClass;
+
+        [super setName:name];
+        [super setMaxConcurrentOperationCount:width];
+
+        if([self respondsToSelector:@selector(setQualityOfService:)])
+            [self setValue:@(SystemQualityOfServiceForQualityOfService(qualityOfServiceClass)) forKey:@"qualityOfService"];
+
+        _isRegistered = YES;
+    }
+
+    return self;
+}
+
+#pragma mark - Properties
+
+- (void)setName:(NSString *)name
+{
+    if(_isRegistered)
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                       reason:@"Cannot rename an executor"
+                                     userInfo:nil];
+
+    [super setName:name];
+}
+
+- (void)setMaxConcurrentOperationCount:(NSInteger)maxConcurrentOperationCount
+{
+    if(_isRegistered)
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                       reason:@"Cannot change the width of an executor"
+                                     userInfo:nil];
+
+    [super setMaxConcurrentOperationCount:maxConcurrentOperationCount];
+}
+
+- (NSInteger)width
+{
+    return self.maxConcurrentOperationCount;
+}
+
+#pragma mark - Adding Operations
+
+- (void)addOperation:(NSOperation *)operation
+{
+    NSParameterAssert(operation);
+
+    operation.threadPriority = ThreadPriorityForQualityOfService(_qualityOfServiceClass);
+
+    RKExecutorOperationTimes *times = [RKExecutorOperationTimes new];
+    times.enqueueTime = CFAbsoluteTimeGetCurrent();
+    objc_setAssociatedObject(operation, &kOperationTimesKey, times, OBJC_ASSOCIATION_RETAIN);
+
+    @synchronized(self) {
+        _queueDepth++;
+    }
+
+    //The operation is observed before it is enqueued so its start cannot be missed.
+    [operation addObserver:self forKeyPath:@"isExecuting" options:0 context:kOperationStateObservationContext];
+    [operation addObserver:self forKeyPath:@"isFinished" options:0 context:kOperationStateObservationContext];
+
+    [super addOperation:operation];
+}
+
+- (void)addOperations:(NSArray *)operations waitUntilFinished:(BOOL)wait
+{
+    //Operations are added individually so each one is instrumented exactly once.
+    for (NSOperation *operation in operations)
+        [self addOperation:operation];
+
+    if(wait) {
+        for (NSOperation *operation in operations)
+            [operation waitUntilFinished];
+    }
+}
+
+- (void)addOperationWithBlock:(void (^)(void))block
+{
+    NSParameterAssert(block);
+
+    if(RKTraceIsEnabled())
+        block = RKTraceWrapBlock(kRKTraceCategoryQueue, self.name, block);
+
+    [self addOperation:[NSBlockOperation blockOperationWithBlock:block]];
+}
+
+#pragma mark - Measuring
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+{
+    if(context != kOperationStateObservationContext) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+
+    NSOperation *operation = object;
+    RKExecutorOperationTimes *times = objc_getAssociatedObject(operation, &kOperationTimesKey);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+    if([keyPath isEqualToString:@"isExecuting"]) {
+        if(!operation.isExecuting)
+            return;
+
+        @synchronized(self) {
+            if(times.startTime != 0.0)
+                return;
+
+            times.startTime = now;
+
+            NSTimeInterval waitTime = now - times.enqueueTime;
+            _totalWaitTime += waitTime;
+            _maximumWaitTime = MAX(_maximumWaitTime, waitTime);
+
+            _queueDepth--;
+            _runningCount++;
+        }
+    } else if([keyPath isEqualToString:@"isFinished"]) {
+        if(!operation.isFinished)
+            return;
+
+        [operation removeObserver:self forKeyPath:@"isExecuting" context:kOperationStateObservationContext];
+        [operation removeObserver:self forKeyPath:@"isFinished" context:kOperationStateObservationContext];
+        objc_setAssociatedObject(operation, &kOperationTimesKey, nil, OBJC_ASSOCIATION_RETAIN);
+
+        @synchronized(self) {
+            //Operations cancelled before they start finish without ever executing.
+            if(times.startTime == 0.0) {
+                _queueDepth--;
+                return;
+            }
+
+            NSTimeInterval runTime = now - times.startTime;
+            _totalRunTime += runTime;
+            _maximumRunTime = MAX(_maximumRunTime, runTime);
+
+            _runningCount--;
+            _completedCount++;
+
+            long second = (long)floor(now);
+            NSUInteger bucket = (NSUInteger)(second % kRKExecutorThroughputWindow);
+            if(_completionSeconds[bucket] != second) {
+                _completionSeconds[bucket] = second;
+                _completionCounts[bucket] = 0;
+            }
+            _completionCounts[bucket]++;
+        }
+    }
+}
+
+#pragma mark - Metrics
+
+- (NSUInteger)queueDepth
+{
+    @synchronized(self) {
+        return _queueDepth;
+    }
+}
+
+- (NSUInteger)runningCount
+{
+    @synchronized(self) {
+        return _runningCount;
+    }
+}
+
+- (NSDictionary *)snapshot
+{
+    long now = (long)floor(CFAbsoluteTimeGetCurrent());
+
+    @synchronized(self) {
+        NSUInteger recentCompletions = 0;
+        for (NSUInteger bucket = 0; bucket < kRKExecutorThroughputWindow; bucket++) {
+            if(now - _completionSeconds[bucket] < kRKExecutorThroughputWindow)
+                recentCompletions += _completionCounts[bucket];
+        }
+
+        //Wait times are recorded when operations start, so they are averaged over
+        //every started operation, including the ones which are still running.
+        NSUInteger startedCount = _completedCount + _runningCount;
+
+        return @{
+            @"name": self.name,
+            @"qualityOfService": NameForQualityOfService(_qualityOfServiceClass),
+            @"width": @(self.width),
+            @"suspended": @(self.isSuspended),
+            @"queueDepth": @(_queueDepth),
+            @"running": @(_runningCount),
+            @"completed": @(_completedCount),
+            @"waitTime": @{
+                @"mean": @(startedCount > 0? _totalWaitTime / startedCount : 0.0),
+                @"max": @(_maximumWaitTime),
+            },
+            @"runTime": @{
+                @"mean": @(_completedCount > 0? _totalRunTime / _completedCount : 0.0),
+                @"max": @(_maximumRunTime),
+            },
+            @"throughput": @((double)recentCompletions / kRKExecutorThroughputWindow),
+        };
+    }
+}
+
+- (void)resetMetrics
+{
+    @synchronized(self) {
+        _completedCount = 0;
+
+        _totalWaitTime = 0.0;
+        _maximumWaitTime = 0.0;
+        _totalRunTime = 0.0;
+        _maximumRunTime = 0.0;
+
+        memset(_completionCounts, 0, sizeof(_completionCounts));
+        memset(_completionSeconds, 0, sizeof(_completionSeconds));
+    }
+}
+
+#pragma mark - Debugging
+
++ (NSArray *)snapshotsOfAllExecutors
+{
+    NSMutableArray *snapshots = [NSMutableArray array];
+    for (RKExecutor *executor in [self allExecutors])
+        [snapshots addObject:[executor snapshot]];
+
+    return snapshots;
+}
+
++ (void)prettyPrintAllExecutors
+{
+    NSArray *snapshots = [self snapshotsOfAllExecutors];
+    puts([[NSString stringWithFormat:@"-- begin %ld executors --", (unsigned long)snapshots.count] UTF8String]);
+    putc('\n', stdout);
+
+    for (NSDictionary *snapshot in snapshots) {
+        NSInteger width = [snapshot[@"width"] integerValue];
+        NSString *widthDescription = (width == kRKExecutorDefaultWidth)? @"default width" : [NSString stringWithFormat:@"width %ld", (long)width];
+        NSString *suspendedDescription = [snapshot[@"suspended"] boolValue]? @", SUSPENDED" : @"";
+        puts([[NSString stringWithFormat:@"%@ (%@, %@%@)", snapshot[@"name"], snapshot[@"qualityOfService"], widthDescription, suspendedDescription] UTF8String]);
+
+        puts([[NSString stringWithFormat:@"\t%@ waiting, %@ running, %@ completed", snapshot[@"queueDepth"], snapshot[@"running"], snapshot[@"completed"]] UTF8String]);
+
+        NSDictionary *waitTime = snapshot[@"waitTime"];
+        NSDictionary *runTime = snapshot[@"runTime"];
+        puts([[NSString stringWithFormat:@"\twait %.3fs mean %.3fs max, run %.3fs mean %.3fs max",
+               [waitTime[@"mean"] doubleValue], [waitTime[@"max"] doubleValue],
+               [runTime[@"mean"] doubleValue], [runTime[@"max"] doubleValue]] UTF8String]);
+
+        puts([[NSString stringWithFormat:@"\t%.2f operations per second", [snapshot[@"throughput"] doubleValue]] UTF8String]);
+
+        putc('\n', stdout);
+    }
+
+    puts([[NSString stringWithFormat:@"-- end %ld executors --", (unsigned long)snapshots.count] UTF8String]);
+}
+
+@end
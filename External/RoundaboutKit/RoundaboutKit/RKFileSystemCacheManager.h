@@ -15,6 +15,16 @@
 ///when it is initialized. This means that any method calls before the initialization
 ///process has been completed may block longer than is otherwise typical.
 ///
+///The metadata for cached data is kept in memory, and changes to it are appended to a
+///log on disk in batches. The log is periodically folded into a snapshot of the metadata.
+///
+///Data is evicted by an `RKCacheEvictionPolicy` as new data is cached, so that responses
+///that are only requested once do not push out the responses that are reused.
+///
+///The metadata is split into shards which are locked independently, and file IO is
+///performed outside of any lock, so the cache manager may be used from many threads at
+///once. Lookups of revisions and validation dates never take a lock.
+///
 ///The methods on this class should always be called from a background thread.
 ///
 ///This class was formerly known as RKURLRequestPromiseCacheManager.
@@ -30,11 +40,27 @@
 
 ///The maximum size of the cache. Defaults to 30 MB.
 ///
-///Changing the value of this property will not affect
-///the cache until its next maintenance cycle.
+///Data is evicted as new data is cached so that the cache stays within this size.
+///Lowering the value of this property will not evict any data until more data is
+///cached or the cache's next maintenance cycle.
 @property NSUInteger maxCacheSize;
 
-///The estimated size of the cache.
+///The estimated size of the cache on disk.
 @property (readonly) NSUInteger cacheSize;
 
+///Whether or not data is compressed when it is cached. Defaults to YES.
+///
+///Data is compressed with a fast deflate, and is only stored compressed when
+///that saves a meaningful amount of space. Data is transparently decompressed
+///when it is retrieved, regardless of the value of this property.
+@property BOOL compressesCachedData;
+
+#pragma mark - Metadata
+
+///Writes any pending changes to the receiver's metadata to disk, blocking until they have been written.
+///
+///Metadata changes are appended to a log in batches shortly after they are made,
+///so it is only necessary to call this method when the process is about to exit.
+- (void)flushMetadata;
+
 @end
@@ -7,7 +7,13 @@
 //
 
 #import "RKFileSystemCacheManager.h"
+#import "RKCacheEvictionPolicy.h"
 #import <CommonCrypto/CommonDigest.h>
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <zlib.h>
 
 static NSString *const kMaxCacheSize = @"__maxCacheSize";
 static NSString *const kCacheSize = @"__cacheSize";
@@ -15,16 +21,223 @@ static NSString *const kCacheSize = @"__cacheSize";
 static NSString *const kRevisionKey = @"revision";
 static NSString *const kLastAccessedDateKey = @"lastAccessDate";
 static NSString *const kDataSizeKey = @"dataSize";
+static NSString *const kValidationDateKey = @"validationDate";
+static NSString *const kEncodingKey = @"encoding";
+static NSString *const kUncompressedSizeKey = @"uncompressedSize";
+
+///The encoding of data stored as a raw deflate stream. Data without an encoding is stored as-is.
+static NSString *const kDeflateEncoding = @"deflate";
+
+static NSString *const kMetadataGenerationKey = @"__generation";
+
+static NSString *const kLogRecordGenerationKey = @"generation";
+static NSString *const kLogRecordChangesKey = @"changes";
+static NSString *const kLogRecordRemovalsKey = @"removals";
 
 static NSTimeInterval const kExpirationInterval = (RK_TIME_DAY * 7.0);
-static NSUInteger kDefaultMaxCacheSize = (1024 * 30) /* 30 MB */;
+static NSUInteger kDefaultMaxCacheSize = (1024 * 1024 * 30) /* 30 MB */;
+
+///How long metadata changes are collected before being appended to the log as a single record.
+static NSTimeInterval const kMetadataFlushDelay = 1.0;
+
+///The size the metadata log may grow to before it is folded back into the metadata snapshot.
+static unsigned long long const kMetadataLogCompactionThreshold = (1024 * 512);
+
+///How stale an item's last accessed date must be before a read updates it.
+static NSTimeInterval const kLastAccessedDateGranularity = RK_TIME_MINUTE;
+
+///The size above which cached data is memory mapped rather than read when it is retrieved.
+static NSUInteger const kMappedReadThreshold = (1024 * 64);
+
+///The size below which data is never compressed.
+static NSUInteger const kCompressionMinimumSize = 512;
+
+///The largest fraction of its original size compressed data may be before it is stored as-is instead.
+static double const kCompressionMaximumRatio = 0.9;
+
+///The size of the chunks compressed data is read in.
+static NSUInteger const kDecompressionChunkSize = (1024 * 64);
+
+///The number of shards the metadata is split into. Sanitized identifiers are
+///hexadecimal hashes, so their first digit is used to pick a shard.
+#define kShardCount 16
+
+#pragma mark -
+
+///The RKFileSystemCacheShard class encapsulates the metadata for the
+///cache items whose sanitized identifiers share a first hex digit.
+///
+///The items dictionary is never mutated once it has been published. Writers take
+///the shard's lock, publish a modified copy, and release the lock. Readers simply
+///load the current dictionary, and so never wait on writers.
+@interface RKFileSystemCacheShard : NSObject {
+@public
+    pthread_mutex_t _lock;
+}
+
+///The metadata of the items in the shard, keyed by sanitized identifier.
+@property (atomic) NSDictionary *items;
+
+@end
+
+@implementation RKFileSystemCacheShard
+
+- (void)dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (id)init
+{
+    if((self = [super init])) {
+        pthread_mutex_init(&_lock, NULL);
+        self.items = @{};
+    }
+
+    return self;
+}
+
+@end
+
+RK_INLINE NSUInteger ShardIndexForSanitizedIdentifier(NSString *sanitizedIdentifier)
+{
+    unichar firstDigit = [sanitizedIdentifier characterAtIndex:0];
+    if(firstDigit >= '0' && firstDigit <= '9')
+        return (firstDigit - '0');
+    else if(firstDigit >= 'a' && firstDigit <= 'f')
+        return (firstDigit - 'a' + 10);
+    else if(firstDigit >= 'A' && firstDigit <= 'F')
+        return (firstDigit - 'A' + 10);
+    else
+        return (firstDigit % kShardCount);
+}
+
+#pragma mark - Compression
+
+///Returns a raw deflate stream of a given data object compressed for speed, or nil if it could not be compressed.
+static NSData *RKFileSystemCacheCompressData(NSData *data)
+{
+    z_stream stream = {0};
+    if(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return nil;
+
+    NSMutableData *compressedData = [NSMutableData dataWithLength:deflateBound(&stream, (uLong)data.length)];
+    stream.next_in = (Bytef *)data.bytes;
+    stream.avail_in = (uInt)data.length;
+    stream.next_out = compressedData.mutableBytes;
+    stream.avail_out = (uInt)compressedData.length;
+
+    int result = deflate(&stream, Z_FINISH);
+    compressedData.length = stream.total_out;
+    deflateEnd(&stream);
+
+    return (result == Z_STREAM_END)? compressedData : nil;
+}
+
+///Returns an error describing a failure to read the compressed cache file at a given location.
+static NSError *RKFileSystemCacheDecompressionError(NSURL *location, NSInteger code, NSError *underlyingError)
+{
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:location forKey:NSURLErrorKey];
+    if(underlyingError)
+        userInfo[NSUnderlyingErrorKey] = underlyingError;
+
+    return [NSError errorWithDomain:NSCocoaErrorDomain code:code userInfo:userInfo];
+}
+
+///Reads and decompresses the raw deflate stream in the file at a given location.
+///
+/// \param  location            The location of the compressed file. Required.
+/// \param  uncompressedSize    The expected size of the decompressed data. Used as a capacity hint.
+/// \param  outError            out NSError. `NSFileReadNoSuchFileError` if the file does not exist.
+///
+/// \result The decompressed data, or nil if the file could not be read or decompressed.
+///
+///The file is read and decompressed in fixed size chunks, so the compressed data
+///is never held in memory alongside the decompressed data in its entirety.
+static NSData *RKFileSystemCacheDecompressContentsOfURL(NSURL *location, NSUInteger uncompressedSize, NSError **outError)
+{
+    int fileDescriptor = open([[location path] fileSystemRepresentation], O_RDONLY);
+    if(fileDescriptor == -1) {
+        if(outError) {
+            NSError *posixError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            *outError = RKFileSystemCacheDecompressionError(location, (errno == ENOENT)? NSFileReadNoSuchFileError : NSFileReadUnknownError, posixError);
+        }
+        return nil;
+    }
+
+    z_stream stream = {0};
+    if(inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        close(fileDescriptor);
+        if(outError) *outError = RKFileSystemCacheDecompressionError(location, NSFileReadUnknownError, nil);
+        return nil;
+    }
+
+    NSMutableData *data = [NSMutableData dataWithLength:MAX(uncompressedSize, kDecompressionChunkSize)];
+    uint8_t *chunk = malloc(kDecompressionChunkSize);
+
+    int result = Z_OK;
+    NSInteger errorCode = 0;
+    while (result != Z_STREAM_END && errorCode == 0) {
+        ssize_t chunkLength = read(fileDescriptor, chunk, kDecompressionChunkSize);
+        if(chunkLength <= 0) {
+            errorCode = (chunkLength == 0)? NSFileReadCorruptFileError : NSFileReadUnknownError;
+            break;
+        }
+
+        stream.next_in = chunk;
+        stream.avail_in = (uInt)chunkLength;
+        while (stream.avail_in > 0 && result != Z_STREAM_END) {
+            if(stream.total_out == data.length)
+                data.length *= 2;
+
+            stream.next_out = (Bytef *)data.mutableBytes + stream.total_out;
+            stream.avail_out = (uInt)(data.length - stream.total_out);
+
+            result = inflate(&stream, Z_NO_FLUSH);
+            if(result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                errorCode = NSFileReadCorruptFileError;
+                break;
+            }
+        }
+    }
+
+    data.length = stream.total_out;
+    inflateEnd(&stream);
+    free(chunk);
+    close(fileDescriptor);
+
+    if(errorCode != 0) {
+        if(outError) *outError = RKFileSystemCacheDecompressionError(location, errorCode, nil);
+        return nil;
+    }
+
+    return data;
+}
+
+#pragma mark -
 
 @implementation RKFileSystemCacheManager {
     NSURL *_cacheLocation;
     NSURL *_cacheMetadataLocation;
-    
-    dispatch_queue_t _accessControlQueue;
-    NSMutableDictionary *_cacheMetadata;
+    NSURL *_cacheMetadataLogLocation;
+
+    dispatch_group_t _loadGroup;
+    volatile BOOL _isLoaded;
+
+    RKFileSystemCacheShard *_shards[kShardCount];
+    volatile int64_t _cacheSize;
+    volatile int64_t _maxCacheSize;
+
+    pthread_mutex_t _evictionPolicyLock;
+    RKCacheEvictionPolicy *_evictionPolicy;
+
+    /* Owned by _metadataLogQueue */
+    dispatch_queue_t _metadataLogQueue;
+    NSMutableDictionary *_pendingMetadataChanges;
+    BOOL _isMetadataFlushScheduled;
+    int _metadataLogDescriptor;
+    NSUInteger _metadataLogGeneration;
+    unsigned long long _metadataLogLength;
 }
 
 #pragma mark - Lifecycle
@@ -38,17 +251,17 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
     dispatch_once(&onceToken, ^{
         dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
         maintenanceTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
-        
+
         dispatch_source_set_timer(maintenanceTimer,
                                   dispatch_time(DISPATCH_TIME_NOW, 60.0 * NSEC_PER_SEC),
                                   kMaintenanceTimerInterval * NSEC_PER_SEC,
                                   kMaintenanceTimerInterval / 2);
-        
+
         dispatch_source_set_event_handler(maintenanceTimer, ^{
             [[RKFileSystemCacheManager sharedCacheManager] preformMaintenance];
         });
     });
-    
+
     return maintenanceTimer;
 }
 
@@ -58,21 +271,44 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
         sharedCacheManager = [self new];
-        
+
         dispatch_resume([self maintenanceTimer]);
     });
-    
+
     return sharedCacheManager;
 }
 
 #pragma mark -
 
+- (void)dealloc
+{
+    if(_metadataLogDescriptor != -1)
+        close(_metadataLogDescriptor);
+
+    pthread_mutex_destroy(&_evictionPolicyLock);
+}
+
 - (id)init
 {
     if((self = [super init])) {
-        _accessControlQueue = dispatch_queue_create("com.roundabout.RoundaboutKit.RKURLRequestPromiseCacheManager.accessQueue", 0);
-        dispatch_barrier_async(_accessControlQueue, ^{
-            _cacheLocation = [self cacheLocation];
+        for (NSUInteger index = 0; index < kShardCount; index++)
+            _shards[index] = [RKFileSystemCacheShard new];
+
+        self.compressesCachedData = YES;
+
+        pthread_mutex_init(&_evictionPolicyLock, NULL);
+        _evictionPolicy = [[RKCacheEvictionPolicy alloc] initWithCapacity:kDefaultMaxCacheSize];
+
+        _metadataLogQueue = dispatch_queue_create("com.roundabout.RoundaboutKit.RKURLRequestPromiseCacheManager.metadataLogQueue", 0);
+        _metadataLogDescriptor = -1;
+        _pendingMetadataChanges = [NSMutableDictionary dictionary];
+
+        _cacheLocation = [self cacheLocation];
+        _cacheMetadataLocation = [self locationForMetadata];
+        _cacheMetadataLogLocation = [self locationForMetadataLog];
+
+        _loadGroup = dispatch_group_create();
+        dispatch_group_async(_loadGroup, _metadataLogQueue, ^{
             if(![_cacheLocation checkResourceIsReachableAndReturnError:nil]) {
                 NSError *error = nil;
                 if(![[NSFileManager defaultManager] createDirectoryAtURL:_cacheLocation
@@ -82,15 +318,24 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
                     [NSException raise:NSInternalInconsistencyException format:@"Could not create bucket location %@. %@", _cacheLocation, error];
                 }
             }
-            
-            _cacheMetadataLocation = [self locationForMetadata];
-            _cacheMetadata = [NSMutableDictionary dictionaryWithContentsOfURL:_cacheMetadataLocation] ?: [NSMutableDictionary dictionary];
+
+            [self loadMetadata];
+
+            OSMemoryBarrier();
+            _isLoaded = YES;
         });
     }
-    
+
     return self;
 }
 
+///Blocks the caller until the receiver's metadata has been loaded.
+RK_INLINE void WaitUntilLoaded(RKFileSystemCacheManager *self)
+{
+    if(!self->_isLoaded)
+        dispatch_group_wait(self->_loadGroup, DISPATCH_TIME_FOREVER);
+}
+
 #pragma mark - Locations
 
 ///Returns the location of the cache manager's directory.
@@ -106,39 +351,120 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
     return [[cachesLocation URLByAppendingPathComponent:[[NSBundle bundleForClass:[self class]] bundleIdentifier]] URLByAppendingPathComponent:@"RKFileSystemCache"];
 }
 
+///Returns the location of the data for a given sanitized identifier stored with a given encoding.
+- (NSURL *)locationForSanitizedIdentifier:(NSString *)sanitizedIdentifier encoding:(NSString *)encoding
+{
+    //Each encoding has its own file, so a reader whose metadata is out of date can never
+    //misinterpret the contents of a file written with a different encoding.
+    if(encoding)
+        return [_cacheLocation URLByAppendingPathComponent:[sanitizedIdentifier stringByAppendingPathExtension:encoding]];
+    else
+        return [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
+}
+
 ///Returns the location of a bucket's metadata file.
 - (NSURL *)locationForMetadata
 {
     return [[self cacheLocation] URLByAppendingPathComponent:@"__Metadata.plist"];
 }
 
+///Returns the location of the log of changes made since the metadata file was written.
+- (NSURL *)locationForMetadataLog
+{
+    return [[self cacheLocation] URLByAppendingPathComponent:@"__Metadata.log"];
+}
+
 #pragma mark - Properties
 
 - (void)setMaxCacheSize:(NSUInteger)maxCacheSize
 {
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        _cacheMetadata[kCacheSize] = @(maxCacheSize);
+    WaitUntilLoaded(self);
+
+    _maxCacheSize = maxCacheSize;
+
+    pthread_mutex_lock(&_evictionPolicyLock);
+    _evictionPolicy.capacity = self.maxCacheSize;
+    pthread_mutex_unlock(&_evictionPolicyLock);
+
+    dispatch_async(_metadataLogQueue, ^{
+        [self enqueueMetadataChangeForKey:kMaxCacheSize value:@(maxCacheSize)];
     });
 }
 
 - (NSUInteger)maxCacheSize
 {
-    __block NSUInteger maxCacheSize = 0;
-    dispatch_sync(_accessControlQueue, ^{
-        maxCacheSize = [_cacheMetadata[kMaxCacheSize] unsignedIntegerValue] ?: kDefaultMaxCacheSize;
-    });
-    
-    return maxCacheSize;
+    WaitUntilLoaded(self);
+
+    return (NSUInteger)_maxCacheSize ?: kDefaultMaxCacheSize;
 }
 
 - (NSUInteger)cacheSize
 {
-    __block NSUInteger cacheSize = 0;
-    dispatch_sync(_accessControlQueue, ^{
-        cacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue];
-    });
-    
-    return cacheSize;
+    WaitUntilLoaded(self);
+
+    return (NSUInteger)MAX(_cacheSize, 0);
+}
+
+#pragma mark - Shards
+
+///Returns the shard responsible for a given sanitized identifier.
+- (RKFileSystemCacheShard *)shardForSanitizedIdentifier:(NSString *)sanitizedIdentifier
+{
+    return _shards[ShardIndexForSanitizedIdentifier(sanitizedIdentifier)];
+}
+
+///Returns the metadata for a given sanitized identifier without taking any locks.
+- (NSDictionary *)itemMetadataForSanitizedIdentifier:(NSString *)sanitizedIdentifier
+{
+    return [self shardForSanitizedIdentifier:sanitizedIdentifier].items[sanitizedIdentifier];
+}
+
+///Replaces the metadata for a given sanitized identifier.
+///
+/// \param  sanitizedIdentifier The identifier whose metadata is being replaced. Required.
+/// \param  block               A block which is passed the current metadata of the item, or nil if there is none,
+///                             and returns the new metadata of the item, or nil to remove it. Required.
+///
+/// \result The metadata of the item before it was replaced.
+///
+///The block is invoked while the item's shard is locked, and so must not perform any IO.
+- (NSDictionary *)replaceItemMetadataForSanitizedIdentifier:(NSString *)sanitizedIdentifier withBlock:(NSDictionary *(^)(NSDictionary *itemMetadata))block
+{
+    RKFileSystemCacheShard *shard = [self shardForSanitizedIdentifier:sanitizedIdentifier];
+
+    pthread_mutex_lock(&shard->_lock);
+
+    NSDictionary *oldItemMetadata = shard.items[sanitizedIdentifier];
+    NSDictionary *newItemMetadata = block(oldItemMetadata);
+    if(newItemMetadata != oldItemMetadata) {
+        NSMutableDictionary *items = [shard.items mutableCopy];
+        if(newItemMetadata)
+            items[sanitizedIdentifier] = newItemMetadata;
+        else
+            [items removeObjectForKey:sanitizedIdentifier];
+        shard.items = items;
+
+        OSAtomicAdd64Barrier([newItemMetadata[kDataSizeKey] longLongValue] - [oldItemMetadata[kDataSizeKey] longLongValue], &_cacheSize);
+
+        //Enqueued while the shard is locked so that changes to an item reach the log in order.
+        dispatch_async(_metadataLogQueue, ^{
+            [self enqueueMetadataChangeForKey:sanitizedIdentifier value:newItemMetadata];
+        });
+    }
+
+    pthread_mutex_unlock(&shard->_lock);
+
+    return oldItemMetadata;
+}
+
+///Returns a dictionary containing the metadata of every item, keyed by sanitized identifier.
+- (NSMutableDictionary *)copyAllItemMetadata
+{
+    NSMutableDictionary *allItemMetadata = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < kShardCount; index++)
+        [allItemMetadata addEntriesFromDictionary:_shards[index].items];
+
+    return allItemMetadata;
 }
 
 #pragma mark - Maintenance
@@ -152,7 +478,7 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 
 ///Enumerates a given metadata hash and expunges any cache which has not been recently accessed.
 ///
-/// \param  metadata    A copy of the cache metadata with the special keys removed.
+/// \param  metadata    A copy of the metadata of every item.
 ///
 - (void)removeExpiredCacheWithMetadata:(NSDictionary *)metadata
 {
@@ -167,87 +493,289 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
     }];
 }
 
-///Checks if the cache has exceeded the limits set for it, subsequently
-///enumerating and expunging data until the cache is within acceptable limits.
-///
-/// \param  metadata    A copy of the cache metadata with the special keys removed.
-///
-- (void)removeExcessCacheWithMetadata:(NSDictionary *)metadata
-{
-    //The accessors for these properties can deadlock.
-    NSUInteger maxCacheSize = [metadata[kMaxCacheSize] unsignedIntegerValue] ?: kDefaultMaxCacheSize;
-    NSUInteger cacheSize = [metadata[kCacheSize] unsignedIntegerValue];
-    
-    if(cacheSize > maxCacheSize) {
-        NSArray *weightedSanitizedIdentifiers = [metadata keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *left, NSDictionary *right) {
-            return [left[kLastAccessedDateKey] compare:right[kLastAccessedDateKey]];
-        }];
-        
-        for (NSString *sanitizedIdentifier in weightedSanitizedIdentifiers) {
-            NSDictionary *itemMetadata = metadata[sanitizedIdentifier];
-            
-            NSError *error = nil;
-            if(![self removeCacheForSanitizedIdentifier:sanitizedIdentifier error:&error]) {
-                RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
-            }
-            
-            cacheSize -= [itemMetadata[kDataSizeKey] unsignedIntegerValue];
-            
-            if(cacheSize <= maxCacheSize)
-                break;
+///Removes the data for a given array of sanitized identifiers evicted by the receiver's eviction policy.
+- (void)removeEvictedCacheForSanitizedIdentifiers:(NSArray *)sanitizedIdentifiers
+{
+    for (NSString *sanitizedIdentifier in sanitizedIdentifiers) {
+        //The identifier may have been cached again since it was evicted.
+        pthread_mutex_lock(&_evictionPolicyLock);
+        BOOL wasReadmitted = [_evictionPolicy containsKey:sanitizedIdentifier];
+        pthread_mutex_unlock(&_evictionPolicyLock);
+        if(wasReadmitted)
+            continue;
+
+        NSError *error = nil;
+        if(![self removeCacheForSanitizedIdentifier:sanitizedIdentifier error:&error]) {
+            RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
         }
     }
 }
 
+///Evicts data until the cache is within the limits set for it.
+///
+///Eviction normally happens as data is cached. This method
+///picks up changes to the maximum size of the cache.
+- (void)removeExcessCache
+{
+    pthread_mutex_lock(&_evictionPolicyLock);
+    NSArray *evictedSanitizedIdentifiers = [_evictionPolicy evictKeysExceedingCapacity];
+    pthread_mutex_unlock(&_evictionPolicyLock);
+
+    [self removeEvictedCacheForSanitizedIdentifiers:evictedSanitizedIdentifiers];
+}
+
 - (void)preformMaintenance
 {
-    __block NSMutableDictionary *metadataCopy = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        metadataCopy = [_cacheMetadata mutableCopy];
-    });
-    
-    [metadataCopy removeObjectForKey:kMaxCacheSize];
-    [metadataCopy removeObjectForKey:kCacheSize];
-    
+    WaitUntilLoaded(self);
+
+    NSDictionary *metadataCopy = [self copyAllItemMetadata];
+
     [self removeExpiredCacheWithMetadata:metadataCopy];
-    [self removeExcessCacheWithMetadata:metadataCopy];
+    [self removeExcessCache];
 }
 
-#pragma mark - Internal
+#pragma mark - Metadata Log
+
+//The metadata is stored as a snapshot file, `__Metadata.plist`, and a log of changes made
+//since the snapshot was written, `__Metadata.log`. Changes are collected in memory and
+//appended to the log as a single record at most once every `kMetadataFlushDelay` seconds.
+//Once the log grows past `kMetadataLogCompactionThreshold`, the snapshot is rewritten and
+//the log is truncated. On launch, the snapshot is loaded and the log is replayed over it.
+//
+//Each log record is a big-endian uint32 length followed by a binary property list with
+//the keys `generation`, `changes` (key -> new value) and `removals` (keys). A partially
+//written record at the end of the log is discarded when it is replayed. The snapshot
+//carries a generation that is incremented every time it is rewritten, so records left
+//behind by a compaction that was interrupted before the log was truncated are ignored.
+//
+//All of the methods in this section must be called from the metadata log queue.
+
+///Applies a single log record to a given metadata dictionary.
+static void ApplyMetadataLogRecord(NSMutableDictionary *metadata, NSDictionary *record)
+{
+    [metadata addEntriesFromDictionary:record[kLogRecordChangesKey]];
+    [metadata removeObjectsForKeys:record[kLogRecordRemovalsKey]];
+}
+
+///Loads the metadata snapshot, replays the metadata log over it, distributes the
+///result into the receiver's shards, and opens the log for appending.
+- (void)loadMetadata
+{
+    NSMutableDictionary *metadata = [NSMutableDictionary dictionaryWithContentsOfURL:_cacheMetadataLocation] ?: [NSMutableDictionary dictionary];
+    _metadataLogGeneration = [metadata[kMetadataGenerationKey] unsignedIntegerValue];
+
+    NSData *log = [NSData dataWithContentsOfURL:_cacheMetadataLogLocation options:NSDataReadingMappedIfSafe error:NULL];
+    const uint8_t *bytes = log.bytes;
+    NSUInteger length = log.length;
+    NSUInteger offset = 0;
+    while (length - offset >= sizeof(uint32_t)) {
+        uint32_t recordLength = 0;
+        memcpy(&recordLength, bytes + offset, sizeof(recordLength));
+        recordLength = CFSwapInt32BigToHost(recordLength);
+        if(recordLength == 0 || recordLength > length - offset - sizeof(uint32_t))
+            break;
+
+        NSData *recordData = [NSData dataWithBytesNoCopy:(void *)(bytes + offset + sizeof(uint32_t)) length:recordLength freeWhenDone:NO];
+        NSDictionary *record = [NSPropertyListSerialization propertyListWithData:recordData options:0 format:NULL error:NULL];
+        if(![record isKindOfClass:[NSDictionary class]])
+            break;
+
+        if([record[kLogRecordGenerationKey] unsignedIntegerValue] == _metadataLogGeneration)
+            ApplyMetadataLogRecord(metadata, record);
+
+        offset += sizeof(uint32_t) + recordLength;
+    }
+
+    _metadataLogDescriptor = open([[_cacheMetadataLogLocation path] fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if(_metadataLogDescriptor != -1 && offset < length)
+        ftruncate(_metadataLogDescriptor, offset);
+
+    _metadataLogLength = offset;
+
+    _maxCacheSize = [metadata[kMaxCacheSize] longLongValue];
+    [metadata removeObjectForKey:kMaxCacheSize];
+    [metadata removeObjectForKey:kCacheSize];
+    [metadata removeObjectForKey:kMetadataGenerationKey];
+
+    NSMutableDictionary *shardItems[kShardCount];
+    for (NSUInteger index = 0; index < kShardCount; index++)
+        shardItems[index] = [NSMutableDictionary dictionary];
 
-///Writes the metadata dictionary to the file system.
+    __block int64_t cacheSize = 0;
+    [metadata enumerateKeysAndObjectsUsingBlock:^(NSString *sanitizedIdentifier, NSDictionary *itemMetadata, BOOL *stop) {
+        if(sanitizedIdentifier.length == 0 || ![itemMetadata isKindOfClass:[NSDictionary class]])
+            return;
+
+        shardItems[ShardIndexForSanitizedIdentifier(sanitizedIdentifier)][sanitizedIdentifier] = itemMetadata;
+        cacheSize += [itemMetadata[kDataSizeKey] longLongValue];
+    }];
+
+    for (NSUInteger index = 0; index < kShardCount; index++)
+        _shards[index].items = shardItems[index];
+
+    _cacheSize = cacheSize;
+
+    //The queues of the eviction policy are not persisted, so items are
+    //restored into it from least to most recently accessed.
+    NSDictionary *itemMetadataByIdentifier = [self copyAllItemMetadata];
+    NSArray *sanitizedIdentifiersByAccess = [itemMetadataByIdentifier keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *left, NSDictionary *right) {
+        return [left[kLastAccessedDateKey] compare:right[kLastAccessedDateKey]];
+    }];
+    _evictionPolicy.capacity = (NSUInteger)_maxCacheSize ?: kDefaultMaxCacheSize;
+    for (NSString *sanitizedIdentifier in sanitizedIdentifiersByAccess) {
+        NSDictionary *itemMetadata = itemMetadataByIdentifier[sanitizedIdentifier];
+        [_evictionPolicy restoreKey:sanitizedIdentifier cost:[itemMetadata[kDataSizeKey] unsignedLongLongValue]];
+    }
+}
+
+///Returns a snapshot of the receiver's metadata suitable for writing to disk.
+- (NSDictionary *)copyMetadataSnapshot
+{
+    NSMutableDictionary *snapshot = [self copyAllItemMetadata];
+    if(_maxCacheSize > 0)
+        snapshot[kMaxCacheSize] = @(_maxCacheSize);
+
+    return snapshot;
+}
+
+///Records a change to a given key of the metadata, scheduling it to be written to the log.
 ///
-///This method assumes it has been surrounded by a queue barrier.
-- (void)synchronizeMetadata
+/// \param  key     The key that changed. Required.
+/// \param  value   The new value of the key, or nil if the key was removed.
+///
+- (void)enqueueMetadataChangeForKey:(NSString *)key value:(id)value
+{
+    _pendingMetadataChanges[key] = value ?: [NSNull null];
+
+    if(_isMetadataFlushScheduled)
+        return;
+
+    _isMetadataFlushScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kMetadataFlushDelay * NSEC_PER_SEC)), _metadataLogQueue, ^{
+        [self flushPendingMetadataChanges];
+    });
+}
+
+///Writes any pending metadata changes to the log, compacting the log if it has grown too large.
+- (void)flushPendingMetadataChanges
 {
-    [_cacheMetadata writeToURL:_cacheMetadataLocation atomically:YES];
+    _isMetadataFlushScheduled = NO;
+    if(_pendingMetadataChanges.count == 0)
+        return;
+
+    //The shards already include every pending change, so a snapshot supersedes the record.
+    if(_metadataLogLength >= kMetadataLogCompactionThreshold) {
+        [_pendingMetadataChanges removeAllObjects];
+        [self writeMetadataSnapshot:[self copyMetadataSnapshot]];
+        return;
+    }
+
+    NSMutableDictionary *changes = [NSMutableDictionary dictionary];
+    NSMutableArray *removals = [NSMutableArray array];
+    [_pendingMetadataChanges enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        if(value == [NSNull null])
+            [removals addObject:key];
+        else
+            changes[key] = value;
+    }];
+    [_pendingMetadataChanges removeAllObjects];
+
+    NSDictionary *record = @{kLogRecordGenerationKey: @(_metadataLogGeneration),
+                             kLogRecordChangesKey: changes,
+                             kLogRecordRemovalsKey: removals};
+    [self appendMetadataLogRecord:record];
 }
 
+///Appends a record to the metadata log.
+- (void)appendMetadataLogRecord:(NSDictionary *)record
+{
+    if(_metadataLogDescriptor == -1)
+        return;
+
+    NSError *error = nil;
+    NSData *recordData = [NSPropertyListSerialization dataWithPropertyList:record format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+    if(!recordData) {
+#if RoundaboutKit_EmitWarnings
+        NSLog(@"*** Warning, could not serialize cache metadata log record. Error: %@", error);
+#endif /* RoundaboutKit_EmitWarnings */
+        return;
+    }
+
+    NSMutableData *framedRecord = [NSMutableData dataWithCapacity:sizeof(uint32_t) + recordData.length];
+    uint32_t recordLength = CFSwapInt32HostToBig((uint32_t)recordData.length);
+    [framedRecord appendBytes:&recordLength length:sizeof(recordLength)];
+    [framedRecord appendData:recordData];
+
+    //The log is only a cache of a cache, so it is not fsync'd. A torn record is discarded on replay.
+    if(write(_metadataLogDescriptor, framedRecord.bytes, framedRecord.length) == (ssize_t)framedRecord.length)
+        _metadataLogLength += framedRecord.length;
+}
+
+///Replaces the metadata snapshot with a given dictionary and truncates the metadata log.
+- (void)writeMetadataSnapshot:(NSDictionary *)snapshot
+{
+    NSMutableDictionary *generationalSnapshot = [snapshot mutableCopy];
+    generationalSnapshot[kMetadataGenerationKey] = @(_metadataLogGeneration + 1);
+
+    NSData *snapshotData = [NSPropertyListSerialization dataWithPropertyList:generationalSnapshot format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+    if(![snapshotData writeToURL:_cacheMetadataLocation options:NSDataWritingAtomic error:NULL])
+        return;
+
+    _metadataLogGeneration++;
+    if(_metadataLogDescriptor != -1 && ftruncate(_metadataLogDescriptor, 0) == 0)
+        _metadataLogLength = 0;
+}
+
+///Discards any pending metadata changes, and recreates the metadata
+///snapshot and log from the current contents of the shards.
+- (void)resetMetadataLog
+{
+    [_pendingMetadataChanges removeAllObjects];
+
+    if(_metadataLogDescriptor != -1)
+        close(_metadataLogDescriptor);
+
+    _metadataLogDescriptor = open([[_cacheMetadataLogLocation path] fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT | O_TRUNC, 0644);
+    _metadataLogLength = 0;
+
+    [self writeMetadataSnapshot:[self copyMetadataSnapshot]];
+}
+
+- (void)flushMetadata
+{
+    WaitUntilLoaded(self);
+
+    dispatch_sync(_metadataLogQueue, ^{
+        [self flushPendingMetadataChanges];
+    });
+}
+
+#pragma mark - Internal
+
 - (BOOL)removeCacheForSanitizedIdentifier:(NSString *)sanitizedIdentifier error:(NSError **)outError
 {
     NSParameterAssert(sanitizedIdentifier);
-    
-    __block BOOL success = YES;
-    __block NSError *error = nil;
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
-        
-        if([[NSFileManager defaultManager] removeItemAtURL:dataLocation error:&error] || error.code == NSFileNoSuchFileError) {
-            NSUInteger newCacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue] - [_cacheMetadata[sanitizedIdentifier][kDataSizeKey] unsignedIntegerValue];
-            _cacheMetadata[kCacheSize] = @(newCacheSize);
-            
-            [_cacheMetadata removeObjectForKey:sanitizedIdentifier];
-            [self synchronizeMetadata];
-            
-            error = nil;
-        } else {
-            success = NO;
+
+    WaitUntilLoaded(self);
+
+    pthread_mutex_lock(&_evictionPolicyLock);
+    [_evictionPolicy removeKey:sanitizedIdentifier];
+    pthread_mutex_unlock(&_evictionPolicyLock);
+
+    [self replaceItemMetadataForSanitizedIdentifier:sanitizedIdentifier withBlock:^NSDictionary *(NSDictionary *itemMetadata) {
+        return nil;
+    }];
+
+    for (NSString *encoding in @[ [NSNull null], kDeflateEncoding ]) {
+        NSError *error = nil;
+        NSURL *dataLocation = [self locationForSanitizedIdentifier:sanitizedIdentifier encoding:RKFilterOutNSNull(encoding)];
+        if(![[NSFileManager defaultManager] removeItemAtURL:dataLocation error:&error] && error.code != NSFileNoSuchFileError) {
+            if(outError) *outError = error;
+            return NO;
         }
-    });
-    
-    if(outError) *outError = error;
-    
-    return success;
+    }
+
+    return YES;
 }
 
 #pragma mark - <RKURLRequestPromiseCacheManager>
@@ -255,67 +783,108 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 - (NSString *)revisionForIdentifier:(NSString *)identifier
 {
     NSParameterAssert(identifier);
-    
-    __block NSString *revision = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        revision = _cacheMetadata[sanitizedIdentifier][kRevisionKey];
-    });
-    
-    return revision;
+
+    WaitUntilLoaded(self);
+
+    return [self itemMetadataForSanitizedIdentifier:RKStringGetMD5Hash(identifier)][kRevisionKey];
 }
 
 - (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)error
 {
     NSParameterAssert(identifier);
     NSParameterAssert(revision);
-    
-    __block BOOL success = YES;
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
-        
-        if([data writeToURL:dataLocation options:NSAtomicWrite error:error]) {
-            _cacheMetadata[sanitizedIdentifier] = @{ kRevisionKey: revision,
-                                                     kLastAccessedDateKey: [NSDate date],
-                                                     kDataSizeKey: @(data.length) };
-            
-            NSUInteger newCacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue] + data.length;
-            _cacheMetadata[kCacheSize] = @(newCacheSize);
-            
-            [self synchronizeMetadata];
-        } else {
-            success = NO;
+
+    WaitUntilLoaded(self);
+
+    NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
+
+    //Data is only compressed when it saves a meaningful amount of space.
+    NSData *storedData = data;
+    NSString *encoding = nil;
+    if(self.compressesCachedData && data.length >= kCompressionMinimumSize) {
+        NSData *compressedData = RKFileSystemCacheCompressData(data);
+        if(compressedData && compressedData.length <= data.length * kCompressionMaximumRatio) {
+            storedData = compressedData;
+            encoding = kDeflateEncoding;
         }
-    });
-    
-    return success;
+    }
+
+    //Atomic writes go through a temporary file and a rename, so readers
+    //never observe a partially written file and no lock is required.
+    NSURL *dataLocation = [self locationForSanitizedIdentifier:sanitizedIdentifier encoding:encoding];
+    if(![storedData writeToURL:dataLocation options:NSDataWritingAtomic error:error])
+        return NO;
+
+    NSDate *now = [NSDate date];
+    NSMutableDictionary *itemMetadata = [@{ kRevisionKey: revision,
+                                            kLastAccessedDateKey: now,
+                                            kValidationDateKey: now,
+                                            kDataSizeKey: @(storedData.length) } mutableCopy];
+    if(encoding) {
+        itemMetadata[kEncodingKey] = encoding;
+        itemMetadata[kUncompressedSizeKey] = @(data.length);
+    }
+    NSDictionary *oldItemMetadata = [self replaceItemMetadataForSanitizedIdentifier:sanitizedIdentifier withBlock:^NSDictionary *(NSDictionary *oldItemMetadata) {
+        return itemMetadata;
+    }];
+
+    //The data may have previously been stored with a different encoding.
+    NSString *oldEncoding = oldItemMetadata[kEncodingKey];
+    if(oldItemMetadata && !(oldEncoding == encoding || [oldEncoding isEqualToString:encoding]))
+        [[NSFileManager defaultManager] removeItemAtURL:[self locationForSanitizedIdentifier:sanitizedIdentifier encoding:oldEncoding] error:NULL];
+
+    //Eviction happens as data is admitted so the cache never overshoots its maximum size.
+    pthread_mutex_lock(&_evictionPolicyLock);
+    NSArray *evictedSanitizedIdentifiers = [_evictionPolicy insertKey:sanitizedIdentifier cost:storedData.length];
+    pthread_mutex_unlock(&_evictionPolicyLock);
+
+    [self removeEvictedCacheForSanitizedIdentifiers:evictedSanitizedIdentifiers];
+
+    return YES;
 }
 
 - (NSData *)cachedDataForIdentifier:(NSString *)identifier error:(NSError **)outError
 {
     NSParameterAssert(identifier);
-    
-    __block NSError *error = nil;
-    __block NSData *data = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
-        data = [NSData dataWithContentsOfURL:dataLocation options:0 error:&error];
-        
-        NSMutableDictionary *itemMetadata = [_cacheMetadata[sanitizedIdentifier] mutableCopy];
-        if(itemMetadata) {
-            NSDate *lastAccessed = itemMetadata[kLastAccessedDateKey];
-            itemMetadata[kLastAccessedDateKey] = [NSDate date];
-            _cacheMetadata[sanitizedIdentifier] = itemMetadata;
-            if(!lastAccessed || -[lastAccessed timeIntervalSinceNow] >= kExpirationInterval / 2.0) {
-                dispatch_barrier_async(_accessControlQueue, ^{
-                    [self synchronizeMetadata];
-                });
-            }
-        }
-    });
-    
+
+    WaitUntilLoaded(self);
+
+    NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
+    NSDictionary *itemMetadata = [self itemMetadataForSanitizedIdentifier:sanitizedIdentifier];
+    NSString *encoding = itemMetadata[kEncodingKey];
+    NSURL *dataLocation = [self locationForSanitizedIdentifier:sanitizedIdentifier encoding:encoding];
+
+    NSError *error = nil;
+    NSData *data = nil;
+    if([encoding isEqualToString:kDeflateEncoding]) {
+        data = RKFileSystemCacheDecompressContentsOfURL(dataLocation, [itemMetadata[kUncompressedSizeKey] unsignedIntegerValue], &error);
+    } else {
+        //Cache files are only ever replaced by renaming over them, so a mapping remains valid.
+        NSDataReadingOptions readingOptions = 0;
+        if([itemMetadata[kDataSizeKey] unsignedIntegerValue] >= kMappedReadThreshold)
+            readingOptions = NSDataReadingMappedIfSafe;
+
+        data = [NSData dataWithContentsOfURL:dataLocation options:readingOptions error:&error];
+    }
+
+    if(data) {
+        pthread_mutex_lock(&_evictionPolicyLock);
+        [_evictionPolicy recordAccessForKey:sanitizedIdentifier];
+        pthread_mutex_unlock(&_evictionPolicyLock);
+    }
+
+    NSDate *lastAccessed = itemMetadata[kLastAccessedDateKey];
+    if(data && (!lastAccessed || -[lastAccessed timeIntervalSinceNow] >= kLastAccessedDateGranularity)) {
+        [self replaceItemMetadataForSanitizedIdentifier:sanitizedIdentifier withBlock:^NSDictionary *(NSDictionary *itemMetadata) {
+            if(!itemMetadata)
+                return nil;
+
+            NSMutableDictionary *newItemMetadata = [itemMetadata mutableCopy];
+            newItemMetadata[kLastAccessedDateKey] = [NSDate date];
+            return newItemMetadata;
+        }];
+    }
+
     if(data) {
         return data;
     } else {
@@ -331,30 +900,75 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 - (BOOL)removeCacheForIdentifier:(NSString *)identifier error:(NSError **)outError
 {
     NSParameterAssert(identifier);
-    
+
     return [self removeCacheForSanitizedIdentifier:RKStringGetMD5Hash(identifier) error:outError];
 }
 
 - (BOOL)removeAllCache:(NSError **)outError
 {
-    __block BOOL success = YES;
-    __block NSError *error = nil;
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        if([[NSFileManager defaultManager] removeItemAtURL:_cacheLocation error:&error] || error.code == NSFileNoSuchFileError) {
-            NSNumber *maxCacheSize = _cacheMetadata[kMaxCacheSize] ?: @(kDefaultMaxCacheSize);
-            [_cacheMetadata removeAllObjects];
-            _cacheMetadata[kMaxCacheSize] = maxCacheSize;
-            [self synchronizeMetadata];
-            
-            error = nil;
-        } else {
-            success = NO;
-        }
+    WaitUntilLoaded(self);
+
+    for (NSUInteger index = 0; index < kShardCount; index++)
+        pthread_mutex_lock(&_shards[index]->_lock);
+
+    for (NSUInteger index = 0; index < kShardCount; index++)
+        _shards[index].items = @{};
+
+    _cacheSize = 0;
+
+    pthread_mutex_lock(&_evictionPolicyLock);
+    [_evictionPolicy removeAllKeys];
+    pthread_mutex_unlock(&_evictionPolicyLock);
+
+    for (NSUInteger index = kShardCount; index > 0; index--)
+        pthread_mutex_unlock(&_shards[index - 1]->_lock);
+
+    //The directory is moved aside and deleted in the background so no lock is held during the IO.
+    NSError *error = nil;
+    NSString *removedName = [NSString stringWithFormat:@"%@-Removed-%@", [_cacheLocation lastPathComponent], [[NSUUID UUID] UUIDString]];
+    NSURL *removedLocation = [[_cacheLocation URLByDeletingLastPathComponent] URLByAppendingPathComponent:removedName];
+    if(![[NSFileManager defaultManager] moveItemAtURL:_cacheLocation toURL:removedLocation error:&error] && error.code != NSFileNoSuchFileError) {
+        if(outError) *outError = error;
+        return NO;
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtURL:_cacheLocation withIntermediateDirectories:YES attributes:nil error:NULL];
+
+    dispatch_async(_metadataLogQueue, ^{
+        [self resetMetadataLog];
     });
-    
-    if(outError) *outError = error;
-    
-    return success;
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        [[NSFileManager defaultManager] removeItemAtURL:removedLocation error:NULL];
+    });
+
+    return YES;
+}
+
+- (NSDate *)validationDateForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+
+    WaitUntilLoaded(self);
+
+    return [self itemMetadataForSanitizedIdentifier:RKStringGetMD5Hash(identifier)][kValidationDateKey];
+}
+
+- (void)setValidationDate:(NSDate *)date forIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(date);
+    NSParameterAssert(identifier);
+
+    WaitUntilLoaded(self);
+
+    [self replaceItemMetadataForSanitizedIdentifier:RKStringGetMD5Hash(identifier) withBlock:^NSDictionary *(NSDictionary *itemMetadata) {
+        if(!itemMetadata)
+            return nil;
+
+        NSMutableDictionary *newItemMetadata = [itemMetadata mutableCopy];
+        newItemMetadata[kValidationDateKey] = date;
+        return newItemMetadata;
+    }];
 }
 
 @end
@@ -6,16 +6,38 @@
 //  Copyright (c) 2013 Live Nation Labs. All rights reserved.
 //
 
+#ifndef RKImageLoader_h
+#define RKImageLoader_h 1
+
 #if TARGET_OS_IPHONE
+#   import <UIKit/UIKit.h>
+
+///The image class produced by an image loader.
+typedef UIImage RKImageLoaderImage;
+#else
+#   import <Cocoa/Cocoa.h>
 
-#import <UIKit/UIKit.h>
+///The image class produced by an image loader.
+typedef NSImage RKImageLoaderImage;
+#endif /* TARGET_OS_IPHONE */
 
-@class RKFileSystemCacheManager;
+@class RKFileSystemCacheManager, RKMemoryCache, RKPromise;
 
 ///A block which is invoked as a callback for an image loader.
 typedef void(^RKImageLoaderCompletionHandler)(BOOL wasSuccessful);
 
-///The RKImageLoader class encapsulates the asynchronous loading of images for libTap.
+///A block which is invoked when an image requested for an owner has been loaded.
+///
+/// \param  image   The loaded image. Never nil.
+///
+typedef void(^RKImageLoaderImageHandler)(RKImageLoaderImage *image);
+
+///The RKImageLoader class encapsulates the asynchronous loading of remote images.
+///
+///Images are loaded through RKURLRequestPromises which are keyed by their URL in the
+///image loader's cache manager, so an image is only downloaded once across launches.
+///Concurrent requests for the same URL are coalesced into a single request, and a
+///request is cancelled as soon as nothing is waiting on it any longer.
 @interface RKImageLoader : NSObject
 
 ///Returns the shared image loader, creating it if it does not already exist.
@@ -26,6 +48,46 @@ typedef void(^RKImageLoaderCompletionHandler)(BOOL wasSuccessful);
 ///The cache manager for the image loader.
 @property (nonatomic, readonly) RKFileSystemCacheManager *cacheManager;
 
+///The in-memory cache of decoded images for the image loader.
+///
+///Images are keyed by the absolute string of their URL.
+@property (nonatomic, readonly) RKMemoryCache *memoryCache;
+
+#pragma mark - Loading Images for Owners
+
+///Returns the image at a given URL if it is in the receiver's memory cache.
+///
+///This method never touches the disk or network, and is
+///suitable for calling while drawing a table view row.
+- (RKImageLoaderImage *)cachedImageAtURL:(NSURL *)url;
+
+///Asynchronously load an image at a given URL on behalf of an owner.
+///
+/// \param  url                 The location of the image. Required.
+/// \param  owner               The object the image is being loaded for, such as the item displayed in a row. Required.
+/// \param  completionHandler   The block to invoke on the main thread when the image has loaded. Optional.
+///
+///If the image is already in memory, `completionHandler` is invoked immediately. If
+///another owner is already loading the same URL, the owners share a single request.
+///
+///An owner may only wait on one image at a time. Asking to load a different URL
+///for an owner stops the load that was previously requested for it, and asking
+///to load the same URL again does nothing.
+///
+///This method must be called from the main thread.
+- (void)loadImageAtURL:(NSURL *)url forOwner:(id)owner completionHandler:(RKImageLoaderImageHandler)completionHandler;
+
+///Stops waiting on the image load requested for a given owner.
+///
+///The underlying request is cancelled if no other owner is waiting on it.
+///
+///This method must be called from the main thread.
+- (void)stopLoadingImagesForOwner:(id)owner;
+
+#if TARGET_OS_IPHONE
+
+#pragma mark - Loading Images into Views
+
 ///The maximum image size that can be cached.
 ///
 ///This property describes the total area of the image and not a specific size.
@@ -33,13 +95,11 @@ typedef void(^RKImageLoaderCompletionHandler)(BOOL wasSuccessful);
 ///Default value is the size of the device's screen.
 @property (nonatomic) CGSize maximumCacheableSize;
 
-///The maximum number of images that may be kept in memory at a given time.
+///The maximum number of images of the maximum cacheable size that may be kept in memory at a given time.
 ///
 ///This property defaults to 8.
 @property (nonatomic) NSUInteger maximumCacheCount;
 
-#pragma mark - Loading Images
-
 ///Asynchronously load a URL request promise into a specified image view.
 ///
 /// \param  imagePromise    The image promise to load.
@@ -68,6 +128,8 @@ typedef void(^RKImageLoaderCompletionHandler)(BOOL wasSuccessful);
 ///Stops all asynchronous image loads currently being executed for a specified image view.
 - (void)stopLoadingImagesForView:(UIImageView *)imageView;
 
+#endif /* TARGET_OS_IPHONE */
+
 @end
 
-#endif /* TARGET_OS_IPHONE */
+#endif /* RKImageLoader_h */
@@ -6,24 +6,79 @@
 //  Copyright (c) 2013 Live Nation Labs. All rights reserved.
 //
 
-#if TARGET_OS_IPHONE
-
 #import "RKImageLoader.h"
 
 #import "RKURLRequestPromise.h"
 #import "RKFileSystemCacheManager.h"
+#import "RKMemoryCache.h"
 
 #define xCGSizeGetArea(size) (size.width * size.height)
 
+///The revision images are kept under in the memory cache.
+///
+///Remote images are treated as immutable, so the revision never changes.
+static NSString *const kMemoryCacheRevision = @"1";
+
+///The number of images that may be downloaded at once.
+static NSInteger const kMaximumConcurrentRequests = 4;
+
+#if !TARGET_OS_IPHONE
+///The default capacity of the memory cache.
+static NSUInteger const kDefaultMemoryCacheCapacity = (1024 * 1024 * 4) /* 4 MB */;
+#endif /* !TARGET_OS_IPHONE */
+
+///Returns the estimated cost in bytes of a decoded image.
+static NSUInteger RKImageLoaderImageGetCost(RKImageLoaderImage *image)
+{
+#if TARGET_OS_IPHONE
+    CGSize pixelSize = CGSizeMake(image.size.width * image.scale, image.size.height * image.scale);
+#else
+    NSSize pixelSize = image.size;
+    NSImageRep *representation = [image.representations lastObject];
+    if(representation && representation.pixelsWide > 0 && representation.pixelsHigh > 0)
+        pixelSize = NSMakeSize(representation.pixelsWide, representation.pixelsHigh);
+#endif /* TARGET_OS_IPHONE */
+
+    return (NSUInteger)xCGSizeGetArea(pixelSize) * 4;
+}
+
+///Returns whether or not an image load that failed would fail again if it were retried.
+///
+///Images that could not be decoded and requests the server refused are not retried
+///for the rest of the session. Anything else, such as a network error, may be transient.
+static BOOL RKImageLoaderIsPermanentFailure(RKPromise *imagePromise, NSError *error)
+{
+    NSInteger statusCode = RK_TRY_CAST(RKURLRequestPromise, imagePromise).response.statusCode;
+    if(statusCode >= 400 && statusCode < 500)
+        return YES;
+
+    return (error.code == '!img' && statusCode < 400);
+}
+
+#pragma mark -
+
+///The RKImageLoaderSubscriber class encapsulates an owner waiting on an image load.
+@interface RKImageLoaderSubscriber : NSObject
+
+@property (nonatomic) id owner;
+@property (nonatomic, copy) RKImageLoaderImageHandler handler;
+
+@end
+
+@implementation RKImageLoaderSubscriber
+
+@end
+
+#pragma mark -
+
 @interface RKImageLoader ()
 
-///The map that contains the loaded images.
+#if TARGET_OS_IPHONE
+///The map that contains the promises being loaded into image views.
 ///
-///nocopy NSURL => UIImage.
+///nocopy UIImageView => RKPromise.
 @property (nonatomic) NSMutableDictionary *imageMap;
-
-///The in-memory cache for the image loader.
-@property (nonatomic) NSCache *inMemoryCache;
+#endif /* TARGET_OS_IPHONE */
 
 ///The cache identifiers known to be invalid to the image loader.
 ///Used to prevent redundant network requests in a session.
@@ -32,10 +87,22 @@
 #pragma mark - Readwrite
 
 @property (nonatomic, readwrite) RKFileSystemCacheManager *cacheManager;
+@property (nonatomic, readwrite) RKMemoryCache *memoryCache;
 
 @end
 
-@implementation RKImageLoader
+@implementation RKImageLoader {
+    NSOperationQueue *_requestQueue;
+
+    ///NSURL => RKURLRequestPromise.
+    NSMutableDictionary *_promisesByURL;
+
+    ///NSURL => NSMutableArray<RKImageLoaderSubscriber>.
+    NSMutableDictionary *_subscribersByURL;
+
+    ///owner => NSURL. Owners are compared by equality and are not copied.
+    NSMapTable *_URLsByOwner;
+}
 
 + (instancetype)sharedImageLoader
 {
@@ -44,114 +111,289 @@
     dispatch_once(&onceToken, ^{
         sharedImageLoader = [RKImageLoader new];
     });
-    
+
     return sharedImageLoader;
 }
 
 - (id)init
 {
     if((self = [super init])) {
-        self.imageMap = (__bridge NSMutableDictionary *)CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
-        
         self.cacheManager = [RKFileSystemCacheManager sharedCacheManager];
-        self.inMemoryCache = [NSCache new];
-        self.inMemoryCache.name = @"com.roundabout.roundaboutkit.imageloader.inMemoryCache";
-        
         self.knownInvalidCacheIdentifiers = [NSMutableSet set];
-        
-        self.maximumCacheCount = 8;
+
+        _requestQueue = [NSOperationQueue new];
+        _requestQueue.name = @"com.roundabout.roundaboutkit.imageloader.requestQueue";
+        _requestQueue.maxConcurrentOperationCount = kMaximumConcurrentRequests;
+
+        _promisesByURL = [NSMutableDictionary dictionary];
+        _subscribersByURL = [NSMutableDictionary dictionary];
+        _URLsByOwner = [NSMapTable strongToStrongObjectsMapTable];
+
+#if TARGET_OS_IPHONE
+        self.imageMap = (__bridge_transfer NSMutableDictionary *)CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+
+        self.memoryCache = [RKMemoryCache new];
+        _maximumCacheCount = 8;
         self.maximumCacheableSize = [UIScreen mainScreen].bounds.size;
+#else
+        self.memoryCache = [[RKMemoryCache alloc] initWithCapacity:kDefaultMemoryCacheCapacity];
+#endif /* TARGET_OS_IPHONE */
     }
-    
+
     return self;
 }
 
+#pragma mark - Memory Cache
+
+- (RKImageLoaderImage *)cachedImageForIdentifier:(NSString *)identifier
+{
+    if(!identifier)
+        return nil;
+
+    return [self.memoryCache objectForKey:identifier revision:kMemoryCacheRevision transform:kRKImagePostProcessorBlock];
+}
+
+- (void)cacheImage:(RKImageLoaderImage *)image forIdentifier:(NSString *)identifier
+{
+    if(!image || !identifier)
+        return;
+
+#if TARGET_OS_IPHONE
+    if(xCGSizeGetArea(image.size) > xCGSizeGetArea(_maximumCacheableSize))
+        return;
+#endif /* TARGET_OS_IPHONE */
+
+    [self.memoryCache setObject:image
+                         forKey:identifier
+                       revision:kMemoryCacheRevision
+                      transform:kRKImagePostProcessorBlock
+                           cost:RKImageLoaderImageGetCost(image)];
+}
+
+- (RKURLRequestPromise *)imagePromiseForURL:(NSURL *)url
+{
+    NSURLRequest *imageURLRequest = [NSURLRequest requestWithURL:url];
+    RKURLRequestPromise *imagePromise = [[RKURLRequestPromise alloc] initWithRequest:imageURLRequest
+                                                                        cacheManager:self.cacheManager
+                                                                 useCacheWhenOffline:YES
+                                                                        requestQueue:_requestQueue];
+    imagePromise.postProcessor = kRKImagePostProcessorBlock;
+    imagePromise.cachePolicy = kRKURLRequestPromiseCachePolicyCacheFirst;
+    return imagePromise;
+}
+
+#pragma mark - Loading Images for Owners
+
+- (RKImageLoaderImage *)cachedImageAtURL:(NSURL *)url
+{
+    return [self cachedImageForIdentifier:[url absoluteString]];
+}
+
+- (void)loadImageAtURL:(NSURL *)url forOwner:(id)owner completionHandler:(RKImageLoaderImageHandler)completionHandler
+{
+    NSParameterAssert(url);
+    NSParameterAssert(owner);
+    NSAssert([NSThread isMainThread], @"-[RKImageLoader loadImageAtURL:forOwner:completionHandler:] must be called from the main thread.");
+
+    NSURL *existingURL = [_URLsByOwner objectForKey:owner];
+    if(existingURL) {
+        if([existingURL isEqual:url])
+            return;
+
+        [self stopLoadingImagesForOwner:owner];
+    }
+
+    RKImageLoaderImage *cachedImage = [self cachedImageAtURL:url];
+    if(cachedImage) {
+        if(completionHandler)
+            completionHandler(cachedImage);
+
+        return;
+    }
+
+    if([_knownInvalidCacheIdentifiers containsObject:[url absoluteString]])
+        return;
+
+    RKImageLoaderSubscriber *subscriber = [RKImageLoaderSubscriber new];
+    subscriber.owner = owner;
+    subscriber.handler = completionHandler;
+
+    NSMutableArray *subscribers = _subscribersByURL[url];
+    if(!subscribers) {
+        subscribers = [NSMutableArray array];
+        _subscribersByURL[url] = subscribers;
+    }
+    [subscribers addObject:subscriber];
+    [_URLsByOwner setObject:url forKey:owner];
+
+    if(_promisesByURL[url])
+        return;
+
+    RKURLRequestPromise *imagePromise = [self imagePromiseForURL:url];
+    _promisesByURL[url] = imagePromise;
+
+    __weak RKURLRequestPromise *weakPromise = imagePromise;
+    [imagePromise then:^(RKImageLoaderImage *image) {
+        [self finishLoadingImageAtURL:url forPromise:weakPromise withImage:image error:nil];
+    } otherwise:^(NSError *error) {
+        [self finishLoadingImageAtURL:url forPromise:weakPromise withImage:nil error:error];
+    } onQueue:[NSOperationQueue mainQueue]];
+}
+
+- (void)finishLoadingImageAtURL:(NSURL *)url forPromise:(RKURLRequestPromise *)imagePromise withImage:(RKImageLoaderImage *)image error:(NSError *)error
+{
+    //The request was stopped after its result was dispatched.
+    if(!imagePromise || _promisesByURL[url] != imagePromise)
+        return;
+
+    [_promisesByURL removeObjectForKey:url];
+
+    NSArray *subscribers = _subscribersByURL[url];
+    [_subscribersByURL removeObjectForKey:url];
+
+    for (RKImageLoaderSubscriber *subscriber in subscribers)
+        [_URLsByOwner removeObjectForKey:subscriber.owner];
+
+    if(image) {
+        [self cacheImage:image forIdentifier:[url absoluteString]];
+
+        for (RKImageLoaderSubscriber *subscriber in subscribers) {
+            if(subscriber.handler)
+                subscriber.handler(image);
+        }
+    } else {
+        if(RKImageLoaderIsPermanentFailure(imagePromise, error))
+            [_knownInvalidCacheIdentifiers addObject:[url absoluteString]];
+
+        if(error.code != '!img')
+            NSLog(@"Could not load image. %@", error);
+    }
+}
+
+- (void)stopLoadingImagesForOwner:(id)owner
+{
+    NSParameterAssert(owner);
+    NSAssert([NSThread isMainThread], @"-[RKImageLoader stopLoadingImagesForOwner:] must be called from the main thread.");
+
+    NSURL *url = [_URLsByOwner objectForKey:owner];
+    if(!url)
+        return;
+
+    [_URLsByOwner removeObjectForKey:owner];
+
+    NSMutableArray *subscribers = _subscribersByURL[url];
+    NSIndexSet *ownedIndexes = [subscribers indexesOfObjectsPassingTest:^BOOL(RKImageLoaderSubscriber *subscriber, NSUInteger index, BOOL *stop) {
+        return [subscriber.owner isEqual:owner];
+    }];
+    [subscribers removeObjectsAtIndexes:ownedIndexes];
+
+    if(subscribers.count == 0) {
+        [_subscribersByURL removeObjectForKey:url];
+
+        [_promisesByURL[url] cancel:nil];
+        [_promisesByURL removeObjectForKey:url];
+    }
+}
+
+#if TARGET_OS_IPHONE
+
 #pragma mark - Properties
 
 - (void)setMaximumCacheableSize:(CGSize)maximumCacheableSize
 {
     _maximumCacheableSize = maximumCacheableSize;
-    
-    self.inMemoryCache.totalCostLimit = xCGSizeGetArea(maximumCacheableSize) * self.maximumCacheCount;
+
+    CGFloat scale = [UIScreen mainScreen].scale;
+    self.memoryCache.capacity = (NSUInteger)(xCGSizeGetArea(maximumCacheableSize) * scale * scale * 4) * _maximumCacheCount;
 }
 
 - (void)setMaximumCacheCount:(NSUInteger)maximumCacheCount
 {
-    self.inMemoryCache.countLimit = maximumCacheCount;
-    self.inMemoryCache.totalCostLimit = xCGSizeGetArea(_maximumCacheableSize) * self.maximumCacheCount;
-}
+    _maximumCacheCount = maximumCacheCount;
 
-- (NSUInteger)maximumCacheCount
-{
-    return self.inMemoryCache.countLimit;
+    self.maximumCacheableSize = _maximumCacheableSize;
 }
 
-#pragma mark - Image Loading
+#pragma mark - Loading Images into Views
 
 - (void)loadImagePromise:(RKPromise *)imagePromise placeholder:(UIImage *)placeholder intoView:(UIImageView *)imageView completionHandler:(RKImageLoaderCompletionHandler)completionHandler
 {
     NSParameterAssert(imageView);
-    
+
+    [self stopLoadingImagesForView:imageView];
+
     imageView.image = placeholder;
-    
+
     if(imagePromise && ![_knownInvalidCacheIdentifiers containsObject:imagePromise.cacheIdentifier]) {
-        [[self.imageMap objectForKey:imageView] cancel:nil];
-        [self.imageMap removeObjectForKey:imageView];
-        
-        UIImage *existingImage = [self.inMemoryCache objectForKey:imagePromise.cacheIdentifier];
+        UIImage *existingImage = [self cachedImageForIdentifier:imagePromise.cacheIdentifier];
         if(existingImage) {
             imageView.image = existingImage;
-            
+
             if(completionHandler)
                 completionHandler(YES);
-            
+
             return;
         }
-        
+
         //Our dictionary does not actually copy its keys.
         CFDictionarySetValue((__bridge CFMutableDictionaryRef)self.imageMap,
                              (__bridge const void *)imageView,
                              (__bridge const void *)imagePromise);
-        
-        RKRealize(imagePromise, ^(UIImage *image) {
+
+        [imagePromise then:^(UIImage *image) {
+            if([self.imageMap objectForKey:imageView] != imagePromise)
+                return;
+
             imageView.image = image;
-            
+
             UITableViewCell *superCell = RK_TRY_CAST(UITableViewCell, imageView.superview.superview);
             [superCell setNeedsLayout];
-            
-            if(xCGSizeGetArea(image.size) < xCGSizeGetArea(_maximumCacheableSize))
-                [self.inMemoryCache setObject:image forKey:imagePromise.cacheIdentifier cost:image.size.width + image.size.height];
-            
+
+            [self cacheImage:image forIdentifier:imagePromise.cacheIdentifier];
+
             [self.imageMap removeObjectForKey:imageView];
-            
+
             if(completionHandler)
                 completionHandler(YES);
-        }, ^(NSError *error) {
-            if(imagePromise.cacheIdentifier)
+        } otherwise:^(NSError *error) {
+            if([self.imageMap objectForKey:imageView] != imagePromise)
+                return;
+
+            if(imagePromise.cacheIdentifier && RKImageLoaderIsPermanentFailure(imagePromise, error))
                 [self.knownInvalidCacheIdentifiers addObject:imagePromise.cacheIdentifier];
             [self.imageMap removeObjectForKey:imageView];
-            
+
             if(error.code != '!img')
                 NSLog(@"Could not load image. %@", error);
-            
+
             if(completionHandler)
                 completionHandler(NO);
-        });
+        } onQueue:[NSOperationQueue mainQueue]];
     }
 }
 
 - (void)loadImageAtURL:(NSURL *)url placeholder:(UIImage *)placeholder intoView:(UIImageView *)imageView completionHandler:(RKImageLoaderCompletionHandler)completionHandler
 {
     NSParameterAssert(imageView);
-    
-    NSURLRequest *imageURLRequest = [NSURLRequest requestWithURL:url];
-    RKURLRequestPromise *imagePromise = [[RKURLRequestPromise alloc] initWithRequest:imageURLRequest
-                                                                        cacheManager:self.cacheManager
-                                                                 useCacheWhenOffline:YES
-                                                                        requestQueue:[RKBlockPromise defaultBlockPromiseQueue]];
-    imagePromise.postProcessor = kRKImagePostProcessorBlock;
-    
-    [self loadImagePromise:imagePromise placeholder:placeholder intoView:imageView completionHandler:completionHandler];
+
+    [self stopLoadingImagesForView:imageView];
+
+    imageView.image = placeholder;
+
+    if(!url)
+        return;
+
+    __weak UIImageView *weakImageView = imageView;
+    [self loadImageAtURL:url forOwner:imageView completionHandler:^(UIImage *image) {
+        UIImageView *imageView = weakImageView;
+        imageView.image = image;
+
+        UITableViewCell *superCell = RK_TRY_CAST(UITableViewCell, imageView.superview.superview);
+        [superCell setNeedsLayout];
+
+        if(completionHandler)
+            completionHandler(YES);
+    }];
 }
 
 - (void)loadImageAtURL:(NSURL *)url placeholder:(UIImage *)placeholder intoView:(UIImageView *)imageView
@@ -162,11 +404,13 @@
 - (void)stopLoadingImagesForView:(UIImageView *)imageView
 {
     NSParameterAssert(imageView);
-    
+
     [[self.imageMap objectForKey:imageView] cancel:nil];
     [self.imageMap removeObjectForKey:imageView];
-}
 
-@end
+    [self stopLoadingImagesForOwner:imageView];
+}
 
 #endif /* TARGET_OS_IPHONE */
+
+@end
@@ -0,0 +1,80 @@
+//
+//  RKMemoryCache.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/27/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKMemoryCache_h
+#define RKMemoryCache_h 1
+
+#import <Foundation/Foundation.h>
+
+///The RKMemoryCache class encapsulates an in-memory cache of objects produced from
+///data in a persistent cache, such as the post-processed results of RKURLRequestPromises.
+///
+///Each object is stored with the revision of the data it was produced from, and the
+///transform that produced it. An object is only returned when both match the values
+///given when it is looked up, so an object is implicitly invalidated as soon as its
+///data is replaced in the persistent cache, or is produced by a different post-processor.
+///
+///The cache is bounded by the estimated cost of its objects in bytes, and evicts them
+///with an `RKCacheEvictionPolicy`. RKMemoryCache is safe to use from multiple threads.
+@interface RKMemoryCache : NSObject
+
+///Returns the shared memory cache, creating it if it does not already exist.
+///
+///The shared memory cache has a capacity of 8 MB.
++ (instancetype)sharedMemoryCache;
+
+///Initialize the receiver with a given capacity.
+///
+/// \param  capacity    The estimated cost in bytes of the objects the cache may hold.
+///
+/// \result A fully initialized memory cache.
+///
+///This is the designated initializer.
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+#pragma mark - Properties
+
+///The estimated cost in bytes of the objects the cache may hold.
+@property NSUInteger capacity;
+
+///The estimated cost in bytes of the objects currently in the cache.
+@property (readonly) NSUInteger totalCost;
+
+#pragma mark - Objects
+
+///Returns the object for a given key if it is current.
+///
+/// \param  key         The key of the object. Required.
+/// \param  revision    The current revision of the data the object is produced from. Required.
+/// \param  transform   The object used to produce the cached object from its data, such as a
+///                     post-processor block. Compared by identity. Optional.
+///
+/// \result The cached object, or nil if there is no object for the key, or it
+///         was stored with a different revision or transform.
+- (id)objectForKey:(NSString *)key revision:(NSString *)revision transform:(id)transform;
+
+///Stores an object for a given key, evicting other objects as necessary to stay within the receiver's capacity.
+///
+/// \param  object      The object to store. Required.
+/// \param  key         The key of the object. Required.
+/// \param  revision    The revision of the data the object was produced from. Required.
+/// \param  transform   The object used to produce the cached object from its data. Optional.
+/// \param  cost        The estimated cost of the object in bytes, such as the length of its data.
+///
+///Objects in a memory cache are shared between all of their readers, and must not be mutated.
+- (void)setObject:(id)object forKey:(NSString *)key revision:(NSString *)revision transform:(id)transform cost:(NSUInteger)cost;
+
+///Removes the object for a given key.
+- (void)removeObjectForKey:(NSString *)key;
+
+///Removes all objects from the receiver.
+- (void)removeAllObjects;
+
+@end
+
+#endif /* RKMemoryCache_h */
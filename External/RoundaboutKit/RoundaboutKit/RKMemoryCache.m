@@ -0,0 +1,175 @@
+//
+//  RKMemoryCache.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/27/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKMemoryCache.h"
+#import "RKCacheEvictionPolicy.h"
+#import <pthread.h>
+#if TARGET_OS_IPHONE
+#   import <UIKit/UIKit.h>
+#endif /* TARGET_OS_IPHONE */
+
+static NSUInteger const kSharedMemoryCacheCapacity = (1024 * 1024 * 8) /* 8 MB */;
+
+///The RKMemoryCacheEntry class encapsulates a single object in a memory cache.
+@interface RKMemoryCacheEntry : NSObject
+
+@property (nonatomic) id object;
+@property (nonatomic, copy) NSString *revision;
+@property (nonatomic) id transform;
+
+@end
+
+@implementation RKMemoryCacheEntry
+
+@end
+
+#pragma mark -
+
+@implementation RKMemoryCache {
+    pthread_mutex_t _lock;
+    NSMutableDictionary *_entries;
+    RKCacheEvictionPolicy *_evictionPolicy;
+}
+
++ (instancetype)sharedMemoryCache
+{
+    static RKMemoryCache *sharedMemoryCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedMemoryCache = [[self alloc] initWithCapacity:kSharedMemoryCacheCapacity];
+    });
+
+    return sharedMemoryCache;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+
+    pthread_mutex_destroy(&_lock);
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    if((self = [super init])) {
+        pthread_mutex_init(&_lock, NULL);
+        _entries = [NSMutableDictionary dictionary];
+        _evictionPolicy = [[RKCacheEvictionPolicy alloc] initWithCapacity:capacity];
+
+#if TARGET_OS_IPHONE
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(removeAllObjects)
+                                                     name:UIApplicationDidReceiveMemoryWarningNotification
+                                                   object:nil];
+#endif /* TARGET_OS_IPHONE */
+    }
+
+    return self;
+}
+
+- (id)init
+{
+    return [self initWithCapacity:kSharedMemoryCacheCapacity];
+}
+
+#pragma mark - Properties
+
+- (void)setCapacity:(NSUInteger)capacity
+{
+    pthread_mutex_lock(&_lock);
+    _evictionPolicy.capacity = capacity;
+    [_entries removeObjectsForKeys:[_evictionPolicy evictKeysExceedingCapacity]];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)capacity
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger capacity = (NSUInteger)_evictionPolicy.capacity;
+    pthread_mutex_unlock(&_lock);
+
+    return capacity;
+}
+
+- (NSUInteger)totalCost
+{
+    pthread_mutex_lock(&_lock);
+    NSUInteger totalCost = (NSUInteger)_evictionPolicy.totalCost;
+    pthread_mutex_unlock(&_lock);
+
+    return totalCost;
+}
+
+#pragma mark - Objects
+
+- (id)objectForKey:(NSString *)key revision:(NSString *)revision transform:(id)transform
+{
+    NSParameterAssert(key);
+    NSParameterAssert(revision);
+
+    pthread_mutex_lock(&_lock);
+
+    id object = nil;
+    RKMemoryCacheEntry *entry = _entries[key];
+    if(entry) {
+        if([entry.revision isEqualToString:revision] && entry.transform == transform) {
+            object = entry.object;
+            [_evictionPolicy recordAccessForKey:key];
+        } else {
+            [_entries removeObjectForKey:key];
+            [_evictionPolicy removeKey:key];
+        }
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    return object;
+}
+
+- (void)setObject:(id)object forKey:(NSString *)key revision:(NSString *)revision transform:(id)transform cost:(NSUInteger)cost
+{
+    NSParameterAssert(object);
+    NSParameterAssert(key);
+    NSParameterAssert(revision);
+
+    RKMemoryCacheEntry *entry = [RKMemoryCacheEntry new];
+    entry.object = object;
+    entry.revision = revision;
+    entry.transform = transform;
+
+    pthread_mutex_lock(&_lock);
+
+    _entries[key] = entry;
+    [_entries removeObjectsForKeys:[_evictionPolicy insertKey:key cost:cost]];
+
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)removeObjectForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+
+    pthread_mutex_lock(&_lock);
+
+    [_entries removeObjectForKey:key];
+    [_evictionPolicy removeKey:key];
+
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)removeAllObjects
+{
+    pthread_mutex_lock(&_lock);
+
+    [_entries removeAllObjects];
+    [_evictionPolicy removeAllKeys];
+
+    pthread_mutex_unlock(&_lock);
+}
+
+@end
@@ -203,8 +203,31 @@ RK_EXTERN NSString *RKSanitizeStringForSorting(NSString *string);
 ///The result of this method is safe to use as a file system name.
 ///
 ///This function is the the replacement for the obsoleted `RKGenerateSongID` function.
+///
+///Identifiers are generated in a single pass over each string. Strings containing only
+///ASCII are sanitized without allocating anything but the result.
 RK_EXTERN NSString *RKGenerateIdentifierForStrings(NSArray *strings);
 
+///Returns a 64-bit hash of the identifier `RKGenerateIdentifierForStrings` would generate for an array of strings.
+///
+/// \param  strings     The strings to combine into the identifier. Required.
+///
+/// \result A 64-bit FNV-1a hash of the identifier.
+///
+///Equal identifiers always have equal hashes. The hash is not stable across versions of RoundaboutKit,
+///so it should only be used for in-memory lookups, e.g. as a key in an `NSMapTable`, and never persisted.
+RK_EXTERN uint64_t RKGenerateIdentifierHashForStrings(NSArray *strings);
+
+///Generates identifiers for many arrays of strings at once.
+///
+/// \param  arraysOfStrings An array of arrays of strings, as passed to `RKGenerateIdentifierForStrings`. Required.
+///
+/// \result An array of identifiers, in the same order as `arraysOfStrings`.
+///
+///The arrays are processed concurrently in batches, reusing one scratch buffer per batch.
+///The strings must not be mutated while this function runs.
+RK_EXTERN NSArray *RKGenerateIdentifiersForStringArrays(NSArray *arraysOfStrings);
+
 #pragma mark -
 
 ///Returns `nil` if `value` is NSNull, `value` otherwise.
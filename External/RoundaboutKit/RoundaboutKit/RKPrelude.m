@@ -199,42 +199,308 @@ NSString *RKSanitizeStringForSorting(NSString *string)
 	return string;
 }
 
+#pragma mark - • Identifiers
+
+///The number of characters an identifier scratch buffer holds before it allocates.
+#define kIdentifierInlineCharacterCapacity  256
+
+///The number of strings an identifier scratch buffer holds before it allocates.
+#define kIdentifierInlinePieceCapacity      8
+
+///The number of string arrays processed by each batch in `RKGenerateIdentifiersForStringArrays`.
+#define kIdentifierBatchSize                512
+
+///The IdentifierPiece type describes one sanitized string within an identifier scratch buffer.
+typedef struct IdentifierPiece {
+    NSUInteger location;
+    NSUInteger length;
+    BOOL isASCII;
+} IdentifierPiece;
+
+///The IdentifierScratch type encapsulates the buffers used to generate an identifier.
+///
+///Scratch buffers point into themselves, so they must not be copied.
+typedef struct IdentifierScratch {
+    unichar *characters;
+    NSUInteger length;
+    NSUInteger capacity;
+
+    IdentifierPiece *pieces;
+    NSUInteger pieceCount;
+    NSUInteger pieceCapacity;
+
+    unichar inlineCharacters[kIdentifierInlineCharacterCapacity];
+    IdentifierPiece inlinePieces[kIdentifierInlinePieceCapacity];
+} IdentifierScratch;
+
+static void IdentifierScratchInitialize(IdentifierScratch *scratch)
+{
+    scratch->characters = scratch->inlineCharacters;
+    scratch->length = 0;
+    scratch->capacity = kIdentifierInlineCharacterCapacity;
+
+    scratch->pieces = scratch->inlinePieces;
+    scratch->pieceCount = 0;
+    scratch->pieceCapacity = kIdentifierInlinePieceCapacity;
+}
+
+static void IdentifierScratchDestroy(IdentifierScratch *scratch)
+{
+    if(scratch->characters != scratch->inlineCharacters)
+        free(scratch->characters);
+
+    if(scratch->pieces != scratch->inlinePieces)
+        free(scratch->pieces);
+}
+
+///Grows a scratch buffer to hold at least a given number of additional characters.
+static void IdentifierScratchReserveCharacters(IdentifierScratch *scratch, NSUInteger additionalLength)
+{
+    NSUInteger requiredCapacity = scratch->length + additionalLength;
+    if(requiredCapacity <= scratch->capacity)
+        return;
+
+    NSUInteger newCapacity = MAX(scratch->capacity * 2, requiredCapacity);
+    if(scratch->characters == scratch->inlineCharacters) {
+        scratch->characters = malloc(newCapacity * sizeof(unichar));
+        memcpy(scratch->characters, scratch->inlineCharacters, scratch->length * sizeof(unichar));
+    } else {
+        scratch->characters = realloc(scratch->characters, newCapacity * sizeof(unichar));
+    }
+
+    scratch->capacity = newCapacity;
+}
+
+///Returns a new piece at the end of a scratch buffer, growing it if necessary.
+static IdentifierPiece *IdentifierScratchAddPiece(IdentifierScratch *scratch)
+{
+    if(scratch->pieceCount == scratch->pieceCapacity) {
+        NSUInteger newCapacity = scratch->pieceCapacity * 2;
+        if(scratch->pieces == scratch->inlinePieces) {
+            scratch->pieces = malloc(newCapacity * sizeof(IdentifierPiece));
+            memcpy(scratch->pieces, scratch->inlinePieces, scratch->pieceCount * sizeof(IdentifierPiece));
+        } else {
+            scratch->pieces = realloc(scratch->pieces, newCapacity * sizeof(IdentifierPiece));
+        }
+
+        scratch->pieceCapacity = newCapacity;
+    }
+
+    return &scratch->pieces[scratch->pieceCount++];
+}
+
+///Returns a bitmap of the characters removed from identifiers, with one bit for each character in the BMP.
+///
+///An identifier cannot contain whitespace, punctuation, or symbols. Looking characters up in
+///a flat bitmap avoids the overhead of `-[NSCharacterSet characterIsMember:]` for each character.
+static const uint8_t *IdentifierRemovedCharacterBitmap()
+{
+    static NSData *removedCharacterBitmap = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *charactersToRemove = [NSMutableCharacterSet new];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet symbolCharacterSet]];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet punctuationCharacterSet]];
+
+        //The first 8192 bytes of a bitmap representation cover the BMP.
+        removedCharacterBitmap = [charactersToRemove bitmapRepresentation];
+    });
+
+    return [removedCharacterBitmap bytes];
+}
+
+///Appends the lowercased contents of a string to a scratch buffer, minus the characters removed from identifiers.
+static void IdentifierScratchAppendSanitizedString(IdentifierScratch *scratch, NSString *string, const uint8_t *removedCharacterBitmap)
+{
+    NSUInteger length = [string length];
+    IdentifierScratchReserveCharacters(scratch, length);
+
+    unichar *characters = scratch->characters + scratch->length;
+    [string getCharacters:characters range:NSMakeRange(0, length)];
+
+    BOOL isASCII = YES;
+    for (NSUInteger index = 0; index < length; index++) {
+        if(characters[index] >= 0x80) {
+            isASCII = NO;
+            break;
+        }
+    }
+
+    //Lowercasing outside of ASCII can change the length of a string,
+    //so anything else is lowercased by Foundation before being sanitized.
+    if(!isASCII) {
+        NSString *lowercaseString = [string lowercaseString];
+        length = [lowercaseString length];
+        IdentifierScratchReserveCharacters(scratch, length);
+
+        characters = scratch->characters + scratch->length;
+        [lowercaseString getCharacters:characters range:NSMakeRange(0, length)];
+    }
+
+    NSUInteger sanitizedLength = 0;
+    for (NSUInteger index = 0; index < length; index++) {
+        unichar character = characters[index];
+        if(character >= 'A' && character <= 'Z')
+            character += ('a' - 'A');
+
+        if((removedCharacterBitmap[character >> 3] & (1 << (character & 7))) == 0)
+            characters[sanitizedLength++] = character;
+    }
+
+    IdentifierPiece *piece = IdentifierScratchAddPiece(scratch);
+    piece->location = scratch->length;
+    piece->length = sanitizedLength;
+    piece->isASCII = isASCII;
+
+    scratch->length += sanitizedLength;
+}
+
+///Compares two pieces of a scratch buffer the same way `-[NSString compare:]` would.
+static NSComparisonResult IdentifierScratchComparePieces(const IdentifierScratch *scratch, const IdentifierPiece *left, const IdentifierPiece *right)
+{
+    const unichar *leftCharacters = scratch->characters + left->location;
+    const unichar *rightCharacters = scratch->characters + right->location;
+
+    //ASCII has no composed characters, so `-compare:` reduces to comparing code units.
+    if(left->isASCII && right->isASCII) {
+        NSUInteger sharedLength = MIN(left->length, right->length);
+        for (NSUInteger index = 0; index < sharedLength; index++) {
+            if(leftCharacters[index] != rightCharacters[index])
+                return (leftCharacters[index] < rightCharacters[index])? NSOrderedAscending : NSOrderedDescending;
+        }
+
+        if(left->length == right->length)
+            return NSOrderedSame;
+
+        return (left->length < right->length)? NSOrderedAscending : NSOrderedDescending;
+    }
+
+    NSString *leftString = [[NSString alloc] initWithCharactersNoCopy:(unichar *)leftCharacters length:left->length freeWhenDone:NO];
+    NSString *rightString = [[NSString alloc] initWithCharactersNoCopy:(unichar *)rightCharacters length:right->length freeWhenDone:NO];
+    return [leftString compare:rightString];
+}
+
+///Sanitizes an array of strings into a scratch buffer, and sorts the resulting pieces.
+static void IdentifierScratchSanitizeStrings(IdentifierScratch *scratch, NSArray *strings)
+{
+    const uint8_t *removedCharacterBitmap = IdentifierRemovedCharacterBitmap();
+
+    scratch->length = 0;
+    scratch->pieceCount = 0;
+    for (NSString *string in strings)
+        IdentifierScratchAppendSanitizedString(scratch, string, removedCharacterBitmap);
+
+    //Identifiers are made of a handful of strings, so an insertion sort is the cheapest option.
+    IdentifierPiece *pieces = scratch->pieces;
+    for (NSUInteger index = 1; index < scratch->pieceCount; index++) {
+        IdentifierPiece piece = pieces[index];
+
+        NSUInteger insertionIndex = index;
+        while (insertionIndex > 0 && IdentifierScratchComparePieces(scratch, &piece, &pieces[insertionIndex - 1]) == NSOrderedAscending) {
+            pieces[insertionIndex] = pieces[insertionIndex - 1];
+            insertionIndex--;
+        }
+
+        pieces[insertionIndex] = piece;
+    }
+}
+
+///Returns the identifier for the sorted pieces of a scratch buffer.
+static NSString *IdentifierScratchCopyIdentifier(IdentifierScratch *scratch)
+{
+    NSUInteger sanitizedLength = scratch->length;
+
+    //The pieces are joined at the end of the buffer, after the pieces themselves.
+    IdentifierScratchReserveCharacters(scratch, sanitizedLength);
+
+    unichar *identifierCharacters = scratch->characters + sanitizedLength;
+    NSUInteger identifierLength = 0;
+    for (NSUInteger index = 0; index < scratch->pieceCount; index++) {
+        const IdentifierPiece *piece = &scratch->pieces[index];
+        memcpy(identifierCharacters + identifierLength, scratch->characters + piece->location, piece->length * sizeof(unichar));
+        identifierLength += piece->length;
+    }
+
+    return [[NSString alloc] initWithCharacters:identifierCharacters length:identifierLength];
+}
+
 NSString *RKGenerateIdentifierForStrings(NSArray *strings)
 {
     NSCParameterAssert(strings);
-    
-    NSString *(^sanitize)(NSString *) = ^(NSString *string)
-    {
-        //An identifier cannot contain whitespace, punctuation, or symbols.
-        //We create an all encompassing character set to test for these.
-        static NSMutableCharacterSet *charactersToRemove = nil;
-        static dispatch_once_t onceToken;
-        dispatch_once(&onceToken, ^{
-            charactersToRemove = [NSMutableCharacterSet new];
-            [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet symbolCharacterSet]];
-            [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet punctuationCharacterSet]];
-        });
-        
-        NSMutableString *resultString = [[string lowercaseString] mutableCopy];
-        for (NSUInteger index = 0; index < [resultString length]; index++)
-        {
-            unichar character = [resultString characterAtIndex:index];
-            if([charactersToRemove characterIsMember:character])
-            {
-                [resultString deleteCharactersInRange:NSMakeRange(index, 1)];
-                index--;
+
+    IdentifierScratch scratch;
+    IdentifierScratchInitialize(&scratch);
+
+    IdentifierScratchSanitizeStrings(&scratch, strings);
+    NSString *identifier = IdentifierScratchCopyIdentifier(&scratch);
+
+    IdentifierScratchDestroy(&scratch);
+
+    return identifier;
+}
+
+uint64_t RKGenerateIdentifierHashForStrings(NSArray *strings)
+{
+    NSCParameterAssert(strings);
+
+    IdentifierScratch scratch;
+    IdentifierScratchInitialize(&scratch);
+
+    IdentifierScratchSanitizeStrings(&scratch, strings);
+
+    //The hash covers both bytes of each code unit, so it is the hash of the identifier's UTF-16 representation.
+    uint64_t hash = 14695981039346656037ULL;
+    for (NSUInteger pieceIndex = 0; pieceIndex < scratch.pieceCount; pieceIndex++) {
+        const IdentifierPiece *piece = &scratch.pieces[pieceIndex];
+        for (NSUInteger index = piece->location; index < piece->location + piece->length; index++) {
+            unichar character = scratch.characters[index];
+
+            hash ^= (character & 0xFF);
+            hash *= 1099511628211ULL;
+            hash ^= (character >> 8);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    IdentifierScratchDestroy(&scratch);
+
+    return hash;
+}
+
+NSArray *RKGenerateIdentifiersForStringArrays(NSArray *arraysOfStrings)
+{
+    NSCParameterAssert(arraysOfStrings);
+
+    NSUInteger count = [arraysOfStrings count];
+    if(count == 0)
+        return @[];
+
+    __strong NSString **identifiers = (__strong NSString **)calloc(count, sizeof(NSString *));
+
+    size_t numberOfBatches = (count + kIdentifierBatchSize - 1) / kIdentifierBatchSize;
+    dispatch_apply(numberOfBatches, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t batch) {
+        IdentifierScratch scratch;
+        IdentifierScratchInitialize(&scratch);
+
+        NSUInteger batchEnd = MIN((batch + 1) * kIdentifierBatchSize, count);
+        for (NSUInteger index = batch * kIdentifierBatchSize; index < batchEnd; index++) {
+            @autoreleasepool {
+                IdentifierScratchSanitizeStrings(&scratch, arraysOfStrings[index]);
+                identifiers[index] = IdentifierScratchCopyIdentifier(&scratch);
             }
         }
-        
-        return resultString;
-    };
-    
-    NSArray *sanitizedStrings = RKCollectionMapToArray(strings, ^(NSString *string) {
-        return sanitize(string);
+
+        IdentifierScratchDestroy(&scratch);
     });
-    NSArray *sortedStrings = [sanitizedStrings sortedArrayUsingSelector:@selector(compare:)];
-    return [sortedStrings componentsJoinedByString:@""];
+
+    NSArray *result = [NSArray arrayWithObjects:identifiers count:count];
+
+    for (NSUInteger index = 0; index < count; index++)
+        identifiers[index] = nil;
+    free(identifiers);
+
+    return result;
 }
 
 #pragma mark -
@@ -8,6 +8,21 @@
 
 #import <Foundation/Foundation.h>
 
+@class RKPromise, RKCancellationToken;
+
+///The error domain used by RKPromise.
+RK_EXTERN NSString *const RKPromiseErrorDomain;
+
+NS_ENUM(NSInteger, RKPromiseErrors) {
+    ///Too many of the promises given to a combinator were rejected for it to be accepted.
+    ///
+    ///The error of the last rejected promise is included under `NSUnderlyingErrorKey`.
+    kRKPromiseErrorNotEnoughValues = 'nenv',
+    
+    ///The promise was cancelled before it was accepted or rejected.
+    kRKPromiseErrorCancelled = 'cncl',
+};
+
 ///The different states a promise can be in.
 typedef NS_ENUM(NSUInteger, RKPromiseState) {
     ///The promise is not yet realized.
@@ -26,9 +41,31 @@ typedef void(^RKPromiseThenBlock)(id);
 ///An error continuation block.
 typedef void(^RKPromiseErrorBlock)(NSError *error);
 
+///A block which transforms the value of a promise.
+typedef id(^RKPromiseMapBlock)(id value);
+
+///A block which continues a promise's value with another promise.
+typedef RKPromise *(^RKPromiseFlatMapBlock)(id value);
+
+///A block which continues a promise's error with another promise.
+typedef RKPromise *(^RKPromiseRecoverBlock)(NSError *error);
+
 #pragma mark -
 
 ///The RKPromise class encapsulates the common promise pattern.
+///
+///A promise may have any number of subscribers, each of which is called back
+///exactly once when the promise is accepted or rejected. The promise is fired
+///when its first subscriber is added. Subscribing to a promise which has already
+///been accepted or rejected calls the subscriber back without recording it.
+///
+///A promise which is cancelled is never accepted or rejected, and its subscribers
+///are released without being called back. Promises produced by the chaining and
+///plural methods depend on the promises they were made from: cancelling one withdraws
+///its interest in those promises, and a promise is cancelled once every promise that
+///depended on it has withdrawn its interest, unless it was subscribed to directly
+///through `-[self then:otherwise:onQueue:]` or `-[self await:]`. Cancellation thereby
+///travels from the outermost promise of a chain down to the connections beneath it.
 @interface RKPromise : NSObject
 
 #pragma mark - Convenience
@@ -41,6 +78,13 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 
 #pragma mark - Plural
 
+///The plural methods combine the outcomes of an array of promises into a single promise.
+///
+///Each method subscribes to all of the promises given to it immediately. Completions are
+///counted with atomic operations, so the promises may be settled from any number of threads
+///at once. Once the outcome of a combination is decided, or the combined promise is cancelled,
+///the combination withdraws its interest in any of the promises which have not yet settled.
+
 ///Realizes an array of promises, placing the results into the returned promise.
 ///
 /// \param  promises    The promises to realize. Required.
@@ -48,8 +92,55 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 /// \result A promise that will contain an array of RKPossibility
 ///         objects in the same order as the promises passed in.
 ///
+///This method is equivalent to `+[self allSettled:]`.
 + (RKPromise *)when:(NSArray *)promises;
 
+///Returns a promise for the values of an array of promises.
+///
+/// \param  promises    The promises to realize. Required.
+///
+/// \result A promise that will contain an array of the values of the promises, in the same
+///         order as the promises passed in, or the error of the first promise to be rejected.
+///         Nil values are represented by NSNull.
++ (RKPromise *)all:(NSArray *)promises;
+
+///Returns a promise for the outcomes of an array of promises.
+///
+/// \param  promises    The promises to realize. Required.
+///
+/// \result A promise that will contain an array of RKPossibility objects in
+///         the same order as the promises passed in. It is never rejected.
+///
+///This method only withdraws its interest in the promises passed in if the returned promise is cancelled.
++ (RKPromise *)allSettled:(NSArray *)promises;
+
+///Returns a promise for the value of the first of an array of promises to be accepted.
+///
+/// \param  promises    The promises to realize. Required.
+///
+/// \result A promise that will contain the first value, or a `kRKPromiseErrorNotEnoughValues`
+///         error if all of the promises are rejected.
++ (RKPromise *)any:(NSArray *)promises;
+
+///Returns a promise for the outcome of the first of an array of promises to be settled.
+///
+/// \param  promises    The promises to realize. Required.
+///
+/// \result A promise that will contain the value or error of the first promise to settle.
+///         If `promises` is empty, the promise is rejected with `kRKPromiseErrorNotEnoughValues`.
++ (RKPromise *)race:(NSArray *)promises;
+
+///Returns a promise for the values of the first promises to be accepted in an array of promises.
+///
+/// \param  count       The number of values to wait for.
+/// \param  promises    The promises to realize. Required.
+///
+/// \result A promise that will contain an array of the first `count` values, in the same order
+///         as the promises that yielded them were passed in, or a `kRKPromiseErrorNotEnoughValues`
+///         error once too many promises are rejected for `count` values to be yielded.
+///         Nil values are represented by NSNull.
++ (RKPromise *)first:(NSUInteger)count ofPromises:(NSArray *)promises;
+
 #pragma mark - State
 
 ///The name of the promise. Defaults to <anonymous>
@@ -65,6 +156,12 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 /// \seealso(RKPromiseState)
 @property (readonly) RKPromiseState state;
 
+///The identifier of the promise's spans in traces recorded by RKTrace. Never 0.
+///
+///While tracing is enabled, a promise records a span from the moment it is first
+///subscribed to until it is settled or cancelled, labelled with its name and cache identifier.
+@property (readonly) uint64_t traceIdentifier;
+
 #pragma mark - Propagating Values
 
 ///Mark the promise as successful and associate a value with it,
@@ -83,6 +180,24 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 ///This method or `-[self accept:]` may only be called once.
 - (void)reject:(NSError *)error;
 
+#pragma mark - Cancelling
+
+///Whether or not the promise is cancelled.
+@property BOOL cancelled;
+
+///The token whose cancellation cancels the receiver.
+///
+///The token is held weakly. Setting a token that is already cancelled cancels the receiver
+///immediately. A token set on a promise that is already settled or cancelled is ignored.
+@property (weak) RKCancellationToken *cancellationToken;
+
+///Cancel the receiver, withdrawing its interest in the promises it depends on.
+///
+///Subclasses that perform work of their own should override this method to stop it,
+///and must call super. Cancelling a promise more than once, or cancelling a promise
+///that has already been accepted or rejected, has no effect.
+- (IBAction)cancel:(id)sender;
+
 #pragma mark - Realizing
 
 ///Overriden by subclasses that wish to perform work based on the promise being realized.
@@ -100,6 +215,7 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 /// \param  otherwise   The block to invoke upon failure. Required.
 ///
 ///The blocks passed in will be invoked on the caller's operation queue.
+///This method may be called any number of times.
 ///
 /// \seealso(-[self then:otherwise:onQueue:])
 - (void)then:(RKPromiseThenBlock)then otherwise:(RKPromiseErrorBlock)otherwise;
@@ -110,9 +226,48 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 /// \param  otherwise   The block to invoke upon failure. Required.
 /// \param  queue       The queue to invoke the blocks on. Required.
 ///
+///This method may be called any number of times.
+///
 /// \seealso(-[self then:otherwise:onQueue:])
 - (void)then:(RKPromiseThenBlock)then otherwise:(RKPromiseErrorBlock)otherwise onQueue:(NSOperationQueue *)queue;
 
+#pragma mark - Chaining
+
+///Returns a promise for the result of transforming the receiver's value.
+///
+/// \param  mapper  The block to transform the receiver's value with. Required.
+///
+/// \result A promise that is accepted with the value returned by `mapper`,
+///         or rejected with the receiver's error.
+///
+///The block is invoked on the thread that accepts the receiver, so it should not block.
+///The receiver is fired immediately.
+- (RKPromise *)map:(RKPromiseMapBlock)mapper RK_REQUIRE_RESULT_USED;
+
+///Returns a promise for the result of continuing the receiver's value with another promise.
+///
+/// \param  binder  A block which returns the promise to continue with. Required.
+///                 If the block returns nil, the result is accepted with nil.
+///
+/// \result A promise that is settled like the promise returned by `binder`,
+///         or rejected with the receiver's error.
+///
+///The block is invoked on the thread that accepts the receiver, so it should not block.
+///The receiver is fired immediately.
+- (RKPromise *)flatMap:(RKPromiseFlatMapBlock)binder RK_REQUIRE_RESULT_USED;
+
+///Returns a promise for the result of continuing the receiver's error with another promise.
+///
+/// \param  recovery    A block which returns the promise to continue with. Required.
+///                     If the block returns nil, the result is rejected with the receiver's error.
+///
+/// \result A promise that is accepted with the receiver's value, or is
+///         settled like the promise returned by `recovery`.
+///
+///The block is invoked on the thread that rejects the receiver, so it should not block.
+///The receiver is fired immediately.
+- (RKPromise *)recover:(RKPromiseRecoverBlock)recovery RK_REQUIRE_RESULT_USED;
+
 #pragma mark -
 
 ///Update a given key path on a given object when the receiver is accepted or rejected.
@@ -136,6 +291,11 @@ typedef void(^RKPromiseErrorBlock)(NSError *error);
 ///
 /// \result The result of realizing the promise.
 ///
+///If the receiver is cancelled before it is realized, this method returns nil
+///and provides a `kRKPromiseErrorCancelled` error.
+///
+///This method blocks the calling thread, and should be avoided in favor
+///of `-[self then:otherwise:onQueue:]` and the chaining methods.
 - (id)await:(NSError **)outError;
 
 @end
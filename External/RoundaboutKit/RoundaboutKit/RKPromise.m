@@ -14,8 +14,13 @@
 #   import <UIKit/UIKit.h>
 #endif /* TARGET_OS_IPHONE */
 
-#import "RKQueueManager.h"
 #import "RKPossibility.h"
+#import "RKCancellationToken.h"
+#import "RKTrace.h"
+#import "RKStallWatchdog.h"
+#import <libkern/OSAtomic.h>
+
+NSString *const RKPromiseErrorDomain = @"RKPromiseErrorDomain";
 
 ///Returns a string representation for a given state.
 static NSString *RKPromiseStateGetString(RKPromiseState state)
@@ -34,7 +39,83 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 
 #pragma mark -
 
-@interface RKPromise ()
+///Returns a block which runs a callback of a promise on a queue, traced under the
+///name of the promise, and labelled with it for the stall watchdog if run on the main queue.
+static dispatch_block_t RKPromiseInstrumentCallback(RKPromise *promise, NSOperationQueue *queue, dispatch_block_t callback)
+{
+    if(RKTraceIsEnabled())
+        callback = RKTraceWrapBlock(kRKTraceCategoryPromise, promise.promiseName, callback);
+    
+    if(RKStallWatchdogIsActive() && queue == [NSOperationQueue mainQueue])
+        callback = RKStallWatchdogWrapBlock(promise.promiseName, callback);
+    
+    return callback;
+}
+
+///Invokes the appropriate block for a settled promise's state.
+///
+///If `queue` is nil, the block is invoked synchronously on the calling thread.
+static void RKPromiseDeliver(RKPromise *promise, RKPromiseState state, id contents, RKPromiseThenBlock then, RKPromiseErrorBlock otherwise, NSOperationQueue *queue)
+{
+    switch (state) {
+        case RKPromiseStateValue: {
+            if(queue) {
+                [queue addOperationWithBlock:RKPromiseInstrumentCallback(promise, queue, ^{
+                    then(contents);
+                })];
+            } else {
+                then(contents);
+            }
+            
+            break;
+        }
+            
+        case RKPromiseStateError: {
+            if(queue) {
+                [queue addOperationWithBlock:RKPromiseInstrumentCallback(promise, queue, ^{
+                    otherwise(contents);
+                })];
+            } else {
+                otherwise(contents);
+            }
+            
+            break;
+        }
+            
+        case RKPromiseStateNotRealized: {
+            break;
+        }
+    }
+}
+
+#pragma mark -
+
+///The RKPromiseSubscriber class encapsulates a pair of continuation blocks waiting on a promise.
+@interface RKPromiseSubscriber : NSObject
+
+@property (copy) RKPromiseThenBlock then;
+@property (copy) RKPromiseErrorBlock otherwise;
+@property NSOperationQueue *queue;
+
+@end
+
+@implementation RKPromiseSubscriber
+
+@end
+
+#pragma mark -
+
+///The RKPromiseDependency protocol describes an object whose outcome depends on one or more promises.
+@protocol RKPromiseDependency <NSObject>
+
+///Informs the receiver that the promise which depended on it no longer needs its outcome.
+- (void)withdrawInterest;
+
+@end
+
+#pragma mark -
+
+@interface RKPromise () <RKPromiseDependency>
 
 #pragma mark - State
 
@@ -44,16 +125,306 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 ///The contents of the promise, as described by `self.state`.
 @property id contents;
 
-#pragma mark - Blocks
+#pragma mark - Subscribers
 
-///The block to invoke upon success.
-@property (copy) RKPromiseThenBlock thenBlock;
+///Adds a subscriber to the receiver, firing it if this is its first subscriber.
+///
+/// \param  then        The block to invoke upon success. Required.
+/// \param  otherwise   The block to invoke upon failure. Required.
+/// \param  queue       The queue to invoke the blocks on. If nil, the blocks are
+///                     invoked synchronously on the thread that settles the receiver.
+///
+///If the receiver is already settled, the subscriber is called back without being recorded.
+- (void)addSubscriberWithThen:(RKPromiseThenBlock)then otherwise:(RKPromiseErrorBlock)otherwise queue:(NSOperationQueue *)queue;
 
-///The block to invoke upon failure.
-@property (copy) RKPromiseErrorBlock otherwiseBlock;
+#pragma mark - Dependencies
 
-///The queue to invoke the blocks on.
-@property NSOperationQueue *queue;
+///Records an object the receiver depends on, whose interest is withdrawn when the receiver is cancelled.
+///
+/// \param  dependency  The object to record. Held weakly. Required.
+///
+///If the receiver is already cancelled, the dependency's interest is withdrawn immediately.
+///If the receiver is already settled, this method does nothing.
+- (void)addDependency:(id <RKPromiseDependency>)dependency;
+
+@end
+
+#pragma mark -
+
+///The different ways an RKPromiseCombination can combine its promises.
+typedef NS_ENUM(NSUInteger, RKPromiseCombinationMode) {
+    ///Accepted with every value in order, rejected with the first error.
+    kRKPromiseCombinationModeAll = 0,
+    
+    ///Accepted with every outcome in order, never rejected.
+    kRKPromiseCombinationModeAllSettled,
+    
+    ///Accepted with the first `count` values in order, rejected once they cannot be yielded.
+    kRKPromiseCombinationModeFirst,
+    
+    ///Like `kRKPromiseCombinationModeFirst` with a count of 1, accepted with the value itself.
+    kRKPromiseCombinationModeAny,
+    
+    ///Settled like the first promise to settle.
+    kRKPromiseCombinationModeRace,
+};
+
+///The RKPromiseCombination class encapsulates the state of one of RKPromise's plural methods.
+///
+///Results are written into preallocated slots which are each only ever written by
+///a single callback, and completions are counted with atomic operations, so no lock
+///is taken while the combined promises settle. The callback whose count completes a
+///combination is the only one to read the slots, after a barrier.
+///
+///Cancelling the combined promise decides the combination without settling it.
+@interface RKPromiseCombination : NSObject <RKPromiseDependency>
+
+- (instancetype)initWithPromises:(NSArray *)promises mode:(RKPromiseCombinationMode)mode count:(NSUInteger)count;
+
+///Subscribes to the combined promises, returning the combined promise.
+- (RKPromise *)start;
+
+@end
+
+@implementation RKPromiseCombination {
+    NSArray *_promises;
+    RKPromiseCombinationMode _mode;
+    NSUInteger _count;
+    RKPromise *_result;
+    
+    ///Indexed by ticket. Holds the index of the promise which took each ticket.
+    NSUInteger *_slotIndexes;
+    
+    ///Indexed by ticket. Holds the value or possibility of the promise which took each ticket.
+    __strong id *_slotValues;
+    
+    ///The number of slots handed out.
+    volatile int32_t _tickets;
+    
+    ///The number of slots which have been written.
+    volatile int32_t _writtenSlots;
+    
+    ///The number of promises which have been rejected.
+    volatile int32_t _failures;
+    
+    ///Whether or not the outcome of the combination has been decided.
+    volatile int32_t _isDecided;
+    
+    ///The number of promises, from the front of `_promises`, which have been subscribed to.
+    volatile int32_t _subscribedPromises;
+}
+
+- (void)dealloc
+{
+    if(_slotValues) {
+        for (NSUInteger index = 0; index < _count; index++)
+            _slotValues[index] = nil;
+        
+        free(_slotValues);
+    }
+    
+    free(_slotIndexes);
+}
+
+- (instancetype)initWithPromises:(NSArray *)promises mode:(RKPromiseCombinationMode)mode count:(NSUInteger)count
+{
+    NSParameterAssert(promises);
+    
+    if((self = [super init])) {
+        _promises = [promises copy];
+        _mode = mode;
+        _count = count;
+        _result = [RKPromise new];
+        
+        if(count > 0 && count <= _promises.count) {
+            _slotIndexes = calloc(count, sizeof(NSUInteger));
+            _slotValues = (__strong id *)calloc(count, sizeof(id));
+        }
+    }
+    
+    return self;
+}
+
+#pragma mark - Deciding
+
+///Returns the error used when a combination cannot yield enough values.
+- (NSError *)notEnoughValuesErrorWithUnderlyingError:(NSError *)underlyingError
+{
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:@"Not enough promises were accepted."
+                                                                       forKey:NSLocalizedDescriptionKey];
+    if(underlyingError)
+        userInfo[NSUnderlyingErrorKey] = underlyingError;
+    
+    return [NSError errorWithDomain:RKPromiseErrorDomain code:kRKPromiseErrorNotEnoughValues userInfo:userInfo];
+}
+
+///Marks the combination as decided, returning whether or not the caller was the one to decide it.
+- (BOOL)decide
+{
+    return OSAtomicCompareAndSwap32Barrier(0, 1, &_isDecided);
+}
+
+///Withdraws the combination's interest in the combined promises which have not yet settled.
+///
+///A promise still being subscribed to while the combination is decided is left alone,
+///so interest is never withdrawn from a promise more times than it was given.
+- (void)withdrawFromUnsettledPromises
+{
+    NSUInteger subscribedPromises = (NSUInteger)OSAtomicAdd32Barrier(0, &_subscribedPromises);
+    for (NSUInteger index = 0; index < subscribedPromises; index++)
+        [_promises[index] withdrawInterest];
+}
+
+- (void)withdrawInterest
+{
+    if([self decide])
+        [self withdrawFromUnsettledPromises];
+}
+
+///Returns the values in the slots of the receiver, in the order of the promises that yielded them.
+- (NSArray *)slotValuesInPromiseOrder
+{
+    NSMutableArray *tickets = [NSMutableArray arrayWithCapacity:_count];
+    for (NSUInteger ticket = 0; ticket < _count; ticket++)
+        [tickets addObject:@(ticket)];
+    
+    [tickets sortUsingComparator:^NSComparisonResult(NSNumber *left, NSNumber *right) {
+        NSUInteger leftIndex = _slotIndexes[left.unsignedIntegerValue];
+        NSUInteger rightIndex = _slotIndexes[right.unsignedIntegerValue];
+        if(leftIndex < rightIndex)
+            return NSOrderedAscending;
+        else if(leftIndex > rightIndex)
+            return NSOrderedDescending;
+        else
+            return NSOrderedSame;
+    }];
+    
+    return RKCollectionMapToArray(tickets, ^id(NSNumber *ticket) {
+        return _slotValues[ticket.unsignedIntegerValue] ?: [NSNull null];
+    });
+}
+
+- (void)acceptWithValue:(id)value
+{
+    if(![self decide])
+        return;
+    
+    [_result accept:value];
+    [self withdrawFromUnsettledPromises];
+}
+
+- (void)rejectWithError:(NSError *)error
+{
+    if(![self decide])
+        return;
+    
+    [_result reject:error];
+    [self withdrawFromUnsettledPromises];
+}
+
+#pragma mark - Recording Outcomes
+
+///Writes an object into the next free slot, returning YES if it filled the last slot.
+- (BOOL)fillSlotWithObject:(id)object forPromiseAtIndex:(NSUInteger)index
+{
+    int32_t ticket = OSAtomicIncrement32Barrier(&_tickets);
+    if((NSUInteger)ticket > _count)
+        return NO;
+    
+    _slotIndexes[ticket - 1] = index;
+    _slotValues[ticket - 1] = object;
+    
+    return ((NSUInteger)OSAtomicIncrement32Barrier(&_writtenSlots) == _count);
+}
+
+- (void)promiseAtIndex:(NSUInteger)index acceptedWithValue:(id)value
+{
+    switch (_mode) {
+        case kRKPromiseCombinationModeAll:
+        case kRKPromiseCombinationModeFirst: {
+            if([self fillSlotWithObject:value forPromiseAtIndex:index])
+                [self acceptWithValue:[self slotValuesInPromiseOrder]];
+            
+            break;
+        }
+            
+        case kRKPromiseCombinationModeAllSettled: {
+            if([self fillSlotWithObject:[[RKPossibility alloc] initWithValue:value] forPromiseAtIndex:index])
+                [self acceptWithValue:[self slotValuesInPromiseOrder]];
+            
+            break;
+        }
+            
+        case kRKPromiseCombinationModeAny:
+        case kRKPromiseCombinationModeRace: {
+            [self acceptWithValue:value];
+            
+            break;
+        }
+    }
+}
+
+- (void)promiseAtIndex:(NSUInteger)index rejectedWithError:(NSError *)error
+{
+    switch (_mode) {
+        case kRKPromiseCombinationModeAll:
+        case kRKPromiseCombinationModeRace: {
+            [self rejectWithError:error];
+            
+            break;
+        }
+            
+        case kRKPromiseCombinationModeAllSettled: {
+            if([self fillSlotWithObject:[[RKPossibility alloc] initWithError:error] forPromiseAtIndex:index])
+                [self acceptWithValue:[self slotValuesInPromiseOrder]];
+            
+            break;
+        }
+            
+        case kRKPromiseCombinationModeFirst:
+        case kRKPromiseCombinationModeAny: {
+            NSUInteger failures = (NSUInteger)OSAtomicIncrement32Barrier(&_failures);
+            if(_promises.count - failures < _count)
+                [self rejectWithError:[self notEnoughValuesErrorWithUnderlyingError:error]];
+            
+            break;
+        }
+    }
+}
+
+#pragma mark -
+
+- (RKPromise *)start
+{
+    NSUInteger totalPromises = _promises.count;
+    
+    if(_count > totalPromises || (totalPromises == 0 && _mode == kRKPromiseCombinationModeRace)) {
+        [self rejectWithError:[self notEnoughValuesErrorWithUnderlyingError:nil]];
+        return _result;
+    }
+    
+    if(_count == 0 && _mode != kRKPromiseCombinationModeRace) {
+        [self acceptWithValue:@[]];
+        return _result;
+    }
+    
+    [_result addDependency:self];
+    
+    [_promises enumerateObjectsUsingBlock:^(RKPromise *promise, NSUInteger index, BOOL *stop) {
+        [promise addSubscriberWithThen:^(id value) {
+            [self promiseAtIndex:index acceptedWithValue:value];
+        } otherwise:^(NSError *error) {
+            [self promiseAtIndex:index rejectedWithError:error];
+        } queue:nil];
+        OSAtomicIncrement32Barrier(&_subscribedPromises);
+        
+        //A combination decided by a promise which had already settled has no need for the rest.
+        if(_isDecided && _mode != kRKPromiseCombinationModeAllSettled)
+            *stop = YES;
+    }];
+    
+    return _result;
+}
 
 @end
 
@@ -61,10 +432,37 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 
 @implementation RKPromise {
     pthread_mutex_t _stateMutex;
+    BOOL _hasFired;
+    
+    //The first subscriber is kept inline, as most promises only ever have one.
+    RKPromiseThenBlock _thenBlock;
+    RKPromiseErrorBlock _otherwiseBlock;
+    NSOperationQueue *_queue;
+    
+    NSMutableArray *_additionalSubscribers;
+    
+    //Blocks which wake threads blocked in `-await:` when the promise is cancelled.
+    NSMutableArray *_cancellationWaiters;
+    
+    //The number of subscribers recorded before the promise settled, and whether any of
+    //them subscribed directly rather than through a chaining or plural method.
+    NSUInteger _interestedSubscriberCount;
+    BOOL _hasDirectSubscribers;
+    
+    NSPointerArray *_dependencies;
+    
+    __weak RKCancellationToken *_cancellationToken;
+    id _cancellationRegistration;
+    
+    volatile int64_t _traceIdentifier;
+    uint64_t _traceParentIdentifier;
+    NSString *_traceName;
 }
 
 - (void)dealloc
 {
+    [_cancellationToken removeCancellationHandler:_cancellationRegistration];
+    
     pthread_mutex_destroy(&_stateMutex);
 }
 
@@ -80,6 +478,7 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
         pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
         
         pthread_mutex_init(&_stateMutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
     }
     
     return self;
@@ -104,43 +503,55 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 #pragma mark - Plural Realization
 
 + (RKPromise *)when:(NSArray *)promises
+{
+    return [self allSettled:promises];
+}
+
++ (RKPromise *)all:(NSArray *)promises
 {
     NSParameterAssert(promises);
     
-    RKPromise *whenPromise = [RKPromise new];
+    return [[[RKPromiseCombination alloc] initWithPromises:promises mode:kRKPromiseCombinationModeAll count:promises.count] start];
+}
+
++ (RKPromise *)allSettled:(NSArray *)promises
+{
+    NSParameterAssert(promises);
     
-    NSOperationQueue *realizationQueue = [RKQueueManager commonQueue];
-    [realizationQueue addOperationWithBlock:^{
-        NSMutableArray *results = [promises mutableCopy];
-        __block NSUInteger numberOfRealizedPromises = 0;
-        for (NSUInteger index = 0, totalPromises = promises.count; index < totalPromises; index++) {
-            RKPromise *promise = promises[index];
-            
-            [promise then:^(id result) {
-                RKPossibility *possibility = [[RKPossibility alloc] initWithValue:result];
-                [results replaceObjectAtIndex:index withObject:possibility];
-                
-                numberOfRealizedPromises++;
-                if(numberOfRealizedPromises == totalPromises) {
-                    [whenPromise accept:results];
-                }
-            } otherwise:^(NSError *error) {
-                RKPossibility *possibility = [[RKPossibility alloc] initWithError:error];
-                [results replaceObjectAtIndex:index withObject:possibility];
-                
-                numberOfRealizedPromises++;
-                if(numberOfRealizedPromises == totalPromises) {
-                    [whenPromise accept:results];
-                }
-            } onQueue:realizationQueue];
-        }
-    }];
+    return [[[RKPromiseCombination alloc] initWithPromises:promises mode:kRKPromiseCombinationModeAllSettled count:promises.count] start];
+}
+
++ (RKPromise *)any:(NSArray *)promises
+{
+    NSParameterAssert(promises);
     
-    return whenPromise;
+    return [[[RKPromiseCombination alloc] initWithPromises:promises mode:kRKPromiseCombinationModeAny count:1] start];
+}
+
++ (RKPromise *)race:(NSArray *)promises
+{
+    NSParameterAssert(promises);
+    
+    return [[[RKPromiseCombination alloc] initWithPromises:promises mode:kRKPromiseCombinationModeRace count:1] start];
+}
+
++ (RKPromise *)first:(NSUInteger)count ofPromises:(NSArray *)promises
+{
+    NSParameterAssert(promises);
+    
+    return [[[RKPromiseCombination alloc] initWithPromises:promises mode:kRKPromiseCombinationModeFirst count:count] start];
 }
 
 #pragma mark - Identity
 
+- (uint64_t)traceIdentifier
+{
+    if(_traceIdentifier == 0)
+        OSAtomicCompareAndSwap64Barrier(0, (int64_t)RKTraceMakeIdentifier(), &_traceIdentifier);
+    
+    return (uint64_t)_traceIdentifier;
+}
+
 - (NSString *)description
 {
     return [NSString stringWithFormat:@"<%@:%p %@, state => %@, contents => %@>", NSStringFromClass(self.class), self, self.promiseName, RKPromiseStateGetString(self.state), self.contents];
@@ -148,68 +559,219 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 
 #pragma mark - Propagating Values
 
-- (void)accept:(id)value
+///Moves the receiver into a settled state, and calls back all of its subscribers.
+- (void)settleWithState:(RKPromiseState)state contents:(id)contents
 {
-    if(self.contents != nil)
-        @throw [NSException exceptionWithName:NSInternalInconsistencyException 
-                                       reason:@"Cannot accept a promise more than once"
-                                     userInfo:nil];
-    
     pthread_mutex_lock(&_stateMutex);
-    {
-        self.contents = value;
-        self.state = RKPromiseStateValue;
-        [self invoke];
+    
+    //The work behind a cancelled promise may finish before noticing it was
+    //cancelled, so settling a cancelled promise is silently ignored.
+    if(self.cancelled) {
+        pthread_mutex_unlock(&_stateMutex);
+        return;
     }
+    
+    if(self.state != RKPromiseStateNotRealized) {
+        pthread_mutex_unlock(&_stateMutex);
+        
+        NSString *reason = (state == RKPromiseStateValue)? @"Cannot accept a promise more than once" : @"Cannot reject a promise more than once";
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                       reason:reason
+                                     userInfo:nil];
+    }
+    
+    self.contents = contents;
+    self.state = state;
+    
+    RKPromiseThenBlock then = _thenBlock;
+    RKPromiseErrorBlock otherwise = _otherwiseBlock;
+    NSOperationQueue *queue = _queue;
+    NSArray *additionalSubscribers = _additionalSubscribers;
+    
+    _thenBlock = nil;
+    _otherwiseBlock = nil;
+    _queue = nil;
+    _additionalSubscribers = nil;
+    _cancellationWaiters = nil;
+    _dependencies = nil;
+    
+    RKCancellationToken *cancellationToken = _cancellationToken;
+    id cancellationRegistration = _cancellationRegistration;
+    _cancellationRegistration = nil;
+    
+    NSString *traceName = _traceName;
+    _traceName = nil;
+    
     pthread_mutex_unlock(&_stateMutex);
+    
+    [cancellationToken removeCancellationHandler:cancellationRegistration];
+    
+    if(traceName)
+        RKTraceEndSpan(kRKTraceCategoryPromise, traceName, self.traceIdentifier, (state == RKPromiseStateValue)? @"value" : @"error");
+    
+    //Subscribers are called back outside of the lock, as subscribers
+    //without a queue run synchronously and may subscribe to other promises.
+    if(then)
+        RKPromiseDeliver(self, state, contents, then, otherwise, queue);
+    
+    for (RKPromiseSubscriber *subscriber in additionalSubscribers)
+        RKPromiseDeliver(self, state, contents, subscriber.then, subscriber.otherwise, subscriber.queue);
+}
+
+- (void)accept:(id)value
+{
+    [self settleWithState:RKPromiseStateValue contents:value];
 }
 
 - (void)reject:(NSError *)error
 {
-    if(self.contents != nil)
-        @throw [NSException exceptionWithName:NSInternalInconsistencyException
-                                       reason:@"Cannot reject a promise more than once"
-                                     userInfo:nil];
+    [self settleWithState:RKPromiseStateError contents:error];
+}
+
+#pragma mark - Cancelling
+
+- (RKCancellationToken *)cancellationToken
+{
+    pthread_mutex_lock(&_stateMutex);
+    RKCancellationToken *cancellationToken = _cancellationToken;
+    pthread_mutex_unlock(&_stateMutex);
+    
+    return cancellationToken;
+}
+
+- (void)setCancellationToken:(RKCancellationToken *)cancellationToken
+{
+    pthread_mutex_lock(&_stateMutex);
+    
+    RKCancellationToken *oldCancellationToken = _cancellationToken;
+    id oldCancellationRegistration = _cancellationRegistration;
+    _cancellationRegistration = nil;
+    
+    BOOL canBeCancelled = (!self.cancelled && self.state == RKPromiseStateNotRealized);
+    _cancellationToken = canBeCancelled? cancellationToken : nil;
+    
+    pthread_mutex_unlock(&_stateMutex);
+    
+    [oldCancellationToken removeCancellationHandler:oldCancellationRegistration];
+    
+    if(!canBeCancelled || !cancellationToken)
+        return;
+    
+    //The handler is invoked immediately if the token is already cancelled,
+    //so it has to be added outside of the lock.
+    __weak RKPromise *weakSelf = self;
+    id cancellationRegistration = [cancellationToken addCancellationHandler:^{
+        [weakSelf cancel:nil];
+    }];
     
     pthread_mutex_lock(&_stateMutex);
-    {
-        self.contents = error;
-        self.state = RKPromiseStateError;
-        [self invoke];
+    
+    BOOL isCurrentToken = (_cancellationToken == cancellationToken && !self.cancelled && self.state == RKPromiseStateNotRealized);
+    if(isCurrentToken)
+        _cancellationRegistration = cancellationRegistration;
+    
+    pthread_mutex_unlock(&_stateMutex);
+    
+    if(!isCurrentToken)
+        [cancellationToken removeCancellationHandler:cancellationRegistration];
+}
+
+- (IBAction)cancel:(id)sender
+{
+    pthread_mutex_lock(&_stateMutex);
+    
+    //A settled promise has nothing left to stop, and marking it as cancelled
+    //would cause anything that subscribes to it afterwards to be dropped.
+    if(self.cancelled || self.state != RKPromiseStateNotRealized) {
+        pthread_mutex_unlock(&_stateMutex);
+        return;
     }
+    
+    self.cancelled = YES;
+    
+    //Subscribers of a cancelled promise are never called back, so they are
+    //released here to break any cycles between chained promises.
+    _thenBlock = nil;
+    _otherwiseBlock = nil;
+    _queue = nil;
+    _additionalSubscribers = nil;
+    
+    NSArray *cancellationWaiters = _cancellationWaiters;
+    _cancellationWaiters = nil;
+    
+    NSArray *dependencies = [_dependencies allObjects];
+    _dependencies = nil;
+    
+    RKCancellationToken *cancellationToken = _cancellationToken;
+    id cancellationRegistration = _cancellationRegistration;
+    _cancellationRegistration = nil;
+    
+    NSString *traceName = _traceName;
+    _traceName = nil;
+    
     pthread_mutex_unlock(&_stateMutex);
+    
+    [cancellationToken removeCancellationHandler:cancellationRegistration];
+    
+    if(traceName)
+        RKTraceEndSpan(kRKTraceCategoryPromise, traceName, self.traceIdentifier, @"cancelled");
+    
+    for (dispatch_block_t waiter in cancellationWaiters)
+        waiter();
+    
+    for (id <RKPromiseDependency> dependency in dependencies)
+        [dependency withdrawInterest];
 }
 
-#pragma mark - Realizing
+- (void)withdrawInterest
+{
+    pthread_mutex_lock(&_stateMutex);
+    
+    BOOL shouldCancel = NO;
+    if(!self.cancelled && self.state == RKPromiseStateNotRealized && _interestedSubscriberCount > 0) {
+        _interestedSubscriberCount--;
+        shouldCancel = (_interestedSubscriberCount == 0 && !_hasDirectSubscribers);
+    }
+    
+    pthread_mutex_unlock(&_stateMutex);
+    
+    if(shouldCancel)
+        [self cancel:nil];
+}
 
-- (void)invoke
+- (void)addDependency:(id <RKPromiseDependency>)dependency
 {
-    if(self.thenBlock && self.otherwiseBlock && self.queue) {
-        switch (self.state) {
-            case RKPromiseStateValue: {
-                [self.queue addOperationWithBlock:^{
-                    self.thenBlock(self.contents);
-                }];
-                
-                break;
-            }
-                
-            case RKPromiseStateError: {
-                [self.queue addOperationWithBlock:^{
-                    self.otherwiseBlock(self.contents);
-                }];
-                
-                break;
-            }
-                
-            case RKPromiseStateNotRealized: {
-                break;
-            }
-        }
+    NSParameterAssert(dependency);
+    
+    //Only the first promise depended on is recorded as the parent of the receiver's span.
+    uint64_t parentIdentifier = 0;
+    if(RKTraceIsEnabled() && [dependency isKindOfClass:[RKPromise class]])
+        parentIdentifier = [(RKPromise *)dependency traceIdentifier];
+    
+    pthread_mutex_lock(&_stateMutex);
+    
+    if(self.cancelled) {
+        pthread_mutex_unlock(&_stateMutex);
+        
+        [dependency withdrawInterest];
+        
+        return;
     }
+    
+    if(self.state == RKPromiseStateNotRealized) {
+        if(!_dependencies)
+            _dependencies = [NSPointerArray weakObjectsPointerArray];
+        
+        [_dependencies addPointer:(__bridge void *)dependency];
+        
+        if(_traceParentIdentifier == 0)
+            _traceParentIdentifier = parentIdentifier;
+    }
+    
+    pthread_mutex_unlock(&_stateMutex);
 }
 
-#pragma mark -
+#pragma mark - Realizing
 
 - (void)fire
 {
@@ -218,6 +780,59 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
 
 #pragma mark -
 
+- (void)addSubscriberWithThen:(RKPromiseThenBlock)then otherwise:(RKPromiseErrorBlock)otherwise queue:(NSOperationQueue *)queue
+{
+    pthread_mutex_lock(&_stateMutex);
+    
+    if(self.cancelled) {
+        pthread_mutex_unlock(&_stateMutex);
+        return;
+    }
+    
+    RKPromiseState state = self.state;
+    if(state != RKPromiseStateNotRealized) {
+        id contents = self.contents;
+        pthread_mutex_unlock(&_stateMutex);
+        
+        RKPromiseDeliver(self, state, contents, then, otherwise, queue);
+        
+        return;
+    }
+    
+    if(!_thenBlock) {
+        _thenBlock = [then copy];
+        _otherwiseBlock = [otherwise copy];
+        _queue = queue;
+    } else {
+        RKPromiseSubscriber *subscriber = [RKPromiseSubscriber new];
+        subscriber.then = then;
+        subscriber.otherwise = otherwise;
+        subscriber.queue = queue;
+        
+        if(!_additionalSubscribers)
+            _additionalSubscribers = [NSMutableArray new];
+        
+        [_additionalSubscribers addObject:subscriber];
+    }
+    
+    _interestedSubscriberCount++;
+    
+    BOOL shouldFire = !_hasFired;
+    _hasFired = YES;
+    
+    //The span of a promise covers the time anything has been waiting on it. It is begun
+    //inside of the lock so it cannot be ended by another thread before it is recorded.
+    if(shouldFire && RKTraceIsEnabled()) {
+        _traceName = [self.promiseName copy];
+        RKTraceBeginSpan(kRKTraceCategoryPromise, _traceName, self.traceIdentifier, _traceParentIdentifier, self.cacheIdentifier);
+    }
+    
+    pthread_mutex_unlock(&_stateMutex);
+    
+    if(shouldFire)
+        [self fire];
+}
+
 - (void)then:(RKPromiseThenBlock)then otherwise:(RKPromiseErrorBlock)otherwise
 {
     [self then:then otherwise:otherwise onQueue:[NSOperationQueue currentQueue]];
@@ -229,25 +844,88 @@ static NSString *RKPromiseStateGetString(RKPromiseState state)
     NSParameterAssert(otherwise);
     NSParameterAssert(queue);
     
-    if(self.thenBlock || self.otherwiseBlock) {
-        @throw [NSException exceptionWithName:NSInternalInconsistencyException
-                                       reason:@"Cannot realize a promise more than once"
-                                     userInfo:nil];
-    }
-    
     pthread_mutex_lock(&_stateMutex);
-    {
-        self.thenBlock = then;
-        self.otherwiseBlock = otherwise;
-        self.queue = queue;
-        
-        if(self.state != RKPromiseStateNotRealized) {
-            [self invoke];
-        } else {
-            [self fire];
-        }
-    }
+    _hasDirectSubscribers = YES;
     pthread_mutex_unlock(&_stateMutex);
+    
+    [self addSubscriberWithThen:then otherwise:otherwise queue:queue];
+}
+
+#pragma mark - Chaining
+
+///Settles a given promise with the eventual result of another promise,
+///making the destination depend on the source.
+static void RKPromiseForward(RKPromise *source, RKPromise *destination)
+{
+    [source addSubscriberWithThen:^(id value) {
+        [destination accept:value];
+    } otherwise:^(NSError *error) {
+        [destination reject:error];
+    } queue:nil];
+    
+    [destination addDependency:source];
+}
+
+- (RKPromise *)map:(RKPromiseMapBlock)mapper
+{
+    NSParameterAssert(mapper);
+    
+    RKPromise *result = [RKPromise new];
+    [result addDependency:self];
+    [self addSubscriberWithThen:^(id value) {
+        if(result.cancelled)
+            return;
+        
+        [result accept:mapper(value)];
+    } otherwise:^(NSError *error) {
+        [result reject:error];
+    } queue:nil];
+    
+    return result;
+}
+
+- (RKPromise *)flatMap:(RKPromiseFlatMapBlock)binder
+{
+    NSParameterAssert(binder);
+    
+    RKPromise *result = [RKPromise new];
+    [result addDependency:self];
+    [self addSubscriberWithThen:^(id value) {
+        if(result.cancelled)
+            return;
+        
+        RKPromise *continuation = binder(value);
+        if(continuation)
+            RKPromiseForward(continuation, result);
+        else
+            [result accept:nil];
+    } otherwise:^(NSError *error) {
+        [result reject:error];
+    } queue:nil];
+    
+    return result;
+}
+
+- (RKPromise *)recover:(RKPromiseRecoverBlock)recovery
+{
+    NSParameterAssert(recovery);
+    
+    RKPromise *result = [RKPromise new];
+    [result addDependency:self];
+    [self addSubscriberWithThen:^(id value) {
+        [result accept:value];
+    } otherwise:^(NSError *error) {
+        if(result.cancelled)
+            return;
+        
+        RKPromise *continuation = recovery(error);
+        if(continuation)
+            RKPromiseForward(continuation, result);
+        else
+            [result reject:error];
+    } queue:nil];
+    
+    return result;
 }
 
 #pragma mark -
@@ -288,17 +966,47 @@ static const char *kCurrentPromiseAssociatedObjectKey = "com.roundabout.rk.promi
 {
     __block id resultValue = nil;
     __block NSError *resultError = nil;
+    __block BOOL wasCancelled = NO;
     dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
-    [self then:^(id value) {
-        resultValue = value;
-        
-        dispatch_semaphore_signal(semaphore);
-    } otherwise:^(NSError *error) {
-        resultError = error;
+    
+    pthread_mutex_lock(&_stateMutex);
+    _hasDirectSubscribers = YES;
+    
+    //Subscribers of a cancelled promise are never called back, so waiting
+    //threads are woken separately when the receiver is cancelled.
+    if(self.cancelled) {
+        wasCancelled = YES;
+    } else if(self.state == RKPromiseStateNotRealized) {
+        if(!_cancellationWaiters)
+            _cancellationWaiters = [NSMutableArray new];
         
-        dispatch_semaphore_signal(semaphore);
-    } onQueue:[RKQueueManager queueNamed:@"com.roundabout.rk.RKPromise.await-queue"]];
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+        [_cancellationWaiters addObject:[^{
+            wasCancelled = YES;
+            
+            dispatch_semaphore_signal(semaphore);
+        } copy]];
+    }
+    pthread_mutex_unlock(&_stateMutex);
+    
+    if(!wasCancelled) {
+        [self addSubscriberWithThen:^(id value) {
+            resultValue = value;
+            
+            dispatch_semaphore_signal(semaphore);
+        } otherwise:^(NSError *error) {
+            resultError = error;
+            
+            dispatch_semaphore_signal(semaphore);
+        } queue:nil];
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    }
+    
+    if(wasCancelled) {
+        resultValue = nil;
+        resultError = [NSError errorWithDomain:RKPromiseErrorDomain
+                                          code:kRKPromiseErrorCancelled
+                                      userInfo:@{NSLocalizedDescriptionKey: @"The promise was cancelled."}];
+    }
     
     if(outError) *outError = resultError;
     
@@ -71,6 +71,25 @@ typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
 ///The authentication handler to use for requests.
 @property (RK_NONATOMIC_IOSONLY) id <RKURLRequestAuthenticationHandler> authenticationHandler;
 
+///The memory cache to keep the post-processed results of GET requests in. Optional.
+///
+/// \seealso(-[RKURLRequestPromise memoryCache])
+@property (RK_NONATOMIC_IOSONLY) RKMemoryCache *memoryCache;
+
+#pragma mark - Stale While Revalidate
+
+///Sets the maximum staleness of cache for GET requests whose path begins with a given prefix.
+///
+/// \param  maximumStaleness    The maximum staleness to use. Pass a negative value to remove the prefix.
+/// \param  pathPrefix          The path prefix to match against. Required.
+///
+///GET request promises dispensed for a matching path use the stale-while-revalidate
+///cache policy with the given maximum staleness. When multiple prefixes match a path,
+///the longest prefix is used. This has no effect if the receiver has no read cache manager.
+///
+/// \seealso(kRKURLRequestPromiseCachePolicyStaleWhileRevalidate)
+- (void)setMaximumStaleness:(NSTimeInterval)maximumStaleness forPathPrefix:(NSString *)pathPrefix;
+
 #pragma mark - Dispensing URLs
 
 ///Returns a new URL constructed from the receiver's base URL,
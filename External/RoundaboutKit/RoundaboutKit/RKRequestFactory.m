@@ -19,7 +19,9 @@
 
 @end
 
-@implementation RKRequestFactory
+@implementation RKRequestFactory {
+    NSMutableDictionary *_maximumStalenessByPathPrefix;
+}
 
 - (id)initWithBaseURL:(NSURL *)baseURL
      readCacheManager:(id <RKURLRequestPromiseCacheManager>)readCacheManager
@@ -36,11 +38,41 @@
         self.writeCacheManager = writeCacheManager;
         self.requestQueue = requestQueue;
         self.postProcessor = postProcessor;
+        
+        _maximumStalenessByPathPrefix = [NSMutableDictionary dictionary];
     }
     
     return self;
 }
 
+#pragma mark - Stale While Revalidate
+
+- (void)setMaximumStaleness:(NSTimeInterval)maximumStaleness forPathPrefix:(NSString *)pathPrefix
+{
+    NSParameterAssert(pathPrefix);
+    
+    @synchronized(_maximumStalenessByPathPrefix) {
+        if(maximumStaleness < 0.0)
+            [_maximumStalenessByPathPrefix removeObjectForKey:pathPrefix];
+        else
+            _maximumStalenessByPathPrefix[pathPrefix] = @(maximumStaleness);
+    }
+}
+
+///Returns the maximum staleness for the longest prefix matching a given path, or nil if there is none.
+- (NSNumber *)maximumStalenessForPath:(NSString *)path
+{
+    @synchronized(_maximumStalenessByPathPrefix) {
+        NSString *longestPrefix = nil;
+        for (NSString *pathPrefix in _maximumStalenessByPathPrefix) {
+            if([path hasPrefix:pathPrefix] && pathPrefix.length > longestPrefix.length)
+                longestPrefix = pathPrefix;
+        }
+        
+        return longestPrefix? _maximumStalenessByPathPrefix[longestPrefix] : nil;
+    }
+}
+
 #pragma mark - Dispensing URLs
 
 - (NSURL *)URLWithPath:(NSString *)path parameters:(NSDictionary *)parameters
@@ -134,6 +166,8 @@
                                                                           requestQueue:self.requestQueue];
     requestPromise.postProcessor = self.postProcessor;
     requestPromise.authenticationHandler = self.authenticationHandler;
+    if([request.HTTPMethod isEqualToString:@"GET"])
+        requestPromise.memoryCache = self.memoryCache;
     return requestPromise;
 }
 
@@ -141,7 +175,15 @@
 
 - (RKURLRequestPromise *)GETRequestPromiseWithPath:(NSString *)path parameters:(NSDictionary *)parameters
 {
-    return [self requestPromiseWithRequest:[self GETRequestWithPath:path parameters:parameters]];
+    RKURLRequestPromise *requestPromise = [self requestPromiseWithRequest:[self GETRequestWithPath:path parameters:parameters]];
+    
+    NSNumber *maximumStaleness = [self maximumStalenessForPath:path];
+    if(maximumStaleness) {
+        requestPromise.cachePolicy = kRKURLRequestPromiseCachePolicyStaleWhileRevalidate;
+        requestPromise.maximumStaleness = [maximumStaleness doubleValue];
+    }
+    
+    return requestPromise;
 }
 
 - (RKURLRequestPromise *)DELETERequestPromiseWithPath:(NSString *)path parameters:(NSDictionary *)parameters
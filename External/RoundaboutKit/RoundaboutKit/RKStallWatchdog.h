@@ -0,0 +1,134 @@
+//
+//  RKStallWatchdog.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKStallWatchdog_h
+#define RKStallWatchdog_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPrelude.h"
+
+#pragma mark - Compile Time Options
+
+///The stall threshold, in seconds, that new watchdogs use.
+#define kRKStallWatchdogDefaultThreshold        0.25
+
+///The maximum number of main thread frames captured for a stall.
+#define kRKStallWatchdogMaximumFrames           128
+
+///The maximum number of nested work labels tracked on the main thread.
+///Labels pushed past this depth are counted, but not recorded.
+#define kRKStallWatchdogMaximumLabelDepth       8
+
+///The size, in bytes, a stall log may grow to before it is rotated.
+#define kRKStallWatchdogLogFileSizeLimit        (512 * 1024)
+
+///The number of rotated stall logs kept, in addition to the current one.
+#define kRKStallWatchdogRotatedLogFileCount     3
+
+#pragma mark - Work Labels
+
+///The number of watchdogs running. Use `RKStallWatchdogIsActive()` to read this.
+RK_EXTERN volatile int32_t RKStallWatchdogRunningCount;
+
+///Returns whether or not any stall watchdog is running.
+RK_INLINE BOOL RKStallWatchdogIsActive()
+{
+    return (RKStallWatchdogRunningCount > 0);
+}
+
+///Pushes a label describing the work the main thread is about to perform.
+///
+///The labels on the main thread when a stall is detected are recorded with it,
+///and the innermost one is used to group the stall with others like it.
+///
+///Has no effect when called from a background thread. Every call on the main
+///thread must be balanced by a call to `RKStallWatchdogPopWorkLabel`.
+RK_EXTERN void RKStallWatchdogPushWorkLabel(NSString *label);
+
+///Pops the innermost work label on the main thread.
+RK_EXTERN void RKStallWatchdogPopWorkLabel();
+
+///Returns a block which runs a given block under a work label.
+///
+/// \param  label   The label to push while the block runs. Required.
+/// \param  block   The block to wrap. Required.
+///
+/// \result The wrapped block, or `block` itself if no watchdog is running.
+///
+///The label is only pushed if the block is run on the main thread.
+RK_EXTERN dispatch_block_t RKStallWatchdogWrapBlock(NSString *label, dispatch_block_t block);
+
+#pragma mark -
+
+///The RKStallWatchdog class watches the main run loop from a background thread,
+///and records a backtrace of the main thread whenever it stops responding.
+///
+///The watchdog periodically schedules a block on the main run loop. If the block has
+///not run within the watchdog's threshold, the main thread is briefly suspended so
+///its frames and work labels can be copied, and the stall is timed until the block runs.
+///
+///Each stall is appended to a rotating log, and folded into statistics which
+///rank the work responsible for the most time spent stalled. Stalls are grouped
+///by their innermost work label, or failing that, by the innermost frame in the
+///main executable.
+///
+///Backtraces are captured by walking frame pointers, and are only available
+///on Intel. Stalls are still detected and timed elsewhere.
+///
+///Every method on RKStallWatchdog is safe to call from multiple threads.
+@interface RKStallWatchdog : NSObject
+
+///Returns the shared watchdog, creating it if it does not already exist.
++ (instancetype)sharedWatchdog;
+
+#pragma mark - Properties
+
+///The length of time, in seconds, the main thread must be unresponsive for to be considered stalled.
+///
+///Stalls are measured from the first unanswered ping, so may be reported up to one threshold short.
+@property NSTimeInterval threshold;
+
+///The directory the stall log and summary are written to.
+///
+///The current log is named `Stalls.log`, and the summary `Stalls-Summary.plist`.
+///If nil, stalls are only recorded in memory. Set before calling `-start` to have
+///the statistics from previous runs loaded from the summary.
+@property (copy) NSURL *logDirectoryLocation;
+
+///Whether or not the receiver is watching the main thread.
+@property (readonly, getter=isRunning) BOOL running;
+
+#pragma mark - Controlling
+
+///Begins watching the main thread. Has no effect if the receiver is already running.
+- (void)start;
+
+///Stops watching the main thread. Has no effect if the receiver is not running.
+- (void)stop;
+
+#pragma mark - Statistics
+
+///Returns a property list compatible summary of the stalls the receiver has recorded.
+///
+///The summary has the keys `stallCount`, `totalDuration`, `maxDuration`, and `offenders`.
+///`offenders` is an array of dictionaries with the keys `signature`, `count`, `totalDuration`,
+///`maxDuration`, and `lastBacktrace`, sorted by `totalDuration` from worst to least bad.
+- (NSDictionary *)statistics;
+
+///Discards the receiver's statistics, and removes its summary from disk.
+- (void)resetStatistics;
+
+///Prints the receiver's worst offenders to stdout.
+///
+///This method is intended to be called from the debugger,
+///e.g. `po [[RKStallWatchdog sharedWatchdog] prettyPrintStatistics]`.
+- (void)prettyPrintStatistics;
+
+@end
+
+#endif /* RKStallWatchdog_h */
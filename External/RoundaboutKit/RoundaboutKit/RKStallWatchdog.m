@@ -0,0 +1,522 @@
+//
+//  RKStallWatchdog.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKStallWatchdog.h"
+#import <libkern/OSAtomic.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <mach-o/dyld.h>
+#import <dlfcn.h>
+#import <pthread.h>
+
+volatile int32_t RKStallWatchdogRunningCount = 0;
+
+#pragma mark - Work Labels
+
+///The size of a work label, including its terminator.
+#define kLabelLength    64
+
+///The work labels of the main thread, from outermost to innermost. Only written on the main thread.
+static char gWorkLabels[kRKStallWatchdogMaximumLabelDepth][kLabelLength];
+
+///The number of labels pushed on the main thread. May exceed `kRKStallWatchdogMaximumLabelDepth`.
+static volatile NSUInteger gWorkLabelDepth = 0;
+
+///Copies as much of a string as will fit into a buffer, always terminating it.
+static void CopyStringIntoBuffer(NSString *string, char *buffer, size_t bufferLength)
+{
+    NSUInteger usedLength = 0;
+    if(string) {
+        [string getBytes:buffer
+               maxLength:bufferLength - 1
+              usedLength:&usedLength
+                encoding:NSUTF8StringEncoding
+                 options:NSStringEncodingConversionAllowLossy
+                   range:NSMakeRange(0, string.length)
+          remainingRange:NULL];
+    }
+
+    buffer[usedLength] = '\0';
+}
+
+void RKStallWatchdogPushWorkLabel(NSString *label)
+{
+    if(!pthread_main_np())
+        return;
+
+    NSUInteger depth = gWorkLabelDepth;
+    if(depth < kRKStallWatchdogMaximumLabelDepth)
+        CopyStringIntoBuffer(label, gWorkLabels[depth], kLabelLength);
+
+    //The label must be complete before the watchdog can see it.
+    OSMemoryBarrier();
+    gWorkLabelDepth = depth + 1;
+}
+
+void RKStallWatchdogPopWorkLabel()
+{
+    if(!pthread_main_np())
+        return;
+
+    if(gWorkLabelDepth > 0)
+        gWorkLabelDepth--;
+}
+
+dispatch_block_t RKStallWatchdogWrapBlock(NSString *label, dispatch_block_t block)
+{
+    NSCParameterAssert(block);
+
+    if(!RKStallWatchdogIsActive())
+        return block;
+
+    NSString *labelCopy = [label copy];
+    return ^{
+        RKStallWatchdogPushWorkLabel(labelCopy);
+        block();
+        RKStallWatchdogPopWorkLabel();
+    };
+}
+
+#pragma mark - Capturing
+
+///The RKStallSnapshot type encapsulates the state of the main thread at the moment a stall is detected.
+typedef struct RKStallSnapshot {
+    ///The return addresses of the main thread, from innermost to outermost.
+    uintptr_t frames[kRKStallWatchdogMaximumFrames];
+    NSUInteger frameCount;
+
+    ///The work labels of the main thread, from outermost to innermost.
+    char labels[kRKStallWatchdogMaximumLabelDepth][kLabelLength];
+    NSUInteger labelDepth;
+} RKStallSnapshot;
+
+///Walks the frame pointers of a suspended thread, copying its return addresses into a buffer.
+///
+///This function is called while the main thread is suspended, so it must not
+///allocate memory, take locks, or message objects: the main thread may hold them.
+static NSUInteger CaptureFramesOfThread(thread_t thread, uintptr_t *frames, NSUInteger maximumFrames)
+{
+#if defined(__x86_64__)
+    x86_thread_state64_t state;
+    mach_msg_type_number_t stateCount = x86_THREAD_STATE64_COUNT;
+    if(thread_get_state(thread, x86_THREAD_STATE64, (thread_state_t)&state, &stateCount) != KERN_SUCCESS)
+        return 0;
+
+    uintptr_t programCounter = (uintptr_t)state.__rip;
+    uintptr_t framePointer = (uintptr_t)state.__rbp;
+#elif defined(__i386__)
+    x86_thread_state32_t state;
+    mach_msg_type_number_t stateCount = x86_THREAD_STATE32_COUNT;
+    if(thread_get_state(thread, x86_THREAD_STATE32, (thread_state_t)&state, &stateCount) != KERN_SUCCESS)
+        return 0;
+
+    uintptr_t programCounter = (uintptr_t)state.__eip;
+    uintptr_t framePointer = (uintptr_t)state.__ebp;
+#else
+    return 0;
+#endif /* defined(__x86_64__) */
+
+#if defined(__x86_64__) || defined(__i386__)
+    NSUInteger frameCount = 0;
+    frames[frameCount++] = programCounter;
+
+    while (framePointer != 0 && frameCount < maximumFrames) {
+        //Each frame begins with the caller's frame pointer, followed by the return address.
+        uintptr_t frame[2];
+        vm_size_t bytesRead = 0;
+        if(vm_read_overwrite(mach_task_self(), (vm_address_t)framePointer, sizeof(frame), (vm_address_t)frame, &bytesRead) != KERN_SUCCESS ||
+           bytesRead != sizeof(frame))
+            break;
+
+        if(frame[1] == 0)
+            break;
+
+        frames[frameCount++] = frame[1];
+
+        //Stacks grow down, so a caller's frame that isn't above this one is garbage.
+        if(frame[0] <= framePointer)
+            break;
+
+        framePointer = frame[0];
+    }
+
+    return frameCount;
+#endif /* defined(__x86_64__) || defined(__i386__) */
+}
+
+///Suspends the main thread, and copies its frames and work labels into a snapshot.
+static void CaptureMainThreadSnapshot(thread_t mainThread, RKStallSnapshot *snapshot)
+{
+    snapshot->frameCount = 0;
+    snapshot->labelDepth = 0;
+
+    if(thread_suspend(mainThread) != KERN_SUCCESS)
+        return;
+
+    snapshot->frameCount = CaptureFramesOfThread(mainThread, snapshot->frames, kRKStallWatchdogMaximumFrames);
+
+    snapshot->labelDepth = MIN(gWorkLabelDepth, (NSUInteger)kRKStallWatchdogMaximumLabelDepth);
+    memcpy(snapshot->labels, gWorkLabels, sizeof(gWorkLabels));
+
+    thread_resume(mainThread);
+}
+
+#pragma mark - Symbolicating
+
+///Looks up the image and symbol containing a frame.
+///
+///Return addresses point just past the call instruction, which may be the
+///first instruction of the next function, so all but the innermost frame
+///are looked up one byte earlier.
+static BOOL LookUpFrame(uintptr_t frame, NSUInteger index, Dl_info *outInfo)
+{
+    uintptr_t address = (index > 0)? frame - 1 : frame;
+    return dladdr((const void *)address, outInfo) != 0;
+}
+
+///Returns a crash report style description of a frame.
+static NSString *DescriptionOfFrame(uintptr_t frame, NSUInteger index)
+{
+    Dl_info info;
+    if(!LookUpFrame(frame, index, &info))
+        return [NSString stringWithFormat:@"%-4lu %-32s 0x%016lx", (unsigned long)index, "???", (unsigned long)frame];
+
+    const char *imageName = "???";
+    if(info.dli_fname) {
+        const char *lastSlash = strrchr(info.dli_fname, '/');
+        imageName = lastSlash? lastSlash + 1 : info.dli_fname;
+    }
+
+    if(info.dli_sname) {
+        return [NSString stringWithFormat:@"%-4lu %-32s 0x%016lx %s + %lu",
+                (unsigned long)index, imageName, (unsigned long)frame, info.dli_sname, (unsigned long)(frame - (uintptr_t)info.dli_saddr)];
+    } else {
+        return [NSString stringWithFormat:@"%-4lu %-32s 0x%016lx 0x%lx + %lu",
+                (unsigned long)index, imageName, (unsigned long)frame, (unsigned long)info.dli_fbase, (unsigned long)(frame - (uintptr_t)info.dli_fbase)];
+    }
+}
+
+///Returns the symbol of the innermost frame in the main executable,
+///or the innermost symbolicated frame if there is none, or nil.
+static NSString *SignatureOfFrames(const uintptr_t *frames, NSUInteger frameCount)
+{
+    const void *mainExecutable = _dyld_get_image_header(0);
+
+    NSString *innermostSymbol = nil;
+    for (NSUInteger index = 0; index < frameCount; index++) {
+        Dl_info info;
+        if(!LookUpFrame(frames[index], index, &info) || !info.dli_sname)
+            continue;
+
+        if(info.dli_fbase == mainExecutable)
+            return @(info.dli_sname);
+
+        if(!innermostSymbol)
+            innermostSymbol = @(info.dli_sname);
+    }
+
+    return innermostSymbol;
+}
+
+#pragma mark -
+
+@implementation RKStallWatchdog {
+    ///Incremented each time the watchdog is started, so a stale watchdog thread knows to exit.
+    volatile int32_t _generation;
+
+    ///The sequence number of the most recent ping answered by the main thread.
+    volatile int64_t _lastAnsweredPing;
+
+    //The following are only accessed while synchronized on self.
+    BOOL _isRunning;
+    NSUInteger _stallCount;
+    NSTimeInterval _totalDuration;
+    NSTimeInterval _maximumDuration;
+    NSMutableDictionary *_offenders;
+}
+
++ (instancetype)sharedWatchdog
+{
+    static RKStallWatchdog *sharedWatchdog = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedWatchdog = [self new];
+    });
+
+    return sharedWatchdog;
+}
+
+- (id)init
+{
+    if((self = [super init])) {
+        self.threshold = kRKStallWatchdogDefaultThreshold;
+
+        _offenders = [NSMutableDictionary new];
+    }
+
+    return self;
+}
+
+#pragma mark - Controlling
+
+- (BOOL)isRunning
+{
+    @synchronized(self) {
+        return _isRunning;
+    }
+}
+
+- (void)start
+{
+    int32_t generation;
+    @synchronized(self) {
+        if(_isRunning)
+            return;
+
+        _isRunning = YES;
+        generation = OSAtomicIncrement32Barrier(&_generation);
+
+        if(_stallCount == 0)
+            [self loadSummary];
+    }
+
+    OSAtomicIncrement32Barrier(&RKStallWatchdogRunningCount);
+
+    NSThread *watchdogThread = [[NSThread alloc] initWithTarget:self selector:@selector(watchMainThreadForGeneration:) object:@(generation)];
+    [watchdogThread setName:@"com.roundabout.rk.stallwatchdog"];
+    [watchdogThread start];
+}
+
+- (void)stop
+{
+    @synchronized(self) {
+        if(!_isRunning)
+            return;
+
+        _isRunning = NO;
+        OSAtomicIncrement32Barrier(&_generation);
+    }
+
+    OSAtomicDecrement32Barrier(&RKStallWatchdogRunningCount);
+}
+
+#pragma mark - Watching
+
+- (void)watchMainThreadForGeneration:(NSNumber *)generationNumber
+{
+    int32_t generation = [generationNumber intValue];
+    thread_t mainThread = pthread_mach_thread_np(pthread_main_thread_np());
+    CFRunLoopRef mainRunLoop = CFRunLoopGetMain();
+
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double secondsPerTick = ((double)timebase.numer / (double)timebase.denom) / NSEC_PER_SEC;
+
+    int64_t ping = 0;
+    while (_generation == generation) {
+        @autoreleasepool {
+            ping++;
+
+            int64_t pingToAnswer = ping;
+            CFRunLoopPerformBlock(mainRunLoop, kCFRunLoopCommonModes, ^{
+                self->_lastAnsweredPing = pingToAnswer;
+            });
+            CFRunLoopWakeUp(mainRunLoop);
+
+            uint64_t pingTime = mach_absolute_time();
+            [NSThread sleepForTimeInterval:self.threshold];
+
+            if(_lastAnsweredPing >= ping || _generation != generation)
+                continue;
+
+            RKStallSnapshot snapshot;
+            CaptureMainThreadSnapshot(mainThread, &snapshot);
+
+            //The stall is timed until the main thread catches up, even if the watchdog is stopped meanwhile.
+            while (_lastAnsweredPing < ping)
+                [NSThread sleepForTimeInterval:0.01];
+
+            NSTimeInterval duration = (mach_absolute_time() - pingTime) * secondsPerTick;
+            [self recordStallWithDuration:duration snapshot:&snapshot];
+        }
+    }
+}
+
+#pragma mark - Recording
+
+///Records a stall into the receiver's statistics, log, and summary.
+- (void)recordStallWithDuration:(NSTimeInterval)duration snapshot:(const RKStallSnapshot *)snapshot
+{
+    NSMutableArray *labels = [NSMutableArray array];
+    for (NSUInteger index = 0; index < snapshot->labelDepth; index++)
+        [labels addObject:@(snapshot->labels[index])];
+
+    NSMutableArray *backtrace = [NSMutableArray array];
+    for (NSUInteger index = 0; index < snapshot->frameCount; index++)
+        [backtrace addObject:DescriptionOfFrame(snapshot->frames[index], index)];
+
+    NSString *signature = [labels lastObject] ?: SignatureOfFrames(snapshot->frames, snapshot->frameCount) ?: @"<unknown>";
+
+    NSDictionary *summary;
+    @synchronized(self) {
+        _stallCount++;
+        _totalDuration += duration;
+        _maximumDuration = MAX(_maximumDuration, duration);
+
+        NSMutableDictionary *offender = _offenders[signature];
+        if(!offender) {
+            offender = [@{@"signature": signature, @"count": @0, @"totalDuration": @0.0, @"maxDuration": @0.0} mutableCopy];
+            _offenders[signature] = offender;
+        }
+
+        offender[@"count"] = @([offender[@"count"] unsignedIntegerValue] + 1);
+        offender[@"totalDuration"] = @([offender[@"totalDuration"] doubleValue] + duration);
+        offender[@"maxDuration"] = @(MAX([offender[@"maxDuration"] doubleValue], duration));
+        offender[@"lastBacktrace"] = backtrace;
+
+        summary = [self statistics];
+    }
+
+    NSURL *logDirectoryLocation = self.logDirectoryLocation;
+    if(!logDirectoryLocation)
+        return;
+
+    NSMutableString *entry = [NSMutableString string];
+    [entry appendFormat:@"--- Stall of %.3fs at %@ ---\n", duration, [NSDate date]];
+    [entry appendFormat:@"Signature: %@\n", signature];
+    if(labels.count > 0)
+        [entry appendFormat:@"Work: %@\n", [labels componentsJoinedByString:@" > "]];
+    [entry appendString:@"Backtrace:\n"];
+    for (NSString *frame in backtrace)
+        [entry appendFormat:@"%@\n", frame];
+    [entry appendString:@"\n"];
+
+    [self appendLogEntry:entry inDirectory:logDirectoryLocation];
+
+    NSError *error = nil;
+    NSData *summaryData = [NSPropertyListSerialization dataWithPropertyList:summary format:NSPropertyListXMLFormat_v1_0 options:0 error:&error];
+    if(!summaryData || ![summaryData writeToURL:[logDirectoryLocation URLByAppendingPathComponent:@"Stalls-Summary.plist"] options:NSDataWritingAtomic error:&error])
+        NSLog(@"*** Warning, could not write stall summary. %@", error);
+}
+
+///Appends an entry to the stall log in a given directory, rotating the log first if it has grown too large.
+- (void)appendLogEntry:(NSString *)entry inDirectory:(NSURL *)logDirectoryLocation
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    NSError *error = nil;
+    if(![fileManager createDirectoryAtURL:logDirectoryLocation withIntermediateDirectories:YES attributes:nil error:&error]) {
+        NSLog(@"*** Warning, could not create stall log directory. %@", error);
+        return;
+    }
+
+    NSURL *logLocation = [logDirectoryLocation URLByAppendingPathComponent:@"Stalls.log"];
+    NSDictionary *attributes = [fileManager attributesOfItemAtPath:[logLocation path] error:NULL];
+    if(attributes && [attributes fileSize] >= kRKStallWatchdogLogFileSizeLimit) {
+        //Stalls.log becomes Stalls.1.log, Stalls.1.log becomes Stalls.2.log, and so on.
+        NSURL *(^rotatedLogLocation)(NSUInteger) = ^NSURL *(NSUInteger number) {
+            return [logDirectoryLocation URLByAppendingPathComponent:[NSString stringWithFormat:@"Stalls.%lu.log", (unsigned long)number]];
+        };
+
+        [fileManager removeItemAtURL:rotatedLogLocation(kRKStallWatchdogRotatedLogFileCount) error:NULL];
+        for (NSUInteger number = kRKStallWatchdogRotatedLogFileCount - 1; number > 0; number--)
+            [fileManager moveItemAtURL:rotatedLogLocation(number) toURL:rotatedLogLocation(number + 1) error:NULL];
+
+        [fileManager moveItemAtURL:logLocation toURL:rotatedLogLocation(1) error:NULL];
+    }
+
+    if(![fileManager fileExistsAtPath:[logLocation path]])
+        [fileManager createFileAtPath:[logLocation path] contents:nil attributes:nil];
+
+    NSFileHandle *logHandle = [NSFileHandle fileHandleForWritingToURL:logLocation error:&error];
+    if(!logHandle) {
+        NSLog(@"*** Warning, could not open stall log. %@", error);
+        return;
+    }
+
+    [logHandle seekToEndOfFile];
+    [logHandle writeData:[entry dataUsingEncoding:NSUTF8StringEncoding]];
+    [logHandle closeFile];
+}
+
+///Loads the statistics of previous runs from the summary. Must be called while synchronized on self.
+- (void)loadSummary
+{
+    NSURL *logDirectoryLocation = self.logDirectoryLocation;
+    if(!logDirectoryLocation)
+        return;
+
+    NSData *summaryData = [NSData dataWithContentsOfURL:[logDirectoryLocation URLByAppendingPathComponent:@"Stalls-Summary.plist"]];
+    if(!summaryData)
+        return;
+
+    NSDictionary *summary = [NSPropertyListSerialization propertyListWithData:summaryData options:0 format:NULL error:NULL];
+    if(![summary isKindOfClass:[NSDictionary class]])
+        return;
+
+    _stallCount = [summary[@"stallCount"] unsignedIntegerValue];
+    _totalDuration = [summary[@"totalDuration"] doubleValue];
+    _maximumDuration = [summary[@"maxDuration"] doubleValue];
+
+    for (NSDictionary *offender in summary[@"offenders"]) {
+        NSString *signature = offender[@"signature"];
+        if(signature)
+            _offenders[signature] = [offender mutableCopy];
+    }
+}
+
+#pragma mark - Statistics
+
+- (NSDictionary *)statistics
+{
+    @synchronized(self) {
+        NSMutableArray *offenders = [NSMutableArray array];
+        for (NSDictionary *offender in [_offenders allValues])
+            [offenders addObject:[offender copy]];
+
+        [offenders sortUsingDescriptors:@[ [NSSortDescriptor sortDescriptorWithKey:@"totalDuration" ascending:NO] ]];
+
+        return @{@"stallCount": @(_stallCount),
+                 @"totalDuration": @(_totalDuration),
+                 @"maxDuration": @(_maximumDuration),
+                 @"offenders": offenders};
+    }
+}
+
+- (void)resetStatistics
+{
+    @synchronized(self) {
+        _stallCount = 0;
+        _totalDuration = 0.0;
+        _maximumDuration = 0.0;
+        [_offenders removeAllObjects];
+    }
+
+    NSURL *logDirectoryLocation = self.logDirectoryLocation;
+    if(logDirectoryLocation)
+        [[NSFileManager defaultManager] removeItemAtURL:[logDirectoryLocation URLByAppendingPathComponent:@"Stalls-Summary.plist"] error:NULL];
+}
+
+- (void)prettyPrintStatistics
+{
+    NSDictionary *statistics = [self statistics];
+    NSArray *offenders = statistics[@"offenders"];
+    puts([[NSString stringWithFormat:@"-- begin %@ stalls, %.3fs total, %.3fs max --", statistics[@"stallCount"], [statistics[@"totalDuration"] doubleValue], [statistics[@"maxDuration"] doubleValue]] UTF8String]);
+    putc('\n', stdout);
+
+    [offenders enumerateObjectsUsingBlock:^(NSDictionary *offender, NSUInteger index, BOOL *stop) {
+        puts([[NSString stringWithFormat:@"%lu. %@", (unsigned long)(index + 1), offender[@"signature"]] UTF8String]);
+        puts([[NSString stringWithFormat:@"\t%@ stalls, %.3fs total, %.3fs max",
+               offender[@"count"], [offender[@"totalDuration"] doubleValue], [offender[@"maxDuration"] doubleValue]] UTF8String]);
+        putc('\n', stdout);
+    }];
+
+    puts([[NSString stringWithFormat:@"-- end %@ stalls --", statistics[@"stallCount"]] UTF8String]);
+}
+
+@end
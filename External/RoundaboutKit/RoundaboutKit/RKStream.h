@@ -0,0 +1,113 @@
+//
+//  RKStream.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKStream_h
+#define RKStream_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPrelude.h"
+
+@class RKPromise, RKCancellationToken;
+
+///The demand to pass to `-[RKStream requestElements:]` to have every element delivered.
+RK_EXTERN NSUInteger const kRKStreamUnboundedDemand;
+
+///The default value of `RKStream.bufferCapacity`.
+RK_EXTERN NSUInteger const kRKStreamDefaultBufferCapacity;
+
+///A block which produces the next batch of elements of a stream.
+///
+/// \param  batchIndex  The number of batches which have been produced so far.
+///
+/// \result A promise for an array of elements. An empty array ends the stream, as does
+///         returning nil. Rejecting the promise ends the stream with its error.
+typedef RKPromise *(^RKStreamProducerBlock)(NSUInteger batchIndex);
+
+///A block which is invoked for each element of a stream.
+typedef void(^RKStreamElementBlock)(id element);
+
+///A block which is invoked when a stream ends.
+///
+/// \param  error   The error the stream ended with, or nil if it ended normally.
+typedef void(^RKStreamCompletionBlock)(NSError *error);
+
+///The RKStream class encapsulates an asynchronous sequence of elements which are produced in batches.
+///
+///A stream is cold: nothing is produced until it is subscribed to. Batches are produced one at a
+///time, and only while fewer than `bufferCapacity` elements are waiting to be delivered, so a slow
+///subscriber holds back the producer instead of accumulating an unbounded backlog.
+///
+///Elements are delivered one at a time, in order, and only as they are requested through
+///`-[self requestElements:]`. The next element is not delivered until the subscriber's block
+///for the previous element has returned, even if the delivery queue is concurrent.
+///
+///Cancelling a stream cancels the promise for the batch being produced, discards any buffered
+///elements, and prevents its subscriber from being called back again.
+///
+///RKStream is safe to use from multiple threads.
+@interface RKStream : NSObject
+
+///Initialize the receiver with a producer block.
+///
+/// \param  producer    The block to invoke to produce each batch of elements. Required.
+///
+/// \result A fully initialized stream.
+///
+///The producer is never invoked concurrently with itself. This is the designated initializer.
+- (instancetype)initWithProducer:(RKStreamProducerBlock)producer;
+
+#pragma mark - Properties
+
+///The maximum number of undelivered elements the receiver will buffer before it stops producing.
+///
+///A batch is produced whenever fewer elements than this are buffered, so the buffer may briefly
+///hold up to one batch more than this number. Defaults to `kRKStreamDefaultBufferCapacity`.
+@property NSUInteger bufferCapacity;
+
+///Whether or not the receiver has produced its last batch.
+@property (readonly, getter=isExhausted) BOOL exhausted;
+
+///Whether or not the receiver has been cancelled.
+@property (readonly) BOOL cancelled;
+
+///The token whose cancellation cancels the receiver. Held weakly.
+@property (weak) RKCancellationToken *cancellationToken;
+
+#pragma mark - Subscribing
+
+///Subscribes to the receiver.
+///
+/// \param  element     The block to invoke for each element. Required.
+/// \param  completion  The block to invoke when the receiver ends. Optional.
+/// \param  queue       The queue to invoke the blocks on. Required.
+///
+///A stream may only be subscribed to once. No elements are delivered
+///until they are requested through `-[self requestElements:]`.
+- (void)subscribeWithElement:(RKStreamElementBlock)element completion:(RKStreamCompletionBlock)completion onQueue:(NSOperationQueue *)queue;
+
+///Requests that a number of additional elements be delivered to the receiver's subscriber.
+///
+/// \param  count   The number of elements to deliver, or `kRKStreamUnboundedDemand`.
+- (void)requestElements:(NSUInteger)count;
+
+///Cancels the receiver. Cancelling a stream more than once has no effect.
+- (IBAction)cancel:(id)sender;
+
+#pragma mark - Collecting
+
+///Returns a promise for every element of the receiver.
+///
+/// \result A promise that will yield an array of the receiver's elements, or the
+///         error the receiver ended with. Cancelling the promise cancels the receiver.
+///
+///This method subscribes to the receiver with an unbounded demand.
+- (RKPromise *)allElements RK_REQUIRE_RESULT_USED;
+
+@end
+
+#endif /* RKStream_h */
@@ -0,0 +1,344 @@
+//
+//  RKStream.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKStream.h"
+#import "RKPromise.h"
+#import "RKCancellationToken.h"
+
+NSUInteger const kRKStreamUnboundedDemand = NSUIntegerMax;
+NSUInteger const kRKStreamDefaultBufferCapacity = 100;
+
+///The RKStreamElementsPromise class encapsulates the result of `-[RKStream allElements]`.
+@interface RKStreamElementsPromise : RKPromise
+
+///The stream to cancel when the promise is cancelled.
+@property (weak) RKStream *stream;
+
+@end
+
+@implementation RKStreamElementsPromise
+
+- (void)cancel:(id)sender
+{
+    [self.stream cancel:sender];
+
+    [super cancel:sender];
+}
+
+@end
+
+#pragma mark -
+
+@interface RKStream ()
+
+///Readwrite.
+@property (readwrite, getter=isExhausted) BOOL exhausted;
+
+///Readwrite.
+@property (readwrite) BOOL cancelled;
+
+@end
+
+@implementation RKStream {
+    BOOL _isSubscribed;
+    __weak RKCancellationToken *_cancellationToken;
+    id _cancellationRegistration;
+
+    //The following are only accessed from the state queue.
+    NSOperationQueue *_stateQueue;
+
+    RKStreamProducerBlock _producer;
+    NSUInteger _batchIndex;
+    RKPromise *_pendingBatch;
+
+    RKStreamElementBlock _elementHandler;
+    RKStreamCompletionBlock _completionHandler;
+    NSOperationQueue *_deliveryQueue;
+
+    NSMutableArray *_buffer;
+    NSUInteger _demand;
+    BOOL _isDelivering;
+    BOOL _hasFailed;
+    NSError *_error;
+    BOOL _hasCompleted;
+}
+
+- (void)dealloc
+{
+    [_cancellationToken removeCancellationHandler:_cancellationRegistration];
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+- (instancetype)initWithProducer:(RKStreamProducerBlock)producer
+{
+    NSParameterAssert(producer);
+
+    if((self = [super init])) {
+        _producer = [producer copy];
+        _bufferCapacity = kRKStreamDefaultBufferCapacity;
+
+        _stateQueue = [NSOperationQueue new];
+        _stateQueue.name = @"com.roundabout.rk.stream.stateQueue";
+        _stateQueue.maxConcurrentOperationCount = 1;
+
+        _buffer = [NSMutableArray new];
+    }
+
+    return self;
+}
+
+#pragma mark - Cancelling
+
+- (RKCancellationToken *)cancellationToken
+{
+    @synchronized(self) {
+        return _cancellationToken;
+    }
+}
+
+- (void)setCancellationToken:(RKCancellationToken *)cancellationToken
+{
+    RKCancellationToken *oldCancellationToken = nil;
+    id oldCancellationRegistration = nil;
+    @synchronized(self) {
+        oldCancellationToken = _cancellationToken;
+        oldCancellationRegistration = _cancellationRegistration;
+
+        _cancellationToken = cancellationToken;
+        _cancellationRegistration = nil;
+    }
+
+    [oldCancellationToken removeCancellationHandler:oldCancellationRegistration];
+
+    if(!cancellationToken)
+        return;
+
+    __weak RKStream *weakSelf = self;
+    id cancellationRegistration = [cancellationToken addCancellationHandler:^{
+        [weakSelf cancel:nil];
+    }];
+
+    @synchronized(self) {
+        if(_cancellationToken == cancellationToken && !self.cancelled) {
+            _cancellationRegistration = cancellationRegistration;
+            cancellationRegistration = nil;
+        }
+    }
+
+    [cancellationToken removeCancellationHandler:cancellationRegistration];
+}
+
+///Unregisters the receiver from its cancellation token, as it no longer has any work to cancel.
+- (void)removeCancellationRegistration
+{
+    RKCancellationToken *cancellationToken = nil;
+    id cancellationRegistration = nil;
+    @synchronized(self) {
+        cancellationToken = _cancellationToken;
+        cancellationRegistration = _cancellationRegistration;
+        _cancellationRegistration = nil;
+    }
+
+    [cancellationToken removeCancellationHandler:cancellationRegistration];
+}
+
+- (IBAction)cancel:(id)sender
+{
+    @synchronized(self) {
+        if(self.cancelled)
+            return;
+
+        self.cancelled = YES;
+    }
+
+    [self removeCancellationRegistration];
+
+    [_stateQueue addOperationWithBlock:^{
+        [_pendingBatch cancel:nil];
+        _pendingBatch = nil;
+
+        [_buffer removeAllObjects];
+
+        [self releaseBlocks];
+    }];
+}
+
+#pragma mark - Subscribing
+
+- (void)subscribeWithElement:(RKStreamElementBlock)element completion:(RKStreamCompletionBlock)completion onQueue:(NSOperationQueue *)queue
+{
+    NSParameterAssert(element);
+    NSParameterAssert(queue);
+
+    @synchronized(self) {
+        if(_isSubscribed)
+            @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                           reason:@"Cannot subscribe to a stream more than once"
+                                         userInfo:nil];
+
+        _isSubscribed = YES;
+    }
+
+    [_stateQueue addOperationWithBlock:^{
+        if(self.cancelled)
+            return;
+
+        _elementHandler = [element copy];
+        _completionHandler = [completion copy];
+        _deliveryQueue = queue;
+
+        [self pump];
+    }];
+}
+
+- (void)requestElements:(NSUInteger)count
+{
+    [_stateQueue addOperationWithBlock:^{
+        if(count > kRKStreamUnboundedDemand - _demand)
+            _demand = kRKStreamUnboundedDemand;
+        else if(_demand != kRKStreamUnboundedDemand)
+            _demand += count;
+
+        [self pump];
+    }];
+}
+
+#pragma mark - Pumping
+
+///Releases the blocks of the receiver, which are frequently the owners of the receiver.
+///
+///Must be called on the state queue.
+- (void)releaseBlocks
+{
+    _producer = nil;
+    _elementHandler = nil;
+    _completionHandler = nil;
+    _deliveryQueue = nil;
+}
+
+///Delivers the next element, completes the receiver, or produces the next batch, as needed.
+///
+///Must be called on the state queue.
+- (void)pump
+{
+    if(self.cancelled || _hasCompleted || !_elementHandler)
+        return;
+
+    if(_isDelivering)
+        return;
+
+    if(_demand > 0 && _buffer.count > 0) {
+        id element = _buffer[0];
+        [_buffer removeObjectAtIndex:0];
+
+        if(_demand != kRKStreamUnboundedDemand)
+            _demand--;
+
+        _isDelivering = YES;
+
+        RKStreamElementBlock elementHandler = _elementHandler;
+        [_deliveryQueue addOperationWithBlock:^{
+            if(!self.cancelled)
+                elementHandler(element);
+
+            [_stateQueue addOperationWithBlock:^{
+                _isDelivering = NO;
+                [self pump];
+            }];
+        }];
+    } else if(_buffer.count == 0 && (self.exhausted || _hasFailed)) {
+        _hasCompleted = YES;
+
+        RKStreamCompletionBlock completionHandler = _completionHandler;
+        NSError *error = _error;
+        if(completionHandler) {
+            [_deliveryQueue addOperationWithBlock:^{
+                if(!self.cancelled)
+                    completionHandler(error);
+            }];
+        }
+
+        [self releaseBlocks];
+        [self removeCancellationRegistration];
+
+        return;
+    }
+
+    if(!_pendingBatch && !self.exhausted && !_hasFailed && _buffer.count < self.bufferCapacity)
+        [self produceBatch];
+}
+
+///Produces the next batch of elements.
+///
+///Must be called on the state queue.
+- (void)produceBatch
+{
+    RKPromise *batch = _producer(_batchIndex);
+    if(!batch) {
+        self.exhausted = YES;
+        [self pump];
+
+        return;
+    }
+
+    _batchIndex++;
+    _pendingBatch = batch;
+
+    [batch then:^(NSArray *elements) {
+        if(batch != _pendingBatch)
+            return;
+
+        _pendingBatch = nil;
+
+        if(elements.count == 0)
+            self.exhausted = YES;
+        else
+            [_buffer addObjectsFromArray:elements];
+
+        [self pump];
+    } otherwise:^(NSError *error) {
+        if(batch != _pendingBatch)
+            return;
+
+        _pendingBatch = nil;
+
+        //Elements which were already produced are still delivered before the error.
+        _hasFailed = YES;
+        _error = error;
+
+        [self pump];
+    } onQueue:_stateQueue];
+}
+
+#pragma mark - Collecting
+
+- (RKPromise *)allElements
+{
+    RKStreamElementsPromise *result = [RKStreamElementsPromise new];
+    result.stream = self;
+
+    NSMutableArray *elements = [NSMutableArray array];
+    [self subscribeWithElement:^(id element) {
+        [elements addObject:element];
+    } completion:^(NSError *error) {
+        if(error)
+            [result reject:error];
+        else
+            [result accept:elements];
+    } onQueue:_stateQueue];
+    [self requestElements:kRKStreamUnboundedDemand];
+
+    return result;
+}
+
+@end
@@ -0,0 +1,137 @@
+//
+//  RKTrace.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKTrace_h
+#define RKTrace_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPrelude.h"
+
+///RKTrace records spans of work into a fixed size ring buffer which can be exported
+///in the Chrome `trace_event` format, and inspected in `chrome://tracing` as a flame chart.
+///
+///Three kinds of events are recorded:
+///
+/// -   Asynchronous spans, which may begin and end on different threads. RKPromise
+///     records one for each promise it is waiting on, linked to the promises it depends on.
+/// -   Slices, which begin and end on the same thread, and nest like a call stack.
+/// -   Hops, which link the point a block is enqueued to the slice which later runs it.
+///     RKExecutor and RKPromise record a hop for every block they run on a queue.
+///
+///Tracing is disabled by default. When disabled, each hook costs a single branch.
+///When enabled, recording an event takes no locks. The oldest events are overwritten
+///once the buffer is full, so a trace always covers the most recent activity.
+///
+///All functions in RKTrace are safe to call from multiple threads.
+
+#pragma mark - Compile Time Options
+
+///Set to 0 to compile out every tracing hook in RoundaboutKit.
+#define RKTrace_Option_Available    1
+
+///The number of events the trace buffer holds before it begins overwriting the oldest.
+#define kRKTraceBufferCapacity      16384
+
+#pragma mark - Categories
+
+///The category of the spans recorded for promises.
+RK_EXTERN const char *const kRKTraceCategoryPromise;
+
+///The category of the spans recorded for network requests.
+RK_EXTERN const char *const kRKTraceCategoryRequest;
+
+///The category of the slices and hops recorded for queues.
+RK_EXTERN const char *const kRKTraceCategoryQueue;
+
+#pragma mark - Enabling
+
+///Whether or not tracing is enabled. Use `RKTraceIsEnabled()` to read this.
+RK_EXTERN volatile BOOL RKTraceEnabledFlag;
+
+///Returns whether or not events are being recorded.
+RK_INLINE BOOL RKTraceIsEnabled()
+{
+#if RKTrace_Option_Available
+    return RKTraceEnabledFlag;
+#else
+    return NO;
+#endif /* RKTrace_Option_Available */
+}
+
+///Sets whether or not events are recorded.
+///
+///The trace buffer is allocated the first time tracing is enabled.
+///Disabling tracing keeps the events recorded so far.
+RK_EXTERN void RKTraceSetEnabled(BOOL enabled);
+
+///Discards every recorded event.
+RK_EXTERN void RKTraceReset();
+
+#pragma mark - Recording
+
+///Returns a new identifier for an asynchronous span. Never returns 0.
+RK_EXTERN uint64_t RKTraceMakeIdentifier();
+
+///Records the beginning of an asynchronous span.
+///
+/// \param  category    The category of the span. Must be a string constant. Required.
+/// \param  name        The name of the span. Truncated to 63 bytes. Required.
+/// \param  identifier  The identifier of the span, from `RKTraceMakeIdentifier()`.
+/// \param  parent      The identifier of the span this span was started on behalf of, or 0.
+/// \param  detail      A label further describing the span, e.g. a cache identifier.
+///                     Truncated to 127 bytes. Optional.
+RK_EXTERN void RKTraceBeginSpan(const char *category, NSString *name, uint64_t identifier, uint64_t parent, NSString *detail);
+
+///Records the end of an asynchronous span.
+///
+/// \param  category    The category the span was begun with. Required.
+/// \param  name        The name the span was begun with. Required.
+/// \param  identifier  The identifier the span was begun with.
+/// \param  outcome     A label describing how the span ended, e.g. `@"error"`. Optional.
+///
+///Ends are recorded even if tracing was disabled after the span began, so spans stay balanced.
+RK_EXTERN void RKTraceEndSpan(const char *category, NSString *name, uint64_t identifier, NSString *outcome);
+
+///Records the beginning of a slice on the calling thread.
+///
+///Every call must be balanced by a call to `RKTraceEndSlice` on the same thread.
+RK_EXTERN void RKTraceBeginSlice(const char *category, NSString *name);
+
+///Records the end of the innermost slice on the calling thread. Recorded even if tracing was disabled.
+RK_EXTERN void RKTraceEndSlice(const char *category, NSString *name);
+
+///Returns a block which records a slice around a given block, and
+///records a hop from the calling thread to the thread which runs it.
+///
+/// \param  category    The category of the slice. Required.
+/// \param  name        The name of the slice, typically the name of the queue. Required.
+/// \param  block       The block to wrap. Required.
+///
+/// \result The wrapped block, or `block` itself if tracing is disabled.
+///
+///The hop is recorded when this function is called, so it should be
+///called at the point the block is handed off to a queue.
+RK_EXTERN dispatch_block_t RKTraceWrapBlock(const char *category, NSString *name, dispatch_block_t block);
+
+#pragma mark - Exporting
+
+///Returns the recorded events in the Chrome `trace_event` JSON format.
+///
+///Events are copied out of the buffer without stopping recording.
+///Spans whose beginning has been overwritten are exported without it.
+RK_EXTERN NSData *RKTraceCopyChromeTraceData();
+
+///Writes the recorded events to a location in the Chrome `trace_event` JSON format.
+///
+/// \param  location    The file to write to. Required.
+/// \param  outError    On return, contains an error if the trace could not be written.
+///
+/// \result YES if the trace was written; NO otherwise.
+RK_EXTERN BOOL RKTraceWriteChromeTrace(NSURL *location, NSError **outError);
+
+#endif /* RKTrace_h */
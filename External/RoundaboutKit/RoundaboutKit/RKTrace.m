@@ -0,0 +1,310 @@
+//
+//  RKTrace.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKTrace.h"
+#import <libkern/OSAtomic.h>
+#import <mach/mach_time.h>
+#import <pthread.h>
+#import <unistd.h>
+
+const char *const kRKTraceCategoryPromise = "promise";
+const char *const kRKTraceCategoryRequest = "request";
+const char *const kRKTraceCategoryQueue = "queue";
+
+volatile BOOL RKTraceEnabledFlag = NO;
+
+#pragma mark - Buffer
+
+///The size of the name of an event, including its terminator.
+#define kNameLength     64
+
+///The size of the detail of an event, including its terminator.
+#define kDetailLength   128
+
+///The RKTraceEvent type encapsulates a single event in the trace buffer.
+typedef struct RKTraceEvent {
+    ///The position of the event in the sequence of recorded events, starting at 1.
+    ///
+    ///Set to 0 while the event is being written, so readers can detect torn events.
+    volatile int64_t sequence;
+
+    ///The Chrome `trace_event` phase of the event.
+    char phase;
+
+    ///The `mach_absolute_time` the event was recorded at.
+    uint64_t timestamp;
+
+    ///The mach port of the thread the event was recorded on.
+    uint64_t threadID;
+
+    ///The span or hop identifier of the event, or 0.
+    uint64_t identifier;
+
+    ///The identifier of the parent of a span, or 0.
+    uint64_t parent;
+
+    ///The category of the event. Always a string constant.
+    const char *category;
+
+    char name[kNameLength];
+    char detail[kDetailLength];
+} RKTraceEvent;
+
+///The trace buffer. Allocated the first time tracing is enabled, and never freed.
+static RKTraceEvent *volatile gEvents = NULL;
+
+///The sequence number of the most recently claimed event.
+static volatile int64_t gLastSequence = 0;
+
+///The sequence number of the last event discarded by `RKTraceReset()`.
+static volatile int64_t gResetSequence = 0;
+
+///The last identifier handed out by `RKTraceMakeIdentifier()`.
+static volatile int64_t gLastIdentifier = 0;
+
+///The mach port of the main thread, once an event has been recorded on it.
+static volatile uint64_t gMainThreadID = 0;
+
+///Copies as much of a string as will fit into a buffer, always terminating it.
+static void CopyStringIntoBuffer(NSString *string, char *buffer, size_t bufferLength)
+{
+    NSUInteger usedLength = 0;
+    if(string) {
+        [string getBytes:buffer
+               maxLength:bufferLength - 1
+              usedLength:&usedLength
+                encoding:NSUTF8StringEncoding
+                 options:NSStringEncodingConversionAllowLossy
+                   range:NSMakeRange(0, string.length)
+          remainingRange:NULL];
+    }
+
+    buffer[usedLength] = '\0';
+}
+
+///Records an event into the trace buffer, if it has been allocated.
+///
+///A slot is claimed with a single atomic increment. The slot's sequence number is
+///cleared while it is written and published afterwards, so a reader copying the slot
+///concurrently sees a mismatched sequence number and skips it instead of locking.
+static void RKTraceRecord(char phase, const char *category, NSString *name, uint64_t identifier, uint64_t parent, NSString *detail)
+{
+    RKTraceEvent *events = gEvents;
+    if(!events)
+        return;
+
+    int64_t sequence = OSAtomicIncrement64Barrier(&gLastSequence);
+    RKTraceEvent *event = &events[(sequence - 1) % kRKTraceBufferCapacity];
+
+    event->sequence = 0;
+    OSMemoryBarrier();
+
+    uint64_t threadID = pthread_mach_thread_np(pthread_self());
+    if(gMainThreadID == 0 && pthread_main_np())
+        gMainThreadID = threadID;
+
+    event->phase = phase;
+    event->timestamp = mach_absolute_time();
+    event->threadID = threadID;
+    event->identifier = identifier;
+    event->parent = parent;
+    event->category = category;
+    CopyStringIntoBuffer(name, event->name, kNameLength);
+    CopyStringIntoBuffer(detail, event->detail, kDetailLength);
+
+    OSMemoryBarrier();
+    event->sequence = sequence;
+}
+
+#pragma mark - Enabling
+
+void RKTraceSetEnabled(BOOL enabled)
+{
+    static dispatch_once_t onceToken;
+    if(enabled) {
+        dispatch_once(&onceToken, ^{
+            gEvents = calloc(kRKTraceBufferCapacity, sizeof(RKTraceEvent));
+            OSMemoryBarrier();
+        });
+    }
+
+    RKTraceEnabledFlag = enabled;
+}
+
+void RKTraceReset()
+{
+    //Events are never erased, readers just ignore everything up to this point.
+    gResetSequence = gLastSequence;
+    OSMemoryBarrier();
+}
+
+#pragma mark - Recording
+
+uint64_t RKTraceMakeIdentifier()
+{
+    return (uint64_t)OSAtomicIncrement64(&gLastIdentifier);
+}
+
+void RKTraceBeginSpan(const char *category, NSString *name, uint64_t identifier, uint64_t parent, NSString *detail)
+{
+    if(!RKTraceIsEnabled())
+        return;
+
+    RKTraceRecord('b', category, name, identifier, parent, detail);
+}
+
+void RKTraceEndSpan(const char *category, NSString *name, uint64_t identifier, NSString *outcome)
+{
+    //Ends are recorded even if tracing has since been disabled, so spans stay balanced.
+    RKTraceRecord('e', category, name, identifier, 0, outcome);
+}
+
+void RKTraceBeginSlice(const char *category, NSString *name)
+{
+    if(!RKTraceIsEnabled())
+        return;
+
+    RKTraceRecord('B', category, name, 0, 0, nil);
+}
+
+void RKTraceEndSlice(const char *category, NSString *name)
+{
+    RKTraceRecord('E', category, name, 0, 0, nil);
+}
+
+dispatch_block_t RKTraceWrapBlock(const char *category, NSString *name, dispatch_block_t block)
+{
+    NSCParameterAssert(block);
+
+    if(!RKTraceIsEnabled())
+        return block;
+
+    uint64_t hop = RKTraceMakeIdentifier();
+    RKTraceRecord('s', category, name, hop, 0, nil);
+
+    return ^{
+        RKTraceRecord('B', category, name, 0, 0, nil);
+        RKTraceRecord('f', category, name, hop, 0, nil);
+
+        block();
+
+        RKTraceRecord('E', category, name, 0, 0, nil);
+    };
+}
+
+#pragma mark - Exporting
+
+///Returns a hexadecimal string for an identifier, the form Chrome expects for ids.
+static NSString *StringFromIdentifier(uint64_t identifier)
+{
+    return [NSString stringWithFormat:@"0x%llx", identifier];
+}
+
+///Returns the Chrome `trace_event` dictionary for an event.
+static NSDictionary *DictionaryFromEvent(const RKTraceEvent *event, double microsecondsPerTick, int processID)
+{
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    dictionary[@"ph"] = [NSString stringWithFormat:@"%c", event->phase];
+    dictionary[@"name"] = @(event->name);
+    dictionary[@"cat"] = @(event->category);
+    dictionary[@"ts"] = @(event->timestamp * microsecondsPerTick);
+    dictionary[@"pid"] = @(processID);
+    dictionary[@"tid"] = @(event->threadID);
+
+    switch (event->phase) {
+        case 'b': {
+            dictionary[@"id"] = StringFromIdentifier(event->identifier);
+
+            NSMutableDictionary *args = [NSMutableDictionary dictionary];
+            if(event->parent != 0)
+                args[@"parent"] = StringFromIdentifier(event->parent);
+            if(event->detail[0] != '\0')
+                args[@"detail"] = @(event->detail);
+            dictionary[@"args"] = args;
+
+            break;
+        }
+
+        case 'e': {
+            dictionary[@"id"] = StringFromIdentifier(event->identifier);
+            if(event->detail[0] != '\0')
+                dictionary[@"args"] = @{@"outcome": @(event->detail)};
+
+            break;
+        }
+
+        case 's': {
+            dictionary[@"id"] = StringFromIdentifier(event->identifier);
+
+            break;
+        }
+
+        case 'f': {
+            dictionary[@"id"] = StringFromIdentifier(event->identifier);
+
+            //Binds the end of the hop to the slice that encloses it.
+            dictionary[@"bp"] = @"e";
+
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+
+    return dictionary;
+}
+
+NSData *RKTraceCopyChromeTraceData()
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double microsecondsPerTick = ((double)timebase.numer / (double)timebase.denom) / 1000.0;
+
+    int processID = getpid();
+
+    NSMutableArray *traceEvents = [NSMutableArray array];
+
+    RKTraceEvent *events = gEvents;
+    if(events) {
+        int64_t lastSequence = gLastSequence;
+        int64_t firstSequence = MAX(gResetSequence, lastSequence - kRKTraceBufferCapacity) + 1;
+        for (int64_t sequence = firstSequence; sequence <= lastSequence; sequence++) {
+            RKTraceEvent *slot = &events[(sequence - 1) % kRKTraceBufferCapacity];
+
+            RKTraceEvent event;
+            int64_t sequenceBeforeCopy = slot->sequence;
+            OSMemoryBarrier();
+            memcpy(&event, (const void *)slot, sizeof(RKTraceEvent));
+            OSMemoryBarrier();
+            int64_t sequenceAfterCopy = slot->sequence;
+
+            //The event was being written, or has been overwritten by a newer one.
+            if(sequenceBeforeCopy != sequence || sequenceAfterCopy != sequence)
+                continue;
+
+            [traceEvents addObject:DictionaryFromEvent(&event, microsecondsPerTick, processID)];
+        }
+    }
+
+    [traceEvents addObject:@{@"ph": @"M", @"name": @"process_name", @"pid": @(processID), @"args": @{@"name": [[NSProcessInfo processInfo] processName]}}];
+    if(gMainThreadID != 0)
+        [traceEvents addObject:@{@"ph": @"M", @"name": @"thread_name", @"pid": @(processID), @"tid": @(gMainThreadID), @"args": @{@"name": @"Main Thread"}}];
+
+    NSDictionary *trace = @{@"traceEvents": traceEvents, @"displayTimeUnit": @"ms"};
+    return [NSJSONSerialization dataWithJSONObject:trace options:0 error:NULL];
+}
+
+BOOL RKTraceWriteChromeTrace(NSURL *location, NSError **outError)
+{
+    NSCParameterAssert(location);
+
+    NSData *traceData = RKTraceCopyChromeTraceData();
+    return [traceData writeToURL:location options:NSDataWritingAtomic error:outError];
+}
@@ -0,0 +1,140 @@
+//
+//  RKURLRequestMetrics.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/23/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKURLRequestMetrics_h
+#define RKURLRequestMetrics_h 1
+
+#import <Foundation/Foundation.h>
+
+///The different ways a request can be satisfied in relation to its cache.
+typedef NS_ENUM(NSUInteger, RKURLRequestCacheOutcome) {
+    ///The request had no cache manager.
+    kRKURLRequestCacheOutcomeNone = 0,
+
+    ///The request was satisfied by the network, and its cache was missing or out of date.
+    kRKURLRequestCacheOutcomeMiss,
+
+    ///The request was satisfied by its cache without consulting the network.
+    kRKURLRequestCacheOutcomeHit,
+
+    ///The request was satisfied by its cache after the server reported it was unchanged.
+    kRKURLRequestCacheOutcomeRevalidated,
+
+    ///The request was satisfied by its cache because there was no internet connection.
+    kRKURLRequestCacheOutcomeOfflineServed,
+};
+
+#pragma mark -
+
+///The RKURLRequestMetricsRecord class encapsulates the measurements of a single request.
+///
+///All durations are in seconds. A duration is negative if the corresponding
+///event never occurred, e.g. time to first byte for a request served offline.
+@interface RKURLRequestMetricsRecord : NSObject
+
+///The host the request was sent to.
+@property (copy) NSString *host;
+
+///The name of the promise that made the request.
+@property (copy) NSString *promiseName;
+
+///The HTTP method of the request.
+@property (copy) NSString *HTTPMethod;
+
+#pragma mark -
+
+///The time the request spent waiting for its request queue.
+@property NSTimeInterval queueWait;
+
+///The time between the request starting and its response arriving.
+@property NSTimeInterval timeToFirstByte;
+
+///The time between the request being fired and it completing.
+@property NSTimeInterval duration;
+
+#pragma mark -
+
+///The number of body bytes sent.
+@property unsigned long long bytesOut;
+
+///The number of body bytes received.
+@property unsigned long long bytesIn;
+
+#pragma mark -
+
+///How the cache was involved in satisfying the request.
+@property RKURLRequestCacheOutcome cacheOutcome;
+
+///Whether or not the request failed.
+@property BOOL failed;
+
+@end
+
+#pragma mark -
+
+///The RKURLRequestMetrics class collects and aggregates RKURLRequestMetricsRecord
+///objects produced by RKURLRequestPromise instances.
+///
+///Records are aggregated into rolling histograms keyed by host and by promise name.
+///Histograms cover a sliding window, older measurements age out as time progresses.
+///
+///Metrics collection is disabled by default. When disabled, RKURLRequestPromise
+///does not take any measurements, and the cost is a single branch per request.
+///
+///All methods on this class are thread-safe.
+@interface RKURLRequestMetrics : NSObject
+
+///Returns the shared metrics object, creating it if it does not already exist.
++ (instancetype)sharedMetrics;
+
+#pragma mark - Properties
+
+///Whether or not metrics are being collected by RKURLRequestPromise. Defaults to NO.
+@property (nonatomic) BOOL enabled;
+
+///The length of time measurements are retained for. Defaults to one hour.
+@property (readonly) NSTimeInterval window;
+
+#pragma mark - Recording
+
+///Adds a given record to the receiver's histograms.
+///
+/// \param  record  The record to add. Required.
+///
+///This method does not block, aggregation is performed asynchronously.
+- (void)addRecord:(RKURLRequestMetricsRecord *)record;
+
+///Removes all recorded measurements from the receiver.
+- (void)reset;
+
+#pragma mark - Snapshots
+
+///Returns a property list compatible snapshot of the receiver's current histograms.
+///
+///The snapshot has the top level keys `window`, `hosts`, and `promiseNames`. The values of `hosts` and
+///`promiseNames` are dictionaries of series. Each series contains `count`, `failures`, `bytesIn`, `bytesOut`,
+///a `cache` dictionary of outcome counts, and `queueWait`, `timeToFirstByte`, and `duration` histograms.
+///Each histogram contains `count`, `p50`, `p90`, `p99`, `max` in milliseconds, and its raw `buckets`.
+- (NSDictionary *)snapshot;
+
+///Returns a JSON representation of `-[RKURLRequestMetrics snapshot]`.
+///
+/// \param  outError    out NSError.
+///
+/// \result A JSON data object, or nil if the snapshot could not be serialized.
+- (NSData *)JSONSnapshot:(NSError **)outError;
+
+@end
+
+///Returns whether or not the shared metrics object is collecting metrics.
+///
+///This function is cheaper than going through the shared instance, and is
+///used by RKURLRequestPromise to avoid measuring anything when disabled.
+RK_EXTERN BOOL RKURLRequestMetricsIsEnabled();
+
+#endif /* RKURLRequestMetrics_h */
@@ -0,0 +1,343 @@
+//
+//  RKURLRequestMetrics.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 7/23/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKURLRequestMetrics.h"
+
+///The number of buckets in a histogram. Bucket 0 holds values under 1 ms,
+///bucket N holds values in [2^(N-1), 2^N) ms, the last bucket is open ended.
+#define kBucketCount        24
+
+///The number of time slices that make up the rolling window.
+#define kSliceCount         6
+
+///The number of distinct cache outcomes.
+#define kCacheOutcomeCount  (kRKURLRequestCacheOutcomeOfflineServed + 1)
+
+///The length of a single time slice.
+static NSTimeInterval const kSliceDuration = (10.0 * RK_TIME_MINUTE);
+
+static BOOL gMetricsEnabled = NO;
+
+BOOL RKURLRequestMetricsIsEnabled()
+{
+    return gMetricsEnabled;
+}
+
+#pragma mark - Histograms
+
+typedef struct RKMetricsHistogram {
+    uint32_t buckets[kBucketCount];
+    uint32_t count;
+    double maximum;
+} RKMetricsHistogram;
+
+RK_INLINE void RKMetricsHistogramAdd(RKMetricsHistogram *histogram, NSTimeInterval seconds)
+{
+    if(seconds < 0.0)
+        return;
+
+    double milliseconds = seconds * 1000.0;
+    NSUInteger bucket = 0;
+    if(milliseconds >= 1.0)
+        bucket = MIN((NSUInteger)floor(log2(milliseconds)) + 1, kBucketCount - 1);
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->maximum = MAX(histogram->maximum, milliseconds);
+}
+
+RK_INLINE void RKMetricsHistogramMerge(RKMetricsHistogram *destination, const RKMetricsHistogram *source)
+{
+    for (NSUInteger index = 0; index < kBucketCount; index++)
+        destination->buckets[index] += source->buckets[index];
+
+    destination->count += source->count;
+    destination->maximum = MAX(destination->maximum, source->maximum);
+}
+
+///Returns the upper bound in milliseconds of the bucket containing a given percentile.
+static double RKMetricsHistogramGetPercentile(const RKMetricsHistogram *histogram, double percentile)
+{
+    if(histogram->count == 0)
+        return 0.0;
+
+    uint32_t threshold = (uint32_t)ceil(histogram->count * percentile);
+    uint32_t seen = 0;
+    for (NSUInteger index = 0; index < kBucketCount; index++) {
+        seen += histogram->buckets[index];
+        if(seen >= threshold)
+            return MIN(ldexp(1.0, (int)index), histogram->maximum);
+    }
+
+    return histogram->maximum;
+}
+
+static NSDictionary *RKMetricsHistogramCopyDictionary(const RKMetricsHistogram *histogram)
+{
+    NSMutableArray *buckets = [NSMutableArray arrayWithCapacity:kBucketCount];
+    for (NSUInteger index = 0; index < kBucketCount; index++)
+        [buckets addObject:@(histogram->buckets[index])];
+
+    return @{
+        @"count": @(histogram->count),
+        @"p50": @(RKMetricsHistogramGetPercentile(histogram, 0.50)),
+        @"p90": @(RKMetricsHistogramGetPercentile(histogram, 0.90)),
+        @"p99": @(RKMetricsHistogramGetPercentile(histogram, 0.99)),
+        @"max": @(histogram->maximum),
+        @"buckets": buckets,
+    };
+}
+
+#pragma mark - Slices
+
+typedef struct RKMetricsSlice {
+    long number;
+
+    uint32_t count;
+    uint32_t failures;
+    unsigned long long bytesIn;
+    unsigned long long bytesOut;
+    uint32_t cacheOutcomes[kCacheOutcomeCount];
+
+    RKMetricsHistogram queueWait;
+    RKMetricsHistogram timeToFirstByte;
+    RKMetricsHistogram duration;
+} RKMetricsSlice;
+
+#pragma mark -
+
+@implementation RKURLRequestMetricsRecord
+
+- (id)init
+{
+    if((self = [super init])) {
+        self.queueWait = -1.0;
+        self.timeToFirstByte = -1.0;
+        self.duration = -1.0;
+    }
+
+    return self;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %@ %@ (%@) wait %.1f ms, ttfb %.1f ms, total %.1f ms, %llu bytes in, %llu bytes out, cache outcome %ld%@>",
+            NSStringFromClass([self class]), self,
+            self.HTTPMethod, self.host, self.promiseName,
+            self.queueWait * 1000.0, self.timeToFirstByte * 1000.0, self.duration * 1000.0,
+            self.bytesIn, self.bytesOut, (long)self.cacheOutcome,
+            self.failed? @", failed" : @""];
+}
+
+@end
+
+#pragma mark -
+
+///The RKURLRequestMetricsSeries class encapsulates the rolling measurements for a single key.
+@interface RKURLRequestMetricsSeries : NSObject
+
+- (void)addRecord:(RKURLRequestMetricsRecord *)record inSlice:(long)sliceNumber;
+
+- (NSDictionary *)dictionaryForSlicesAfter:(long)oldestSliceNumber;
+
+@end
+
+@implementation RKURLRequestMetricsSeries {
+    RKMetricsSlice _slices[kSliceCount];
+}
+
+- (void)addRecord:(RKURLRequestMetricsRecord *)record inSlice:(long)sliceNumber
+{
+    RKMetricsSlice *slice = &_slices[sliceNumber % kSliceCount];
+    if(slice->number != sliceNumber) {
+        memset(slice, 0, sizeof(*slice));
+        slice->number = sliceNumber;
+    }
+
+    slice->count++;
+    if(record.failed)
+        slice->failures++;
+
+    slice->bytesIn += record.bytesIn;
+    slice->bytesOut += record.bytesOut;
+    slice->cacheOutcomes[MIN(record.cacheOutcome, kCacheOutcomeCount - 1)]++;
+
+    RKMetricsHistogramAdd(&slice->queueWait, record.queueWait);
+    RKMetricsHistogramAdd(&slice->timeToFirstByte, record.timeToFirstByte);
+    RKMetricsHistogramAdd(&slice->duration, record.duration);
+}
+
+- (NSDictionary *)dictionaryForSlicesAfter:(long)oldestSliceNumber
+{
+    RKMetricsSlice total;
+    memset(&total, 0, sizeof(total));
+
+    for (NSUInteger index = 0; index < kSliceCount; index++) {
+        const RKMetricsSlice *slice = &_slices[index];
+        if(slice->count == 0 || slice->number <= oldestSliceNumber)
+            continue;
+
+        total.count += slice->count;
+        total.failures += slice->failures;
+        total.bytesIn += slice->bytesIn;
+        total.bytesOut += slice->bytesOut;
+        for (NSUInteger outcome = 0; outcome < kCacheOutcomeCount; outcome++)
+            total.cacheOutcomes[outcome] += slice->cacheOutcomes[outcome];
+
+        RKMetricsHistogramMerge(&total.queueWait, &slice->queueWait);
+        RKMetricsHistogramMerge(&total.timeToFirstByte, &slice->timeToFirstByte);
+        RKMetricsHistogramMerge(&total.duration, &slice->duration);
+    }
+
+    if(total.count == 0)
+        return nil;
+
+    return @{
+        @"count": @(total.count),
+        @"failures": @(total.failures),
+        @"bytesIn": @(total.bytesIn),
+        @"bytesOut": @(total.bytesOut),
+        @"cache": @{
+            @"none": @(total.cacheOutcomes[kRKURLRequestCacheOutcomeNone]),
+            @"miss": @(total.cacheOutcomes[kRKURLRequestCacheOutcomeMiss]),
+            @"hit": @(total.cacheOutcomes[kRKURLRequestCacheOutcomeHit]),
+            @"revalidated": @(total.cacheOutcomes[kRKURLRequestCacheOutcomeRevalidated]),
+            @"offline": @(total.cacheOutcomes[kRKURLRequestCacheOutcomeOfflineServed]),
+        },
+        @"queueWait": RKMetricsHistogramCopyDictionary(&total.queueWait),
+        @"timeToFirstByte": RKMetricsHistogramCopyDictionary(&total.timeToFirstByte),
+        @"duration": RKMetricsHistogramCopyDictionary(&total.duration),
+    };
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKURLRequestMetrics {
+    dispatch_queue_t _aggregationQueue;
+
+    NSMutableDictionary *_seriesByHost;
+    NSMutableDictionary *_seriesByPromiseName;
+}
+
++ (instancetype)sharedMetrics
+{
+    static RKURLRequestMetrics *sharedMetrics = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedMetrics = [self new];
+    });
+
+    return sharedMetrics;
+}
+
+- (id)init
+{
+    if((self = [super init])) {
+        _aggregationQueue = dispatch_queue_create("com.roundabout.rk.RKURLRequestMetrics.aggregationQueue", DISPATCH_QUEUE_SERIAL);
+
+        _seriesByHost = [NSMutableDictionary dictionary];
+        _seriesByPromiseName = [NSMutableDictionary dictionary];
+    }
+
+    return self;
+}
+
+#pragma mark - Properties
+
+- (void)setEnabled:(BOOL)enabled
+{
+    if(self == [RKURLRequestMetrics sharedMetrics])
+        gMetricsEnabled = enabled;
+
+    _enabled = enabled;
+}
+
+- (NSTimeInterval)window
+{
+    return kSliceDuration * kSliceCount;
+}
+
+#pragma mark - Recording
+
+RK_INLINE long CurrentSliceNumber()
+{
+    return (long)floor([NSDate timeIntervalSinceReferenceDate] / kSliceDuration);
+}
+
+- (void)addRecord:(RKURLRequestMetricsRecord *)record
+{
+    NSParameterAssert(record);
+
+    long sliceNumber = CurrentSliceNumber();
+    dispatch_async(_aggregationQueue, ^{
+        NSString *host = record.host ?: @"<unknown>";
+        RKURLRequestMetricsSeries *hostSeries = _seriesByHost[host];
+        if(!hostSeries) {
+            hostSeries = [RKURLRequestMetricsSeries new];
+            _seriesByHost[host] = hostSeries;
+        }
+        [hostSeries addRecord:record inSlice:sliceNumber];
+
+        NSString *promiseName = record.promiseName ?: @"<anonymous>";
+        RKURLRequestMetricsSeries *promiseNameSeries = _seriesByPromiseName[promiseName];
+        if(!promiseNameSeries) {
+            promiseNameSeries = [RKURLRequestMetricsSeries new];
+            _seriesByPromiseName[promiseName] = promiseNameSeries;
+        }
+        [promiseNameSeries addRecord:record inSlice:sliceNumber];
+    });
+}
+
+- (void)reset
+{
+    dispatch_async(_aggregationQueue, ^{
+        [_seriesByHost removeAllObjects];
+        [_seriesByPromiseName removeAllObjects];
+    });
+}
+
+#pragma mark - Snapshots
+
+- (NSDictionary *)snapshot
+{
+    long oldestSliceNumber = CurrentSliceNumber() - kSliceCount;
+
+    __block NSDictionary *snapshot = nil;
+    dispatch_sync(_aggregationQueue, ^{
+        NSMutableDictionary *hosts = [NSMutableDictionary dictionary];
+        [_seriesByHost enumerateKeysAndObjectsUsingBlock:^(NSString *host, RKURLRequestMetricsSeries *series, BOOL *stop) {
+            NSDictionary *seriesDictionary = [series dictionaryForSlicesAfter:oldestSliceNumber];
+            if(seriesDictionary)
+                hosts[host] = seriesDictionary;
+        }];
+
+        NSMutableDictionary *promiseNames = [NSMutableDictionary dictionary];
+        [_seriesByPromiseName enumerateKeysAndObjectsUsingBlock:^(NSString *promiseName, RKURLRequestMetricsSeries *series, BOOL *stop) {
+            NSDictionary *seriesDictionary = [series dictionaryForSlicesAfter:oldestSliceNumber];
+            if(seriesDictionary)
+                promiseNames[promiseName] = seriesDictionary;
+        }];
+
+        snapshot = @{
+            @"window": @(self.window),
+            @"hosts": hosts,
+            @"promiseNames": promiseNames,
+        };
+    });
+
+    return snapshot;
+}
+
+- (NSData *)JSONSnapshot:(NSError **)outError
+{
+    return [NSJSONSerialization dataWithJSONObject:[self snapshot] options:NSJSONWritingPrettyPrinted error:outError];
+}
+
+@end
@@ -11,7 +11,7 @@
 
 #import "RKPromise.h"
 
-@class RKPossibility;
+@class RKPossibility, RKMemoryCache;
 
 ///The error domain used by RKURLRequestPromise.
 RK_EXTERN NSString *const RKURLRequestPromiseErrorDomain;
@@ -34,6 +34,34 @@ NS_ENUM(NSInteger, RKURLRequestPromiseErrors) {
 ///
 typedef void(^RKURLRequestPromiseCacheLoadingBlock)(RKPossibility *maybeData);
 
+///The callback block type expected in `-[RKURLRequestPromise setRevalidationHandler:callbackQueue:]`.
+///
+/// \param  maybeValue  The post-processed result of the background revalidation. Required.
+///
+typedef void(^RKURLRequestPromiseRevalidationBlock)(RKPossibility *maybeValue);
+
+///The different cache policies an RKURLRequestPromise can use.
+typedef NS_ENUM(NSUInteger, RKURLRequestPromiseCachePolicy) {
+    ///The cache is only used when offline, or when the server reports it is unchanged.
+    ///
+    ///This is the default cache policy.
+    kRKURLRequestPromiseCachePolicyDefault = 0,
+    
+    ///The cache is yielded immediately if it is not older than the request promise's
+    ///`.maximumStaleness`, and the request is then revalidated in the background.
+    ///If the remote data differs from the cache, the request promise's revalidation
+    ///handler is invoked with the new data.
+    ///
+    ///If there is no usable cache, this policy behaves like the default policy.
+    kRKURLRequestPromiseCachePolicyStaleWhileRevalidate = 1,
+    
+    ///The cache is yielded if it is not older than the request promise's `.maximumStaleness`,
+    ///and no request is made. Intended for remote data that never changes, such as images.
+    ///
+    ///If there is no usable cache, this policy behaves like the default policy.
+    kRKURLRequestPromiseCachePolicyCacheFirst = 2,
+};
+
 
 ///The RKURLRequestPromiseCacheManager protocol outlines the methods and behaviours
 ///necessary for an object to be used as a cache manager for the RKURLRequestPromise class.
@@ -111,6 +139,23 @@ typedef void(^RKURLRequestPromiseCacheLoadingBlock)(RKPossibility *maybeData);
 ///of writing this documentation.
 - (BOOL)removeAllCache:(NSError **)outError;
 
+@optional
+
+///Returns the date the cached data for a given identifier was last known to match the server.
+///
+///This method is used to enforce `-[RKURLRequestPromise maximumStaleness]`. When it is
+///not implemented, cache is only considered fresh enough if the maximum staleness is infinite.
+///
+///This method will be called from multiple threads.
+- (NSDate *)validationDateForIdentifier:(NSString *)identifier;
+
+///Records that the cached data for a given identifier was found to match the server at a given date.
+///
+///This method is called when a revalidation finds the cache is unchanged.
+///
+///This method will be called from multiple threads, and may safely block.
+- (void)setValidationDate:(NSDate *)date forIdentifier:(NSString *)identifier;
+
 @end
 
 #pragma mark -
@@ -205,6 +250,10 @@ typedef NSURLRequest *(^RKURLRequestPreflightBlock)(NSURLRequest *request, NSErr
 /// -   If NO, then the cache is completely ignored. This is typically
 ///     the intended behaviour of servers.
 ///
+///Timing, byte counts, and cache outcomes are reported to the
+///RKURLRequestMetrics class when its shared instance is enabled.
+///
+/// \seealso(RKURLRequestMetrics)
 @interface RKURLRequestPromise : RKPromise
 
 #pragma mark - Tracking Requests
@@ -316,19 +365,22 @@ typedef NSURLRequest *(^RKURLRequestPreflightBlock)(NSURLRequest *request, NSErr
 ///The authentication handler of the request promise.
 @property (RK_NONATOMIC_IOSONLY) id <RKURLRequestAuthenticationHandler> authenticationHandler;
 
-#pragma mark - Canceling
-
-///Whether or not the abstract promise is cancelled.
-@property BOOL cancelled;
-
-///Cancel the receiver.
-- (IBAction)cancel:(id)sender;
-
 #pragma mark - Cache
 
 ///The cache manager of the request.
 @property (readonly, RK_NONATOMIC_IOSONLY) id <RKURLRequestPromiseCacheManager> cacheManager;
 
+///The in-memory cache to keep the post-processed results of the request in. Optional.
+///
+///When the receiver loads its cache, it first checks the memory cache for a result
+///post-processed from the current revision of its cache, skipping both the cache manager
+///read and the post-processor when one is found. Results are stored in the memory cache
+///whenever the receiver post-processes data that is in its cache manager.
+///
+///Results in a memory cache are shared between requests, and so must not be mutated.
+///This property is ignored if `.cacheManager` is nil.
+@property (RK_NONATOMIC_IOSONLY) RKMemoryCache *memoryCache;
+
 #pragma mark -
 
 ///Whether or not the request can use the cache when the internet connection is offline.
@@ -345,6 +397,33 @@ typedef NSURLRequest *(^RKURLRequestPreflightBlock)(NSURLRequest *request, NSErr
 
 #pragma mark -
 
+///The cache policy of the request. Defaults to `kRKURLRequestPromiseCachePolicyDefault`.
+///
+///This property is ignored if `.cacheManager` is nil.
+@property (RK_NONATOMIC_IOSONLY) RKURLRequestPromiseCachePolicy cachePolicy;
+
+///The maximum age of cache that will be yielded immediately under the
+///stale-while-revalidate and cache-first cache policies. Defaults to `kRKTimeIntervalInfinite`.
+///
+///The age of cache is measured from the last time it was known to match the server.
+@property (RK_NONATOMIC_IOSONLY) NSTimeInterval maximumStaleness;
+
+///Whether or not the receiver yielded its cache and is revalidating it in the background.
+@property (readonly) BOOL isRevalidating;
+
+///Sets the block to invoke when a background revalidation finds that the remote data has changed.
+///
+/// \param  handler         The block to invoke. It is passed the remote data after it has been
+///                         run through the receiver's post-processor. Optional.
+/// \param  callbackQueue   The queue to invoke the handler on. Required if handler is non-nil.
+///
+///The handler is only invoked under the stale-while-revalidate cache policy, and only when
+///the cache was yielded. It is not invoked if the remote data is unchanged, or if the
+///revalidation fails. This method must be called before the receiver is realized.
+- (void)setRevalidationHandler:(RKURLRequestPromiseRevalidationBlock)handler callbackQueue:(NSOperationQueue *)callbackQueue;
+
+#pragma mark -
+
 ///Loads any data cached under the identifier assigned to
 ///the receiver using the receiver's cache manager object.
 ///
@@ -7,9 +7,13 @@
 //
 
 #import "RKURLRequestPromise.h"
+#import <libkern/OSAtomic.h>
 #import "RKConnectivityManager.h"
 #import "RKActivityManager.h"
 #import "RKPossibility.h"
+#import "RKURLRequestMetrics.h"
+#import "RKMemoryCache.h"
+#import "RKTrace.h"
 
 #if TARGET_OS_IPHONE
 #   import <UIKit/UIKit.h>
@@ -201,6 +205,15 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
 ///Whether or not the cache has been successfully loaded.
 @property BOOL isCacheLoaded;
 
+///Readwrite.
+@property (readwrite) BOOL isRevalidating;
+
+///The block to invoke when a revalidation yields changed data.
+@property (copy) RKURLRequestPromiseRevalidationBlock revalidationHandler;
+
+///The queue to invoke the revalidation handler on.
+@property NSOperationQueue *revalidationQueue;
+
 #pragma mark - Readwrite Properties
 
 ///Readwrite
@@ -222,6 +235,20 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
 @implementation RKURLRequestPromise {
     BOOL _isInOfflineMode;
     NSMutableData *_loadedData;
+    NSData *_staleData;
+    NSString *_staleRevision;
+    NSString *_memoryCacheRevision;
+    
+    BOOL _isCollectingMetrics;
+    CFAbsoluteTime _fireTime;
+    CFAbsoluteTime _startTime;
+    CFAbsoluteTime _firstByteTime;
+    unsigned long long _bytesReceived;
+    RKURLRequestCacheOutcome _cacheOutcome;
+    
+    volatile int64_t _requestTraceIdentifier;
+    
+    volatile int32_t _hasEndedActivity;
 }
 
 #pragma mark - Tracking Requests
@@ -289,6 +316,7 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
         self.requestQueue = requestQueue;
         
         self.cacheIdentifier = [request.URL absoluteString];
+        self.maximumStaleness = kRKTimeIntervalInfinite;
         
         self.connectivityManager = [RKConnectivityManager defaultInternetConnectivityManager];
     }
@@ -322,7 +350,28 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     NSAssert((self.connection == nil),
              @"Cannot realize a %@ more than once.", NSStringFromClass([self class]));
     
+    _isCollectingMetrics = RKURLRequestMetricsIsEnabled();
+    if(_isCollectingMetrics)
+        _fireTime = CFAbsoluteTimeGetCurrent();
+    
     [_requestQueue addOperationWithBlock:^{
+        //The promise may have been cancelled while waiting for a slot on the request queue.
+        if(self.cancelled)
+            return;
+        
+        if(_isCollectingMetrics)
+            _startTime = CFAbsoluteTimeGetCurrent();
+        
+        if(RKTraceIsEnabled()) {
+            uint64_t requestTraceIdentifier = RKTraceMakeIdentifier();
+            RKTraceBeginSpan(kRKTraceCategoryRequest,
+                             self.promiseName,
+                             requestTraceIdentifier,
+                             self.traceIdentifier,
+                             self.cacheIdentifier ?: self.request.URL.absoluteString);
+            OSAtomicCompareAndSwap64Barrier(0, (int64_t)requestTraceIdentifier, &_requestTraceIdentifier);
+        }
+        
         @synchronized(self) {
             _loadedData = [NSMutableData new];
         }
@@ -348,6 +397,12 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
                 [self loadCacheAndReportError:YES];
             }];
         } else {
+            if(_cachePolicy == kRKURLRequestPromiseCachePolicyCacheFirst && [self yieldCacheAndRevalidate:NO])
+                return;
+            
+            if(_cachePolicy == kRKURLRequestPromiseCachePolicyStaleWhileRevalidate)
+                [self yieldCacheAndRevalidate:YES];
+            
             self.connection = [[NSURLConnection alloc] initWithRequest:self.request
                                                               delegate:self
                                                       startImmediately:NO];
@@ -364,8 +419,18 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
 
 - (void)cancel:(id)sender
 {
-    if(!self.cancelled && _connection) {
-        [self.connection cancel];
+    if(self.cancelled)
+        return;
+    
+    //A settled promise has already ended its activity and reported its outcome. When it
+    //yielded its cache, its connection is left to finish revalidating the cache.
+    if(self.state != RKPromiseStateNotRealized)
+        return;
+    
+    NSURLConnection *connection = self.connection;
+    if(connection) {
+        [connection cancel];
+        self.connection = nil;
         @synchronized(self) {
              _loadedData = nil;
         }
@@ -374,12 +439,14 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
         NSLog(@"[DEBUG] Outgoing request to <%@> cancelled", self.request.URL);
 #endif /* RKURLRequestPromise_Option_LogRequests */
         
-        [[RKActivityManager sharedActivityManager] decrementActivityCount];
-        
-        self.cancelled = YES;
+        [self endActivity];
         
         RequestCancelled(self);
     }
+    
+    [self endTraceWithOutcome:@"cancelled"];
+    
+    [super cancel:sender];
 }
 
 #pragma mark - Cache Support
@@ -391,7 +458,18 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     
     if(self.cancelled) {
         if(!_isInOfflineMode)
-            [[RKActivityManager sharedActivityManager] decrementActivityCount];
+            [self endActivity];
+        
+        return YES;
+    }
+    
+    NSString *revision = nil;
+    RKPossibility *memoryCachedValue = [self memoryCachedValueWithRevision:&revision];
+    if(memoryCachedValue) {
+        self.isCacheLoaded = YES;
+        _cacheOutcome = _isInOfflineMode? kRKURLRequestCacheOutcomeOfflineServed : kRKURLRequestCacheOutcomeRevalidated;
+        
+        [self invokeSuccessCallbackWithMemoryCachedValue:memoryCachedValue];
         
         return YES;
     }
@@ -400,7 +478,9 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     NSData *data = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:&error];
     if(data) {
         self.isCacheLoaded = YES;
+        _cacheOutcome = _isInOfflineMode? kRKURLRequestCacheOutcomeOfflineServed : kRKURLRequestCacheOutcomeRevalidated;
         
+        _memoryCacheRevision = revision;
         [self invokeSuccessCallbackWithData:data];
     } else {
         NSError *removeError = nil;
@@ -434,6 +514,120 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     return YES;
 }
 
+#pragma mark - Revalidation
+
+- (void)setRevalidationHandler:(RKURLRequestPromiseRevalidationBlock)handler callbackQueue:(NSOperationQueue *)callbackQueue
+{
+    NSParameterAssert(!handler || callbackQueue);
+    
+    self.revalidationHandler = handler;
+    self.revalidationQueue = callbackQueue;
+}
+
+///Yields the receiver's cache if it is fresh enough for the maximum staleness.
+///
+/// \param  revalidate  Whether or not to mark the receiver as revalidating, so its
+///                     connection updates the cache in the background.
+///
+/// \result YES if the cache was yielded; NO otherwise.
+- (BOOL)yieldCacheAndRevalidate:(BOOL)revalidate
+{
+    if(!self.cacheManager || self.cacheIdentifier == nil)
+        return NO;
+    
+    if(_maximumStaleness != kRKTimeIntervalInfinite) {
+        NSDate *validationDate = nil;
+        if([self.cacheManager respondsToSelector:@selector(validationDateForIdentifier:)])
+            validationDate = [self.cacheManager validationDateForIdentifier:self.cacheIdentifier];
+        
+        if(!validationDate || -[validationDate timeIntervalSinceNow] > _maximumStaleness)
+            return NO;
+    }
+    
+    NSString *revision = nil;
+    RKPossibility *memoryCachedValue = [self memoryCachedValueWithRevision:&revision];
+    if(memoryCachedValue) {
+        if(revalidate)
+            _staleRevision = revision;
+        self.isCacheLoaded = YES;
+        self.isRevalidating = revalidate;
+        _cacheOutcome = kRKURLRequestCacheOutcomeHit;
+        
+        [self invokeSuccessCallbackWithMemoryCachedValue:memoryCachedValue];
+        
+        return YES;
+    }
+    
+    NSData *data = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:NULL];
+    if(!data)
+        return NO;
+    
+    if(revalidate) {
+        _staleData = data;
+        _staleRevision = revision;
+    }
+    self.isCacheLoaded = YES;
+    self.isRevalidating = revalidate;
+    _cacheOutcome = kRKURLRequestCacheOutcomeHit;
+    
+    _memoryCacheRevision = revision;
+    [self invokeSuccessCallbackWithData:data];
+    
+    return YES;
+}
+
+///Completes a background revalidation with the data loaded by the receiver's connection.
+- (void)finishRevalidationWithData:(NSData *)data
+{
+    //Writing the cache evicts the stale result from the memory cache, so it is looked up first.
+    id staleValue = nil;
+    if(self.memoryCache && _staleRevision)
+        staleValue = [self.memoryCache objectForKey:self.cacheIdentifier revision:_staleRevision transform:_postProcessor];
+    
+    //When the cache was yielded from the memory cache, its data was never read.
+    NSData *staleData = _staleData;
+    if(!staleData && staleValue)
+        staleData = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:NULL];
+    
+    NSError *error = nil;
+    if(![self writeDataToCache:data error:&error]) {
+#if RKURLRequestPromise_Option_LogErrors
+        NSLog(@"[DEBUG] Could not write revalidated data for <%@> to cache: %@", self.request.URL, error);
+#endif /* RKURLRequestPromise_Option_LogErrors */
+    }
+    
+    BOOL isUnchanged = [data isEqualToData:staleData];
+    _staleData = nil;
+    _staleRevision = nil;
+    self.isRevalidating = NO;
+    
+    NSString *revision = _memoryCacheRevision;
+    _memoryCacheRevision = nil;
+    
+    if(isUnchanged) {
+        if(staleValue)
+            [self storeValueInMemoryCache:[[RKPossibility alloc] initWithValue:staleValue] revision:revision cost:data.length];
+        
+        return;
+    }
+    
+    RKURLRequestPromiseRevalidationBlock revalidationHandler = self.revalidationHandler;
+    if(!revalidationHandler)
+        return;
+    
+    RKPossibility *maybeValue = [[RKPossibility alloc] initWithValue:data];
+    if(_postProcessor)
+        maybeValue = _postProcessor(maybeValue, self);
+    
+    [self storeValueInMemoryCache:maybeValue revision:revision cost:data.length];
+    
+    [self.revalidationQueue addOperationWithBlock:^{
+        revalidationHandler(maybeValue);
+    }];
+}
+
+#pragma mark -
+
 - (void)loadCachedDataWithCallbackQueue:(NSOperationQueue *)callbackQueue block:(RKURLRequestPromiseCacheLoadingBlock)block
 {
     NSParameterAssert(callbackQueue);
@@ -443,6 +637,16 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
         return;
     
     [self.requestQueue addOperationWithBlock:^{
+        NSString *revision = nil;
+        RKPossibility *memoryCachedValue = [self memoryCachedValueWithRevision:&revision];
+        if(memoryCachedValue) {
+            [callbackQueue addOperationWithBlock:^{
+                block(memoryCachedValue);
+            }];
+            
+            return;
+        }
+        
         NSError *error = nil;
         NSData *data = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:&error];
         if(data) {
@@ -450,6 +654,8 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
             if(self.postProcessor)
                 maybeValue = self.postProcessor(maybeValue, self);
             
+            [self storeValueInMemoryCache:maybeValue revision:revision cost:data.length];
+            
             [callbackQueue addOperationWithBlock:^{
                 block(maybeValue);
             }];
@@ -480,6 +686,121 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     [self loadCachedDataWithCallbackQueue:[NSOperationQueue currentQueue] block:block];
 }
 
+#pragma mark - Memory Cache
+
+///Looks up the post-processed result of the receiver's cache in the receiver's memory cache.
+///
+/// \param  outRevision On return, the current revision of the receiver's cache, or nil
+///                     if the receiver has no memory cache. Used to store the result of
+///                     post-processing the cache when the memory cache has no result.
+///
+/// \result The post-processed result if the memory cache has one for the current revision; nil otherwise.
+- (RKPossibility *)memoryCachedValueWithRevision:(NSString **)outRevision
+{
+    if(!self.memoryCache || !self.cacheManager || self.cacheIdentifier == nil)
+        return nil;
+    
+    //The revision is read before the cache so a result is never stored under a revision newer than its data.
+    NSString *revision = [self.cacheManager revisionForIdentifier:self.cacheIdentifier];
+    if(outRevision) *outRevision = revision;
+    if(!revision)
+        return nil;
+    
+    id value = [self.memoryCache objectForKey:self.cacheIdentifier revision:revision transform:_postProcessor];
+    if(!value)
+        return nil;
+    
+    return [[RKPossibility alloc] initWithValue:value];
+}
+
+///Stores the post-processed result of data in the receiver's cache manager in the receiver's memory cache.
+///
+/// \param  maybeValue  The result of post-processing the data. Only stored if it has a value.
+/// \param  revision    The revision of the data in the cache manager. Nothing is stored if nil.
+/// \param  cost        The estimated cost of the result, the length of its data.
+///
+- (void)storeValueInMemoryCache:(RKPossibility *)maybeValue revision:(NSString *)revision cost:(NSUInteger)cost
+{
+    if(!self.memoryCache || !revision || self.cacheIdentifier == nil || maybeValue.state != kRKPossibilityStateValue)
+        return;
+    
+    [self.memoryCache setObject:maybeValue.value
+                         forKey:self.cacheIdentifier
+                       revision:revision
+                      transform:_postProcessor
+                           cost:cost];
+}
+
+#pragma mark - Metrics
+
+///Submits the measurements taken for the receiver to the shared metrics object.
+///
+///This method does nothing if metrics were not being collected when the receiver
+///was fired, and only submits measurements the first time it is called.
+- (void)recordMetricsWithFailure:(BOOL)failed
+{
+    if(!_isCollectingMetrics)
+        return;
+    
+    _isCollectingMetrics = NO;
+    
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    
+    RKURLRequestMetricsRecord *record = [RKURLRequestMetricsRecord new];
+    record.host = self.request.URL.host;
+    record.promiseName = self.promiseName;
+    record.HTTPMethod = self.request.HTTPMethod;
+    
+    if(_startTime > 0.0)
+        record.queueWait = _startTime - _fireTime;
+    if(_firstByteTime > 0.0)
+        record.timeToFirstByte = _firstByteTime - _startTime;
+    record.duration = now - _fireTime;
+    
+    record.bytesOut = self.request.HTTPBody.length;
+    record.bytesIn = _bytesReceived;
+    
+    record.cacheOutcome = _cacheOutcome;
+    record.failed = failed;
+    
+    [[RKURLRequestMetrics sharedMetrics] addRecord:record];
+}
+
+#pragma mark - Activity
+
+///Balances the activity count incremented when the receiver started.
+///
+/// \result YES if the caller ended the activity; NO if it had already been ended.
+///
+///Cancellation and completion can race on different threads, so only
+///the first call to this method decrements the activity count.
+- (BOOL)endActivity
+{
+    if(!OSAtomicCompareAndSwap32Barrier(0, 1, &_hasEndedActivity))
+        return NO;
+    
+    [[RKActivityManager sharedActivityManager] decrementActivityCount];
+    
+    return YES;
+}
+
+#pragma mark - Tracing
+
+///Ends the receiver's request span, if it began one when it started.
+///
+/// \param  outcome The label describing how the request ended.
+///
+///This method only records the end of the span the first time it is called. Cancellation
+///and completion can race on different threads, so the span is claimed atomically.
+- (void)endTraceWithOutcome:(NSString *)outcome
+{
+    int64_t requestTraceIdentifier = _requestTraceIdentifier;
+    if(requestTraceIdentifier == 0 || !OSAtomicCompareAndSwap64Barrier(requestTraceIdentifier, 0, &_requestTraceIdentifier))
+        return;
+    
+    RKTraceEndSpan(kRKTraceCategoryRequest, self.promiseName, (uint64_t)requestTraceIdentifier, outcome);
+}
+
 #pragma mark - Invoking Callbacks
 
 - (void)invokeSuccessCallbackWithData:(NSData *)data
@@ -487,7 +808,7 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     if(self.cancelled)
         return;
     
-    [[RKActivityManager sharedActivityManager] decrementActivityCount];
+    [self endActivity];
     
 #if RKURLRequestPromise_Option_LogResponses
     NSLog(@"[DEBUG] %@Response for request to <%@>: %@", (_isInOfflineMode? @"(offline) " : @""), self.request.URL, [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
@@ -498,11 +819,17 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
         maybeValue = _postProcessor([[RKPossibility alloc] initWithValue:data], self);
     }
     
+    NSString *revision = _memoryCacheRevision;
+    _memoryCacheRevision = nil;
+    [self storeValueInMemoryCache:(maybeValue ?: [[RKPossibility alloc] initWithValue:data]) revision:revision cost:data.length];
+    
     //Post-processors can be long running.
     if(self.cancelled)
         return;
     
     RequestDidSucceed(self);
+    [self recordMetricsWithFailure:(maybeValue.state == kRKPossibilityStateError)];
+    [self endTraceWithOutcome:(maybeValue.state == kRKPossibilityStateError)? @"error" : @"value"];
     
     if(maybeValue) {
         if(maybeValue.state == kRKPossibilityStateError) {
@@ -515,26 +842,112 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     }
 }
 
+///Invokes the receiver's success callback with a result from its memory cache, bypassing its post-processor.
+- (void)invokeSuccessCallbackWithMemoryCachedValue:(RKPossibility *)maybeValue
+{
+    if(self.cancelled)
+        return;
+    
+    [self endActivity];
+    
+    RequestDidSucceed(self);
+    [self recordMetricsWithFailure:NO];
+    [self endTraceWithOutcome:@"value"];
+    
+    [self accept:maybeValue.value];
+}
+
 - (void)invokeFailureCallbackWithError:(NSError *)error
 {
     if(self.cancelled)
         return;
     
-    [[RKActivityManager sharedActivityManager] decrementActivityCount];
+    [self endActivity];
     
 #if RKURLRequestPromise_Option_LogErrors
     NSLog(@"[DEBUG] Error for request to <%@>: %@", self.request.URL, error);
 #endif /* RKURLRequestPromise_Option_LogErrors */
     
     RequestDidFail(self);
+    [self recordMetricsWithFailure:YES];
+    [self endTraceWithOutcome:@"error"];
     
     [self reject:error];
 }
 
+#pragma mark - Writing Cache
+
+///Writes data loaded by the receiver's connection into the receiver's cache manager.
+///
+/// \param  data        The data to write. Required.
+/// \param  outError    out NSError.
+///
+/// \result NO if the cache manager could not write the data; YES otherwise.
+///
+///This method does nothing if the receiver has no cache manager, or if the
+///response has no ETag and the receiver does not use its cache when offline.
+///
+///When the data is written, its revision is recorded so that the next call to
+///`-invokeSuccessCallbackWithData:` stores its result in the receiver's memory cache.
+- (BOOL)writeDataToCache:(NSData *)data error:(NSError **)outError
+{
+    _memoryCacheRevision = nil;
+    
+    if(!self.cacheManager)
+        return YES;
+    
+    //Revisions are not always unique, so any result from the data being replaced is discarded.
+    if(self.memoryCache && self.cacheIdentifier)
+        [self.memoryCache removeObjectForKey:self.cacheIdentifier];
+    
+    NSString *etag = self.response.allHeaderFields[kETagHeaderKey];
+    if(!etag && self.useCacheWhenOffline)
+        etag = kDefaultETagKey;
+    
+    if(!etag)
+        return YES;
+    
+    NSError *error = nil;
+    if(![self.cacheManager cacheData:data
+                       forIdentifier:self.cacheIdentifier
+                        withRevision:etag
+                               error:&error]) {
+        if(outError) {
+            NSDictionary *userInfo = @{
+                NSUnderlyingErrorKey: error,
+                NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not write data to cache for identifier %@.", self.cacheIdentifier],
+                RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
+            };
+            *outError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
+                                            code:kRKURLRequestPromiseErrorCannotWriteCache
+                                        userInfo:userInfo];
+        }
+        
+        return NO;
+    }
+    
+    _memoryCacheRevision = etag;
+    
+    return YES;
+}
+
 #pragma mark - <NSURLConnectionDelegate>
 
 - (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
 {
+    self.connection = nil;
+    @synchronized(self) {
+        _loadedData = nil;
+    }
+    
+    //The cache has already been yielded, so there is nobody to report the error to.
+    if(self.isRevalidating) {
+        self.isRevalidating = NO;
+        _staleData = nil;
+        _staleRevision = nil;
+        return;
+    }
+    
     switch (error.code) {
         case NSURLErrorCannotFindHost:
         case NSURLErrorCannotConnectToHost:
@@ -563,6 +976,9 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
 {
     self.response = response;
     
+    if(_isCollectingMetrics)
+        _firstByteTime = CFAbsoluteTimeGetCurrent();
+    
     if(!self.cacheManager || self.cancelled || self.cacheIdentifier == nil)
         return;
     
@@ -570,12 +986,20 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     NSString *cachedEtag = [self.cacheManager revisionForIdentifier:self.cacheIdentifier];
     if(etag && cachedEtag && [etag caseInsensitiveCompare:cachedEtag] == NSOrderedSame) {
         [self.connection cancel];
+        self.connection = nil;
         @synchronized(self) {
             _loadedData = nil;
         }
         
-        if(self.cancelWhenRemoteDataUnchanged) {
-            [[RKActivityManager sharedActivityManager] decrementActivityCount];
+        if(self.isRevalidating) {
+            if([self.cacheManager respondsToSelector:@selector(setValidationDate:forIdentifier:)])
+                [self.cacheManager setValidationDate:[NSDate date] forIdentifier:self.cacheIdentifier];
+            
+            self.isRevalidating = NO;
+            _staleData = nil;
+            _staleRevision = nil;
+        } else if(self.cancelWhenRemoteDataUnchanged) {
+            [self endActivity];
         } else {
             [self loadCacheAndReportError:YES];
         }
@@ -587,6 +1011,9 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
     @synchronized(self) {
         [_loadedData appendData:data];
     }
+    
+    if(_isCollectingMetrics)
+        _bytesReceived += data.length;
 }
 
 - (void)connectionDidFinishLoading:(NSURLConnection *)connection
@@ -599,33 +1026,20 @@ static NSArray *ActiveRequestArrayGetInstanteousCopy()
         loadedData = _loadedData;
     }
     
-    if(self.cacheManager) {
-        NSString *etag = self.response.allHeaderFields[kETagHeaderKey];
-        if(!etag && self.useCacheWhenOffline)
-            etag = kDefaultETagKey;
+    if(self.isRevalidating) {
+        [self finishRevalidationWithData:loadedData];
+    } else {
+        if(self.cacheManager)
+            _cacheOutcome = kRKURLRequestCacheOutcomeMiss;
         
-        if(etag) {
-            NSError *error = nil;
-            if(![self.cacheManager cacheData:loadedData
-                               forIdentifier:self.cacheIdentifier
-                                withRevision:etag
-                                       error:&error]) {
-                NSDictionary *userInfo = @{
-                    NSUnderlyingErrorKey: error,
-                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not write data to cache for identifier %@.", self.cacheIdentifier],
-                    RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
-                };
-                NSError *highLevelError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
-                                                              code:kRKURLRequestPromiseErrorCannotWriteCache
-                                                          userInfo:userInfo];
-                [self invokeFailureCallbackWithError:highLevelError];
-            }
-        }
+        NSError *error = nil;
+        if(![self writeDataToCache:loadedData error:&error])
+            [self invokeFailureCallbackWithError:error];
+        
+        [self invokeSuccessCallbackWithData:loadedData];
     }
     
-    [self invokeSuccessCallbackWithData:loadedData];
-    
-    _connection = nil;
+    self.connection = nil;
     @synchronized(self) {
         _loadedData = nil;
     }
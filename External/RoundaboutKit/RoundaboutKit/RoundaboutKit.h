@@ -26,17 +26,22 @@
 */
 
 #import "RKPrelude.h"
-#import "RKQueueManager.h"
+#import "RKExecutor.h"
 #import "RKPromise.h"
+#import "RKCancellationToken.h"
+#import "RKStream.h"
+#import "RKDurableQueue.h"
 #import "RKPossibility.h"
 #import "RKDefaults.h"
 #import "RKConnectivityManager.h"
 #import "RKURLRequestPromise.h"
+#import "RKURLRequestMetrics.h"
+#import "RKTrace.h"
+#import "RKStallWatchdog.h"
+#import "RKCacheEvictionPolicy.h"
 #import "RKFileSystemCacheManager.h"
+#import "RKMemoryCache.h"
 #import "RKRequestFactory.h"
 #import "RKPossibility.h"
 #import "RKActivityManager.h"
-
-#if TARGET_OS_IPHONE
-#   import "RKImageLoader.h"
-#endif /* TARGET_OS_IPHONE */
+#import "RKImageLoader.h"
@@ -0,0 +1,13 @@
+//
+//  RKCacheEvictionPolicyTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/26/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKCacheEvictionPolicyTests : SenTestCase
+
+@end
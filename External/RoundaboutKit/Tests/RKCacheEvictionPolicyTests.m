@@ -0,0 +1,270 @@
+//
+//  RKCacheEvictionPolicyTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/26/13.
+//
+//
+
+#import "RKCacheEvictionPolicyTests.h"
+#import "RKCacheEvictionPolicy.h"
+
+#define TRACE_LENGTH            40000
+#define TRACE_FEED_COUNT        300
+#define TRACE_ONE_OFF_RATIO     0.35
+#define TRACE_CAPACITY          (512 * 1024)
+
+///The number of requests between sweeps of the LRU model. Roughly
+///five minutes of requests for a busy session of the Player.
+#define SWEEP_INTERVAL          500
+
+#pragma mark - Traces
+
+///A tiny deterministic random number generator so that traces are identical across runs.
+static double TraceRandom(uint64_t *state)
+{
+    *state = (*state * 6364136223846793005ULL) + 1442695040888963407ULL;
+    return (double)(*state >> 11) / (double)(1ULL << 53);
+}
+
+///Returns an array of `@[key, cost]` pairs modelling the Player's request traffic.
+///
+///Most requests are for a fixed set of feeds whose popularity follows a Zipf
+///distribution. The remainder are for one-off responses such as rare searches.
+static NSArray *CreateTrace()
+{
+    uint64_t state = 7;
+
+    double cumulativeWeights[TRACE_FEED_COUNT];
+    double totalWeight = 0.0;
+    for (NSUInteger index = 0; index < TRACE_FEED_COUNT; index++) {
+        totalWeight += 1.0 / pow(index + 1, 0.9);
+        cumulativeWeights[index] = totalWeight;
+    }
+
+    unsigned long long feedCosts[TRACE_FEED_COUNT];
+    for (NSUInteger index = 0; index < TRACE_FEED_COUNT; index++)
+        feedCosts[index] = 2048 + (unsigned long long)(TraceRandom(&state) * 22528);
+
+    NSMutableArray *trace = [NSMutableArray arrayWithCapacity:TRACE_LENGTH];
+    NSUInteger oneOffCount = 0;
+    for (NSUInteger index = 0; index < TRACE_LENGTH; index++) {
+        if(TraceRandom(&state) < TRACE_ONE_OFF_RATIO) {
+            oneOffCount++;
+            unsigned long long cost = 4096 + (unsigned long long)(TraceRandom(&state) * 28672);
+            [trace addObject:@[ [NSString stringWithFormat:@"search-%lu", (unsigned long)oneOffCount], @(cost) ]];
+        } else {
+            double target = TraceRandom(&state) * totalWeight;
+            NSUInteger low = 0, high = TRACE_FEED_COUNT - 1;
+            while (low < high) {
+                NSUInteger middle = (low + high) / 2;
+                if(cumulativeWeights[middle] < target)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            [trace addObject:@[ [NSString stringWithFormat:@"feed-%lu", (unsigned long)low], @(feedCosts[low]) ]];
+        }
+    }
+
+    return trace;
+}
+
+#pragma mark - Models
+
+///Replays a trace against a model of the periodic LRU sweep that RKFileSystemCacheManager
+///used before it adopted RKCacheEvictionPolicy, returning the hit ratio.
+static double ReplayTraceWithLRUSweep(NSArray *trace, unsigned long long capacity, unsigned long long *outPeakCost)
+{
+    NSMutableDictionary *costs = [NSMutableDictionary dictionary];
+    NSMutableDictionary *lastAccesses = [NSMutableDictionary dictionary];
+    unsigned long long totalCost = 0, peakCost = 0;
+    NSUInteger hits = 0;
+
+    NSUInteger time = 0;
+    for (NSArray *request in trace) {
+        NSString *key = request[0];
+        if(costs[key]) {
+            hits++;
+        } else {
+            costs[key] = request[1];
+            totalCost += [request[1] unsignedLongLongValue];
+        }
+        lastAccesses[key] = @(time);
+        peakCost = MAX(peakCost, totalCost);
+
+        if((time % SWEEP_INTERVAL) == 0 && totalCost > capacity) {
+            NSArray *keysByAccess = [lastAccesses keysSortedByValueUsingSelector:@selector(compare:)];
+            for (NSString *victim in keysByAccess) {
+                totalCost -= [costs[victim] unsignedLongLongValue];
+                [costs removeObjectForKey:victim];
+                [lastAccesses removeObjectForKey:victim];
+
+                if(totalCost <= capacity)
+                    break;
+            }
+        }
+
+        time++;
+    }
+
+    if(outPeakCost) *outPeakCost = peakCost;
+
+    return (double)hits / trace.count;
+}
+
+///Replays a trace against a strict LRU which evicts on every insert, returning the hit ratio.
+static double ReplayTraceWithLRU(NSArray *trace, unsigned long long capacity)
+{
+    NSMutableOrderedSet *keysByAccess = [NSMutableOrderedSet orderedSet];
+    NSMutableDictionary *costs = [NSMutableDictionary dictionary];
+    unsigned long long totalCost = 0;
+    NSUInteger hits = 0;
+
+    for (NSArray *request in trace) {
+        NSString *key = request[0];
+        if(costs[key]) {
+            hits++;
+            [keysByAccess removeObject:key];
+            [keysByAccess addObject:key];
+        } else {
+            costs[key] = request[1];
+            totalCost += [request[1] unsignedLongLongValue];
+            [keysByAccess addObject:key];
+
+            while (totalCost > capacity) {
+                NSString *victim = keysByAccess[0];
+                totalCost -= [costs[victim] unsignedLongLongValue];
+                [costs removeObjectForKey:victim];
+                [keysByAccess removeObjectAtIndex:0];
+            }
+        }
+    }
+
+    return (double)hits / trace.count;
+}
+
+///Replays a trace against RKCacheEvictionPolicy, returning the hit ratio.
+static double ReplayTraceWithEvictionPolicy(NSArray *trace, unsigned long long capacity, unsigned long long *outPeakCost)
+{
+    RKCacheEvictionPolicy *policy = [[RKCacheEvictionPolicy alloc] initWithCapacity:capacity];
+    unsigned long long peakCost = 0;
+    NSUInteger hits = 0;
+
+    for (NSArray *request in trace) {
+        NSString *key = request[0];
+        if([policy containsKey:key]) {
+            hits++;
+            [policy recordAccessForKey:key];
+        } else {
+            (void)[policy insertKey:key cost:[request[1] unsignedLongLongValue]];
+        }
+
+        peakCost = MAX(peakCost, policy.totalCost);
+    }
+
+    if(outPeakCost) *outPeakCost = peakCost;
+
+    return (double)hits / trace.count;
+}
+
+#pragma mark -
+
+@implementation RKCacheEvictionPolicyTests
+
+- (void)testInsertion
+{
+    RKCacheEvictionPolicy *policy = [[RKCacheEvictionPolicy alloc] initWithCapacity:100];
+
+    STAssertEqualObjects([policy insertKey:@"a" cost:40], @[], @"unexpected eviction");
+    STAssertEqualObjects([policy insertKey:@"b" cost:40], @[], @"unexpected eviction");
+    STAssertTrue([policy containsKey:@"a"], @"key missing");
+    STAssertEquals(policy.count, (NSUInteger)2, @"unexpected count");
+    STAssertEquals(policy.totalCost, 80ULL, @"unexpected total cost");
+
+    NSArray *evictedKeys = [policy insertKey:@"c" cost:40];
+    STAssertEqualObjects(evictedKeys, @[ @"a" ], @"oldest key was not evicted");
+    STAssertTrue(policy.totalCost <= policy.capacity, @"policy exceeded its capacity");
+
+    STAssertEqualObjects([policy insertKey:@"huge" cost:500], @[ @"b", @"c", @"huge" ], @"oversized key was not evicted");
+    STAssertEquals(policy.totalCost, 0ULL, @"unexpected total cost");
+}
+
+- (void)testRemoval
+{
+    RKCacheEvictionPolicy *policy = [[RKCacheEvictionPolicy alloc] initWithCapacity:100];
+    (void)[policy insertKey:@"a" cost:10];
+    [policy restoreKey:@"b" cost:20];
+
+    [policy removeKey:@"a"];
+    STAssertFalse([policy containsKey:@"a"], @"key was not removed");
+    STAssertEquals(policy.totalCost, 20ULL, @"unexpected total cost");
+
+    [policy removeAllKeys];
+    STAssertEquals(policy.count, (NSUInteger)0, @"keys were not removed");
+    STAssertEquals(policy.totalCost, 0ULL, @"unexpected total cost");
+}
+
+- (void)testScanResistance
+{
+    RKCacheEvictionPolicy *policy = [[RKCacheEvictionPolicy alloc] initWithCapacity:1000];
+
+    for (NSUInteger index = 0; index < 5; index++) {
+        NSString *key = [NSString stringWithFormat:@"feed-%lu", (unsigned long)index];
+        (void)[policy insertKey:key cost:100];
+        [policy recordAccessForKey:key];
+    }
+
+    for (NSUInteger index = 0; index < 100; index++) {
+        NSString *key = [NSString stringWithFormat:@"search-%lu", (unsigned long)index];
+        (void)[policy insertKey:key cost:50];
+    }
+
+    for (NSUInteger index = 0; index < 5; index++) {
+        NSString *key = [NSString stringWithFormat:@"feed-%lu", (unsigned long)index];
+        STAssertTrue([policy containsKey:key], @"reused key %@ was pushed out by one-off keys", key);
+    }
+
+    STAssertTrue(policy.totalCost <= policy.capacity, @"policy exceeded its capacity");
+}
+
+- (void)testGhostReadmission
+{
+    RKCacheEvictionPolicy *policy = [[RKCacheEvictionPolicy alloc] initWithCapacity:100];
+    (void)[policy insertKey:@"a" cost:60];
+    STAssertEqualObjects([policy insertKey:@"b" cost:60], @[ @"a" ], @"unexpected eviction");
+
+    //"a" was evicted from the small queue recently, so it is readmitted into the main queue
+    //and the next eviction comes from the small queue, which now only contains "b".
+    STAssertEqualObjects([policy insertKey:@"a" cost:60], @[ @"b" ], @"ghost was not readmitted into the main queue");
+    STAssertTrue([policy containsKey:@"a"], @"ghost was not readmitted");
+}
+
+- (void)testTraceReplay
+{
+    NSArray *trace = CreateTrace();
+
+    unsigned long long sweepPeakCost = 0, policyPeakCost = 0;
+    NSDate *startDate = [NSDate date];
+    double sweepHitRatio = ReplayTraceWithLRUSweep(trace, TRACE_CAPACITY, &sweepPeakCost);
+    NSTimeInterval sweepDuration = -[startDate timeIntervalSinceNow];
+
+    double lruHitRatio = ReplayTraceWithLRU(trace, TRACE_CAPACITY);
+
+    startDate = [NSDate date];
+    double policyHitRatio = ReplayTraceWithEvictionPolicy(trace, TRACE_CAPACITY, &policyPeakCost);
+    NSTimeInterval policyDuration = -[startDate timeIntervalSinceNow];
+
+    NSLog(@"[BENCHMARK] %d requests, %d byte budget", TRACE_LENGTH, TRACE_CAPACITY);
+    NSLog(@"[BENCHMARK] LRU sweep every %d requests: hit ratio %.3f, peak %llu bytes, %f seconds",
+          SWEEP_INTERVAL, sweepHitRatio, sweepPeakCost, sweepDuration);
+    NSLog(@"[BENCHMARK] LRU on insert: hit ratio %.3f", lruHitRatio);
+    NSLog(@"[BENCHMARK] RKCacheEvictionPolicy: hit ratio %.3f, peak %llu bytes, %f seconds",
+          policyHitRatio, policyPeakCost, policyDuration);
+
+    STAssertTrue(policyPeakCost <= TRACE_CAPACITY, @"eviction policy exceeded its budget");
+    STAssertTrue(policyHitRatio > lruHitRatio, @"eviction policy did not outperform LRU within the same budget");
+}
+
+@end
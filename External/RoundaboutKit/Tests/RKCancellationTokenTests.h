@@ -0,0 +1,13 @@
+//
+//  RKCancellationTokenTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKCancellationTokenTests : SenTestCase
+
+@end
@@ -0,0 +1,148 @@
+//
+//  RKCancellationTokenTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKCancellationTokenTests.h"
+#import "RKCancellationToken.h"
+
+@implementation RKCancellationTokenTests
+
+- (void)testHandlers
+{
+    RKCancellationToken *token = [RKCancellationToken new];
+
+    __block NSUInteger timesCalled = 0;
+    __block BOOL removedHandlerWasCalled = NO;
+    [token addCancellationHandler:^{
+        timesCalled++;
+    }];
+    id registration = [token addCancellationHandler:^{
+        removedHandlerWasCalled = YES;
+    }];
+    [token removeCancellationHandler:registration];
+
+    STAssertFalse(token.isCancelled, @"New token is cancelled");
+
+    [token cancel];
+    [token cancel];
+    STAssertTrue(token.isCancelled, @"Token was not cancelled");
+    STAssertEquals(timesCalled, (NSUInteger)1, @"Handler was not called exactly once");
+    STAssertFalse(removedHandlerWasCalled, @"Removed handler was called");
+
+    __block BOOL lateHandlerWasCalled = NO;
+    [token addCancellationHandler:^{
+        lateHandlerWasCalled = YES;
+    }];
+    STAssertTrue(lateHandlerWasCalled, @"Handler added to cancelled token was not called immediately");
+}
+
+- (void)testParentTokens
+{
+    RKCancellationToken *parent = [RKCancellationToken new];
+    RKCancellationToken *firstChild = [[RKCancellationToken alloc] initWithParentToken:parent];
+    RKCancellationToken *secondChild = [[RKCancellationToken alloc] initWithParentToken:parent];
+
+    [firstChild cancel];
+    STAssertFalse(parent.isCancelled, @"Cancelling child cancelled parent");
+    STAssertFalse(secondChild.isCancelled, @"Cancelling child cancelled sibling");
+
+    [parent cancel];
+    STAssertTrue(secondChild.isCancelled, @"Cancelling parent did not cancel child");
+
+    RKCancellationToken *lateChild = [[RKCancellationToken alloc] initWithParentToken:parent];
+    STAssertTrue(lateChild.isCancelled, @"Child of cancelled parent was not cancelled");
+}
+
+#pragma mark - Promises
+
+- (void)testCancellingChain
+{
+    RKCancellationToken *token = [RKCancellationToken new];
+    RKPromise *source = [RKPromise new];
+    RKPromise *chain = [[source map:^id(id value) {
+        return value;
+    }] flatMap:^RKPromise *(id value) {
+        return [RKPromise acceptedPromiseWithValue:value];
+    }];
+    chain.cancellationToken = token;
+
+    __block BOOL subscriberWasCalled = NO;
+    [chain then:^(id value) {
+        subscriberWasCalled = YES;
+    } otherwise:^(NSError *error) {
+        subscriberWasCalled = YES;
+    } onQueue:[NSOperationQueue mainQueue]];
+
+    [token cancel];
+    STAssertTrue(chain.cancelled, @"Token did not cancel promise");
+    STAssertTrue(source.cancelled, @"Cancellation did not reach source of chain");
+
+    STAssertNoThrow([source accept:@"value"], @"Accepting cancelled promise threw");
+    STAssertEquals(chain.state, RKPromiseStateNotRealized, @"Cancelled promise was settled");
+    STAssertFalse(subscriberWasCalled, @"Subscriber of cancelled promise was called");
+}
+
+- (void)testCancellingContinuation
+{
+    RKPromise *source = [RKPromise new];
+    RKPromise *continuation = [RKPromise new];
+    RKPromise *chain = [source flatMap:^RKPromise *(id value) {
+        return continuation;
+    }];
+    [source accept:@"value"];
+
+    [chain cancel:nil];
+    STAssertTrue(continuation.cancelled, @"Cancellation did not reach continuation");
+}
+
+- (void)testSharedSourcesAreNotCancelled
+{
+    RKPromise *source = [RKPromise new];
+    RKPromise *firstChain = [source map:^id(id value) { return value; }];
+    RKPromise *secondChain = [source map:^id(id value) { return value; }];
+
+    [firstChain cancel:nil];
+    STAssertFalse(source.cancelled, @"Source still depended on was cancelled");
+
+    [secondChain cancel:nil];
+    STAssertTrue(source.cancelled, @"Source no longer depended on was not cancelled");
+
+    RKPromise *directlySubscribedSource = [RKPromise new];
+    [directlySubscribedSource then:^(id value) {} otherwise:^(NSError *error) {} onQueue:[NSOperationQueue mainQueue]];
+    [[directlySubscribedSource map:^id(id value) { return value; }] cancel:nil];
+    STAssertFalse(directlySubscribedSource.cancelled, @"Directly subscribed source was cancelled");
+}
+
+- (void)testCancellingCombination
+{
+    RKCancellationToken *token = [RKCancellationToken new];
+    RKPromise *first = [RKPromise new];
+    RKPromise *second = [RKPromise new];
+    RKPromise *all = [RKPromise all:@[ first, second ]];
+    all.cancellationToken = token;
+
+    [token cancel];
+    STAssertTrue(first.cancelled, @"Cancellation did not reach first combined promise");
+    STAssertTrue(second.cancelled, @"Cancellation did not reach second combined promise");
+}
+
+- (void)testSettledPromisesIgnoreTokens
+{
+    RKCancellationToken *token = [RKCancellationToken new];
+    RKPromise *promise = [RKPromise acceptedPromiseWithValue:@"value"];
+    promise.cancellationToken = token;
+
+    [token cancel];
+    STAssertFalse(promise.cancelled, @"Settled promise was cancelled");
+    STAssertNil(promise.cancellationToken, @"Settled promise kept token");
+
+    RKPromise *latePromise = [RKPromise new];
+    latePromise.cancellationToken = token;
+    STAssertTrue(latePromise.cancelled, @"Cancelled token did not cancel promise immediately");
+}
+
+@end
@@ -14,6 +14,13 @@ static NSString *const PersistentIntegerKey = @"com.roundabout.roundaboutkitests
 static NSString *const PersistentFloatKey = @"com.roundabout.roundaboutkitests/PersistentFloat";
 static NSString *const PersistentBoolKey = @"com.roundabout.roundaboutkitests/PersistentBool";
 static NSString *const TestDefault1Key = @"com.roundabout.roundaboutkitests/TestDefault1";
+static NSString *const SettingIntegerKey = @"com.roundabout.roundaboutkitests/SettingInteger";
+static NSString *const SettingBoolKey = @"com.roundabout.roundaboutkitests/SettingBool";
+static NSString *const SettingFloatKey = @"com.roundabout.roundaboutkitests/SettingFloat";
+
+static RK_DEFINE_SETTING(IntegerSetting, SettingIntegerKey, kRKSettingTypeInteger)
+static RK_DEFINE_SETTING(BoolSetting, SettingBoolKey, kRKSettingTypeBool)
+static RK_DEFINE_SETTING(FloatSetting, SettingFloatKey, kRKSettingTypeFloat)
 
 @interface RKDefaultsTests ()
 
@@ -32,7 +39,10 @@ static NSString *const TestDefault1Key = @"com.roundabout.roundaboutkitests/Test
         PersistentIntegerKey,
         PersistentFloatKey,
         PersistentBoolKey,
-        TestDefault1Key
+        TestDefault1Key,
+        SettingIntegerKey,
+        SettingBoolKey,
+        SettingFloatKey
     ];
 }
 
@@ -40,6 +50,8 @@ static NSString *const TestDefault1Key = @"com.roundabout.roundaboutkitests/Test
 {
     [super tearDown];
     
+    RKSettingsFlushPendingWrites();
+    
     NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
     for (NSString *affectedKey in self.affectedKeys)
         [defaults removeObjectForKey:affectedKey];
@@ -82,4 +94,82 @@ static NSString *const TestDefault1Key = @"com.roundabout.roundaboutkitests/Test
     STAssertTrue(RKPersistentValueExists(TestDefault1Key), @"RKPersistentValueExists returned wrong result");
 }
 
+#pragma mark - Settings
+
+- (void)testSettingRegistry
+{
+    STAssertEquals(IntegerSetting(), [RKSetting settingForKey:SettingIntegerKey type:kRKSettingTypeInteger], @"Setting was registered twice");
+    STAssertEquals(IntegerSetting(), [RKSetting existingSettingForKey:SettingIntegerKey], @"Setting was not registered");
+    STAssertNil([RKSetting existingSettingForKey:TestDefault1Key], @"Unregistered key has a setting");
+}
+
+- (void)testSettingValues
+{
+    IntegerSetting().integerValue = 42;
+    STAssertEquals(IntegerSetting().integerValue, 42L, @"Integer setting is broken");
+    STAssertEqualObjects(IntegerSetting().objectValue, @42, @"Integer setting was not boxed");
+    
+    BoolSetting().boolValue = YES;
+    STAssertTrue(BoolSetting().boolValue, @"Bool setting is broken");
+    
+    FloatSetting().floatValue = 0.5f;
+    STAssertEquals(FloatSetting().floatValue, 0.5f, @"Float setting is broken");
+}
+
+- (void)testSettingWritesAreBatched
+{
+    IntegerSetting().integerValue = 7;
+    STAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:SettingIntegerKey], @"Setting was written before its write delay");
+    STAssertEquals(RKGetPersistentInteger(SettingIntegerKey), 7L, @"RKGetPersistentInteger did not read through setting");
+    
+    RKSettingsFlushPendingWrites();
+    STAssertEqualObjects([[NSUserDefaults standardUserDefaults] objectForKey:SettingIntegerKey], @7, @"Setting was not written by flush");
+}
+
+- (void)testSettingsInTestMode
+{
+    IntegerSetting().integerValue = 5;
+    
+    RKDefaultsActivateTestMode();
+    STAssertEquals(IntegerSetting().integerValue, 0L, @"Setting kept its pending change after test mode was activated");
+    
+    IntegerSetting().integerValue = 9;
+    RKSettingsFlushPendingWrites();
+    STAssertEquals(RKGetPersistentInteger(SettingIntegerKey), 9L, @"Setting was not written in test mode");
+    STAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:SettingIntegerKey], @"Setting was written to user defaults in test mode");
+    
+    RKDefaultsDeactivateTestMode();
+    STAssertEquals(IntegerSetting().integerValue, 0L, @"Setting kept its test mode value after test mode was deactivated");
+    STAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:SettingIntegerKey], @"Pending change was written after test mode was activated");
+}
+
+- (void)testPersistentFunctionsWriteThroughSettings
+{
+    RKSetPersistentBool(SettingBoolKey, YES);
+    STAssertTrue(BoolSetting().boolValue, @"RKSetPersistentBool did not write through setting");
+    STAssertTrue(RKPersistentValueExists(SettingBoolKey), @"RKPersistentValueExists did not read through setting");
+}
+
+- (void)testSettingChangeNotifications
+{
+    __block NSUInteger numberOfChanges = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:RKSettingDidChangeNotification
+                                                                    object:FloatSetting()
+                                                                     queue:nil
+                                                                usingBlock:^(NSNotification *notification) {
+                                                                    numberOfChanges++;
+                                                                }];
+    
+    FloatSetting().floatValue = 2.f;
+    FloatSetting().floatValue = 2.f;
+    STAssertEquals(numberOfChanges, 1UL, @"Unchanged setting posted change notification");
+    
+    RKSettingsFlushPendingWrites();
+    [[NSUserDefaults standardUserDefaults] setFloat:3.f forKey:SettingFloatKey];
+    STAssertEquals(FloatSetting().floatValue, 3.f, @"Setting did not pick up direct change to user defaults");
+    STAssertEquals(numberOfChanges, 2UL, @"Direct change to user defaults did not post change notification");
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+}
+
 @end
@@ -0,0 +1,206 @@
+//
+//  RKDurableQueueTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKDurableQueueTests.h"
+#import "RKDurableQueue.h"
+#import "RKMockURLProtocol.h"
+
+#define DEFAULT_TIMEOUT     1.0
+
+#define SUBMIT_URL_STRING   @"http://test/submit"
+
+///Matches the batch size used for Last.fm scrobbles.
+#define TEST_BATCH_SIZE     50
+
+@interface RKDurableQueueTests ()
+
+@property RKConnectivityManager *connectivityManager;
+
+@end
+
+@implementation RKDurableQueueTests {
+    NSString *_journalPath;
+    NSOperationQueue *_ioQueue;
+    NSMutableArray *_submittedBatches;
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    self.connectivityManager = [[RKConnectivityManager alloc] initWithHostName:@"localhost"];
+
+    NSString *fileName = [NSString stringWithFormat:@"RKDurableQueueTests-%@.journal", [[NSProcessInfo processInfo] globallyUniqueString]];
+    _journalPath = [NSTemporaryDirectory() stringByAppendingPathComponent:fileName];
+
+    _ioQueue = [NSOperationQueue new];
+    _ioQueue.maxConcurrentOperationCount = 1;
+
+    _submittedBatches = [NSMutableArray array];
+
+    [self respondWithStatusCode:200];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+
+    [RKMockURLProtocol removeAllRoutes];
+
+    [_ioQueue waitUntilAllOperationsAreFinished];
+    [[NSFileManager defaultManager] removeItemAtPath:_journalPath error:NULL];
+}
+
+#pragma mark -
+
+///Replaces the response of the mock submission endpoint.
+- (void)respondWithStatusCode:(NSInteger)statusCode
+{
+    [RKMockURLProtocol removeAllRoutes];
+    [RKMockURLProtocol on:[NSURL URLWithString:SUBMIT_URL_STRING]
+               withMethod:@"POST"
+          yieldStatusCode:statusCode
+                  headers:@{@"Content-Type": @"application/json"}
+                     data:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+///Returns a new queue for the test journal which posts its entries to the mock endpoint,
+///and records the identifiers of each batch it submits.
+- (RKDurableQueue *)makeQueue
+{
+    RKDurableQueue *queue = [[RKDurableQueue alloc] initWithPath:_journalPath ioQueue:_ioQueue];
+    queue.maximumBatchSize = TEST_BATCH_SIZE;
+    queue.initialRetryDelay = 0.2;
+    queue.maximumRetryDelay = 0.5;
+
+    NSMutableArray *submittedBatches = _submittedBatches;
+    RKConnectivityManager *connectivityManager = self.connectivityManager;
+    queue.submitter = ^RKPromise *(NSArray *entries) {
+        [submittedBatches addObject:[entries valueForKey:@"id"]];
+
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:SUBMIT_URL_STRING]];
+        [request setHTTPMethod:@"POST"];
+        [request setHTTPBody:[NSJSONSerialization dataWithJSONObject:entries options:0 error:NULL]];
+
+        RKURLRequestPromise *submission = [[RKURLRequestPromise alloc] initWithRequest:request requestQueue:[RKExecutor commonExecutor]];
+        submission.connectivityManager = connectivityManager;
+        submission.postProcessor = ^RKPossibility *(RKPossibility *maybeData, RKURLRequestPromise *request) {
+            if(request.response.statusCode >= 400)
+                return [[RKPossibility alloc] initWithError:[NSError errorWithDomain:@"RKDurableQueueTestsErrorDomain" code:request.response.statusCode userInfo:nil]];
+
+            return maybeData;
+        };
+        return submission;
+    };
+
+    return queue;
+}
+
+///Enqueues a number of entries with sequential identifiers.
+- (void)enqueueEntries:(NSUInteger)count inQueue:(RKDurableQueue *)queue
+{
+    for (NSUInteger index = 0; index < count; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"entry-%ld", (unsigned long)index];
+        [queue enqueueEntry:@{@"id": identifier, @"index": @(index)} withIdentifier:identifier];
+    }
+}
+
+#pragma mark -
+
+- (void)testEntriesPersistAcrossInstances
+{
+    RKDurableQueue *queue = [self makeQueue];
+    [self enqueueEntries:3 inQueue:queue];
+    STAssertEquals(queue.numberOfPendingEntries, (NSUInteger)3, @"Entries were not enqueued");
+    [_ioQueue waitUntilAllOperationsAreFinished];
+
+    //A record cut off by a crash is discarded when the journal is replayed.
+    NSFileHandle *journal = [NSFileHandle fileHandleForWritingAtPath:_journalPath];
+    [journal seekToEndOfFile];
+    [journal writeData:[NSData dataWithBytes:"\x00\x00\x01" length:3]];
+    [journal closeFile];
+
+    RKDurableQueue *reopenedQueue = [self makeQueue];
+    STAssertEquals(reopenedQueue.numberOfPendingEntries, (NSUInteger)3, @"Entries were not replayed from journal");
+
+    [reopenedQueue flush];
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (reopenedQueue.numberOfPendingEntries == 0); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Submission timed out");
+    STAssertEqualObjects(_submittedBatches, (@[ @[ @"entry-0", @"entry-1", @"entry-2" ] ]), @"Replayed entries were not submitted in order");
+    [_ioQueue waitUntilAllOperationsAreFinished];
+
+    RKDurableQueue *finalQueue = [self makeQueue];
+    STAssertEquals(finalQueue.numberOfPendingEntries, (NSUInteger)0, @"Acknowledged entries were replayed from journal");
+}
+
+- (void)testEntriesAreSubmittedInBatches
+{
+    RKDurableQueue *queue = [self makeQueue];
+    [self enqueueEntries:(TEST_BATCH_SIZE * 2) + 20 inQueue:queue];
+
+    [queue flush];
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (queue.numberOfPendingEntries == 0); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Submission timed out");
+
+    NSArray *batchSizes = [_submittedBatches valueForKey:@"@count"];
+    STAssertEqualObjects(batchSizes, (@[ @(TEST_BATCH_SIZE), @(TEST_BATCH_SIZE), @20 ]), @"Entries were not submitted in full batches");
+    STAssertEqualObjects([_submittedBatches[1] firstObject], @"entry-50", @"Batches were not submitted in order");
+}
+
+- (void)testFailedSubmissionsBackOff
+{
+    [self respondWithStatusCode:503];
+
+    RKDurableQueue *queue = [self makeQueue];
+    [self enqueueEntries:3 inQueue:queue];
+
+    [queue flush];
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (queue.consecutiveFailures == 1); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Submission timed out");
+    STAssertEquals(queue.numberOfPendingEntries, (NSUInteger)3, @"Entries were removed after failed submission");
+    STAssertTrue([queue.nextAttemptDate timeIntervalSinceNow] > 0.0, @"Failed submission did not back off");
+
+    [queue flush];
+    STAssertEquals(_submittedBatches.count, (NSUInteger)1, @"Flushing during backoff period submitted entries");
+
+    [self respondWithStatusCode:200];
+    finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (queue.numberOfPendingEntries == 0); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Failed submission was not retried after backoff period");
+    STAssertEquals(queue.consecutiveFailures, (NSUInteger)0, @"Failures were not reset after successful submission");
+    STAssertNil(queue.nextAttemptDate, @"Backoff was not reset after successful submission");
+}
+
+- (void)testRetriesAreIdempotent
+{
+    //The endpoint accepts the first submission, but its response never arrives.
+    [RKMockURLProtocol removeAllRoutes];
+    [RKMockURLProtocol on:[NSURL URLWithString:SUBMIT_URL_STRING]
+               withMethod:@"POST"
+               yieldError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]];
+
+    RKDurableQueue *queue = [self makeQueue];
+    [self enqueueEntries:3 inQueue:queue];
+
+    [queue flush];
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (queue.consecutiveFailures == 1); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Submission timed out");
+
+    //Playing the same entries again while they are pending must not duplicate them.
+    [self enqueueEntries:3 inQueue:queue];
+    STAssertFalse([queue enqueueEntry:@{@"id": @"entry-0"} withIdentifier:@"entry-0"], @"Duplicate entry was enqueued");
+    STAssertEquals(queue.numberOfPendingEntries, (NSUInteger)3, @"Duplicate entries were enqueued");
+
+    [self respondWithStatusCode:200];
+    finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (queue.numberOfPendingEntries == 0); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Failed submission was not retried after backoff period");
+
+    STAssertEquals(_submittedBatches.count, (NSUInteger)2, @"Unexpected number of submissions");
+    STAssertEqualObjects(_submittedBatches[1], _submittedBatches[0], @"Retried batch did not have the same entries");
+}
+
+@end
@@ -0,0 +1,13 @@
+//
+//  RKExecutorTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKExecutorTests : SenTestCase
+
+@end
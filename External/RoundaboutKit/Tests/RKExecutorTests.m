@@ -0,0 +1,104 @@
+//
+//  RKExecutorTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKExecutorTests.h"
+#import "RKExecutor.h"
+#import "RunLoopHelper.h"
+
+#define DEFAULT_TIMEOUT 1.0
+
+@implementation RKExecutorTests
+
+- (void)testRegistry
+{
+    RKExecutor *executor = [RKExecutor executorNamed:@"com.roundabout.rk.tests.executor.registry"
+                                    qualityOfService:kRKExecutorQualityOfServiceUserInitiated
+                                               width:2];
+    STAssertNotNil(executor, @"Executor was not created");
+    STAssertEquals(executor.qualityOfServiceClass, kRKExecutorQualityOfServiceUserInitiated, @"Executor has wrong quality of service");
+    STAssertEquals(executor.width, (NSInteger)2, @"Executor has wrong width");
+
+    RKExecutor *sameExecutor = [RKExecutor executorNamed:@"com.roundabout.rk.tests.executor.registry"
+                                        qualityOfService:kRKExecutorQualityOfServiceBackground
+                                                   width:1];
+    STAssertEquals(sameExecutor, executor, @"Executor with same name was not reused");
+    STAssertEquals(sameExecutor.width, (NSInteger)2, @"Registered executor was reconfigured");
+
+    STAssertEquals([RKExecutor existingExecutorNamed:@"com.roundabout.rk.tests.executor.registry"], executor, @"Existing executor was not found");
+    STAssertNil([RKExecutor existingExecutorNamed:@"com.roundabout.rk.tests.executor.nonexistent"], @"Nonexistent executor was found");
+    STAssertTrue([[RKExecutor allExecutors] containsObject:executor], @"Executor is not listed");
+
+    STAssertThrows([executor setMaxConcurrentOperationCount:4], @"Executor width was changed");
+    STAssertThrows([executor setName:@"com.roundabout.rk.tests.executor.renamed"], @"Executor was renamed");
+}
+
+- (void)testWidth
+{
+    RKExecutor *executor = [RKExecutor executorNamed:@"com.roundabout.rk.tests.executor.width"
+                                    qualityOfService:kRKExecutorQualityOfServiceUtility
+                                               width:1];
+
+    __block NSInteger concurrentCount = 0;
+    __block NSInteger maximumConcurrentCount = 0;
+    NSObject *lock = [NSObject new];
+    for (NSUInteger index = 0; index < 10; index++) {
+        [executor addOperationWithBlock:^{
+            @synchronized(lock) {
+                concurrentCount++;
+                maximumConcurrentCount = MAX(maximumConcurrentCount, concurrentCount);
+            }
+
+            usleep(1000);
+
+            @synchronized(lock) {
+                concurrentCount--;
+            }
+        }];
+    }
+
+    [executor waitUntilAllOperationsAreFinished];
+    STAssertEquals(maximumConcurrentCount, (NSInteger)1, @"Serial executor ran operations concurrently");
+}
+
+- (void)testMetrics
+{
+    RKExecutor *executor = [RKExecutor executorNamed:@"com.roundabout.rk.tests.executor.metrics"
+                                    qualityOfService:kRKExecutorQualityOfServiceUtility
+                                               width:1];
+    [executor resetMetrics];
+
+    [executor setSuspended:YES];
+    for (NSUInteger index = 0; index < 3; index++) {
+        [executor addOperationWithBlock:^{
+            usleep(10000);
+        }];
+    }
+
+    NSOperation *cancelledOperation = [NSBlockOperation blockOperationWithBlock:^{}];
+    [executor addOperation:cancelledOperation];
+
+    STAssertEquals(executor.queueDepth, (NSUInteger)4, @"Suspended executor has wrong queue depth");
+    STAssertTrue([[executor snapshot][@"suspended"] boolValue], @"Snapshot does not report suspension");
+
+    [cancelledOperation cancel];
+    [executor setSuspended:NO];
+    [executor waitUntilAllOperationsAreFinished];
+
+    //Completion is observed after the operation queue considers the operation finished.
+    [RunLoopHelper runUntil:^BOOL{ return (executor.queueDepth == 0 && executor.runningCount == 0); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+
+    NSDictionary *snapshot = [executor snapshot];
+    STAssertEqualObjects(snapshot[@"queueDepth"], @0, @"Operations are still waiting");
+    STAssertEqualObjects(snapshot[@"running"], @0, @"Operations are still running");
+    STAssertEqualObjects(snapshot[@"completed"], @3, @"Cancelled operation was counted as completed");
+    STAssertTrue([snapshot[@"runTime"][@"mean"] doubleValue] >= 0.01, @"Run time was not measured");
+    STAssertTrue([snapshot[@"waitTime"][@"max"] doubleValue] > 0.0, @"Wait time was not measured");
+    STAssertTrue([snapshot[@"throughput"] doubleValue] > 0.0, @"Throughput was not measured");
+}
+
+@end
@@ -8,6 +8,7 @@
 
 #import "RKFileSystemCacheManagerTests.h"
 #import "RKFileSystemCacheManager.h"
+#import <libkern/OSAtomic.h>
 
 static NSString *const kTestDataString = @"this is some lovely data you've got here";
 
@@ -82,7 +83,197 @@ static NSString *const kNonExistentCacheIdentiifer = @"SmarchFifth";
     STAssertNil(error, @"unexpected error");
 }
 
-- (void)test5RemovingAllData
+- (void)test5RecoveringMetadata
+{
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    NSError *error = nil;
+    BOOL success = [self.cacheManager cacheData:testData
+                                  forIdentifier:kCacheIdentifier
+                                   withRevision:kRevision
+                                          error:&error];
+    STAssertTrue(success, @"could not store cache");
+    
+    [self.cacheManager flushMetadata];
+    
+    RKFileSystemCacheManager *recoveredCacheManager = [RKFileSystemCacheManager new];
+    STAssertEqualObjects([recoveredCacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"revision was not recovered from metadata log");
+    STAssertNotNil([recoveredCacheManager validationDateForIdentifier:kCacheIdentifier], @"validation date was not recovered from metadata log");
+    STAssertEquals(recoveredCacheManager.cacheSize, self.cacheManager.cacheSize, @"cache size was not recovered from metadata log");
+    
+    success = [self.cacheManager removeCacheForIdentifier:kCacheIdentifier error:&error];
+    STAssertTrue(success, @"removing cache failed");
+    
+    [self.cacheManager flushMetadata];
+    
+    recoveredCacheManager = [RKFileSystemCacheManager new];
+    STAssertNil([recoveredCacheManager revisionForIdentifier:kCacheIdentifier], @"removal was not recovered from metadata log");
+}
+
+- (void)test6ConcurrentAccess
+{
+    NSUInteger const identifierCount = 64;
+    NSUInteger const iterationCount = 2000;
+    
+    NSMutableArray *identifiers = [NSMutableArray array];
+    for (NSUInteger index = 0; index < identifierCount; index++)
+        [identifiers addObject:[NSString stringWithFormat:@"ConcurrentValue%ld", (long)index]];
+    
+    __block volatile int32_t mismatches = 0;
+    __block volatile int32_t failures = 0;
+    NSDate *startDate = [NSDate date];
+    dispatch_apply(iterationCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        NSString *identifier = identifiers[iteration % identifierCount];
+        NSData *expectedData = [[identifier stringByAppendingString:kTestDataString] dataUsingEncoding:NSUTF8StringEncoding];
+        
+        switch (iteration % 4) {
+            case 0: {
+                if(![self.cacheManager cacheData:expectedData forIdentifier:identifier withRevision:kRevision error:NULL])
+                    OSAtomicIncrement32(&failures);
+                break;
+            }
+                
+            case 1: {
+                NSError *error = nil;
+                NSData *data = [self.cacheManager cachedDataForIdentifier:identifier error:&error];
+                if(error)
+                    OSAtomicIncrement32(&failures);
+                else if(data && ![data isEqualToData:expectedData])
+                    OSAtomicIncrement32(&mismatches);
+                break;
+            }
+                
+            case 2: {
+                NSString *revision = [self.cacheManager revisionForIdentifier:identifier];
+                if(revision && ![revision isEqualToString:kRevision])
+                    OSAtomicIncrement32(&mismatches);
+                break;
+            }
+                
+            case 3: {
+                [self.cacheManager validationDateForIdentifier:identifier];
+                break;
+            }
+        }
+    });
+    NSTimeInterval duration = -[startDate timeIntervalSinceNow];
+    NSLog(@"[BENCHMARK] %ld mixed cache operations across %ld identifiers in %f seconds (%.0f operations per second)",
+          (long)iterationCount, (long)identifierCount, duration, iterationCount / duration);
+    
+    STAssertEquals(failures, 0, @"unexpected failures");
+    STAssertEquals(mismatches, 0, @"readers observed partially written or mismatched data");
+    
+    for (NSString *identifier in identifiers) {
+        NSError *error = nil;
+        BOOL success = [self.cacheManager removeCacheForIdentifier:identifier error:&error];
+        STAssertTrue(success, @"removing cache failed");
+    }
+}
+
+///Returns an array of response bodies to measure compression against.
+///
+///When the `RK_CACHE_CORPUS_PATH` environment variable names a directory, every file in it
+///is used, e.g. responses recorded from the Ex.fm API or the Player's stand-in server with
+///`curl`. Otherwise a corpus of responses shaped like Ex.fm song lists is generated.
+- (NSArray *)compressionCorpus
+{
+    NSString *corpusPath = [[NSProcessInfo processInfo] environment][@"RK_CACHE_CORPUS_PATH"];
+    if(corpusPath) {
+        NSMutableArray *corpus = [NSMutableArray array];
+        for (NSString *filename in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:corpusPath error:NULL]) {
+            NSData *response = [NSData dataWithContentsOfFile:[corpusPath stringByAppendingPathComponent:filename]];
+            if(response)
+                [corpus addObject:response];
+        }
+        
+        return corpus;
+    }
+    
+    NSMutableArray *corpus = [NSMutableArray array];
+    for (NSUInteger page = 0; page < 50; page++) {
+        NSMutableArray *songs = [NSMutableArray array];
+        for (NSUInteger index = 0; index < 20; index++) {
+            NSString *songID = RKStringGetMD5Hash([NSString stringWithFormat:@"%ld-%ld", (long)page, (long)index]);
+            [songs addObject:@{
+                @"id": songID,
+                @"title": [NSString stringWithFormat:@"Song %ld of Page %ld", (long)index, (long)page],
+                @"artist": [NSString stringWithFormat:@"Artist %ld", (long)((page * 7 + index) % 40)],
+                @"album": [NSString stringWithFormat:@"Album %ld", (long)((page * 3 + index) % 25)],
+                @"url": [NSString stringWithFormat:@"http://example.com/audio/%@.mp3", songID],
+                @"image": @{
+                    @"small": [NSString stringWithFormat:@"http://example.com/artwork/%@/small", songID],
+                    @"medium": [NSString stringWithFormat:@"http://example.com/artwork/%@/medium", songID],
+                    @"large": [NSString stringWithFormat:@"http://example.com/artwork/%@/large", songID],
+                },
+                @"loved_count": @((page * 31 + index * 17) % 500),
+                @"sources": @[ [NSString stringWithFormat:@"http://blog%ld.example.com/post/%@", (long)(index % 9), songID] ],
+            }];
+        }
+        
+        NSDictionary *response = @{@"status_code": @200, @"status_text": @"OK", @"results": @(songs.count), @"songs": songs};
+        [corpus addObject:[NSJSONSerialization dataWithJSONObject:response options:0 error:NULL]];
+    }
+    
+    return corpus;
+}
+
+///Caches and then retrieves every item in a corpus, returning the size of the
+///cache it occupied and the time taken to write and read it.
+- (NSUInteger)storeCorpus:(NSArray *)corpus writeDuration:(NSTimeInterval *)outWriteDuration readDuration:(NSTimeInterval *)outReadDuration
+{
+    NSUInteger initialCacheSize = self.cacheManager.cacheSize;
+    
+    NSDate *startDate = [NSDate date];
+    [corpus enumerateObjectsUsingBlock:^(NSData *response, NSUInteger index, BOOL *stop) {
+        NSString *identifier = [NSString stringWithFormat:@"CorpusValue%ld", (long)index];
+        [self.cacheManager cacheData:response forIdentifier:identifier withRevision:kRevision error:NULL];
+    }];
+    *outWriteDuration = -[startDate timeIntervalSinceNow];
+    
+    NSUInteger cacheSize = self.cacheManager.cacheSize - initialCacheSize;
+    
+    startDate = [NSDate date];
+    [corpus enumerateObjectsUsingBlock:^(NSData *response, NSUInteger index, BOOL *stop) {
+        NSString *identifier = [NSString stringWithFormat:@"CorpusValue%ld", (long)index];
+        NSData *data = [self.cacheManager cachedDataForIdentifier:identifier error:NULL];
+        STAssertEqualObjects(data, response, @"retrieved data does not match cached data");
+    }];
+    *outReadDuration = -[startDate timeIntervalSinceNow];
+    
+    for (NSUInteger index = 0; index < corpus.count; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"CorpusValue%ld", (long)index];
+        [self.cacheManager removeCacheForIdentifier:identifier error:NULL];
+    }
+    
+    return cacheSize;
+}
+
+- (void)test7CompressingData
+{
+    NSArray *corpus = [self compressionCorpus];
+    STAssertTrue(corpus.count > 0, @"corpus is empty");
+    
+    NSUInteger corpusSize = [[corpus valueForKeyPath:@"@sum.length"] unsignedIntegerValue];
+    
+    NSTimeInterval rawWriteDuration = 0.0, rawReadDuration = 0.0;
+    self.cacheManager.compressesCachedData = NO;
+    NSUInteger rawCacheSize = [self storeCorpus:corpus writeDuration:&rawWriteDuration readDuration:&rawReadDuration];
+    
+    NSTimeInterval compressedWriteDuration = 0.0, compressedReadDuration = 0.0;
+    self.cacheManager.compressesCachedData = YES;
+    NSUInteger compressedCacheSize = [self storeCorpus:corpus writeDuration:&compressedWriteDuration readDuration:&compressedReadDuration];
+    
+    NSLog(@"[BENCHMARK] %ld responses, %ld bytes", (long)corpus.count, (long)corpusSize);
+    NSLog(@"[BENCHMARK] uncompressed: %ld bytes on disk, write %f seconds, read %f seconds",
+          (long)rawCacheSize, rawWriteDuration, rawReadDuration);
+    NSLog(@"[BENCHMARK] compressed: %ld bytes on disk, write %f seconds, read %f seconds",
+          (long)compressedCacheSize, compressedWriteDuration, compressedReadDuration);
+    NSLog(@"[BENCHMARK] effective capacity gain %.2fx", (double)rawCacheSize / MAX(compressedCacheSize, 1));
+    
+    STAssertTrue(compressedCacheSize <= rawCacheSize, @"compression increased the size of the cache");
+}
+
+- (void)test8RemovingAllData
 {
     NSError *error = nil;
     BOOL success = [self.cacheManager removeAllCache:&error];
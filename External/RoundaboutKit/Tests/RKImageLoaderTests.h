@@ -0,0 +1,13 @@
+//
+//  RKImageLoaderTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKImageLoaderTests : SenTestCase
+
+@end
@@ -0,0 +1,191 @@
+//
+//  RKImageLoaderTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKImageLoaderTests.h"
+#import "RKImageLoader.h"
+#import "RKMockURLProtocol.h"
+#import "RunLoopHelper.h"
+
+#define DEFAULT_TIMEOUT 1.0
+
+@implementation RKImageLoaderTests
+
+- (void)tearDown
+{
+    [super tearDown];
+    
+    [RKMockURLProtocol removeAllRoutes];
+}
+
+#pragma mark -
+
+///Routes a URL to the test image.
+- (void)routeTestImageToURL:(NSURL *)url
+{
+    NSURL *testImageLocation = [[NSBundle bundleForClass:[self class]] URLForImageResource:@"RKPostProcessorTestImage"];
+    NSData *testImageData = [NSData dataWithContentsOfURL:testImageLocation];
+    
+    [RKMockURLProtocol on:url
+               withMethod:@"GET"
+          yieldStatusCode:200
+                  headers:@{@"Content-Type": @"image/png", @"Status": @"200"}
+                     data:testImageData];
+}
+
+///Returns a URL that is not in the cache manager.
+- (NSURL *)makeUncachedURL
+{
+    NSString *urlString = [NSString stringWithFormat:@"http://test/image/%@.png", [[NSProcessInfo processInfo] globallyUniqueString]];
+    return [NSURL URLWithString:urlString];
+}
+
+///Returns a URL that is not in the cache manager, routed to the test image.
+- (NSURL *)makeImageURL
+{
+    NSURL *url = [self makeUncachedURL];
+    [self routeTestImageToURL:url];
+    return url;
+}
+
+- (void)testCoalescedLoads
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *url = [self makeImageURL];
+    
+    __block NSImage *firstImage = nil;
+    __block NSImage *secondImage = nil;
+    [imageLoader loadImageAtURL:url forOwner:@"first" completionHandler:^(NSImage *image) {
+        firstImage = image;
+    }];
+    [imageLoader loadImageAtURL:url forOwner:@"second" completionHandler:^(NSImage *image) {
+        secondImage = image;
+    }];
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (firstImage != nil && secondImage != nil); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Timed out");
+    STAssertEquals(firstImage, secondImage, @"Owners of the same URL were given different images");
+    STAssertEquals([imageLoader cachedImageAtURL:url], firstImage, @"Loaded image was not kept in memory");
+    
+    __block NSImage *cachedImage = nil;
+    [imageLoader loadImageAtURL:url forOwner:@"third" completionHandler:^(NSImage *image) {
+        cachedImage = image;
+    }];
+    STAssertEquals(cachedImage, firstImage, @"Image in memory was not yielded immediately");
+}
+
+- (void)testStoppingSharedLoad
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *url = [self makeImageURL];
+    
+    __block BOOL stoppedOwnerWasCalled = NO;
+    __block NSImage *remainingImage = nil;
+    [imageLoader loadImageAtURL:url forOwner:@"stopped" completionHandler:^(NSImage *image) {
+        stoppedOwnerWasCalled = YES;
+    }];
+    [imageLoader loadImageAtURL:url forOwner:@"remaining" completionHandler:^(NSImage *image) {
+        remainingImage = image;
+    }];
+    [imageLoader stopLoadingImagesForOwner:@"stopped"];
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (remainingImage != nil); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Timed out");
+    STAssertFalse(stoppedOwnerWasCalled, @"Stopped owner was called back");
+}
+
+- (void)testStoppingLastOwnerCancelsLoad
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *url = [self makeImageURL];
+    
+    __block BOOL wasCalled = NO;
+    [imageLoader loadImageAtURL:url forOwner:@"owner" completionHandler:^(NSImage *image) {
+        wasCalled = YES;
+    }];
+    [imageLoader stopLoadingImagesForOwner:@"owner"];
+    
+    [RunLoopHelper runFor:DEFAULT_TIMEOUT];
+    STAssertFalse(wasCalled, @"Stopped owner was called back");
+    STAssertNil([imageLoader cachedImageAtURL:url], @"Cancelled load was kept in memory");
+}
+
+- (void)testChangingOwnerURL
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *firstURL = [self makeImageURL];
+    NSURL *secondURL = [self makeImageURL];
+    
+    __block BOOL firstWasCalled = NO;
+    __block NSImage *secondImage = nil;
+    [imageLoader loadImageAtURL:firstURL forOwner:@"owner" completionHandler:^(NSImage *image) {
+        firstWasCalled = YES;
+    }];
+    [imageLoader loadImageAtURL:secondURL forOwner:@"owner" completionHandler:^(NSImage *image) {
+        secondImage = image;
+    }];
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (secondImage != nil); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Timed out");
+    STAssertFalse(firstWasCalled, @"Superseded load was called back");
+}
+
+#pragma mark -
+
+- (void)testTransientFailuresAreRetried
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *url = [self makeUncachedURL];
+    [RKMockURLProtocol on:url
+               withMethod:@"GET"
+               yieldError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]];
+    
+    __block BOOL failedLoadWasCalled = NO;
+    [imageLoader loadImageAtURL:url forOwner:@"failed" completionHandler:^(NSImage *image) {
+        failedLoadWasCalled = YES;
+    }];
+    [RunLoopHelper runFor:0.3];
+    STAssertFalse(failedLoadWasCalled, @"Failed load was called back");
+    
+    [RKMockURLProtocol removeAllRoutes];
+    [self routeTestImageToURL:url];
+    
+    __block NSImage *retriedImage = nil;
+    [imageLoader loadImageAtURL:url forOwner:@"retried" completionHandler:^(NSImage *image) {
+        retriedImage = image;
+    }];
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (retriedImage != nil); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Image was not retried after a network error");
+}
+
+- (void)testMissingImagesAreNotRetried
+{
+    RKImageLoader *imageLoader = [RKImageLoader new];
+    NSURL *url = [self makeUncachedURL];
+    [RKMockURLProtocol on:url
+               withMethod:@"GET"
+          yieldStatusCode:404
+                  headers:@{@"Content-Type": @"text/plain", @"Status": @"404"}
+                     data:[@"not found" dataUsingEncoding:NSUTF8StringEncoding]];
+    
+    [imageLoader loadImageAtURL:url forOwner:@"missing" completionHandler:nil];
+    [RunLoopHelper runFor:0.3];
+    
+    [RKMockURLProtocol removeAllRoutes];
+    [self routeTestImageToURL:url];
+    
+    __block BOOL retriedLoadWasCalled = NO;
+    [imageLoader loadImageAtURL:url forOwner:@"retried" completionHandler:^(NSImage *image) {
+        retriedLoadWasCalled = YES;
+    }];
+    
+    [RunLoopHelper runFor:0.3];
+    STAssertFalse(retriedLoadWasCalled, @"Missing image was retried");
+}
+
+@end
@@ -0,0 +1,13 @@
+//
+//  RKMemoryCacheTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/27/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKMemoryCacheTests : SenTestCase
+
+@end
@@ -0,0 +1,62 @@
+//
+//  RKMemoryCacheTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/27/13.
+//
+//
+
+#import "RKMemoryCacheTests.h"
+#import "RKMemoryCache.h"
+
+static NSString *const kKey = @"MyLovelyArbitraryValue";
+static NSString *const kRevision = @"1";
+
+@implementation RKMemoryCacheTests
+
+- (void)testStorage
+{
+    RKMemoryCache *memoryCache = [[RKMemoryCache alloc] initWithCapacity:1024];
+    id transform = [NSObject new];
+    
+    [memoryCache setObject:@"fizz" forKey:kKey revision:kRevision transform:transform cost:10];
+    STAssertEqualObjects([memoryCache objectForKey:kKey revision:kRevision transform:transform], @"fizz", @"object was not stored");
+    STAssertEquals(memoryCache.totalCost, (NSUInteger)10, @"unexpected total cost");
+    
+    STAssertNil([memoryCache objectForKey:kKey revision:kRevision transform:[NSObject new]], @"object was returned for a different transform");
+    STAssertNil([memoryCache objectForKey:kKey revision:kRevision transform:transform], @"object was not discarded after it was found to be stale");
+    
+    [memoryCache setObject:@"buzz" forKey:kKey revision:kRevision transform:nil cost:10];
+    STAssertNil([memoryCache objectForKey:kKey revision:@"2" transform:nil], @"object was returned for a different revision");
+    STAssertEquals(memoryCache.totalCost, (NSUInteger)0, @"stale object was not removed");
+}
+
+- (void)testEviction
+{
+    RKMemoryCache *memoryCache = [[RKMemoryCache alloc] initWithCapacity:100];
+    
+    [memoryCache setObject:@"a" forKey:@"a" revision:kRevision transform:nil cost:60];
+    [memoryCache setObject:@"b" forKey:@"b" revision:kRevision transform:nil cost:60];
+    STAssertNil([memoryCache objectForKey:@"a" revision:kRevision transform:nil], @"object was not evicted");
+    STAssertEqualObjects([memoryCache objectForKey:@"b" revision:kRevision transform:nil], @"b", @"wrong object was evicted");
+    STAssertTrue(memoryCache.totalCost <= memoryCache.capacity, @"memory cache exceeded its capacity");
+    
+    memoryCache.capacity = 10;
+    STAssertNil([memoryCache objectForKey:@"b" revision:kRevision transform:nil], @"object was not evicted when capacity was lowered");
+}
+
+- (void)testRemoval
+{
+    RKMemoryCache *memoryCache = [[RKMemoryCache alloc] initWithCapacity:1024];
+    [memoryCache setObject:@"a" forKey:@"a" revision:kRevision transform:nil cost:10];
+    [memoryCache setObject:@"b" forKey:@"b" revision:kRevision transform:nil cost:10];
+    
+    [memoryCache removeObjectForKey:@"a"];
+    STAssertNil([memoryCache objectForKey:@"a" revision:kRevision transform:nil], @"object was not removed");
+    
+    [memoryCache removeAllObjects];
+    STAssertNil([memoryCache objectForKey:@"b" revision:kRevision transform:nil], @"objects were not removed");
+    STAssertEquals(memoryCache.totalCost, (NSUInteger)0, @"unexpected total cost");
+}
+
+@end
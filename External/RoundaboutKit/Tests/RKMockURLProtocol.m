@@ -139,13 +139,13 @@ static NSMutableArray *_Routes = nil;
 {
     RKMockURLProtocolRoute *route = [[self class] routeForRequest:self.request];
     if(route.error) {
-        [[RKQueueManager commonQueue] addOperationWithBlock:^{
+        [[RKExecutor commonExecutor] addOperationWithBlock:^{
             if(self.canceled)
                 return;
             [self.client URLProtocol:self didFailWithError:route.error];
         }];
     } else {
-        [[RKQueueManager commonQueue] addOperationWithBlock:^{
+        [[RKExecutor commonExecutor] addOperationWithBlock:^{
             NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:route.URL
                                                                       statusCode:route.statusCode
                                                                      HTTPVersion:@"HTTP/1.1"
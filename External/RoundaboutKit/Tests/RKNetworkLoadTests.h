@@ -0,0 +1,23 @@
+//
+//  RKNetworkLoadTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/24/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+///The RKNetworkLoadTests class drives the RoundaboutKit network stack at scale
+///against the local stand-in server in `Tools/StandInServer` of the Player project.
+///
+///The tests are skipped unless the `RK_STANDIN_SERVER_URL` environment variable is set
+///to the root URL of a running stand-in, e.g. `http://127.0.0.1:8089`. The number of
+///units of work and the number of units in flight can be changed through the
+///`RK_LOAD_TEST_UNITS` and `RK_LOAD_TEST_CONCURRENCY` environment variables.
+///
+///Each test logs its throughput and latency percentiles, followed by the
+///`RKURLRequestMetrics` snapshot collected while it ran.
+@interface RKNetworkLoadTests : SenTestCase
+
+@end
@@ -0,0 +1,301 @@
+//
+//  RKNetworkLoadTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/24/13.
+//
+//
+
+#import "RKNetworkLoadTests.h"
+
+static NSString *const kStandInServerURLEnvironmentKey = @"RK_STANDIN_SERVER_URL";
+static NSString *const kUnitsEnvironmentKey = @"RK_LOAD_TEST_UNITS";
+static NSString *const kConcurrencyEnvironmentKey = @"RK_LOAD_TEST_CONCURRENCY";
+
+static NSUInteger const kDefaultUnits = 400;
+static NSUInteger const kDefaultConcurrency = 16;
+
+///The number of distinct queries and albums used, so that some requests repeat.
+static NSUInteger const kDistinctQueryCount = 100;
+static NSUInteger const kDistinctArtworkCount = 400;
+
+///The page size used when syncing loved songs.
+static NSUInteger const kSyncPageSize = 100;
+
+///The number of scrobbles submitted in each batch.
+static NSUInteger const kScrobbleBatchSize = 50;
+
+///The maximum time a single scenario is allowed to run for.
+static NSTimeInterval const kScenarioTimeout = (5.0 * RK_TIME_MINUTE);
+
+///The block type used to perform a single unit of work in a load test scenario.
+///
+/// \param  index       The index of the unit of work.
+/// \param  completion  The block to invoke when the unit of work has finished. Required.
+///
+typedef void(^RKLoadTestUnitBlock)(NSUInteger index, void(^completion)(BOOL succeeded));
+
+@interface RKNetworkLoadTests ()
+
+@property NSURL *serverURL;
+@property RKRequestFactory *exfmRequestFactory;
+@property RKRequestFactory *lastfmRequestFactory;
+@property RKRequestFactory *artworkRequestFactory;
+
+@property NSUInteger units;
+@property NSUInteger concurrency;
+
+@end
+
+@implementation RKNetworkLoadTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+    NSString *serverURLString = environment[kStandInServerURLEnvironmentKey];
+    if(!serverURLString)
+        return;
+
+    self.serverURL = [NSURL URLWithString:serverURLString];
+    self.units = [environment[kUnitsEnvironmentKey] integerValue] ?: kDefaultUnits;
+    self.concurrency = [environment[kConcurrencyEnvironmentKey] integerValue] ?: kDefaultConcurrency;
+
+    NSOperationQueue *requestQueue = [NSOperationQueue new];
+    requestQueue.name = @"com.roundabout.rk.RKNetworkLoadTests.requestQueue";
+
+    self.exfmRequestFactory = [[RKRequestFactory alloc] initWithBaseURL:[self.serverURL URLByAppendingPathComponent:@"api/v3"]
+                                                       readCacheManager:[RKFileSystemCacheManager sharedCacheManager]
+                                                      writeCacheManager:nil
+                                                           requestQueue:requestQueue
+                                                          postProcessor:kRKJSONPostProcessorBlock];
+    self.lastfmRequestFactory = [[RKRequestFactory alloc] initWithBaseURL:[self.serverURL URLByAppendingPathComponent:@"2.0"]
+                                                         readCacheManager:nil
+                                                        writeCacheManager:nil
+                                                             requestQueue:requestQueue
+                                                            postProcessor:kRKJSONPostProcessorBlock];
+    self.artworkRequestFactory = [[RKRequestFactory alloc] initWithBaseURL:[self.serverURL URLByAppendingPathComponent:@"artwork"]
+                                                          readCacheManager:[RKFileSystemCacheManager sharedCacheManager]
+                                                         writeCacheManager:nil
+                                                              requestQueue:requestQueue
+                                                             postProcessor:nil];
+
+    [[RKURLRequestMetrics sharedMetrics] reset];
+    [RKURLRequestMetrics sharedMetrics].enabled = YES;
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+
+    [RKURLRequestMetrics sharedMetrics].enabled = NO;
+    [[RKURLRequestMetrics sharedMetrics] reset];
+}
+
+#pragma mark - Running Scenarios
+
+///Returns the value at a given percentile of an array of sorted latencies.
+static double PercentileOfSortedLatencies(NSArray *sortedLatencies, double percentile)
+{
+    if(sortedLatencies.count == 0)
+        return 0.0;
+
+    NSUInteger index = (NSUInteger)ceil(sortedLatencies.count * percentile);
+    return [sortedLatencies[MIN(MAX(index, 1), sortedLatencies.count) - 1] doubleValue];
+}
+
+///Performs a given number of units of work with a fixed number in flight, logging the results.
+///
+/// \param  name    The name of the scenario, used when logging. Required.
+/// \param  units   The number of units of work to perform.
+/// \param  unit    The block that performs a single unit of work. Required.
+///
+/// \result YES if every unit of work completed before the scenario timed out; NO otherwise.
+- (BOOL)runScenarioNamed:(NSString *)name units:(NSUInteger)units unit:(RKLoadTestUnitBlock)unit
+{
+    NSParameterAssert(name);
+    NSParameterAssert(unit);
+
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:units];
+    __block NSUInteger nextIndex = 0;
+    __block NSUInteger completedUnits = 0;
+    __block NSUInteger failedUnits = 0;
+    NSObject *lock = [NSObject new];
+
+    CFAbsoluteTime scenarioStartTime = CFAbsoluteTimeGetCurrent();
+
+    //Closed loop: each completed unit starts the next, keeping `concurrency` units in flight.
+    __block void(^startNextUnit)();
+    void(^startNextUnitStrong)() = ^{
+        NSUInteger index;
+        @synchronized(lock) {
+            if(nextIndex >= units)
+                return;
+
+            index = nextIndex++;
+        }
+
+        CFAbsoluteTime unitStartTime = CFAbsoluteTimeGetCurrent();
+        unit(index, ^(BOOL succeeded) {
+            CFAbsoluteTime unitDuration = CFAbsoluteTimeGetCurrent() - unitStartTime;
+            void(^next)() = nil;
+            @synchronized(lock) {
+                [latencies addObject:@(unitDuration * 1000.0)];
+                completedUnits++;
+                if(!succeeded)
+                    failedUnits++;
+
+                next = startNextUnit;
+            }
+
+            //Nil once the scenario has finished or timed out.
+            if(next)
+                next();
+        });
+    };
+    startNextUnit = startNextUnitStrong;
+
+    for (NSUInteger index = 0; index < MIN(self.concurrency, units); index++)
+        startNextUnit();
+
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{
+        @synchronized(lock) {
+            return (completedUnits == units);
+        }
+    } orSecondsHasElapsed:kScenarioTimeout];
+
+    CFAbsoluteTime scenarioDuration = CFAbsoluteTimeGetCurrent() - scenarioStartTime;
+
+    @synchronized(lock) {
+        startNextUnit = nil;
+
+        NSArray *sortedLatencies = [latencies sortedArrayUsingSelector:@selector(compare:)];
+        NSLog(@"[LOAD] %@: %lu units (%lu failed), %lu in flight, %.2f s, %.1f units/s, "
+              @"p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms",
+              name, (unsigned long)completedUnits, (unsigned long)failedUnits, (unsigned long)self.concurrency,
+              scenarioDuration, completedUnits / scenarioDuration,
+              PercentileOfSortedLatencies(sortedLatencies, 0.50),
+              PercentileOfSortedLatencies(sortedLatencies, 0.90),
+              PercentileOfSortedLatencies(sortedLatencies, 0.99),
+              [[sortedLatencies lastObject] doubleValue]);
+    }
+
+    NSData *metricsSnapshot = [[RKURLRequestMetrics sharedMetrics] JSONSnapshot:NULL];
+    NSLog(@"[LOAD] %@ metrics: %@", name, [[NSString alloc] initWithData:metricsSnapshot encoding:NSUTF8StringEncoding]);
+
+    return finishedNaturally;
+}
+
+///Realizes a given promise, invoking a completion block with whether or not it succeeded.
+- (void)realizePromise:(RKPromise *)promise completion:(void(^)(BOOL succeeded, id value))completion
+{
+    static NSOperationQueue *callbackQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        callbackQueue = [NSOperationQueue new];
+        callbackQueue.name = @"com.roundabout.rk.RKNetworkLoadTests.callbackQueue";
+    });
+
+    [promise then:^(id value) {
+        completion(YES, value);
+    } otherwise:^(NSError *error) {
+        completion(NO, nil);
+    } onQueue:callbackQueue];
+}
+
+#pragma mark - Scenarios
+
+- (void)testSearch
+{
+    if(!self.serverURL) {
+        NSLog(@"[LOAD] Skipping %s, %@ is not set", __PRETTY_FUNCTION__, kStandInServerURLEnvironmentKey);
+        return;
+    }
+
+    BOOL finished = [self runScenarioNamed:@"search" units:self.units unit:^(NSUInteger index, void (^completion)(BOOL)) {
+        NSString *path = [NSString stringWithFormat:@"/song/search/load-test-query-%lu", (unsigned long)(index % kDistinctQueryCount)];
+        RKURLRequestPromise *searchPromise = [self.exfmRequestFactory GETRequestPromiseWithPath:path parameters:@{@"results": @50, @"start": @0}];
+        [self realizePromise:searchPromise completion:^(BOOL succeeded, id value) {
+            completion(succeeded);
+        }];
+    }];
+    STAssertTrue(finished, @"search scenario timed out");
+}
+
+- (void)testPagingSync
+{
+    if(!self.serverURL) {
+        NSLog(@"[LOAD] Skipping %s, %@ is not set", __PRETTY_FUNCTION__, kStandInServerURLEnvironmentKey);
+        return;
+    }
+
+    //Each unit is a full sync of one user's loved songs, one page at a time.
+    NSUInteger users = MAX(self.units / 10, 1);
+    BOOL finished = [self runScenarioNamed:@"paging sync" units:users unit:^(NSUInteger index, void (^completion)(BOOL)) {
+        NSString *path = [NSString stringWithFormat:@"/user/load-test-user-%lu/loved", (unsigned long)index];
+
+        __block void(^fetchPage)(NSUInteger);
+        void(^fetchPageStrong)(NSUInteger) = ^(NSUInteger start) {
+            RKURLRequestPromise *pagePromise = [self.exfmRequestFactory GETRequestPromiseWithPath:path parameters:@{@"results": @(kSyncPageSize), @"start": @(start)}];
+            [self realizePromise:pagePromise completion:^(BOOL succeeded, NSDictionary *response) {
+                NSUInteger total = [RKFilterOutNSNull(response[@"total"]) unsignedIntegerValue];
+                if(succeeded && start + kSyncPageSize < total) {
+                    fetchPage(start + kSyncPageSize);
+                } else {
+                    fetchPage = nil;
+                    completion(succeeded);
+                }
+            }];
+        };
+        fetchPage = fetchPageStrong;
+        fetchPage(0);
+    }];
+    STAssertTrue(finished, @"paging sync scenario timed out");
+}
+
+- (void)testScrobbling
+{
+    if(!self.serverURL) {
+        NSLog(@"[LOAD] Skipping %s, %@ is not set", __PRETTY_FUNCTION__, kStandInServerURLEnvironmentKey);
+        return;
+    }
+
+    BOOL finished = [self runScenarioNamed:@"scrobbling" units:self.units unit:^(NSUInteger index, void (^completion)(BOOL)) {
+        NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithDictionary:@{@"method": @"track.scrobble", @"format": @"json"}];
+        long long timestamp = (long long)[[NSDate date] timeIntervalSince1970];
+        for (NSUInteger scrobbleIndex = 0; scrobbleIndex < kScrobbleBatchSize; scrobbleIndex++) {
+            parameters[[NSString stringWithFormat:@"track[%lu]", (unsigned long)scrobbleIndex]] = [NSString stringWithFormat:@"Song %lu", (unsigned long)(index * kScrobbleBatchSize + scrobbleIndex)];
+            parameters[[NSString stringWithFormat:@"artist[%lu]", (unsigned long)scrobbleIndex]] = @"Load Test";
+            parameters[[NSString stringWithFormat:@"timestamp[%lu]", (unsigned long)scrobbleIndex]] = @(timestamp - scrobbleIndex * 240);
+        }
+
+        RKURLRequestPromise *scrobblePromise = [self.lastfmRequestFactory POSTRequestPromiseWithPath:@"/"
+                                                                                          parameters:nil
+                                                                                                body:parameters
+                                                                                            bodyType:kRKRequestFactoryBodyTypeURLParameters];
+        [self realizePromise:scrobblePromise completion:^(BOOL succeeded, NSDictionary *response) {
+            completion(succeeded && response[@"scrobbles"] != nil);
+        }];
+    }];
+    STAssertTrue(finished, @"scrobbling scenario timed out");
+}
+
+- (void)testArtworkFetch
+{
+    if(!self.serverURL) {
+        NSLog(@"[LOAD] Skipping %s, %@ is not set", __PRETTY_FUNCTION__, kStandInServerURLEnvironmentKey);
+        return;
+    }
+
+    BOOL finished = [self runScenarioNamed:@"artwork fetch" units:self.units unit:^(NSUInteger index, void (^completion)(BOOL)) {
+        NSString *path = [NSString stringWithFormat:@"/%lu/large", (unsigned long)(index % kDistinctArtworkCount)];
+        RKURLRequestPromise *artworkPromise = [self.artworkRequestFactory GETRequestPromiseWithPath:path parameters:nil];
+        [self realizePromise:artworkPromise completion:^(BOOL succeeded, NSData *data) {
+            completion(succeeded && data.length > 0);
+        }];
+    }];
+    STAssertTrue(finished, @"artwork fetch scenario timed out");
+}
+
+@end
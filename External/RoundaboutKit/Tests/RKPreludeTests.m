@@ -8,6 +8,62 @@
 
 #import "RKPreludeTests.h"
 
+///The number of string arrays identifiers are generated for in `-testGenerateIdentifierBenchmark`.
+#define IDENTIFIER_BENCHMARK_COUNT  20000
+
+///The implementation of `RKGenerateIdentifierForStrings` prior to single-pass sanitization,
+///kept to verify the current implementation against, and to benchmark it.
+static NSString *LegacyGenerateIdentifierForStrings(NSArray *strings)
+{
+    static NSMutableCharacterSet *charactersToRemove = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        charactersToRemove = [NSMutableCharacterSet new];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet symbolCharacterSet]];
+        [charactersToRemove formUnionWithCharacterSet:[NSCharacterSet punctuationCharacterSet]];
+    });
+    
+    NSArray *sanitizedStrings = RKCollectionMapToArray(strings, ^(NSString *string) {
+        NSMutableString *resultString = [[string lowercaseString] mutableCopy];
+        for (NSUInteger index = 0; index < [resultString length]; index++)
+        {
+            unichar character = [resultString characterAtIndex:index];
+            if([charactersToRemove characterIsMember:character])
+            {
+                [resultString deleteCharactersInRange:NSMakeRange(index, 1)];
+                index--;
+            }
+        }
+        
+        return resultString;
+    });
+    NSArray *sortedStrings = [sanitizedStrings sortedArrayUsingSelector:@selector(compare:)];
+    return [sortedStrings componentsJoinedByString:@""];
+}
+
+///Returns string arrays resembling the name, artist, and album of songs in a library.
+static NSArray *GenerateIdentifierStringArrays(NSUInteger count)
+{
+    NSArray *samples = @[
+        @"Bohemian Rhapsody", @"Queen", @"A Night at the Opera",
+        @"(Don't Fear) The Reaper", @"Blue Öyster Cult", @"Agents of Fortune",
+        @"Sigur Rós", @"Hoppípolla", @"Takk...",
+        @"Motörhead", @"Ace of Spades", @"Ace of Spades [Deluxe Edition]",
+        @"Straße", @"İstanbul", @"東京事変",
+        @"Track #1 — Intro", @"AC/DC", @"Back in Black (Remastered)",
+        @"👍 Emoji Song", @"   padded   ", @"",
+    ];
+    
+    NSMutableArray *arraysOfStrings = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger index = 0; index < count; index++) {
+        NSString *name = [NSString stringWithFormat:@"%@ %lu", samples[index % samples.count], (unsigned long)index];
+        [arraysOfStrings addObject:@[ name, samples[(index * 7) % samples.count], samples[(index * 13) % samples.count] ]];
+    }
+    
+    return arraysOfStrings;
+}
+
 @implementation RKPreludeTests {
     NSArray *_pregeneratedArray;
     NSDictionary *_pregeneratedDictionary;
@@ -151,6 +207,65 @@
     STAssertEqualObjects(RKGenerateIdentifierForStrings(@[@"first", @"Second", @"()[].,", @"THIRD"]), @"firstsecondthird", @"RKGenerateIdentifierForStrings returned incorrect value");
 }
 
+- (void)testGenerateIdentifierMatchesLegacyImplementation
+{
+    for (NSArray *strings in GenerateIdentifierStringArrays(500)) {
+        STAssertEqualObjects(RKGenerateIdentifierForStrings(strings), LegacyGenerateIdentifierForStrings(strings), @"RKGenerateIdentifierForStrings differs from legacy implementation for %@", strings);
+    }
+    
+    NSString *longString = [@"" stringByPaddingToLength:1000 withString:@"Long String, " startingAtIndex:0];
+    NSArray *manyStrings = @[ @"j", @"i", @"h", @"g", @"f", @"e", @"d", @"c", @"b", @"a", longString ];
+    STAssertEqualObjects(RKGenerateIdentifierForStrings(manyStrings), LegacyGenerateIdentifierForStrings(manyStrings), @"RKGenerateIdentifierForStrings differs from legacy implementation past its inline buffers");
+}
+
+- (void)testGenerateIdentifierHashForStrings
+{
+    STAssertEquals(RKGenerateIdentifierHashForStrings(@[@"First", @"second"]), RKGenerateIdentifierHashForStrings(@[@"second!", @"FIRST"]), @"Equal identifiers have different hashes");
+    STAssertFalse(RKGenerateIdentifierHashForStrings(@[@"first"]) == RKGenerateIdentifierHashForStrings(@[@"second"]), @"Different identifiers have equal hashes");
+}
+
+- (void)testGenerateIdentifiersForStringArrays
+{
+    NSArray *arraysOfStrings = GenerateIdentifierStringArrays(2000);
+    NSArray *identifiers = RKGenerateIdentifiersForStringArrays(arraysOfStrings);
+    STAssertEquals(identifiers.count, arraysOfStrings.count, @"RKGenerateIdentifiersForStringArrays returned wrong number of identifiers");
+    
+    [arraysOfStrings enumerateObjectsUsingBlock:^(NSArray *strings, NSUInteger index, BOOL *stop) {
+        STAssertEqualObjects(identifiers[index], RKGenerateIdentifierForStrings(strings), @"RKGenerateIdentifiersForStringArrays returned identifier out of order");
+    }];
+}
+
+- (void)testGenerateIdentifierBenchmark
+{
+    NSArray *arraysOfStrings = GenerateIdentifierStringArrays(IDENTIFIER_BENCHMARK_COUNT);
+    
+    NSTimeInterval (^measure)(void(^)()) = ^NSTimeInterval(void(^block)()) {
+        NSDate *start = [NSDate date];
+        @autoreleasepool {
+            block();
+        }
+        return -[start timeIntervalSinceNow];
+    };
+    
+    NSTimeInterval legacyDuration = measure(^{
+        for (NSArray *strings in arraysOfStrings)
+            (void)LegacyGenerateIdentifierForStrings(strings);
+    });
+    NSTimeInterval singlePassDuration = measure(^{
+        for (NSArray *strings in arraysOfStrings)
+            (void)RKGenerateIdentifierForStrings(strings);
+    });
+    NSTimeInterval batchDuration = measure(^{
+        (void)RKGenerateIdentifiersForStringArrays(arraysOfStrings);
+    });
+    
+    NSLog(@"%d identifiers: legacy %.3fs, single pass %.3fs (%.1fx), batch %.3fs (%.1fx)",
+          IDENTIFIER_BENCHMARK_COUNT,
+          legacyDuration,
+          singlePassDuration, legacyDuration / singlePassDuration,
+          batchDuration, legacyDuration / batchDuration);
+}
+
 - (void)testFilterOutNSNull
 {
     STAssertNil(RKFilterOutNSNull([NSNull null]), @"RKFilterOutNSNull didn't filter out NSNull");
@@ -14,6 +14,28 @@
 
 #pragma mark -
 
+///A promise which records whether or not it was cancelled.
+@interface RKCancellableTestPromise : RKPromise
+
+@property BOOL wasCancelled;
+
+- (void)cancel:(id)sender;
+
+@end
+
+@implementation RKCancellableTestPromise
+
+- (void)cancel:(id)sender
+{
+    self.wasCancelled = YES;
+    
+    [super cancel:sender];
+}
+
+@end
+
+#pragma mark -
+
 @interface RKPromiseTests ()
 
 @property RKPossibility *successPossibility;
@@ -119,6 +141,234 @@
     STAssertEqualObjects(results, (@[ @0, @1, @2, @3, @4 ]), @"RKRealizePromises yielded wrong value");
 }
 
+#pragma mark - Test Combinators
+
+- (void)testCombinatorsUnderContention
+{
+    NSUInteger const kNumberOfPromises = 5000;
+    NSUInteger const kNumberOfFirstValues = 100;
+    NSArray *promises = RKCollectionGenerateArray(kNumberOfPromises, ^(NSUInteger promiseNumber) {
+        return [RKPromise new];
+    });
+    
+    RKPromise *all = [RKPromise all:promises];
+    RKPromise *allSettled = [RKPromise allSettled:promises];
+    RKPromise *first = [RKPromise first:kNumberOfFirstValues ofPromises:promises];
+    RKPromise *any = [RKPromise any:promises];
+    RKPromise *race = [RKPromise race:promises];
+    
+    dispatch_apply(kNumberOfPromises, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+        [promises[index] accept:@(index)];
+    });
+    
+    NSError *error = nil;
+    NSArray *expectedValues = RKCollectionGenerateArray(kNumberOfPromises, ^(NSUInteger index) {
+        return @(index);
+    });
+    STAssertEqualObjects([all await:&error], expectedValues, @"all yielded values out of order");
+    STAssertNil(error, @"all unexpectedly yielded error");
+    
+    NSArray *possibilities = [allSettled await:&error];
+    STAssertEqualObjects([possibilities valueForKey:@"value"], expectedValues, @"allSettled yielded outcomes out of order");
+    
+    NSArray *firstValues = [first await:&error];
+    STAssertEquals(firstValues.count, kNumberOfFirstValues, @"first yielded the wrong number of values");
+    STAssertEqualObjects(firstValues, [firstValues sortedArrayUsingSelector:@selector(compare:)], @"first yielded values out of order");
+    
+    STAssertNotNil([any await:&error], @"any did not yield a value");
+    STAssertNotNil([race await:&error], @"race did not yield a value");
+}
+
+- (void)testCombinatorsCancelUndecidedPromises
+{
+    RKCancellableTestPromise *pending = [RKCancellableTestPromise new];
+    RKPromise *failed = [RKPromise rejectedPromiseWithError:self.errorPossibility.error];
+    
+    NSError *error = nil;
+    STAssertNil([[RKPromise all:@[ pending, failed ]] await:&error], @"all unexpectedly yielded value");
+    STAssertEqualObjects(error, self.errorPossibility.error, @"all did not yield the first error");
+    STAssertTrue(pending.wasCancelled, @"all did not cancel undecided promise");
+    
+    RKCancellableTestPromise *loser = [RKCancellableTestPromise new];
+    id result = [[RKPromise race:@[ loser, [RKPromise acceptedPromiseWithValue:@"winner"] ]] await:&error];
+    STAssertEqualObjects(result, @"winner", @"race yielded wrong value");
+    STAssertTrue(loser.wasCancelled, @"race did not cancel losing promise");
+    
+    RKCancellableTestPromise *settling = [RKCancellableTestPromise new];
+    RKPromise *allSettled = [RKPromise allSettled:@[ settling, failed ]];
+    [settling accept:@"settled"];
+    STAssertEquals([[allSettled await:&error] count], (NSUInteger)2, @"allSettled yielded wrong number of outcomes");
+    STAssertFalse(settling.wasCancelled, @"allSettled cancelled a promise");
+}
+
+- (void)testCombinatorsWithoutEnoughValues
+{
+    NSArray *failures = @[ [RKPromise rejectedPromiseWithError:self.errorPossibility.error],
+                           [RKPromise rejectedPromiseWithError:self.errorPossibility.error] ];
+    
+    NSError *error = nil;
+    STAssertNil([[RKPromise any:failures] await:&error], @"any unexpectedly yielded value");
+    STAssertEquals(error.code, (NSInteger)kRKPromiseErrorNotEnoughValues, @"any yielded wrong error");
+    STAssertEqualObjects(error.userInfo[NSUnderlyingErrorKey], self.errorPossibility.error, @"any did not include underlying error");
+    
+    NSArray *mixed = @[ [RKPromise acceptedPromiseWithValue:@1], failures[0] ];
+    STAssertNil([[RKPromise first:2 ofPromises:mixed] await:&error], @"first unexpectedly yielded value");
+    STAssertEquals(error.code, (NSInteger)kRKPromiseErrorNotEnoughValues, @"first yielded wrong error");
+    
+    STAssertEqualObjects([[RKPromise all:@[]] await:&error], @[], @"all of nothing yielded wrong value");
+}
+
+#pragma mark - Test Subscribers
+
+- (void)testMultipleSubscribers
+{
+    RKMockPromise *testPromise = [[RKMockPromise alloc] initWithResult:self.successPossibility
+                                                              duration:DEFAULT_DURATION];
+    
+    __block NSUInteger numberOfCallbacks = 0;
+    for (NSUInteger index = 0; index < 3; index++) {
+        [testPromise then:^(id data) {
+            numberOfCallbacks++;
+        } otherwise:^(NSError *error) {
+            //Do nothing
+        }];
+    }
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (numberOfCallbacks == 3); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"subscribers timed out");
+    
+    __block BOOL lateSubscriberWasCalled = NO;
+    [testPromise then:^(id data) {
+        lateSubscriberWasCalled = YES;
+    } otherwise:^(NSError *error) {
+        //Do nothing
+    }];
+    
+    finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return lateSubscriberWasCalled; } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"subscriber of settled promise timed out");
+    STAssertEquals(numberOfCallbacks, (NSUInteger)3, @"subscriber was called more than once");
+}
+
+- (void)testSettlingTwice
+{
+    RKPromise *testPromise = [RKPromise acceptedPromiseWithValue:nil];
+    STAssertThrows([testPromise accept:@"fizz"], @"promise was accepted twice");
+    STAssertThrows([testPromise reject:self.errorPossibility.error], @"promise was rejected after being accepted");
+}
+
+- (void)testCancellingSettledPromise
+{
+    RKPromise *testPromise = [RKPromise acceptedPromiseWithValue:@"fizz"];
+    [testPromise cancel:nil];
+    STAssertFalse(testPromise.cancelled, @"settled promise was cancelled");
+    
+    __block BOOL lateSubscriberWasCalled = NO;
+    [testPromise then:^(id data) {
+        lateSubscriberWasCalled = YES;
+    } otherwise:^(NSError *error) {
+        //Do nothing
+    }];
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return lateSubscriberWasCalled; } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"subscriber of cancelled settled promise was dropped");
+}
+
+#pragma mark - Test Chaining
+
+- (void)testMap
+{
+    RKMockPromise *testPromise = [[RKMockPromise alloc] initWithResult:self.successPossibility
+                                                              duration:DEFAULT_DURATION];
+    
+    NSError *error = nil;
+    id result = [[testPromise map:^id(NSString *value) {
+        return @(value.length);
+    }] await:&error];
+    STAssertEqualObjects(result, @([self.successPossibility.value length]), @"map yielded wrong value");
+    STAssertNil(error, @"map unexpectedly yielded error");
+    
+    RKMockPromise *failingPromise = [[RKMockPromise alloc] initWithResult:self.errorPossibility
+                                                                 duration:DEFAULT_DURATION];
+    __block BOOL mapperWasCalled = NO;
+    result = [[failingPromise map:^id(id value) {
+        mapperWasCalled = YES;
+        return value;
+    }] await:&error];
+    STAssertNil(result, @"map unexpectedly yielded value");
+    STAssertEqualObjects(error, self.errorPossibility.error, @"map did not propagate error");
+    STAssertFalse(mapperWasCalled, @"mapper was called for error");
+}
+
+- (void)testFlatMap
+{
+    RKPromise *chain = [[RKPromise acceptedPromiseWithValue:@1] flatMap:^RKPromise *(NSNumber *value) {
+        return [[RKMockPromise alloc] initWithResult:[[RKPossibility alloc] initWithValue:@(value.integerValue + 1)]
+                                            duration:0.05];
+    }];
+    chain = [chain flatMap:^RKPromise *(NSNumber *value) {
+        return [RKPromise acceptedPromiseWithValue:@(value.integerValue * 10)];
+    }];
+    
+    NSError *error = nil;
+    id result = [chain await:&error];
+    STAssertEqualObjects(result, @20, @"flatMap yielded wrong value");
+    STAssertNil(error, @"flatMap unexpectedly yielded error");
+}
+
+- (void)testRecover
+{
+    RKPromise *recovered = [[RKPromise rejectedPromiseWithError:self.errorPossibility.error] recover:^RKPromise *(NSError *error) {
+        return [RKPromise acceptedPromiseWithValue:@"recovered"];
+    }];
+    
+    NSError *error = nil;
+    STAssertEqualObjects([recovered await:&error], @"recovered", @"recover yielded wrong value");
+    STAssertNil(error, @"recover unexpectedly yielded error");
+    
+    RKPromise *unrecovered = [[RKPromise rejectedPromiseWithError:self.errorPossibility.error] recover:^RKPromise *(NSError *error) {
+        return nil;
+    }];
+    STAssertNil([unrecovered await:&error], @"recover unexpectedly yielded value");
+    STAssertEqualObjects(error, self.errorPossibility.error, @"recover did not propagate error");
+}
+
+#pragma mark - Test Throughput
+
+- (void)testThroughput
+{
+    NSUInteger const kNumberOfPromises = 100000;
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    __block NSUInteger numberOfCallbacks = 0;
+    NSOperationQueue *callbackQueue = [NSOperationQueue mainQueue];
+    for (NSUInteger index = 0; index < kNumberOfPromises; index++) {
+        [[RKPromise acceptedPromiseWithValue:@(index)] then:^(id value) {
+            numberOfCallbacks++;
+        } otherwise:^(NSError *error) {
+            //Do nothing
+        } onQueue:callbackQueue];
+    }
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (numberOfCallbacks == kNumberOfPromises); } orSecondsHasElapsed:30.0];
+    CFAbsoluteTime settledDuration = CFAbsoluteTimeGetCurrent() - startTime;
+    STAssertTrue(finishedNaturally, @"settled promises timed out");
+    
+    startTime = CFAbsoluteTimeGetCurrent();
+    RKPromise *chain = [RKPromise acceptedPromiseWithValue:@0];
+    for (NSUInteger index = 0; index < kNumberOfPromises; index++) {
+        chain = [chain map:^id(NSNumber *value) {
+            return @(value.unsignedIntegerValue + 1);
+        }];
+    }
+    id result = [chain await:NULL];
+    CFAbsoluteTime chainDuration = CFAbsoluteTimeGetCurrent() - startTime;
+    STAssertEqualObjects(result, @(kNumberOfPromises), @"map chain yielded wrong value");
+    
+    NSLog(@"[BENCHMARK] %lu settled promises delivered to a queue at %.0f/sec, %lu maps chained at %.0f/sec",
+          (unsigned long)kNumberOfPromises, kNumberOfPromises / settledDuration,
+          (unsigned long)kNumberOfPromises, kNumberOfPromises / chainDuration);
+}
+
 #pragma mark - Test Await
 
 - (void)testSuccessAwait
@@ -143,4 +393,22 @@
     STAssertNotNil(error, @"RKAwait failed to yield error");
 }
 
+- (void)testCancelledAwait
+{
+    RKPromise *testPromise = [RKPromise new];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.05 * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [testPromise cancel:nil];
+    });
+    
+    NSError *error = nil;
+    id result = [testPromise await:&error];
+    STAssertNil(result, @"RKAwait unexpectedly yielded value");
+    STAssertEquals(error.code, (NSInteger)kRKPromiseErrorCancelled, @"RKAwait yielded wrong error");
+    
+    error = nil;
+    result = [testPromise await:&error];
+    STAssertNil(result, @"RKAwait unexpectedly yielded value");
+    STAssertEquals(error.code, (NSInteger)kRKPromiseErrorCancelled, @"RKAwait yielded wrong error for already cancelled promise");
+}
+
 @end
@@ -0,0 +1,13 @@
+//
+//  RKStallWatchdogTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKStallWatchdogTests : SenTestCase
+
+@end
@@ -0,0 +1,140 @@
+//
+//  RKStallWatchdogTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKStallWatchdogTests.h"
+#import "RKStallWatchdog.h"
+#import "RunLoopHelper.h"
+
+#define DEFAULT_TIMEOUT 1.0
+
+#define TEST_THRESHOLD  0.1
+
+@implementation RKStallWatchdogTests {
+    NSURL *_logDirectoryLocation;
+    RKStallWatchdog *_watchdog;
+}
+
+- (void)setUp
+{
+    [super setUp];
+
+    NSString *directoryName = [NSString stringWithFormat:@"RKStallWatchdogTests-%@", [[NSProcessInfo processInfo] globallyUniqueString]];
+    _logDirectoryLocation = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:directoryName]];
+
+    _watchdog = [RKStallWatchdog new];
+    _watchdog.threshold = TEST_THRESHOLD;
+    _watchdog.logDirectoryLocation = _logDirectoryLocation;
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+
+    [_watchdog stop];
+    _watchdog = nil;
+
+    [[NSFileManager defaultManager] removeItemAtURL:_logDirectoryLocation error:NULL];
+}
+
+#pragma mark -
+
+///Blocks the main thread for a given length of time under a work label.
+- (void)stallMainThreadFor:(NSTimeInterval)duration withLabel:(NSString *)label
+{
+    RKStallWatchdogPushWorkLabel(label);
+    [NSThread sleepForTimeInterval:duration];
+    RKStallWatchdogPopWorkLabel();
+}
+
+///Runs the main run loop until the watchdog has recorded a given number of stalls.
+- (void)waitForStallCount:(NSUInteger)stallCount
+{
+    [RunLoopHelper runUntil:^BOOL{
+        return [_watchdog.statistics[@"stallCount"] unsignedIntegerValue] >= stallCount;
+    } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+}
+
+#pragma mark -
+
+- (void)testBlocksAreNotWrappedWhenInactive
+{
+    dispatch_block_t block = ^{};
+    STAssertEquals(RKStallWatchdogWrapBlock(@"label", block), block, @"Block was wrapped with no watchdog running");
+}
+
+- (void)testIdleMainThreadIsNotStalled
+{
+    [_watchdog start];
+    STAssertTrue(_watchdog.isRunning, @"Watchdog did not start");
+
+    [RunLoopHelper runFor:TEST_THRESHOLD * 5];
+
+    STAssertEquals([_watchdog.statistics[@"stallCount"] unsignedIntegerValue], (NSUInteger)0, @"Idle main thread was reported as stalled");
+}
+
+- (void)testStallsAreDetectedAndLabelled
+{
+    [_watchdog start];
+    [RunLoopHelper runFor:TEST_THRESHOLD];
+
+    [self stallMainThreadFor:TEST_THRESHOLD * 4 withLabel:@"test stall"];
+    [self waitForStallCount:1];
+
+    NSDictionary *statistics = _watchdog.statistics;
+    STAssertEquals([statistics[@"stallCount"] unsignedIntegerValue], (NSUInteger)1, @"Stall was not detected");
+    STAssertTrue([statistics[@"maxDuration"] doubleValue] >= TEST_THRESHOLD, @"Stall was not timed");
+
+    NSDictionary *offender = [statistics[@"offenders"] firstObject];
+    STAssertEqualObjects(offender[@"signature"], @"test stall", @"Stall was not grouped by its work label");
+
+#if defined(__x86_64__) || defined(__i386__)
+    NSString *backtrace = [offender[@"lastBacktrace"] componentsJoinedByString:@"\n"];
+    STAssertTrue([backtrace rangeOfString:@"stallMainThreadFor"].location != NSNotFound, @"Backtrace does not include the stalling method");
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+    NSString *log = [NSString stringWithContentsOfURL:[_logDirectoryLocation URLByAppendingPathComponent:@"Stalls.log"] encoding:NSUTF8StringEncoding error:NULL];
+    STAssertTrue([log rangeOfString:@"Work: test stall"].location != NSNotFound, @"Stall was not logged");
+}
+
+- (void)testOffendersAreRankedByTotalDuration
+{
+    [_watchdog start];
+    [RunLoopHelper runFor:TEST_THRESHOLD];
+
+    [self stallMainThreadFor:TEST_THRESHOLD * 3 withLabel:@"short stall"];
+    [self waitForStallCount:1];
+
+    [self stallMainThreadFor:TEST_THRESHOLD * 8 withLabel:@"long stall"];
+    [self waitForStallCount:2];
+
+    NSArray *signatures = [_watchdog.statistics[@"offenders"] valueForKey:@"signature"];
+    STAssertEqualObjects(signatures, (@[ @"long stall", @"short stall" ]), @"Offenders were not ranked");
+}
+
+- (void)testStatisticsPersistAcrossRuns
+{
+    [_watchdog start];
+    [RunLoopHelper runFor:TEST_THRESHOLD];
+
+    [self stallMainThreadFor:TEST_THRESHOLD * 4 withLabel:@"persistent stall"];
+    [self waitForStallCount:1];
+    [_watchdog stop];
+
+    RKStallWatchdog *nextWatchdog = [RKStallWatchdog new];
+    nextWatchdog.logDirectoryLocation = _logDirectoryLocation;
+    [nextWatchdog start];
+    [nextWatchdog stop];
+
+    NSDictionary *offender = [nextWatchdog.statistics[@"offenders"] firstObject];
+    STAssertEqualObjects(offender[@"signature"], @"persistent stall", @"Statistics were not loaded from summary");
+
+    [nextWatchdog resetStatistics];
+    STAssertEquals([nextWatchdog.statistics[@"stallCount"] unsignedIntegerValue], (NSUInteger)0, @"Statistics were not reset");
+}
+
+@end
@@ -0,0 +1,13 @@
+//
+//  RKStreamTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKStreamTests : SenTestCase
+
+@end
@@ -0,0 +1,129 @@
+//
+//  RKStreamTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKStreamTests.h"
+#import "RKStream.h"
+#import "RunLoopHelper.h"
+
+#define DEFAULT_TIMEOUT 1.0
+
+@implementation RKStreamTests
+
+///Returns a stream which yields the given batches, then ends.
+- (RKStream *)streamWithBatches:(NSArray *)batches
+{
+    return [[RKStream alloc] initWithProducer:^RKPromise *(NSUInteger batchIndex) {
+        if(batchIndex >= batches.count)
+            return nil;
+
+        return [RKPromise acceptedPromiseWithValue:batches[batchIndex]];
+    }];
+}
+
+#pragma mark -
+
+- (void)testAllElements
+{
+    RKStream *stream = [self streamWithBatches:@[ @[ @0, @1, @2 ], @[ @3, @4 ], @[] ]];
+
+    NSError *error = nil;
+    NSArray *elements = [[stream allElements] await:&error];
+    STAssertNil(error, @"Unexpected error");
+    STAssertEqualObjects(elements, (@[ @0, @1, @2, @3, @4 ]), @"Elements were not delivered in order");
+    STAssertTrue(stream.isExhausted, @"Stream was not exhausted");
+}
+
+- (void)testDemand
+{
+    RKStream *stream = [self streamWithBatches:@[ @[ @0, @1, @2 ], @[ @3 ] ]];
+
+    NSMutableArray *elements = [NSMutableArray array];
+    __block BOOL completed = NO;
+    [stream subscribeWithElement:^(id element) {
+        [elements addObject:element];
+    } completion:^(NSError *error) {
+        completed = YES;
+    } onQueue:[NSOperationQueue mainQueue]];
+
+    [stream requestElements:2];
+    [RunLoopHelper runUntil:^BOOL{ return (elements.count >= 2); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    [RunLoopHelper runFor:0.1];
+    STAssertEqualObjects(elements, (@[ @0, @1 ]), @"Stream did not deliver exactly the requested elements");
+    STAssertFalse(completed, @"Stream completed before its elements were delivered");
+
+    [stream requestElements:kRKStreamUnboundedDemand];
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return completed; } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Timed out");
+    STAssertEqualObjects(elements, (@[ @0, @1, @2, @3 ]), @"Stream did not deliver remaining elements");
+}
+
+- (void)testBufferCapacity
+{
+    __block NSUInteger batchesProduced = 0;
+    RKStream *stream = [[RKStream alloc] initWithProducer:^RKPromise *(NSUInteger batchIndex) {
+        batchesProduced++;
+        return [RKPromise acceptedPromiseWithValue:@[ @(batchIndex), @(batchIndex) ]];
+    }];
+    stream.bufferCapacity = 4;
+
+    [stream subscribeWithElement:^(id element) {
+        //Do nothing.
+    } completion:nil onQueue:[NSOperationQueue mainQueue]];
+
+    [RunLoopHelper runFor:0.2];
+    STAssertEquals(batchesProduced, (NSUInteger)2, @"Stream produced past its buffer capacity");
+
+    [stream cancel:nil];
+}
+
+- (void)testErrorsFollowProducedElements
+{
+    NSError *batchError = [NSError errorWithDomain:@"RKFictitiousErrorDomain" code:'fail' userInfo:nil];
+    RKStream *stream = [[RKStream alloc] initWithProducer:^RKPromise *(NSUInteger batchIndex) {
+        if(batchIndex == 0)
+            return [RKPromise acceptedPromiseWithValue:@[ @0 ]];
+
+        return [RKPromise rejectedPromiseWithError:batchError];
+    }];
+
+    NSMutableArray *elements = [NSMutableArray array];
+    __block NSError *completionError = nil;
+    [stream subscribeWithElement:^(id element) {
+        [elements addObject:element];
+    } completion:^(NSError *error) {
+        completionError = error;
+    } onQueue:[NSOperationQueue mainQueue]];
+    [stream requestElements:kRKStreamUnboundedDemand];
+
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (completionError != nil); } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+    STAssertTrue(finishedNaturally, @"Timed out");
+    STAssertEqualObjects(elements, (@[ @0 ]), @"Elements produced before error were not delivered");
+    STAssertEqualObjects(completionError, batchError, @"Stream did not end with batch error");
+}
+
+- (void)testCancellation
+{
+    RKPromise *pendingBatch = [RKPromise new];
+    RKStream *stream = [[RKStream alloc] initWithProducer:^RKPromise *(NSUInteger batchIndex) {
+        return pendingBatch;
+    }];
+
+    RKCancellationToken *token = [RKCancellationToken new];
+    RKPromise *allElements = [stream allElements];
+    allElements.cancellationToken = token;
+
+    [RunLoopHelper runFor:0.1];
+    [token cancel];
+    [RunLoopHelper runUntil:^BOOL{ return pendingBatch.cancelled; } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+
+    STAssertTrue(stream.cancelled, @"Cancelling collected promise did not cancel stream");
+    STAssertTrue(pendingBatch.cancelled, @"Cancelling stream did not cancel pending batch");
+    STAssertEquals(allElements.state, RKPromiseStateNotRealized, @"Cancelled promise was settled");
+}
+
+@end
@@ -0,0 +1,13 @@
+//
+//  RKTraceTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKTraceTests : SenTestCase
+
+@end
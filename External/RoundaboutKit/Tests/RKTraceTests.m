@@ -0,0 +1,165 @@
+//
+//  RKTraceTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/28/13.
+//
+//
+
+#import "RKTraceTests.h"
+#import "RKTrace.h"
+#import "RKMockURLProtocol.h"
+#import "RunLoopHelper.h"
+
+#define DEFAULT_TIMEOUT 1.0
+
+#define PLAIN_TEXT_URL_STRING   @"http://trace-test/plaintext"
+
+@implementation RKTraceTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    RKTraceSetEnabled(YES);
+    RKTraceReset();
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+
+    RKTraceSetEnabled(NO);
+    RKTraceReset();
+
+    [RKMockURLProtocol removeAllRoutes];
+}
+
+#pragma mark -
+
+///Returns the exported events of a given category, in the order they were recorded.
+- (NSArray *)exportedEventsInCategory:(NSString *)category
+{
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:RKTraceCopyChromeTraceData() options:0 error:NULL];
+    STAssertNotNil(trace, @"Exported trace is not valid JSON");
+
+    return [trace[@"traceEvents"] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"cat == %@", category]];
+}
+
+///Returns the first event with a given phase and name in an array of events.
+- (NSDictionary *)eventWithPhase:(NSString *)phase name:(NSString *)name inEvents:(NSArray *)events
+{
+    return RKCollectionFindFirstMatch(events, ^BOOL(NSDictionary *event) {
+        return [event[@"ph"] isEqualToString:phase] && [event[@"name"] isEqualToString:name];
+    });
+}
+
+#pragma mark -
+
+- (void)testNothingIsRecordedWhenDisabled
+{
+    RKTraceSetEnabled(NO);
+
+    RKTraceBeginSpan("test", @"span", RKTraceMakeIdentifier(), 0, nil);
+    RKTraceBeginSlice("test", @"slice");
+    dispatch_block_t block = ^{};
+    STAssertEquals(RKTraceWrapBlock("test", @"hop", block), block, @"Block was wrapped while disabled");
+
+    STAssertEquals([self exportedEventsInCategory:@"test"].count, (NSUInteger)0, @"Events were recorded while disabled");
+}
+
+- (void)testWrappedBlocksRecordHops
+{
+    dispatch_block_t block = RKTraceWrapBlock("test", @"hop", ^{});
+    dispatch_sync(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), block);
+
+    NSArray *events = [self exportedEventsInCategory:@"test"];
+    NSArray *phases = [events valueForKey:@"ph"];
+    STAssertEqualObjects(phases, (@[ @"s", @"B", @"f", @"E" ]), @"Wrapped block did not record a hop into a slice");
+
+    NSDictionary *hopStart = events[0];
+    NSDictionary *hopEnd = events[2];
+    STAssertEqualObjects(hopStart[@"id"], hopEnd[@"id"], @"Hop ends were not linked");
+    STAssertEqualObjects(hopEnd[@"tid"], [events[1] objectForKey:@"tid"], @"Hop did not end in the slice running the block");
+}
+
+- (void)testPromiseSpans
+{
+    RKPromise *source = [RKPromise new];
+    source.promiseName = @"source";
+    source.cacheIdentifier = @"source-cache-identifier";
+
+    RKPromise *chain = [source map:^id(id value) {
+        return value;
+    }];
+    chain.promiseName = @"chain";
+
+    __block BOOL finished = NO;
+    [chain then:^(id value) {
+        finished = YES;
+    } otherwise:^(NSError *error) {
+        finished = YES;
+    } onQueue:[NSOperationQueue mainQueue]];
+
+    [source accept:@"value"];
+    [RunLoopHelper runUntil:^BOOL{ return finished; } orSecondsHasElapsed:DEFAULT_TIMEOUT];
+
+    NSArray *events = [self exportedEventsInCategory:@(kRKTraceCategoryPromise)];
+
+    NSDictionary *sourceBegin = [self eventWithPhase:@"b" name:@"source" inEvents:events];
+    STAssertNotNil(sourceBegin, @"Source span was not begun");
+    STAssertEqualObjects(sourceBegin[@"args"][@"detail"], @"source-cache-identifier", @"Source span was not labelled with its cache identifier");
+
+    NSDictionary *chainBegin = [self eventWithPhase:@"b" name:@"chain" inEvents:events];
+    STAssertNotNil(chainBegin, @"Chain span was not begun");
+    STAssertEqualObjects(chainBegin[@"args"][@"parent"], sourceBegin[@"id"], @"Chain span was not linked to source span");
+
+    NSDictionary *chainEnd = [self eventWithPhase:@"e" name:@"chain" inEvents:events];
+    STAssertEqualObjects(chainEnd[@"id"], chainBegin[@"id"], @"Chain span was not ended");
+    STAssertEqualObjects(chainEnd[@"args"][@"outcome"], @"value", @"Chain span has wrong outcome");
+
+    STAssertNotNil([self eventWithPhase:@"f" name:@"chain" inEvents:events], @"Hop to callback queue was not recorded");
+}
+
+- (void)testRequestSpans
+{
+    [RKMockURLProtocol on:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]
+               withMethod:@"GET"
+          yieldStatusCode:200
+                  headers:@{@"Content-Type": @"plain-text;charset=utf-8", @"Status": @"200"}
+                     data:[@"hello, world!" dataUsingEncoding:NSUTF8StringEncoding]];
+
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:nil
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.connectivityManager = [[RKConnectivityManager alloc] initWithHostName:@"localhost"];
+    testPromise.promiseName = @"trace-test";
+
+    NSError *error = nil;
+    STAssertNotNil([testPromise await:&error], @"Request unexpectedly failed");
+
+    NSArray *events = [self exportedEventsInCategory:@(kRKTraceCategoryRequest)];
+    NSDictionary *requestBegin = [self eventWithPhase:@"b" name:@"trace-test" inEvents:events];
+    STAssertNotNil(requestBegin, @"Request span was not begun");
+    STAssertEqualObjects(requestBegin[@"args"][@"detail"], PLAIN_TEXT_URL_STRING, @"Request span was not labelled with its URL");
+    STAssertEqualObjects(requestBegin[@"args"][@"parent"], ([NSString stringWithFormat:@"0x%llx", testPromise.traceIdentifier]), @"Request span was not linked to its promise");
+
+    NSDictionary *requestEnd = [self eventWithPhase:@"e" name:@"trace-test" inEvents:events];
+    STAssertEqualObjects(requestEnd[@"args"][@"outcome"], @"value", @"Request span has wrong outcome");
+}
+
+- (void)testOldestEventsAreOverwritten
+{
+    NSUInteger numberOfSlices = kRKTraceBufferCapacity + 10;
+    for (NSUInteger index = 0; index < numberOfSlices; index++)
+        RKTraceBeginSlice("test", [NSString stringWithFormat:@"%lu", (unsigned long)index]);
+
+    NSArray *events = [self exportedEventsInCategory:@"test"];
+    STAssertTrue(events.count <= kRKTraceBufferCapacity, @"Trace buffer grew past its capacity");
+    STAssertTrue([[events[0] objectForKey:@"name"] integerValue] >= 10, @"Oldest events were not overwritten");
+    STAssertEquals([[events.lastObject objectForKey:@"name"] integerValue], (NSInteger)(numberOfSlices - 1), @"Newest event was not kept");
+}
+
+@end
@@ -0,0 +1,13 @@
+//
+//  RKURLRequestMetricsTests.h
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/23/13.
+//
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+
+@interface RKURLRequestMetricsTests : SenTestCase
+
+@end
@@ -0,0 +1,121 @@
+//
+//  RKURLRequestMetricsTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 7/23/13.
+//
+//
+
+#import "RKURLRequestMetricsTests.h"
+#import "RKMockURLProtocol.h"
+
+#define PLAIN_TEXT_URL_STRING   @"http://metrics-test/plaintext"
+#define PLAIN_TEXT_STRING       (@"hello, world!")
+
+@implementation RKURLRequestMetricsTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    [RKMockURLProtocol on:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]
+               withMethod:@"GET"
+          yieldStatusCode:200
+                  headers:@{@"Content-Type": @"plain-text;charset=utf-8", @"Status": @"200"}
+                     data:[PLAIN_TEXT_STRING dataUsingEncoding:NSUTF8StringEncoding]];
+    
+    [[RKURLRequestMetrics sharedMetrics] reset];
+    [RKURLRequestMetrics sharedMetrics].enabled = YES;
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+    
+    [RKURLRequestMetrics sharedMetrics].enabled = NO;
+    [[RKURLRequestMetrics sharedMetrics] reset];
+    
+    [RKMockURLProtocol removeAllRoutes];
+}
+
+#pragma mark -
+
+- (RKURLRequestPromise *)makePlainTextRequest
+{
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:nil
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.connectivityManager = [[RKConnectivityManager alloc] initWithHostName:@"localhost"];
+    testPromise.promiseName = @"metrics-test";
+    return testPromise;
+}
+
+- (void)testRequestIsRecorded
+{
+    NSError *error = nil;
+    NSData *result = [[self makePlainTextRequest] await:&error];
+    STAssertNotNil(result, @"Request unexpectedly failed");
+    
+    NSDictionary *snapshot = [[RKURLRequestMetrics sharedMetrics] snapshot];
+    NSDictionary *hostSeries = snapshot[@"hosts"][@"metrics-test"];
+    STAssertNotNil(hostSeries, @"Request was not recorded by host");
+    STAssertEqualObjects(hostSeries[@"count"], @1, @"Wrong request count");
+    STAssertEqualObjects(hostSeries[@"failures"], @0, @"Wrong failure count");
+    STAssertEqualObjects(hostSeries[@"bytesIn"], @([PLAIN_TEXT_STRING lengthOfBytesUsingEncoding:NSUTF8StringEncoding]), @"Wrong byte count");
+    STAssertEqualObjects(hostSeries[@"cache"][@"none"], @1, @"Wrong cache outcome");
+    STAssertEqualObjects(hostSeries[@"duration"][@"count"], @1, @"Duration was not recorded");
+    
+    NSDictionary *promiseNameSeries = snapshot[@"promiseNames"][@"metrics-test"];
+    STAssertEqualObjects(promiseNameSeries[@"count"], @1, @"Request was not recorded by promise name");
+}
+
+- (void)testNothingIsRecordedWhenDisabled
+{
+    [RKURLRequestMetrics sharedMetrics].enabled = NO;
+    
+    NSError *error = nil;
+    NSData *result = [[self makePlainTextRequest] await:&error];
+    STAssertNotNil(result, @"Request unexpectedly failed");
+    
+    NSDictionary *snapshot = [[RKURLRequestMetrics sharedMetrics] snapshot];
+    STAssertEquals([snapshot[@"hosts"] count], (NSUInteger)0, @"Request was recorded while disabled");
+}
+
+- (void)testPercentiles
+{
+    RKURLRequestMetrics *metrics = [RKURLRequestMetrics new];
+    for (NSUInteger index = 0; index < 100; index++) {
+        RKURLRequestMetricsRecord *record = [RKURLRequestMetricsRecord new];
+        record.host = @"percentiles";
+        record.duration = (index < 90)? 0.003 : 0.5;
+        [metrics addRecord:record];
+    }
+    
+    NSDictionary *duration = [metrics snapshot][@"hosts"][@"percentiles"][@"duration"];
+    STAssertEqualObjects(duration[@"count"], @100, @"Wrong sample count");
+    STAssertEqualsWithAccuracy([duration[@"p50"] doubleValue], 4.0, 0.001, @"p50 should be the upper bound of the 2-4 ms bucket");
+    STAssertEqualsWithAccuracy([duration[@"p99"] doubleValue], 500.0, 0.001, @"p99 should be clamped to the maximum");
+    
+    NSDictionary *queueWait = [metrics snapshot][@"hosts"][@"percentiles"][@"queueWait"];
+    STAssertEqualObjects(queueWait[@"count"], @0, @"Unmeasured values should not be recorded");
+}
+
+- (void)testJSONSnapshot
+{
+    RKURLRequestMetrics *metrics = [RKURLRequestMetrics new];
+    RKURLRequestMetricsRecord *record = [RKURLRequestMetricsRecord new];
+    record.host = @"json";
+    record.cacheOutcome = kRKURLRequestCacheOutcomeRevalidated;
+    [metrics addRecord:record];
+    
+    NSError *error = nil;
+    NSData *JSONData = [metrics JSONSnapshot:&error];
+    STAssertNotNil(JSONData, @"Could not serialize snapshot. %@", error);
+    
+    NSDictionary *snapshot = [NSJSONSerialization JSONObjectWithData:JSONData options:0 error:&error];
+    STAssertEqualObjects(snapshot[@"hosts"][@"json"][@"cache"][@"revalidated"], @1, @"Wrong cache outcome in JSON");
+}
+
+@end
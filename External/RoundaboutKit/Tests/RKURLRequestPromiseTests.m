@@ -9,6 +9,7 @@
 #import "RKURLRequestPromiseTests.h"
 #import "RKMockURLProtocol.h"
 #import "RKMockURLRequestPromiseCacheManager.h"
+#import <libkern/OSAtomic.h>
 
 #define PLAIN_TEXT_URL_STRING   @"http://test/plaintext"
 #define PLAIN_TEXT_STRING       (@"hello, world!")
@@ -54,7 +55,7 @@
     RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                        cacheManager:nil
                                                                 useCacheWhenOffline:NO
-                                                                       requestQueue:[RKQueueManager commonQueue]];
+                                                                       requestQueue:[RKExecutor commonExecutor]];
     testPromise.connectivityManager = self.connectivityManager;
     return testPromise;
 }
@@ -136,7 +137,7 @@
     RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                        cacheManager:cacheManager
                                                                 useCacheWhenOffline:NO
-                                                                       requestQueue:[RKQueueManager commonQueue]];
+                                                                       requestQueue:[RKExecutor commonExecutor]];
     testPromise.cacheIdentifier = kCacheIdentifier;
     testPromise.connectivityManager = self.connectivityManager;
     
@@ -170,7 +171,7 @@
     RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                        cacheManager:cacheManager
                                                                 useCacheWhenOffline:NO
-                                                                       requestQueue:[RKQueueManager commonQueue]];
+                                                                       requestQueue:[RKExecutor commonExecutor]];
     testPromise.cacheIdentifier = kCacheIdentifier;
     testPromise.connectivityManager = self.connectivityManager;
     
@@ -206,7 +207,7 @@
     RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                        cacheManager:cacheManager
                                                                 useCacheWhenOffline:NO
-                                                                       requestQueue:[RKQueueManager commonQueue]];
+                                                                       requestQueue:[RKExecutor commonExecutor]];
     testPromise.cacheIdentifier = kCacheIdentifier;
     testPromise.connectivityManager = self.connectivityManager;
     
@@ -237,7 +238,7 @@
     RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                        cacheManager:cacheManager
                                                                 useCacheWhenOffline:NO
-                                                                       requestQueue:[RKQueueManager commonQueue]];
+                                                                       requestQueue:[RKExecutor commonExecutor]];
     testPromise.cacheIdentifier = kCacheIdentifier;
     testPromise.connectivityManager = self.connectivityManager;
     
@@ -259,6 +260,212 @@
     STAssertFalse(cacheManager.removeCacheForIdentifierErrorWasCalled, @"removeCacheForIdentifierErrorWasCalled was called");
 }
 
+- (void)testStaleWhileRevalidate
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    NSString *const kStaleString = @"This string is stale";
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeOtherArbitraryValue",
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [kStaleString dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:cacheManager
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.cacheIdentifier = kCacheIdentifier;
+    testPromise.connectivityManager = self.connectivityManager;
+    testPromise.cachePolicy = kRKURLRequestPromiseCachePolicyStaleWhileRevalidate;
+    
+    __block RKPossibility *revalidatedValue = nil;
+    [testPromise setRevalidationHandler:^(RKPossibility *maybeValue) {
+        revalidatedValue = maybeValue;
+    } callbackQueue:[NSOperationQueue mainQueue]];
+    
+    NSError *error = nil;
+    NSData *result = [testPromise await:&error];
+    STAssertNotNil(result, @"RKAwait unexpectedly failed");
+    
+    NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
+    STAssertEqualObjects(resultString, kStaleString, @"Cache was not yielded immediately");
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return (revalidatedValue != nil); } orSecondsHasElapsed:1.0];
+    STAssertTrue(finishedNaturally, @"revalidation timed out.");
+    STAssertFalse(testPromise.isRevalidating, @"Promise is still revalidating");
+    STAssertTrue(cacheManager.cacheDataForIdentifierWithRevisionErrorWasCalled, @"cacheDataForIdentifierWithRevisionError was not called");
+    STAssertFalse(cacheManager.wasCalledFromMainThread, @"Cache manager was called from main thread");
+    
+    NSString *revalidatedString = [[NSString alloc] initWithData:revalidatedValue.value encoding:NSUTF8StringEncoding];
+    STAssertEqualObjects(revalidatedString, PLAIN_TEXT_STRING, @"Wrong revalidated value was given");
+}
+
+- (void)testCacheFirst
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    NSString *const kCachedString = @"This string is cached";
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeOtherArbitraryValue",
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [kCachedString dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:cacheManager
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.cacheIdentifier = kCacheIdentifier;
+    testPromise.connectivityManager = self.connectivityManager;
+    testPromise.cachePolicy = kRKURLRequestPromiseCachePolicyCacheFirst;
+    
+    NSError *error = nil;
+    NSData *result = [testPromise await:&error];
+    NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
+    STAssertEqualObjects(resultString, kCachedString, @"Cache was not yielded");
+    
+    [RunLoopHelper runFor:0.2];
+    STAssertFalse(testPromise.isRevalidating, @"Cache-first promise is revalidating");
+    STAssertNil(testPromise.response, @"Cache-first promise made a request");
+    STAssertFalse(cacheManager.cacheDataForIdentifierWithRevisionErrorWasCalled, @"Cache-first promise wrote to cache");
+}
+
+- (void)testUnchangedRevalidationKeepsMemoryCache
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    NSString *const kStaleRevision = @"SomeOtherArbitraryValue";
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: kStaleRevision,
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [PLAIN_TEXT_STRING dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKMemoryCache *memoryCache = [[RKMemoryCache alloc] initWithCapacity:1024];
+    
+    __block int32_t postProcessorCallCount = 0;
+    RKPostProcessorBlock postProcessor = ^RKPossibility *(RKPossibility *maybeData, RKURLRequestPromise *request) {
+        OSAtomicIncrement32(&postProcessorCallCount);
+        return [maybeData refineValue:^RKPossibility *(NSData *data) {
+            return [[RKPossibility alloc] initWithValue:[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]];
+        }];
+    };
+    [memoryCache setObject:PLAIN_TEXT_STRING forKey:kCacheIdentifier revision:kStaleRevision transform:postProcessor cost:10];
+    
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:cacheManager
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.cacheIdentifier = kCacheIdentifier;
+    testPromise.connectivityManager = self.connectivityManager;
+    testPromise.cachePolicy = kRKURLRequestPromiseCachePolicyStaleWhileRevalidate;
+    testPromise.postProcessor = postProcessor;
+    testPromise.memoryCache = memoryCache;
+    
+    __block BOOL revalidationHandlerWasCalled = NO;
+    [testPromise setRevalidationHandler:^(RKPossibility *maybeValue) {
+        revalidationHandlerWasCalled = YES;
+    } callbackQueue:[NSOperationQueue mainQueue]];
+    
+    NSError *error = nil;
+    NSString *result = [testPromise await:&error];
+    STAssertEqualObjects(result, PLAIN_TEXT_STRING, @"Memory cache was not yielded immediately");
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return !testPromise.isRevalidating; } orSecondsHasElapsed:1.0];
+    STAssertTrue(finishedNaturally, @"revalidation timed out.");
+    STAssertTrue(cacheManager.cacheDataForIdentifierWithRevisionErrorWasCalled, @"cacheDataForIdentifierWithRevisionError was not called");
+    
+    [RunLoopHelper runFor:0.1];
+    STAssertFalse(revalidationHandlerWasCalled, @"Revalidation handler was called for unchanged data");
+    STAssertEquals(postProcessorCallCount, 0, @"Post-processor was called for unchanged data");
+    STAssertEqualObjects([memoryCache objectForKey:kCacheIdentifier revision:@"SomeArbitraryValue" transform:postProcessor], PLAIN_TEXT_STRING, @"Memory cache was not carried over to the new revision");
+}
+
+- (void)testCancellingSettledRequest
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeOtherArbitraryValue",
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [@"This string is stale" dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                       cacheManager:cacheManager
+                                                                useCacheWhenOffline:NO
+                                                                       requestQueue:[RKExecutor commonExecutor]];
+    testPromise.cacheIdentifier = kCacheIdentifier;
+    testPromise.connectivityManager = self.connectivityManager;
+    testPromise.cachePolicy = kRKURLRequestPromiseCachePolicyStaleWhileRevalidate;
+    
+    NSError *error = nil;
+    STAssertNotNil([testPromise await:&error], @"RKAwait unexpectedly failed");
+    
+    NSUInteger activityCount = [RKActivityManager sharedActivityManager].activityCount;
+    [testPromise cancel:nil];
+    [testPromise cancel:nil];
+    STAssertFalse(testPromise.cancelled, @"Settled request was cancelled");
+    STAssertEquals([RKActivityManager sharedActivityManager].activityCount, activityCount, @"Cancelling settled request changed activity count");
+    
+    BOOL finishedNaturally = [RunLoopHelper runUntil:^BOOL{ return !testPromise.isRevalidating; } orSecondsHasElapsed:1.0];
+    STAssertTrue(finishedNaturally, @"Cancelling settled request stopped its revalidation");
+    STAssertEquals([RKActivityManager sharedActivityManager].activityCount, activityCount, @"Revalidation changed activity count");
+}
+
+- (void)testMemoryCache
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeArbitraryValue",
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [PLAIN_TEXT_STRING dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKMemoryCache *memoryCache = [[RKMemoryCache alloc] initWithCapacity:1024];
+    
+    __block int32_t postProcessorCallCount = 0;
+    RKPostProcessorBlock postProcessor = ^RKPossibility *(RKPossibility *maybeData, RKURLRequestPromise *request) {
+        OSAtomicIncrement32(&postProcessorCallCount);
+        return [maybeData refineValue:^RKPossibility *(NSData *data) {
+            return [[RKPossibility alloc] initWithValue:[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]];
+        }];
+    };
+    
+    for (NSUInteger attempt = 0; attempt < 2; attempt++) {
+        NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+        RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                           cacheManager:cacheManager
+                                                                    useCacheWhenOffline:NO
+                                                                           requestQueue:[RKExecutor commonExecutor]];
+        testPromise.cacheIdentifier = kCacheIdentifier;
+        testPromise.connectivityManager = self.connectivityManager;
+        testPromise.postProcessor = postProcessor;
+        testPromise.memoryCache = memoryCache;
+        
+        NSError *error = nil;
+        NSString *result = [testPromise await:&error];
+        STAssertEqualObjects(result, PLAIN_TEXT_STRING, @"Wrong value was given");
+    }
+    
+    STAssertEquals(postProcessorCallCount, 1, @"Post-processor was called for memory cache hit");
+    STAssertTrue(memoryCache.totalCost > 0, @"Result was not stored in memory cache");
+}
+
 #pragma mark -
 
 - (void)testPostProcessorChaining
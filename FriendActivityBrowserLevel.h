@@ -16,10 +16,6 @@
 	
 	NSArray *mCachedActors;
 	NSArray *mCachedSongs;
-	
-	NSCache *mArtworkCache;
-	NSMutableSet *mArtworkBeingDownloaded;
-	NSOperationQueue *mArtworkDownloadQueue;
 }
 
 @end
@@ -18,10 +18,6 @@
 
 #import "Song.h"
 
-static NSUInteger kHighCacheLimit = 50;
-static NSUInteger kLowCacheLimit = 5;
-static NSUInteger kNumberOfConcurrentDownloads = 5;
-
 @implementation FriendActivityBrowserLevel
 
 - (void)dealloc
@@ -38,16 +34,6 @@ static NSUInteger kNumberOfConcurrentDownloads = 5;
 		mCachedActors = [NSArray array];
 		mCachedSongs = [NSArray array];
 		
-		mArtworkCache = [NSCache new];
-		[mArtworkCache setName:@"com.roundabout.pinna.ExploreBrowserLevel.mArtworkCache"];
-		[mArtworkCache setCountLimit:kLowCacheLimit];
-		
-		mArtworkBeingDownloaded = [NSMutableSet set];
-		
-		mArtworkDownloadQueue = [NSOperationQueue new];
-		[mArtworkDownloadQueue setMaxConcurrentOperationCount:kNumberOfConcurrentDownloads];
-		[mArtworkDownloadQueue setName:@"com.roundabout.pinna.ExploreBrowserLevel.mArtworkDownloadQueue"];
-		
 		[[NSNotificationCenter defaultCenter] addObserver:self
 												 selector:@selector(exfmSessionUpdatedCachedLovedSongsOfFriends:)
 													 name:ExfmSessionUpdatedCachedLovedSongsOfFriendsNotification
@@ -119,7 +105,6 @@ static NSUInteger kNumberOfConcurrentDownloads = 5;
 	[super levelWillBecomeVisibleInBrowser:browserView];
 	
     [self updateSongs];
-    [mArtworkCache setCountLimit:kHighCacheLimit];
 }
 
 - (void)levelWillBeRemovedFromBrowser:(RKBrowserView *)browserView
@@ -133,14 +118,6 @@ static NSUInteger kNumberOfConcurrentDownloads = 5;
                                                         object:[ExfmSession defaultSession]];
 }
 
-- (void)levelWasRemovedFromBrowser:(RKBrowserView *)browserView
-{
-	[super levelWasRemovedFromBrowser:browserView];
-	
-    [mArtworkCache setCountLimit:kLowCacheLimit];
-
-}
-
 #pragma mark -
 
 - (CGFloat)rowHeight
@@ -156,36 +133,6 @@ static NSUInteger kNumberOfConcurrentDownloads = 5;
 	return [[MenuGenerator sharedGenerator] contextualMenuForLibraryItems:items];
 }
 
-- (NSImage *)artworkImageForSong:(Song *)song
-{
-	NSImage *artwork = [mArtworkCache objectForKey:song.universalIdentifier];
-	if(artwork)
-		return artwork;
-	
-	if(![mArtworkBeingDownloaded containsObject:song.universalIdentifier])
-	{
-		[mArtworkDownloadQueue addOperationWithBlock:^{
-			NSURL *remoteArtworkLocation = [song.remoteArtworkLocations objectForKey:@"small"];
-			if(!remoteArtworkLocation)
-				return;
-			
-			NSImage *artworkImage = [[NSImage alloc] initWithContentsOfURL:remoteArtworkLocation];
-			if(artworkImage) //Can be nil.
-			{
-				[mArtworkCache setObject:artworkImage forKey:song.universalIdentifier];
-				[[NSOperationQueue mainQueue] addOperationWithBlock:^{
-					[mArtworkBeingDownloaded removeObject:song.universalIdentifier];
-					
-					[self willChangeValueForKey:@"contents"];
-					[self didChangeValueForKey:@"contents"];
-				}];
-			}
-		}];
-	}
-	
-	return [NSImage imageNamed:@"NoArtwork"];
-}
-
 - (void)levelRowCell:(RKBrowserIconTextFieldCell *)cell willBeDisplayedForItem:(Song *)item atRow:(NSUInteger)index
 {
 	BOOL isSelected = [self.selectedItemIndexes containsIndex:index];
@@ -196,12 +143,19 @@ static NSUInteger kNumberOfConcurrentDownloads = 5;
 	NSAttributedString *displayString = [RKBrowserLevel formatBrowserTextForDisplay:string isSelected:isSelected dividerString:@"\n"];
 	[cell setAttributedStringValue:displayString];
 	
-	NSImage *artworkImage = [self artworkImageForSong:item];
+	NSImage *artworkImage = [self imageAtURL:[item.remoteArtworkLocations objectForKey:@"small"] forItem:item placeholder:[NSImage imageNamed:@"NoArtwork"]];
     [artworkImage setSize:NSMakeSize(32.0, 32.0)];
     [cell setImage:artworkImage];
 	[cell setStylizesImage:YES];
 }
 
+#pragma mark - Callbacks
+
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows
+{
+	[self stopLoadingImagesForItemsNotInArray:[self displayedItemsInRows:[self prefetchRowsForVisibleRows:visibleRows]]];
+}
+
 #pragma mark - Hover Buttons
 
 - (NSImage *)hoverButtonImageForItem:(Song *)item
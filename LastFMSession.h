@@ -62,4 +62,16 @@
 ///
 - (RKURLRequestPromise *)invokeMethodWithName:(NSString *)methodName parameters:(NSDictionary *)parameters HTTPMethod:(NSString *)HTTPMethod RK_REQUIRE_RESULT_USED;
 
+#pragma mark -
+
+///Returns a promise to scrobble a batch of at most 50 songs through a single `track.scrobble` call.
+///
+/// \param songs   The songs to scrobble. The `lastPlayed` date of each song is used as its timestamp. Required.
+///
+/// \result A promise that upon success will yield a dictionary.
+///
+///Last.fm ignores scrobbles that exactly match an existing scrobble's track and
+///timestamp, so it is safe to resubmit a batch whose outcome is unknown.
+- (RKURLRequestPromise *)scrobbleSongs:(NSArray *)songs RK_REQUIRE_RESULT_USED;
+
 @end
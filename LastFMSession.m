@@ -13,6 +13,12 @@
 
 static NSString *const kLastFMAPIURLString = @"http://ws.audioscrobbler.com/2.0/?";
 
+///The defaults key used to point the session at a different API endpoint, such as a local mock server.
+static NSString *const kLastFMAPIURLOverrideDefaultsKey = @"LastFMAPIURLOverride";
+
+///The maximum number of scrobbles accepted by a single `track.scrobble` call.
+static NSUInteger const kLastFMMaximumScrobbleBatchSize = 50;
+
 @implementation LastFMSession {
     NSString *_loginToken;
 }
@@ -80,12 +86,14 @@ static NSString *const kLastFMAPIURLString = @"http://ws.audioscrobbler.com/2.0/
 	allParameters[@"api_sig"] = [self hashStringForParameters:allParameters withSecret:kLastFMSecret];
 	allParameters[@"format"] = @"json";
     
+    NSString *apiURLString = RKGetPersistentObject(kLastFMAPIURLOverrideDefaultsKey) ?: kLastFMAPIURLString;
+    
 	NSMutableURLRequest *request = nil;
 	if([HTTPMethod isEqualToString:@"POST"]) {
-		request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:kLastFMAPIURLString]];
+		request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:apiURLString]];
 		[request setHTTPBody:[RKDictionaryToURLParametersString(allParameters) dataUsingEncoding:NSUTF8StringEncoding]];
 	} else {
-		NSString *baseURLString = [kLastFMAPIURLString stringByAppendingString:RKDictionaryToURLParametersString(allParameters)];
+		NSString *baseURLString = [apiURLString stringByAppendingString:RKDictionaryToURLParametersString(allParameters)];
 		
 		request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:baseURLString]];
 	}
@@ -94,7 +102,7 @@ static NSString *const kLastFMAPIURLString = @"http://ws.audioscrobbler.com/2.0/
     RKURLRequestPromise *requestPromise = [[RKURLRequestPromise alloc] initWithRequest:request
                                                                           cacheManager:nil
                                                                    useCacheWhenOffline:NO
-                                                                          requestQueue:[RKQueueManager commonQueue]];
+                                                                          requestQueue:[RKExecutor commonExecutor]];
     requestPromise.postProcessor = RKPostProcessorBlockChain(kRKJSONPostProcessorBlock, ^RKPossibility *(RKPossibility *maybeData, RKURLRequestPromise *request) {
         return [maybeData refineValue:^RKPossibility *(NSDictionary *response) {
             if(RKFilterOutNSNull(response[@"error"])) {
@@ -160,7 +168,7 @@ static NSString *const kLastFMAPIURLString = @"http://ws.audioscrobbler.com/2.0/
 - (RKPromise *)reloginWithAccount:(Account *)account
 {
     RKPromise *promise = [RKPromise new];
-    [[RKQueueManager commonQueue] addOperationWithBlock:^{
+    [[RKExecutor commonExecutor] addOperationWithBlock:^{
         self.sessionKey = account.token;
         
         NSError *error = nil;
@@ -232,4 +240,31 @@ static NSString *const kLastFMAPIURLString = @"http://ws.audioscrobbler.com/2.0/
                            HTTPMethod:@"POST"];
 }
 
+- (RKURLRequestPromise *)scrobbleSongs:(NSArray *)songs
+{
+    NSParameterAssert(songs);
+    NSParameterAssert([songs count] > 0 && [songs count] <= kLastFMMaximumScrobbleBatchSize);
+    
+    NSAssert(self.isAuthorized, @"Cannot scrobble songs without scrobbler being authorized, sorry.");
+    
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+    [songs enumerateObjectsUsingBlock:^(Song *song, NSUInteger index, BOOL *stop) {
+        parameters[[NSString stringWithFormat:@"track[%lu]", (unsigned long)index]] = song.name;
+        parameters[[NSString stringWithFormat:@"artist[%lu]", (unsigned long)index]] = song.artist;
+        parameters[[NSString stringWithFormat:@"album[%lu]", (unsigned long)index]] = song.album ?: @"";
+        parameters[[NSString stringWithFormat:@"trackNumber[%lu]", (unsigned long)index]] = [NSString stringWithFormat:@"%ld", (long)song.trackNumber];
+        parameters[[NSString stringWithFormat:@"duration[%lu]", (unsigned long)index]] = [NSString stringWithFormat:@"%ld", (long)song.duration];
+        parameters[[NSString stringWithFormat:@"timestamp[%lu]", (unsigned long)index]] = [NSString stringWithFormat:@"%ld", (long)[song.lastPlayed timeIntervalSince1970]];
+    }];
+    
+    return [self invokeMethodWithName:@"track.scrobble"
+                           parameters:parameters
+                           HTTPMethod:@"POST"];
+}
+
+- (NSUInteger)maximumScrobbleBatchSize
+{
+    return kLastFMMaximumScrobbleBatchSize;
+}
+
 @end
@@ -74,6 +74,8 @@ RK_EXTERN NSString *const LibraryDidLoadNotification;
 	NSURL *mCustomITunesFolderWithSecurityScope;
     
 	NSArray/*of Song*/ *mCachedSongs;
+	NSDictionary/*of NSString -> Song*/ *mCachedSongsByUniversalIdentifier;
+	NSDictionary/*of NSString -> Song*/ *mCachedSongsBySourceIdentifier;
 	NSDictionary/*of NSString -> Artist*/ *mCachedArtists;
 	NSArray/*of Playlist*/ *mCachedPlaylists;
 	
@@ -136,6 +138,25 @@ RK_EXTERN NSString *const LibraryDidLoadNotification;
 
 #pragma mark -
 
+///Returns the first song in `.songs` with a given universal identifier, or nil if there is none.
+///
+///Songs are looked up in an index rebuilt each time the library updates.
+- (Song *)songWithUniversalIdentifier:(NSString *)universalIdentifier;
+
+///Returns the songs matching an array of universal identifiers.
+///
+///	\param	universalIdentifiers	The universal identifiers to look up. Required.
+///
+///	\result	An array with the song for each identifier, in the same order, with NSNull in place of identifiers without a song.
+- (NSArray *)songsWithUniversalIdentifiers:(NSArray *)universalIdentifiers;
+
+///Returns the first song in `.songs` with a given source identifier, or nil if there is none.
+///
+///Songs created from local files share a placeholder source identifier, and cannot be found with this method.
+- (Song *)songWithSourceIdentifier:(NSString *)sourceIdentifier;
+
+#pragma mark -
+
 ///All the artists known to the library.
 @property (readonly) NSArray/*of Artist*/ *artists;
 
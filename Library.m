@@ -56,6 +56,9 @@ NSString *const kCompilationArtistMarker = @"\b≪Autogenerated Compilation≫\b
 
 - (void)updateLibraryCaches;
 
+///Schedules `-[self updateLibraryCaches]` on the cache update queue.
+- (void)scheduleLibraryCacheUpdate;
+
 ///Whether or not the library has loaded.
 @property BOOL hasLoaded;
 
@@ -119,10 +122,12 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 		mExternalAlternateSongSourceIdentifiers = [NSMutableDictionary new];
 		
 		mCachedSongs = [NSArray new];
+		mCachedSongsByUniversalIdentifier = [NSDictionary new];
+		mCachedSongsBySourceIdentifier = [NSDictionary new];
 		
 		mCachedPlaylists = [NSArray new];
 		mCacheUpdateQueue = dispatch_queue_create("com.roundabout.pinna.Library.mPlaylistCacheUpdateQueue", NULL);
-		dispatch_async(mCacheUpdateQueue, ^{ [self updateLibraryCaches]; });
+		[self scheduleLibraryCacheUpdate];
 		
 		mCachedArtists = [NSDictionary new];
 		
@@ -206,7 +211,7 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
     
     //We don't wait for the update pulse to tick, the user
     //changed their library so we need to update things now.
-    dispatch_async(mCacheUpdateQueue, ^{ [self updateLibraryCaches]; });
+    [self scheduleLibraryCacheUpdate];
 }
 
 - (NSURL *)iTunesFolderLocation
@@ -349,6 +354,13 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 
 #pragma mark -
 
+- (void)scheduleLibraryCacheUpdate
+{
+	dispatch_async(mCacheUpdateQueue, RKTraceWrapBlock(kRKTraceCategoryQueue, @"com.roundabout.pinna.Library.mCacheUpdateQueue", ^{
+		[self updateLibraryCaches];
+	}));
+}
+
 - (void)updateLibraryCaches
 {
 	NSDictionary *iTunesLibrary = [self iTunesLibraryContents];
@@ -363,7 +375,7 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
         if([self shouldOmitITunesTrack:track])
             return;
         
-        Song *song = [[Song alloc] initWithTrackDictionary:track source:kSongSourceITunes];
+        Song *song = [[Song alloc] initWithTrackDictionary:track source:kSongSourceITunes deferringUniqueIdentifier:YES];
 		if(!song)
 			return;
 		
@@ -371,6 +383,9 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
         
         [iTunesSongMap setObject:song forKey:identifier];
     }];
+    
+	//Identifiers are generated for the whole library at once, before anything reads them.
+	[Song generateUniqueIdentifiersForSongs:[iTunesSongMap allValues]];
 	
 	NSArray *iTunesPlaylists = [iTunesLibrary objectForKey:@"Playlists"];
 	NSArray *cachedPlaylists = RKCollectionMapToArray(iTunesPlaylists, ^id(NSDictionary *playlist) {
@@ -445,7 +460,24 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 	
 	NSArray *allSongs = [iTunesSongs arrayByAddingObjectsFromArray:filteredExFMSongs];
 	NSArray *cachedSongs = [allSongs sortedArrayUsingDescriptors:kSongSortDescriptors];
-	dispatch_async(dispatch_get_main_queue(), ^{
+	
+	//Scripting and URL lookups go through these indexes instead of scanning the songs.
+	//The first song in sorted order wins, matching the linear scans these replace.
+	NSMutableDictionary *songsByUniversalIdentifier = [NSMutableDictionary dictionaryWithCapacity:[cachedSongs count]];
+	NSMutableDictionary *songsBySourceIdentifier = [NSMutableDictionary dictionaryWithCapacity:[cachedSongs count]];
+	for (Song *song in cachedSongs)
+	{
+		NSString *universalIdentifier = song.universalIdentifier;
+		if(universalIdentifier && ![songsByUniversalIdentifier objectForKey:universalIdentifier])
+			[songsByUniversalIdentifier setObject:song forKey:universalIdentifier];
+		
+		NSString *sourceIdentifier = song.sourceIdentifier;
+		if(sourceIdentifier && ![sourceIdentifier isEqualToString:kSongExternalSourceTrackIdentifier] && ![songsBySourceIdentifier objectForKey:sourceIdentifier])
+			[songsBySourceIdentifier setObject:song forKey:sourceIdentifier];
+	}
+	
+	//Publishing the caches triggers a storm of KVO and notification observers, so it's labelled for the stall watchdog.
+	dispatch_async(dispatch_get_main_queue(), RKStallWatchdogWrapBlock(@"Library Update", ^{
 		@synchronized(self)
 		{
 			[self willChangeValueForKey:@"playlists"];
@@ -454,6 +486,8 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 			
 			[self willChangeValueForKey:@"songs"];
 			mCachedSongs = cachedSongs;
+			mCachedSongsByUniversalIdentifier = songsByUniversalIdentifier;
+			mCachedSongsBySourceIdentifier = songsBySourceIdentifier;
 			[self didChangeValueForKey:@"songs"];
 			
 			[self willChangeValueForKey:@"artists"];
@@ -480,7 +514,7 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
             [[NSNotificationCenter defaultCenter] postNotificationName:LibraryDidLoadNotification object:self];
             self.hasLoaded = YES;
         }
-	});
+	}));
 }
 
 #pragma mark - • Responding To Changes
@@ -489,7 +523,7 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 {
 	if(mCacheIsInvalid)
 	{
-		dispatch_async(mCacheUpdateQueue, ^{ [self updateLibraryCaches]; });
+		[self scheduleLibraryCacheUpdate];
 		mCacheIsInvalid = NO;
 	}
 }
@@ -505,7 +539,7 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 {
 	//We don't wait for the next update pulse tick, this
 	//notification comes directly from another part of Pinna.
-	dispatch_async(mCacheUpdateQueue, ^{ [self updateLibraryCaches]; });
+	[self scheduleLibraryCacheUpdate];
 }
 
 #pragma mark - Ex.fm
@@ -630,6 +664,47 @@ NSString *const LibraryDidUpdateNotification = @"LibraryDidUpdateNotification";
 
 #pragma mark -
 
+- (Song *)songWithUniversalIdentifier:(NSString *)universalIdentifier
+{
+	if(!universalIdentifier)
+		return nil;
+	
+	@synchronized(self)
+	{
+		return [mCachedSongsByUniversalIdentifier objectForKey:universalIdentifier];
+	}
+}
+
+- (NSArray *)songsWithUniversalIdentifiers:(NSArray *)universalIdentifiers
+{
+	NSParameterAssert(universalIdentifiers);
+	
+	NSDictionary *songsByUniversalIdentifier = nil;
+	@synchronized(self)
+	{
+		songsByUniversalIdentifier = mCachedSongsByUniversalIdentifier;
+	}
+	
+	NSMutableArray *songs = [NSMutableArray arrayWithCapacity:[universalIdentifiers count]];
+	for (NSString *universalIdentifier in universalIdentifiers)
+		[songs addObject:[songsByUniversalIdentifier objectForKey:universalIdentifier] ?: [NSNull null]];
+	
+	return songs;
+}
+
+- (Song *)songWithSourceIdentifier:(NSString *)sourceIdentifier
+{
+	if(!sourceIdentifier)
+		return nil;
+	
+	@synchronized(self)
+	{
+		return [mCachedSongsBySourceIdentifier objectForKey:sourceIdentifier];
+	}
+}
+
+#pragma mark -
+
 - (NSArray/*of Artist*/ *)artists
 {
 	@synchronized(self)
@@ -59,9 +59,9 @@
 					 @"Could not create lyrics cache directory (%@). Error %@.", lyricsCachePath, [error localizedDescription]);
 		}
 		
-		mCachingQueue = [NSOperationQueue new];
-		[mCachingQueue setName:@"com.roundabout.pinna.LyricsCache.mCachingQueue"];
-		[mCachingQueue setMaxConcurrentOperationCount:1];
+		mCachingQueue = [RKExecutor executorNamed:@"com.roundabout.pinna.LyricsCache.mCachingQueue"
+								 qualityOfService:kRKExecutorQualityOfServiceUtility
+											width:1];
 		[NSApp addImportantQueue:mCachingQueue];
 		
 		mLyricsCache = [NSCache new];
@@ -1331,6 +1331,7 @@ typedef enum {
 	{
 		NSArray *fileURLs = [pasteboard readObjectsForClasses:@[[NSURL class]] options:nil];
 		NSMutableArray *songs = [NSMutableArray array];
+		RKStallWatchdogPushWorkLabel(@"Import Dropped Files");
 		for (NSURL *fileURL in fileURLs)
 		{
 			EnumerateFilesInLocation(fileURL, ^(NSURL *songLocation) {
@@ -1339,6 +1340,7 @@ typedef enum {
 					[songs addObject:song];
 			});
 		}
+		RKStallWatchdogPopWorkLabel();
 		
 		NSUInteger insertionRow = row;
 		for (Song *song in songs)
@@ -78,6 +78,10 @@
 ///Returns the first song matching a given universal identifier.
 - (id <PinnaSong>)songWithUniversalIdentifier:(NSString *)universalIdentifier;
 
+///Returns the songs matching an array of universal identifiers, in the same order.
+///Identifiers without a matching song are represented by null.
+- (NSArray *)songsWithUniversalIdentifiers:(NSArray *)universalIdentifiers;
+
 #pragma mark - Main Window
 
 ///The search string of the main window.
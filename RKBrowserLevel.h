@@ -33,6 +33,9 @@ typedef void(^RKBrowserDropTargetUpdaterBlock)(id targetItem, RKBrowserDropOpera
 	///Backing for `scrollPoint`
 	NSPoint mScrollPoint;
 	
+	///Backing for `scrollVelocity`
+	CGFloat mScrollVelocity;
+	
 	
 	///Backing for `filterPredicate`
 	NSPredicate *mFilterPredicate;
@@ -50,6 +53,9 @@ typedef void(^RKBrowserDropTargetUpdaterBlock)(id targetItem, RKBrowserDropOpera
 	
 	///Storage for `controller`
 	RKBrowserLevelController *mController;
+	
+	///The items whose images are being loaded by `-imageAtURL:forItem:placeholder:`
+	NSMutableSet *mItemsLoadingImages;
 }
 
 + (NSMutableAttributedString *)formatBrowserTextForDisplay:(NSString *)text isSelected:(BOOL)isSelected dividerString:(NSString *)divider;
@@ -86,6 +92,12 @@ typedef void(^RKBrowserDropTargetUpdaterBlock)(id targetItem, RKBrowserDropOpera
 ///The scroll point of the browser level.
 @property (nonatomic) NSPoint scrollPoint;
 
+///The speed at which the user is scrolling the browser level, in rows per second.
+///
+///Positive when scrolling towards the end of the contents, negative when scrolling
+///towards the start, and zero when the user has paused.
+@property (nonatomic, readonly) CGFloat scrollVelocity;
+
 #pragma mark -
 
 ///The filter predicate the browser should apply to
@@ -234,4 +246,51 @@ typedef void(^RKBrowserDropTargetUpdaterBlock)(id targetItem, RKBrowserDropOpera
 ///This method should be used to implement infinite scrolling.
 - (void)levelDidScrollToEndOfContents;
 
+///Invoked when the user has scrolled the receiver's contents.
+///
+/// \param visibleRows The range of rows that are currently visible.
+///
+///This method should be used to prefetch content before the user reaches
+///the end of the contents. It is invoked frequently, and should be cheap.
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows;
+
+#pragma mark - Prefetching
+
+///Returns the rows whose content should be loaded for a specified range of visible rows.
+///
+/// \param visibleRows The range of rows that are currently visible.
+///
+///The returned range contains the visible rows, and extends further in the direction the
+///user is scrolling the faster they scroll, up to four screens ahead. The range may
+///extend past the last row; `-displayedItemsInRows:` clamps it.
+- (NSRange)prefetchRowsForVisibleRows:(NSRange)visibleRows;
+
+///Returns the items displayed in a specified range of rows.
+///
+///This method takes into account any filtering of contents
+///done in the presentation layer of the RKBrowserView apparatus.
+- (NSArray *)displayedItemsInRows:(NSRange)rows;
+
+///Redraws any visible rows displaying one of the specified items.
+///
+///This method should be used to update rows whose content was loaded asynchronously.
+- (void)redisplayRowsForItems:(NSArray *)items;
+
+#pragma mark - Remote Images
+
+///Returns the image at a specified URL to display for an item, loading it if necessary.
+///
+/// \param url          The location of the image. Optional.
+/// \param item         The item the image is displayed for. Required.
+/// \param placeholder  The image to return until the image has loaded, or if there is no URL.
+///
+///The rows displaying the item are redisplayed once the image has loaded.
+- (NSImage *)imageAtURL:(NSURL *)url forItem:(id)item placeholder:(NSImage *)placeholder;
+
+///Stops loading the images of any items that are not in a specified array.
+///
+///Levels should invoke this method with the items of their prefetch rows as the
+///user scrolls. All images stop loading when the level is removed from its browser.
+- (void)stopLoadingImagesForItemsNotInArray:(NSArray *)items;
+
 @end
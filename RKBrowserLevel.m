@@ -182,6 +182,8 @@
 
 - (void)levelWasRemovedFromBrowser:(RKBrowserView *)browserView
 {
+	[self stopLoadingImagesForItemsNotInArray:nil];
+	
 	[self willChangeValueForKey:@"parentBrowser"];
 	mParentBrowser = nil;
 	[self didChangeValueForKey:@"parentBrowser"];
@@ -268,4 +270,86 @@
 	
 }
 
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows
+{
+	
+}
+
+#pragma mark - Prefetching
+
+@synthesize scrollVelocity = mScrollVelocity;
+
+- (NSRange)prefetchRowsForVisibleRows:(NSRange)visibleRows
+{
+	//How far ahead of the user we load, in seconds of scrolling.
+	static CGFloat const kLookaheadInterval = 0.5;
+	
+	NSUInteger screenLength = MAX(visibleRows.length, 1);
+	NSUInteger rowsAhead = MIN(MAX((NSUInteger)(ABS(mScrollVelocity) * kLookaheadInterval), screenLength / 2), screenLength * 4);
+	NSUInteger rowsBehind = screenLength / 2;
+	
+	NSUInteger firstRow, lastRow;
+	if(mScrollVelocity < 0.0)
+	{
+		firstRow = (visibleRows.location > rowsAhead)? visibleRows.location - rowsAhead : 0;
+		lastRow = NSMaxRange(visibleRows) + rowsBehind;
+	}
+	else
+	{
+		firstRow = (visibleRows.location > rowsBehind)? visibleRows.location - rowsBehind : 0;
+		lastRow = NSMaxRange(visibleRows) + rowsAhead;
+	}
+	
+	return NSMakeRange(firstRow, lastRow - firstRow);
+}
+
+- (NSArray *)displayedItemsInRows:(NSRange)rows
+{
+	return [self.controller displayedItemsInRows:rows];
+}
+
+- (void)redisplayRowsForItems:(NSArray *)items
+{
+	[self.controller redisplayRowsForItems:items];
+}
+
+#pragma mark - Remote Images
+
+- (NSImage *)imageAtURL:(NSURL *)url forItem:(id)item placeholder:(NSImage *)placeholder
+{
+	NSParameterAssert(item);
+	
+	if(!url)
+		return placeholder;
+	
+	RKImageLoader *imageLoader = [RKImageLoader sharedImageLoader];
+	NSImage *image = [imageLoader cachedImageAtURL:url];
+	if(image)
+		return image;
+	
+	if(!mItemsLoadingImages)
+		mItemsLoadingImages = [NSMutableSet set];
+	
+	[mItemsLoadingImages addObject:item];
+	[imageLoader loadImageAtURL:url forOwner:item completionHandler:^(NSImage *image) {
+		[mItemsLoadingImages removeObject:item];
+		[self redisplayRowsForItems:@[item]];
+	}];
+	
+	return placeholder;
+}
+
+- (void)stopLoadingImagesForItemsNotInArray:(NSArray *)items
+{
+	NSMutableSet *itemsToStop = [mItemsLoadingImages mutableCopy];
+	if(items)
+		[itemsToStop minusSet:[NSSet setWithArray:items]];
+	
+	RKImageLoader *imageLoader = [RKImageLoader sharedImageLoader];
+	for (id item in itemsToStop)
+		[imageLoader stopLoadingImagesForOwner:item];
+	
+	[mItemsLoadingImages minusSet:itemsToStop];
+}
+
 @end
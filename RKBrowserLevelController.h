@@ -18,6 +18,12 @@
 	IBOutlet RKBrowserTableView *oTableView;
 	
 	IBOutlet NSArrayController *oContentsController;
+	
+	///The first visible row when the table was last scrolled.
+	NSUInteger mLastFirstVisibleRow;
+	
+	///The time the table was last scrolled.
+	NSTimeInterval mLastScrollTime;
 }
 
 ///Initialize the receiver with a specified browser level.
@@ -37,6 +43,14 @@
 ///The level of the controller.
 @property (nonatomic, readonly) RKBrowserLevel *browserLevel;
 
+#pragma mark - Displayed Items
+
+///Returns the items displayed in a specified range of rows, clamped to the displayed items.
+- (NSArray *)displayedItemsInRows:(NSRange)rows;
+
+///Redraws any visible rows displaying one of the specified items.
+- (void)redisplayRowsForItems:(NSArray *)items;
+
 #pragma mark - Visibility
 
 ///Invoked when the receiver is about to become visible in a browser view.
@@ -9,6 +9,7 @@
 #import "RKBrowserLevelController.h"
 #import "RKBrowserView.h"
 #import "RKBrowserLevel.h"
+#import "RKBrowserLevelInternal.h"
 #import "RKBrowserTableView.h"
 #import "RKBrowserScrollView.h"
 
@@ -60,6 +61,13 @@
 											 selector:@selector(browserScrollViewDidScrollToBottom:) 
 												 name:RKBrowserScrollViewDidScrollToBottomNotification 
 											   object:[oTableView enclosingScrollView]];
+	
+	NSClipView *contentView = [[oTableView enclosingScrollView] contentView];
+	[contentView setPostsBoundsChangedNotifications:YES];
+	[[NSNotificationCenter defaultCenter] addObserver:self
+											 selector:@selector(contentViewBoundsDidChange:)
+												 name:NSViewBoundsDidChangeNotification
+											   object:contentView];
 }
 
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
@@ -102,6 +110,33 @@
 @synthesize tableView = oTableView;
 @synthesize browserLevel = mBrowserLevel;
 
+#pragma mark - Displayed Items
+
+- (NSArray *)displayedItemsInRows:(NSRange)rows
+{
+	NSArray *arrangedObjects = [oContentsController arrangedObjects];
+	NSUInteger numberOfItems = [arrangedObjects count];
+	if(rows.location >= numberOfItems)
+		return @[];
+	
+	rows.length = MIN(rows.length, numberOfItems - rows.location);
+	return [arrangedObjects subarrayWithRange:rows];
+}
+
+- (void)redisplayRowsForItems:(NSArray *)items
+{
+	if([items count] == 0)
+		return;
+	
+	NSRange visibleRows = [oTableView rowsInRect:[oTableView visibleRect]];
+	NSArray *visibleItems = [self displayedItemsInRows:visibleRows];
+	NSSet *itemsToRedisplay = [NSSet setWithArray:items];
+	[visibleItems enumerateObjectsUsingBlock:^(id item, NSUInteger index, BOOL *stop) {
+		if([itemsToRedisplay member:item])
+			[oTableView setNeedsDisplayInRect:[oTableView rectOfRow:visibleRows.location + index]];
+	}];
+}
+
 #pragma mark - Visibility
 
 - (void)controllerWillBecomeVisibleInBrowser:(RKBrowserView *)browserView
@@ -137,6 +172,35 @@
 	[mBrowserLevel levelDidScrollToEndOfContents];
 }
 
+- (void)contentViewBoundsDidChange:(NSNotification *)notification
+{
+	//A pause longer than this between scroll events is treated as the user having stopped.
+	static NSTimeInterval const kScrollPauseInterval = 0.25;
+	
+	NSRange visibleRows = [oTableView rowsInRect:[oTableView visibleRect]];
+	if(visibleRows.length == 0)
+		return;
+	
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	NSTimeInterval elapsedTime = now - mLastScrollTime;
+	if(mLastScrollTime > 0.0 && elapsedTime > 0.0 && elapsedTime < kScrollPauseInterval)
+	{
+		CGFloat velocity = ((CGFloat)visibleRows.location - (CGFloat)mLastFirstVisibleRow) / elapsedTime;
+		
+		//Scroll events arrive unevenly, so the velocity is smoothed.
+		mBrowserLevel.scrollVelocity = (mBrowserLevel.scrollVelocity * 0.5) + (velocity * 0.5);
+	}
+	else
+	{
+		mBrowserLevel.scrollVelocity = 0.0;
+	}
+	
+	mLastFirstVisibleRow = visibleRows.location;
+	mLastScrollTime = now;
+	
+	[mBrowserLevel levelDidScrollToVisibleRows:visibleRows];
+}
+
 #pragma mark - Table View Stuff
 
 - (void)tableViewSelectionDidChange:(NSNotification *)notification
@@ -15,6 +15,10 @@
 ///	\see(-[RKBrowserLevel parentBrowser])
 @property (nonatomic, readwrite) RKBrowserView *parentBrowser;
 
+///	\ignore
+///	\see(-[RKBrowserLevel scrollVelocity])
+@property (nonatomic, readwrite) CGFloat scrollVelocity;
+
 #pragma mark -
 
 ///The cached previous browser level.
@@ -82,6 +82,10 @@ RK_EXTERN NSString *const ScriptingControllerPlayingSongDidChangeNotification;
 ///Returns the first song matching a given universal identifier.
 - (Song *)songWithUniversalIdentifier:(NSString *)universalIdentifier;
 
+///Returns the songs matching an array of universal identifiers, in the same order.
+///Identifiers without a matching song are represented by null.
+- (NSArray *)songsWithUniversalIdentifiers:(NSArray *)universalIdentifiers;
+
 #pragma mark - Main Window
 
 ///The search string of the main window.
@@ -104,4 +108,32 @@ RK_EXTERN NSString *const ScriptingControllerPlayingSongDidChangeNotification;
 ///Causes the main window to browse by explore.
 - (void)browseByExplore;
 
+#pragma mark - Tracing
+
+///Whether or not Pinna is recording an execution trace.
+///
+///Tracing can also be enabled for a whole launch with the `TraceExecution` default.
+@property (nonatomic) BOOL tracingEnabled;
+
+///Discards the execution trace recorded so far.
+- (void)resetTrace;
+
+///Writes the execution trace recorded so far to a path in the Chrome trace format,
+///returning whether or not it could be written. Open it in `chrome://tracing`.
+- (BOOL)writeTraceToPath:(NSString *)path;
+
+#pragma mark - Stalls
+
+///Whether or not Pinna is watching the main thread for stalls.
+///
+///Stalls are logged to `~/Library/Logs/Pinna`. The watchdog can also be
+///started for a whole launch with the `WatchForMainThreadStalls` default.
+@property (nonatomic) BOOL watchingForStalls;
+
+///The main thread stalls recorded so far, with the worst offenders first.
+- (NSDictionary *)stallStatistics;
+
+///Discards the main thread stalls recorded so far.
+- (void)resetStallStatistics;
+
 @end
@@ -159,12 +159,15 @@ NSString *const ScriptingControllerPlayingSongDidChangeNotification = @"com.roun
 
 - (Song *)songWithUniversalIdentifier:(NSString *)universalIdentifier
 {
-	if(!universalIdentifier)
+	return [mLibrary songWithUniversalIdentifier:universalIdentifier];
+}
+
+- (NSArray *)songsWithUniversalIdentifiers:(NSArray *)universalIdentifiers
+{
+	if(!universalIdentifiers)
 		return nil;
 	
-	return RKCollectionFindFirstMatch(mLibrary.songs, ^BOOL(Song *song) {
-		return [song.universalIdentifier isEqualToString:universalIdentifier];
-	});
+	return [mLibrary songsWithUniversalIdentifiers:universalIdentifiers];
 }
 
 #pragma mark - Main Window
@@ -206,4 +209,69 @@ NSString *const ScriptingControllerPlayingSongDidChangeNotification = @"com.roun
 	[mMainWindow showExplorePane:nil];
 }
 
+#pragma mark - Tracing
+
+- (void)setTracingEnabled:(BOOL)tracingEnabled
+{
+	RKTraceSetEnabled(tracingEnabled);
+}
+
+- (BOOL)tracingEnabled
+{
+	return RKTraceIsEnabled();
+}
+
+- (void)resetTrace
+{
+	RKTraceReset();
+}
+
+- (BOOL)writeTraceToPath:(NSString *)path
+{
+	NSError *error = nil;
+	if(!RKTraceWriteChromeTrace([NSURL fileURLWithPath:[path stringByExpandingTildeInPath]], &error))
+	{
+		NSLog(@"Could not write trace to %@. %@", path, error);
+		return NO;
+	}
+	
+	return YES;
+}
+
+#pragma mark - Stalls
+
+- (void)setWatchingForStalls:(BOOL)watchingForStalls
+{
+	RKStallWatchdog *watchdog = [RKStallWatchdog sharedWatchdog];
+	if(watchingForStalls)
+	{
+		if(!watchdog.logDirectoryLocation)
+		{
+			NSURL *libraryLocation = [[[NSFileManager defaultManager] URLsForDirectory:NSLibraryDirectory inDomains:NSUserDomainMask] lastObject];
+			watchdog.logDirectoryLocation = [[libraryLocation URLByAppendingPathComponent:@"Logs"] URLByAppendingPathComponent:@"Pinna"];
+		}
+		
+		[watchdog start];
+	}
+	else
+	{
+		[watchdog stop];
+	}
+}
+
+- (BOOL)watchingForStalls
+{
+	return [[RKStallWatchdog sharedWatchdog] isRunning];
+}
+
+- (NSDictionary *)stallStatistics
+{
+	return [[RKStallWatchdog sharedWatchdog] statistics];
+}
+
+- (void)resetStallStatistics
+{
+	[[RKStallWatchdog sharedWatchdog] resetStatistics];
+}
+
 @end
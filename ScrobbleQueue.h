@@ -0,0 +1,69 @@
+//
+//  ScrobbleQueue.h
+//  Pinna
+//
+//  Created by Kevin MacWhinnie on 7/22/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class Song, Account;
+
+///The ScrobbleQueue class encapsulates a durable, per-account journal of scrobbles
+///that have not yet been accepted by their services.
+///
+///Each account's scrobbles are kept in an `RKDurableQueue`, so they are appended to an
+///on-disk journal as soon as they are enqueued, and are only removed from the journal
+///once their service has accepted them. Plays that occur while offline, or while a service
+///is having problems, are submitted in batches of up to the service's
+///`maximumScrobbleBatchSize` when the queue is next flushed. Failed submissions are
+///retried with an exponential backoff.
+///
+///Each scrobble is identified by its song and the time it was played, so enqueuing
+///or submitting the same scrobble more than once is harmless.
+///
+///All methods on ScrobbleQueue must be called from the main thread.
+@interface ScrobbleQueue : NSObject
+
+///Returns the shared scrobble queue, creating it if it does not already exist.
+///
+///The shared queue stores its journals in the application support directory.
++ (ScrobbleQueue *)sharedScrobbleQueue;
+
+///Initialize the receiver with a given journal directory.
+///
+/// \param  directoryPath   The directory to store the receiver's journals in. Created if it does not exist. Required.
+///
+/// \result A fully initialized scrobble queue.
+///
+///This is the designated initializer.
+- (id)initWithDirectoryPath:(NSString *)directoryPath;
+
+#pragma mark - Properties
+
+///The directory the receiver stores its journals in.
+@property (readonly, copy) NSString *directoryPath;
+
+#pragma mark - Scrobbling
+
+///Appends a scrobble for a given song to the journals of a given array of accounts.
+///
+/// \param  song        The song to scrobble. The song's `lastPlayed` date is used as the
+///                     time of the scrobble, so it should not be changed before this method
+///                     returns. Required.
+/// \param  accounts    The accounts to scrobble the song on. Required.
+///
+///This method does not submit the scrobble, call `-[ScrobbleQueue flush]` to do that.
+- (void)enqueueSong:(Song *)song forAccounts:(NSArray *)accounts;
+
+///Submits any pending scrobbles for the accounts currently managed by the AccountManager.
+///
+///This method does nothing for accounts which are in a backoff period after a failed
+///submission, or when there is no internet connection. It is safe to call frequently.
+- (void)flush;
+
+///Returns the number of scrobbles waiting to be submitted for a given account.
+- (NSUInteger)numberOfPendingScrobblesForAccount:(Account *)account;
+
+@end
@@ -0,0 +1,169 @@
+//
+//  ScrobbleQueue.m
+//  Pinna
+//
+//  Created by Kevin MacWhinnie on 7/22/13.
+//  Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "ScrobbleQueue.h"
+
+#import "Song.h"
+#import "Account.h"
+#import "AccountManager.h"
+#import "ServiceDescriptor.h"
+
+#import "PlayerApplication.h"
+
+///Entry keys.
+static NSString *const kEntrySongKey = @"song";
+
+#pragma mark -
+
+@implementation ScrobbleQueue {
+    NSOperationQueue *_ioQueue;
+    NSMutableDictionary *_journals;
+}
+
++ (ScrobbleQueue *)sharedScrobbleQueue
+{
+    static ScrobbleQueue *sharedScrobbleQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *applicationSupportPath = [NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES) lastObject];
+        NSString *directoryPath = [[applicationSupportPath stringByAppendingPathComponent:[[NSBundle mainBundle] bundleIdentifier]] stringByAppendingPathComponent:@"Scrobbles"];
+        sharedScrobbleQueue = [[ScrobbleQueue alloc] initWithDirectoryPath:directoryPath];
+    });
+
+    return sharedScrobbleQueue;
+}
+
+- (id)initWithDirectoryPath:(NSString *)directoryPath
+{
+    NSParameterAssert(directoryPath);
+
+    if((self = [super init])) {
+        _directoryPath = [directoryPath copy];
+
+        NSError *error = nil;
+        if(![[NSFileManager defaultManager] createDirectoryAtPath:_directoryPath withIntermediateDirectories:YES attributes:nil error:&error])
+            NSLog(@"*** Could not create scrobble journal directory %@. %@", _directoryPath, error);
+
+        _ioQueue = [NSOperationQueue new];
+        [_ioQueue setName:@"com.roundabout.pinna.ScrobbleQueue.ioQueue"];
+        [_ioQueue setMaxConcurrentOperationCount:1];
+        [NSApp addImportantQueue:_ioQueue];
+
+        _journals = [NSMutableDictionary dictionary];
+    }
+
+    return self;
+}
+
+#pragma mark - Journals
+
+- (RKDurableQueue *)journalForAccount:(Account *)account
+{
+    NSParameterAssert(account);
+    NSAssert([NSThread isMainThread], @"ScrobbleQueue must only be used from the main thread.");
+
+    NSString *accountKey = [NSString stringWithFormat:@"%@:%@", account.serviceIdentifier, account.username ?: @""];
+    RKDurableQueue *journal = _journals[accountKey];
+    if(!journal) {
+        NSString *journalPath = [_directoryPath stringByAppendingPathComponent:[RKStringGetMD5Hash(accountKey) stringByAppendingPathExtension:@"journal"]];
+        journal = [[RKDurableQueue alloc] initWithPath:journalPath ioQueue:_ioQueue];
+        __weak ScrobbleQueue *weakSelf = self;
+        journal.submitter = ^RKPromise *(NSArray *entries) {
+            return [weakSelf submitEntries:entries forAccount:account];
+        };
+        _journals[accountKey] = journal;
+    }
+
+    //Services without batch support are sent one scrobble at a time.
+    id <Service> service = account.descriptor.service;
+    if([service respondsToSelector:@selector(scrobbleSongs:)] && [service respondsToSelector:@selector(maximumScrobbleBatchSize)])
+        journal.maximumBatchSize = [service maximumScrobbleBatchSize];
+    else
+        journal.maximumBatchSize = 1;
+
+    return journal;
+}
+
+#pragma mark - Scrobbling
+
+- (void)enqueueSong:(Song *)song forAccounts:(NSArray *)accounts
+{
+    NSParameterAssert(song);
+    NSParameterAssert(accounts);
+
+    NSString *identifier = [NSString stringWithFormat:@"%@@%ld", song.uniqueIdentifier, (long)[song.lastPlayed timeIntervalSince1970]];
+    NSDictionary *entry = @{
+        kEntrySongKey: [NSKeyedArchiver archivedDataWithRootObject:song],
+    };
+    for (Account *account in accounts) {
+        if(!account.descriptor.service)
+            continue;
+
+        [[self journalForAccount:account] enqueueEntry:entry withIdentifier:identifier];
+    }
+}
+
+- (void)flush
+{
+    for (Account *account in [AccountManager sharedAccountManager].accounts) {
+        [[self journalForAccount:account] flush];
+    }
+}
+
+- (NSUInteger)numberOfPendingScrobblesForAccount:(Account *)account
+{
+    return [self journalForAccount:account].numberOfPendingEntries;
+}
+
+#pragma mark - Submission
+
+///Returns a promise to submit a batch of journal entries to the service of a given account,
+///or nil if the account's service cannot be reached right now.
+///
+///Entries whose songs can no longer be unarchived are dropped along with the batch.
+- (RKPromise *)submitEntries:(NSArray *)entries forAccount:(Account *)account
+{
+    if(![RKConnectivityManager defaultInternetConnectivityManager].isConnected)
+        return nil;
+
+    id <Service> service = account.descriptor.service;
+    if(!service || ([service respondsToSelector:@selector(isAuthorized)] && ![(id)service isAuthorized]))
+        return nil;
+
+    NSMutableArray *songs = [NSMutableArray array];
+    for (NSDictionary *entry in entries) {
+        Song *song = nil;
+        @try {
+            song = [NSKeyedUnarchiver unarchiveObjectWithData:entry[kEntrySongKey]];
+        }
+        @catch (NSException *exception) {
+            NSLog(@"*** Could not unarchive scrobbled song. %@", exception);
+        }
+
+        if(song)
+            [songs addObject:song];
+    }
+
+    if([songs count] == 0)
+        return [RKPromise acceptedPromiseWithValue:nil];
+
+    RKPromise *submission = nil;
+    if([service respondsToSelector:@selector(scrobbleSongs:)]) {
+        submission = [service scrobbleSongs:songs];
+    } else {
+        Song *song = songs[0];
+        submission = [service scrobbleSong:song duration:song.duration];
+    }
+
+    return [submission map:^id(id response) {
+        NSLog(@"scrobbled %lu songs on %@!", (unsigned long)[songs count], account.serviceIdentifier);
+        return response;
+    }];
+}
+
+@end
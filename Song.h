@@ -73,6 +73,23 @@ typedef NSInteger SongSource;
 ///	\param	source	The source of the track.
 - (id)initWithTrackDictionary:(NSDictionary *)track source:(SongSource)source;
 
+///Initialize the song using the information contained in a track dictionary,
+///optionally leaving its unique identifier to be generated later.
+///
+///	\param	track					A track dictionary loaded from either iTunes or Ex.fm. Required.
+///	\param	source					The source of the track.
+///	\param	deferUniqueIdentifier	Whether to skip generating the unique identifier. When YES, the
+///									song must be passed to `+generateUniqueIdentifiersForSongs:`
+///									before anything else reads it.
+- (id)initWithTrackDictionary:(NSDictionary *)track source:(SongSource)source deferringUniqueIdentifier:(BOOL)deferUniqueIdentifier;
+
+///Generates the unique identifiers of songs created with a deferred identifier in a single batch.
+///
+///	\param	songs	The songs to generate identifiers for. Songs that already have one are left alone. Required.
+///
+///This is faster than generating identifiers one song at a time when loading a whole library.
++ (void)generateUniqueIdentifiersForSongs:(NSArray *)songs;
+
 #pragma mark - Properties
 
 ///The location of the song.
@@ -83,6 +100,8 @@ typedef NSInteger SongSource;
 
 ///Returns the unique identifier of the song.
 ///
+///The identifier is generated when the song is created.
+///
 ///	\see(RKGenerateSongID)
 @property (readonly) NSString *uniqueIdentifier;
 
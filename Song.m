@@ -20,6 +20,12 @@ enum SongArchiveVersion {
 
 static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c70";
 
+///Returns the unique identifier for a song with a given name, artist, and album.
+static NSString *GenerateUniqueIdentifier(NSString *name, NSString *artist, NSString *album)
+{
+	return RKGenerateIdentifierForStrings(@[name ?: @"", artist ?: @"", album ?: @""]);
+}
+
 @implementation Song
 
 #pragma mark Initialization
@@ -63,6 +69,8 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 		mDuration = [(__bridge_transfer NSNumber *)MDItemCopyAttribute(metadata, kMDItemDurationSeconds) doubleValue];
 		
 		mSongSource = kSongSourceLocalFile;
+		
+		mPregeneratedUniqueIdentifier = GenerateUniqueIdentifier(mName, mArtist, mAlbum);
 	}
     
     CFRelease(metadata);
@@ -71,6 +79,11 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 }
 
 - (id)initWithTrackDictionary:(NSDictionary *)track source:(SongSource)source
+{
+	return [self initWithTrackDictionary:track source:source deferringUniqueIdentifier:NO];
+}
+
+- (id)initWithTrackDictionary:(NSDictionary *)track source:(SongSource)source deferringUniqueIdentifier:(BOOL)deferUniqueIdentifier
 {
 	NSParameterAssert(track);
 	
@@ -109,6 +122,9 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 			mHasVideo = [[track objectForKey:@"Has Video"] boolValue];
 			mDisabled = [[track objectForKey:@"Disabled"] boolValue];
 			mIsCompilation = [[track objectForKey:@"Compilation"] boolValue];
+			
+			if(!deferUniqueIdentifier)
+				mPregeneratedUniqueIdentifier = GenerateUniqueIdentifier(mName, mArtist, mAlbum);
 		}
 	}
 	else if(source == kSongSourceExfm)
@@ -156,12 +172,35 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 			mRemoteArtworkLocations = artworkLocations;
 			
 			mSongSource = kSongSourceExfm;
+			
+			if(!deferUniqueIdentifier)
+				mPregeneratedUniqueIdentifier = GenerateUniqueIdentifier(mName, mArtist, mAlbum);
 		}
 	}
 	
 	return self;
 }
 
++ (void)generateUniqueIdentifiersForSongs:(NSArray *)songs
+{
+	NSParameterAssert(songs);
+	
+	NSArray *pendingSongs = [songs filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(Song *song, NSDictionary *bindings) {
+		return (song->mPregeneratedUniqueIdentifier == nil);
+	}]];
+	if([pendingSongs count] == 0)
+		return;
+	
+	NSArray *identifierStrings = RKCollectionMapToArray(pendingSongs, ^id(Song *song) {
+		return @[song->mName ?: @"", song->mArtist ?: @"", song->mAlbum ?: @""];
+	});
+	NSArray *identifiers = RKGenerateIdentifiersForStringArrays(identifierStrings);
+	
+	[pendingSongs enumerateObjectsUsingBlock:^(Song *song, NSUInteger index, BOOL *stop) {
+		song->mPregeneratedUniqueIdentifier = [identifiers objectAtIndex:index];
+	}];
+}
+
 #pragma mark - Property Gunk
 
 @synthesize location = mLocation;
@@ -169,9 +208,7 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 
 - (NSString *)uniqueIdentifier
 {
-	if(!mPregeneratedUniqueIdentifier)
-		mPregeneratedUniqueIdentifier = RKGenerateIdentifierForStrings(@[self.name ?: @"", self.artist ?: @"", self.album ?: @""]);
-	
+	//Generated once by each initializer, as songs are immutable.
 	return mPregeneratedUniqueIdentifier;
 }
 
@@ -322,6 +359,8 @@ static NSString *const kSoundcloudConsumerKey = @"dbd9af04adcb11bf14c5bd9b77e32c
 		mSongSource = [decoder decodeIntegerForKey:@"songSource"];
 		
 		mRemoteArtworkLocations = [decoder decodeObjectForKey:@"remoteArtworkLocations"];
+		
+		mPregeneratedUniqueIdentifier = GenerateUniqueIdentifier(mName, mArtist, mAlbum);
 	}
 	return self;
 }
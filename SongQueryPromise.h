@@ -24,6 +24,8 @@ RK_EXTERN NSString *const SongQueryPromiseSongArtistErrorKey;
 	
 	NSString *mName;
 	NSString *mArtist;
+	
+	RKPromise *mMatch;
 }
 
 ///Initialize the receiver with the external identifier of a song.
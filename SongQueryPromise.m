@@ -110,27 +110,26 @@ NSString *const SongQueryPromiseSongArtistErrorKey = @"SongQueryPromiseSongArtis
 	return newString;
 }
 
-- (void)fire
+///Returns a promise for a song in the library matching the receiver's name and artist.
+- (RKPromise *)localMatch
 {
 	Song *possibleMatch = [[mLibrary.songs filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"name ==[cd] %@ && artist ==[cd] %@", mName, mArtist]] lastObject];
 	if(possibleMatch)
-	{
-        [self accept:possibleMatch];
-		
-		return;
-	}
+		return [RKPromise acceptedPromiseWithValue:possibleMatch];
 	
 	possibleMatch = [[mLibrary.songs filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"name ==[cd] %@ && artist ==[cd] %@", [self sanitizeStringForQuery:mName dropApostrophes:NO], [self sanitizeStringForQuery:mArtist dropApostrophes:NO]]] lastObject];
 	if(possibleMatch)
-	{
-		[self accept:possibleMatch];
-		
-		return;
-	}
+		return [RKPromise acceptedPromiseWithValue:possibleMatch];
 	
+	return [RKPromise rejectedPromiseWithError:[self songNotFoundError]];
+}
+
+///Returns a promise for a song on Exfm matching the receiver's name and artist.
+- (RKPromise *)remoteMatch
+{
 	NSString *query = [NSString stringWithFormat:@"%@ %@", [self sanitizeStringForQuery:mArtist dropApostrophes:YES], [self sanitizeStringForQuery:mName dropApostrophes:YES]];
 	RKPromise *songSearch = [[ExfmSession defaultSession] searchSongsWithQuery:query offset:0];
-	[songSearch then:^(NSDictionary *response) {
+	return [songSearch flatMap:^RKPromise *(NSDictionary *response) {
 		NSArray *songs = [response objectForKey:@"songs"];
 		NSDictionary *songResult = RKCollectionFindFirstMatch(songs, ^BOOL(NSDictionary *songResult) {
 			NSString *title = RKFilterOutNSNull([songResult objectForKey:@"title"]);
@@ -138,23 +137,43 @@ NSString *const SongQueryPromiseSongArtistErrorKey = @"SongQueryPromiseSongArtis
 			return (([title caseInsensitiveCompare:mName] == NSOrderedSame || [[title lowercaseString] hasPrefix:[mName lowercaseString]]) &&
 					([artist caseInsensitiveCompare:mArtist] == NSOrderedSame || [[artist lowercaseString] hasPrefix:[mArtist lowercaseString]]));
 		});
-		if(songResult)
-		{
-			Song *match = [[Song alloc] initWithTrackDictionary:songResult source:kSongSourceExfm];
-			[self accept:match];
-		}
-		else
-		{
-			NSError *error = [NSError errorWithDomain:@"SongQueryPromiseErrorDomain"
-												 code:-9393
-											 userInfo:@{NSLocalizedDescriptionKey: @"Could not find song.",
-                                                        SongQueryPromiseSongNameErrorKey: mName,
-                                                        SongQueryPromiseSongArtistErrorKey: mArtist}];
-			[self reject:error];
-		}
+		if(!songResult)
+			return [RKPromise rejectedPromiseWithError:[self songNotFoundError]];
+		
+		Song *match = [[Song alloc] initWithTrackDictionary:songResult source:kSongSourceExfm];
+		return [RKPromise acceptedPromiseWithValue:match];
+	}];
+}
+
+- (NSError *)songNotFoundError
+{
+	return [NSError errorWithDomain:@"SongQueryPromiseErrorDomain"
+							   code:-9393
+						   userInfo:@{NSLocalizedDescriptionKey: @"Could not find song.",
+									  SongQueryPromiseSongNameErrorKey: mName,
+									  SongQueryPromiseSongArtistErrorKey: mArtist}];
+}
+
+- (void)fire
+{
+	RKPromise *match = [[self localMatch] recover:^RKPromise *(NSError *error) {
+		return [self remoteMatch];
+	}];
+	mMatch = match;
+	[match then:^(Song *song) {
+		[self accept:song];
 	} otherwise:^(NSError *error) {
 		[self reject:error];
-	}];
+	} onQueue:[RKExecutor commonExecutor]];
+}
+
+- (void)cancel:(id)sender
+{
+	//The match is only ever subscribed to by the receiver,
+	//so cancelling it stops any search it is waiting on.
+	[mMatch cancel:sender];
+	
+	[super cancel:sender];
 }
 
 @end
@@ -250,17 +250,39 @@
 	
 	if(self.showsArtwork)
 	{
-		NSImage *artworkImage = nil;
-		if([[self.parentBrowser window] inLiveResize])
+		//Artwork is never read from disk here. Rows whose artwork isn't
+		//in memory yet are redrawn once it has been loaded in the background.
+		NSImage *artworkImage = [[ArtworkCache sharedArtworkCache] cachedArtworkForItem:item size:kArtworkSizeSmall];
+		if(!artworkImage)
+		{
+			if(![[self.parentBrowser window] inLiveResize])
+			{
+				[[ArtworkCache sharedArtworkCache] loadArtworkForItems:@[item] size:kArtworkSizeSmall completionHandler:^(id loadedItem) {
+					[self redisplayRowsForItems:@[loadedItem]];
+				}];
+			}
+			
 			artworkImage = [NSImage imageNamed:@"NoArtwork"];
-		else
-			artworkImage = [[ArtworkCache sharedArtworkCache] artworkForSong:item] ?: [NSImage imageNamed:@"NoArtwork"];
-		[artworkImage setSize:NSMakeSize(32.0, 32.0)];
+			[artworkImage setSize:NSMakeSize(32.0, 32.0)];
+		}
 		[cell setImage:artworkImage];
 		[cell setStylizesImage:YES];
 	}
 }
 
+- (void)levelDidScrollToVisibleRows:(NSRange)visibleRows
+{
+	if(!self.showsArtwork)
+		return;
+	
+	NSArray *songs = [self displayedItemsInRows:[self prefetchRowsForVisibleRows:visibleRows]];
+	[[ArtworkCache sharedArtworkCache] prefetchArtworkForItems:songs size:kArtworkSizeSmall completionHandler:^(id loadedItem) {
+		[self redisplayRowsForItems:@[loadedItem]];
+	}];
+}
+
+#pragma mark -
+
 - (NSImage *)hoverButtonImageForItem:(Song *)item
 {
 	if([mLibrary isSongLovable:item])
@@ -0,0 +1,484 @@
+#!/usr/bin/env python
+#
+#	standin
+#
+#	Created by Kevin MacWhinnie on 7/24/13.
+#	Copyright (c) 2013 Roundabout Software, LLC. All rights reserved.
+#
+"""A local stand-in for the Ex.fm v3 and Last.fm 2.0 endpoints used by Pinna.
+
+The stand-in serves a synthetic catalogue of songs, trending lists, loved
+songs, friend feeds and artwork, and accepts scrobbles, now playing updates
+and loves. Latency, bandwidth, error rates, ETags and paging are configurable
+from the command line, from a JSON scenario file, and at runtime.
+
+    usage: standin.py [--port 8089] [--scenario scenarios/flaky.json]
+                      [--latency MS] [--jitter MS] [--bandwidth BYTES_PER_SEC]
+                      [--error-rate 0.0-1.0] [--no-etags] [--catalogue-size N]
+                      [--artwork-size BYTES] [--seed N]
+
+Endpoints:
+
+    /api/v3/...             Ex.fm. Point the app at it with the `ExfmAPIURLOverride` default.
+    /2.0/                   Last.fm. Point the app at it with the `LastFMAPIURLOverride` default.
+    /artwork/<id>/<size>    Synthetic PNG artwork, linked from the song dictionaries.
+
+    GET  /__stats           Request counts, status counts and bytes sent per route.
+    POST /__config          Merges a JSON object into the running configuration.
+    POST /__reset           Clears the statistics and recorded scrobbles.
+
+Configuration keys (all optional, in scenario files and /__config bodies):
+
+    latency         Mean added latency in milliseconds before the response starts.
+    jitter          Uniform +/- jitter in milliseconds applied to latency.
+    bandwidth       Maximum response bandwidth in bytes per second, 0 for unlimited.
+    error_rate      Probability of answering with a 503 instead of the real response.
+    etags           Whether to emit ETags and answer If-None-Match with 304.
+    page_size       The default page size when a request has no `results` parameter.
+    catalogue_size  The number of songs in the synthetic catalogue.
+    artwork_size    The approximate size in bytes of each artwork image.
+    routes          A dictionary of path prefixes to partial configurations. The longest
+                    matching prefix is merged over the top level configuration.
+"""
+
+from __future__ import print_function
+
+import hashlib
+import json
+import optparse
+import random
+import re
+import struct
+import sys
+import threading
+import time
+import zlib
+
+try:
+    from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+    from SocketServer import ThreadingMixIn
+    from urlparse import urlparse, parse_qs
+    from urllib import unquote
+except ImportError:
+    from http.server import BaseHTTPRequestHandler, HTTPServer
+    from socketserver import ThreadingMixIn
+    from urllib.parse import urlparse, parse_qs, unquote
+
+#The size of the chunks responses are written in when bandwidth is limited.
+CHUNK_SIZE = 4096
+
+DEFAULT_CONFIGURATION = {
+    "latency": 0,
+    "jitter": 0,
+    "bandwidth": 0,
+    "error_rate": 0.0,
+    "etags": True,
+    "page_size": 20,
+    "catalogue_size": 5000,
+    "artwork_size": 64 * 1024,
+    "routes": {},
+}
+
+#Path components that are followed by an identifier, and path components that are never identifiers.
+IDENTIFIED_COMPONENTS = ("search", "tag", "user", "song", "scrobble", "now-playing")
+KEYWORD_COMPONENTS = ("search", "loved", "feed", "love", "unlove")
+
+#The parameters naming each track of a batched Last.fm scrobble.
+SCROBBLE_TRACK_KEY = re.compile(r"^track\[\d+\]$")
+
+TAGS = ["electronic", "indie", "hip-hop", "rock", "pop", "ambient", "jazz", "folk"]
+
+# Configuration
+
+class Configuration(object):
+    """Thread-safe holder for the running configuration."""
+
+    def __init__(self, values):
+        self._lock = threading.Lock()
+        self._values = dict(DEFAULT_CONFIGURATION)
+        self.merge(values)
+
+    def merge(self, values):
+        with self._lock:
+            routes = dict(self._values.get("routes", {}))
+            routes.update(values.get("routes", {}))
+            self._values.update(values)
+            self._values["routes"] = routes
+
+    def for_path(self, path):
+        with self._lock:
+            values = dict(self._values)
+            matches = [prefix for prefix in values["routes"] if path.startswith(prefix)]
+            if matches:
+                values.update(values["routes"][max(matches, key=len)])
+            return values
+
+    def snapshot(self):
+        with self._lock:
+            return json.loads(json.dumps(self._values))
+
+# Statistics
+
+class Statistics(object):
+    """Thread-safe counters for requests served by the stand-in."""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._clear()
+
+    def _clear(self):
+        self.routes = {}
+        self.scrobbles = 0
+        self.started = time.time()
+
+    def reset(self):
+        with self._lock:
+            self._clear()
+
+    def record(self, route, status, bytes_sent):
+        with self._lock:
+            entry = self.routes.setdefault(route, {"count": 0, "bytes": 0, "statuses": {}})
+            entry["count"] += 1
+            entry["bytes"] += bytes_sent
+            entry["statuses"][str(status)] = entry["statuses"].get(str(status), 0) + 1
+
+    def record_scrobbles(self, count):
+        with self._lock:
+            self.scrobbles += count
+
+    def snapshot(self):
+        with self._lock:
+            return {
+                "uptime": time.time() - self.started,
+                "scrobbles": self.scrobbles,
+                "routes": json.loads(json.dumps(self.routes)),
+            }
+
+# Catalogue
+
+class Catalogue(object):
+    """A deterministic synthetic catalogue of Ex.fm style song dictionaries."""
+
+    def __init__(self, seed):
+        self.seed = seed
+        self._artwork = {}
+        self._artwork_lock = threading.Lock()
+
+    def song(self, index, base_url):
+        rng = random.Random(self.seed * 1000003 + index)
+        song_id = "standin%06d" % index
+        artist = "Artist %d" % (index // 12)
+        image = dict((size, "%s/artwork/%d/%s" % (base_url, index // 12, size)) for size in ("small", "medium", "large"))
+        return {
+            "id": song_id,
+            "title": "Song %d" % index,
+            "artist": artist,
+            "album": "Album %d" % (index // 12),
+            "url": "%s/audio/%s.mp3" % (base_url, song_id),
+            "tags": rng.sample(TAGS, 2),
+            "image": image,
+            "loved_count": rng.randint(0, 5000),
+        }
+
+    def songs(self, indexes, base_url):
+        return [self.song(index, base_url) for index in indexes]
+
+    def search(self, query, catalogue_size):
+        #Every query matches a stable, query-dependent slice of the catalogue.
+        digest = int(hashlib.md5(query.encode("utf-8")).hexdigest()[:8], 16)
+        total = 50 + digest % 450
+        start = digest % max(1, catalogue_size - total)
+        return list(range(start, start + total))
+
+    def artwork(self, identifier, size, approximate_size):
+        key = (identifier, size, approximate_size)
+        with self._artwork_lock:
+            if key not in self._artwork:
+                self._artwork[key] = make_png(identifier, approximate_size)
+            return self._artwork[key]
+
+def png_chunk(kind, data):
+    chunk = kind + data
+    return struct.pack(">I", len(data)) + chunk + struct.pack(">I", zlib.crc32(chunk) & 0xffffffff)
+
+def make_png(identifier, approximate_size):
+    """Returns an RGB PNG of roughly the given size whose pixels are incompressible noise."""
+    side = max(1, int((approximate_size / 3.0) ** 0.5))
+    rng = random.Random(int(hashlib.md5(identifier.encode("utf-8")).hexdigest()[:8], 16))
+    rows = []
+    for _ in range(side):
+        rows.append(b"\x00" + bytes(bytearray(rng.getrandbits(8) for _ in range(side * 3))))
+    header = struct.pack(">IIBBBBB", side, side, 8, 2, 0, 0, 0)
+    return (b"\x89PNG\r\n\x1a\n" +
+            png_chunk(b"IHDR", header) +
+            png_chunk(b"IDAT", zlib.compress(b"".join(rows), 1)) +
+            png_chunk(b"IEND", b""))
+
+# Handler
+
+class StandInHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "StandIn/1.0"
+
+    def log_message(self, format, *args):
+        if self.server.verbose:
+            BaseHTTPRequestHandler.log_message(self, format, *args)
+
+    @property
+    def base_url(self):
+        return "http://%s" % (self.headers.get("Host") or "localhost:%d" % self.server.server_port)
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        return self.rfile.read(length) if length else b""
+
+    def parameters(self, body):
+        url = urlparse(self.path)
+        parameters = dict((key, values[-1]) for key, values in parse_qs(url.query).items())
+        content_type = self.headers.get("Content-Type") or ""
+        if body and "json" not in content_type:
+            parameters.update((key, values[-1]) for key, values in parse_qs(body.decode("utf-8")).items())
+        return parameters
+
+    def do_GET(self):
+        self.dispatch("GET")
+
+    def do_POST(self):
+        self.dispatch("POST")
+
+    def do_DELETE(self):
+        self.dispatch("DELETE")
+
+    def dispatch(self, method):
+        body = self.read_body()
+        path = unquote(urlparse(self.path).path)
+
+        if path.startswith("/__"):
+            return self.handle_control(method, path, body)
+
+        configuration = self.server.configuration.for_path(path)
+        delay = configuration["latency"] + random.uniform(-configuration["jitter"], configuration["jitter"])
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        route = self.route_name(method, path)
+        if random.random() < configuration["error_rate"]:
+            return self.respond(route, 503, b'{"status_code": 503, "status_text": "Stand-in injected error"}', "application/json", configuration)
+
+        parameters = self.parameters(body)
+        try:
+            if path.startswith("/api/v3"):
+                status, payload, content_type = self.handle_exfm(method, path[len("/api/v3"):], parameters, configuration)
+            elif path.startswith("/2.0"):
+                status, payload, content_type = self.handle_lastfm(method, parameters, configuration)
+            elif path.startswith("/artwork/"):
+                status, payload, content_type = self.handle_artwork(path, configuration)
+            else:
+                status, payload, content_type = 404, b"Not Found", "text/plain"
+        except Exception as e:
+            status, payload, content_type = 500, str(e).encode("utf-8"), "text/plain"
+
+        self.respond(route, status, payload, content_type, configuration)
+
+    def route_name(self, method, path):
+        components = [component for component in path.split("/") if component]
+        if components[:1] == ["artwork"]:
+            components = ["artwork"]
+        else:
+            #Collapse identifiers so statistics group by endpoint.
+            components = [("*" if index > 0 and components[index - 1] in IDENTIFIED_COMPONENTS and component not in KEYWORD_COMPONENTS else component)
+                          for index, component in enumerate(components)]
+        return "%s /%s" % (method, "/".join(components))
+
+    # Control
+
+    def handle_control(self, method, path, body):
+        configuration = self.server.configuration.for_path(path)
+        configuration.update(latency=0, jitter=0, bandwidth=0)
+        if path == "/__stats":
+            payload = self.server.statistics.snapshot()
+            payload["configuration"] = self.server.configuration.snapshot()
+        elif path == "/__config" and method == "POST":
+            self.server.configuration.merge(json.loads(body.decode("utf-8") or "{}"))
+            payload = self.server.configuration.snapshot()
+        elif path == "/__reset" and method == "POST":
+            self.server.statistics.reset()
+            payload = {"reset": True}
+        else:
+            return self.write_response(404, b"Not Found", "text/plain", {}, configuration)
+        self.write_response(200, json.dumps(payload, indent=2).encode("utf-8"), "application/json", {}, configuration)
+
+    # Ex.fm
+
+    def exfm_response(self, payload=None, status_code=200):
+        response = {"status_code": status_code, "status_text": "OK" if status_code == 200 else "Error"}
+        response.update(payload or {})
+        return 200, json.dumps(response).encode("utf-8"), "application/json"
+
+    def exfm_page(self, indexes, parameters, configuration):
+        start = int(parameters.get("start", 0))
+        results = int(parameters.get("results", configuration["page_size"]))
+        page = indexes[start:start + results]
+        return self.exfm_response({
+            "songs": self.server.catalogue.songs(page, self.base_url),
+            "total": len(indexes),
+            "start": start,
+            "results": len(page),
+        })
+
+    def handle_exfm(self, method, path, parameters, configuration):
+        components = [component for component in path.split("/") if component]
+        catalogue_size = configuration["catalogue_size"]
+        hour = int(time.time() // 3600)
+
+        if method == "GET":
+            if components[:2] == ["song", "search"] and len(components) == 3:
+                return self.exfm_page(self.server.catalogue.search(components[2], catalogue_size), parameters, configuration)
+            if components[:1] == ["trending"]:
+                #Trending rotates hourly, so ETags change on the hour.
+                offset = (hour * 37 + sum(bytearray("/".join(components).encode("utf-8")))) % max(1, catalogue_size - 500)
+                return self.exfm_page(list(range(offset, offset + 500)), parameters, configuration)
+            if components[:1] == ["user"] and len(components) == 3 and components[2] == "loved":
+                offset = sum(bytearray(components[1].encode("utf-8"))) % max(1, catalogue_size - 1000)
+                return self.exfm_page(list(range(offset, offset + 1000)), parameters, configuration)
+            if components[:1] == ["user"] and components[2:] == ["feed", "love"]:
+                indexes = [(hour + index * 7) % catalogue_size for index in range(200)]
+                feed = [{"song": song, "verb": "love", "actor": {"username": "friend%d" % (song_index % 10)}}
+                        for song, song_index in zip(self.server.catalogue.songs(indexes, self.base_url), indexes)]
+                start = int(parameters.get("start", 0))
+                results = int(parameters.get("results", configuration["page_size"]))
+                return self.exfm_response({"activities": feed[start:start + results], "total": len(feed)})
+            if components[:1] == ["song"] and len(components) == 2:
+                index = int(components[1].replace("standin", "") or 0) if components[1].startswith("standin") else 0
+                return self.exfm_response({"song": self.server.catalogue.song(index, self.base_url)})
+            if components[:1] in (["me"], ["user"]):
+                username = components[1] if len(components) > 1 else "standin"
+                return self.exfm_response({"user": {"username": username, "name": username.title()}})
+        elif method == "POST":
+            if components[:1] == ["song"] and components[2:] in (["love"], ["unlove"]):
+                return self.exfm_response({"song": {"id": components[1]}})
+            if components[:1] in (["scrobble"], ["now-playing"]):
+                if components[0] == "scrobble":
+                    self.server.statistics.record_scrobbles(1)
+                return self.exfm_response()
+            if components == ["user"]:
+                return self.exfm_response({"user": {"username": parameters.get("username", "standin")}})
+
+        return self.exfm_response(status_code=404)
+
+    # Last.fm
+
+    def handle_lastfm(self, method, parameters, configuration):
+        method_name = parameters.get("method", "")
+        if method_name == "track.scrobble":
+            # Batches index every parameter, e.g. track[0] and trackNumber[0]; a single scrobble does not.
+            count = len([key for key in parameters if SCROBBLE_TRACK_KEY.match(key)])
+            if count == 0 and "track" in parameters:
+                count = 1
+            self.server.statistics.record_scrobbles(count)
+            payload = {"scrobbles": {"@attr": {"accepted": count, "ignored": 0}}}
+        elif method_name == "track.updateNowPlaying":
+            payload = {"nowplaying": {"track": {"#text": parameters.get("track", "")}}}
+        elif method_name == "auth.getToken":
+            payload = {"token": hashlib.md5(str(time.time()).encode("utf-8")).hexdigest()}
+        elif method_name == "auth.getSession":
+            payload = {"session": {"name": "standin", "key": "standin-session-key", "subscriber": 0}}
+        elif method_name == "user.getInfo":
+            payload = {"user": {"name": "standin", "playcount": str(self.server.statistics.scrobbles)}}
+        elif method_name in ("track.love", "track.unlove"):
+            payload = {}
+        else:
+            payload = {"error": 3, "message": "Invalid Method - No method with that name in this package"}
+        return 200, json.dumps(payload).encode("utf-8"), "application/json"
+
+    # Artwork
+
+    def handle_artwork(self, path, configuration):
+        components = [component for component in path.split("/") if component]
+        if len(components) != 3:
+            return 404, b"Not Found", "text/plain"
+        scale = {"small": 0.25, "medium": 0.5, "large": 1.0}.get(components[2], 1.0)
+        payload = self.server.catalogue.artwork(components[1], components[2], int(configuration["artwork_size"] * scale))
+        return 200, payload, "image/png"
+
+    # Responding
+
+    def respond(self, route, status, payload, content_type, configuration):
+        headers = {}
+        if configuration["etags"] and status == 200:
+            etag = '"%s"' % hashlib.md5(payload).hexdigest()
+            headers["ETag"] = etag
+            if self.headers.get("If-None-Match") == etag:
+                status, payload = 304, b""
+
+        bytes_sent = self.write_response(status, payload, content_type, headers, configuration)
+        self.server.statistics.record(route, status, bytes_sent)
+
+    def write_response(self, status, payload, content_type, headers, configuration):
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(payload)))
+        for key, value in headers.items():
+            self.send_header(key, value)
+        self.end_headers()
+
+        bandwidth = configuration["bandwidth"]
+        if not bandwidth:
+            self.wfile.write(payload)
+            return len(payload)
+
+        started = time.time()
+        for offset in range(0, len(payload), CHUNK_SIZE):
+            chunk = payload[offset:offset + CHUNK_SIZE]
+            self.wfile.write(chunk)
+            self.wfile.flush()
+            expected = (offset + len(chunk)) / float(bandwidth)
+            elapsed = time.time() - started
+            if expected > elapsed:
+                time.sleep(expected - elapsed)
+        return len(payload)
+
+class StandInServer(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+    request_queue_size = 128
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options]")
+    parser.add_option("--port", type="int", default=8089)
+    parser.add_option("--scenario", help="JSON file of configuration values")
+    parser.add_option("--latency", type="float", help="mean added latency in ms")
+    parser.add_option("--jitter", type="float", help="latency jitter in ms")
+    parser.add_option("--bandwidth", type="int", help="bytes per second, 0 for unlimited")
+    parser.add_option("--error-rate", type="float", dest="error_rate")
+    parser.add_option("--no-etags", action="store_false", dest="etags")
+    parser.add_option("--catalogue-size", type="int", dest="catalogue_size")
+    parser.add_option("--artwork-size", type="int", dest="artwork_size")
+    parser.add_option("--seed", type="int", default=1)
+    parser.add_option("--verbose", action="store_true", default=False)
+    options, _ = parser.parse_args()
+
+    values = {}
+    if options.scenario:
+        with open(options.scenario) as scenario:
+            values.update(json.load(scenario))
+    for key in ("latency", "jitter", "bandwidth", "error_rate", "etags", "catalogue_size", "artwork_size"):
+        if getattr(options, key) is not None:
+            values[key] = getattr(options, key)
+
+    server = StandInServer(("127.0.0.1", options.port), StandInHandler)
+    server.configuration = Configuration(values)
+    server.statistics = Statistics()
+    server.catalogue = Catalogue(options.seed)
+    server.verbose = options.verbose
+
+    print("Stand-in listening on http://127.0.0.1:%d" % options.port)
+    print(json.dumps(server.configuration.snapshot(), indent=2))
+    sys.stdout.flush()
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+if __name__ == "__main__":
+    main()
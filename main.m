@@ -28,6 +28,19 @@ int main(int argc, char *argv[])
 			NSLog(@"Could not load UserDefaults.plist");
 			abort();
 		}
+		
+		//Tracing is enabled before anything else runs so the whole launch is recorded.
+		if([[NSUserDefaults standardUserDefaults] boolForKey:@"TraceExecution"])
+			RKTraceSetEnabled(YES);
+		
+		//Breakpoints look like stalls, so the watchdog is never started under the debugger.
+		if([[NSUserDefaults standardUserDefaults] boolForKey:@"WatchForMainThreadStalls"] && !RKProcessIsRunningInDebugger())
+		{
+			NSURL *libraryLocation = [[[NSFileManager defaultManager] URLsForDirectory:NSLibraryDirectory inDomains:NSUserDomainMask] lastObject];
+			RKStallWatchdog *watchdog = [RKStallWatchdog sharedWatchdog];
+			watchdog.logDirectoryLocation = [[libraryLocation URLByAppendingPathComponent:@"Logs"] URLByAppendingPathComponent:@"Pinna"];
+			[watchdog start];
+		}
 	}
 	
 	return NSApplicationMain(argc, (const char **)argv);